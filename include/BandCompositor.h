@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "ScreenRect.h"
+#include "UiProfiler.h"
+
+// Push bands with DMA while the next one is drawn
+#ifndef UI_DMA
+#define UI_DMA 1
+#endif
+
+// Off-screen rendering through full-width sprite bands. A region is drawn
+// band by band into RAM, each band is pushed once through a single address
+// window, and so every pixel crosses the SPI bus exactly once instead of a
+// fillScreen() followed by every element drawn over it. Nothing half-drawn is
+// ever visible.
+//
+// With two bands and DMA the pipeline overlaps: while one band is on the
+// wire the CPU draws the next into the other buffer, so a frame costs about
+// the slower of drawing and transfer rather than their sum. Without DMA, or
+// with only one band allocated, each push blocks.
+//
+// A 320x24 band costs 15KB of heap; the whole screen would need 150KB.
+class BandCompositor {
+public:
+    static constexpr int16_t DEFAULT_BAND_HEIGHT = 24;
+    static constexpr uint8_t MAX_BANDS = 2;
+
+    explicit BandCompositor(TFT_eSPI& tft, int16_t bandHeight = DEFAULT_BAND_HEIGHT);
+    ~BandCompositor();
+
+    // Allocates the bands for the current rotation and sets up DMA; false if
+    // not even one band fits, in which case callers draw straight to the
+    // display
+    bool begin();
+    bool isReady() const { return m_bandCount > 0; }
+    // Both bands allocated and DMA running
+    bool canOverlap() const { return m_bandCount == MAX_BANDS && m_dmaReady; }
+    uint32_t memoryUsage() const;
+
+    // Blocking pushes when false, e.g. to measure what the overlap saves
+    void setOverlap(bool enabled) { m_overlap = enabled; }
+    bool overlapping() const { return m_overlap && canOverlap(); }
+
+    // Renders 'area' through the bands: drawScene(canvas, clip) is called per
+    // band with screen coordinates, clipped to the part of 'area' in that
+    // band. Must run inside startWrite()/endWrite(), with finish() called
+    // before endWrite(). Returns the number of address windows pushed.
+    template <typename Fn>
+    uint16_t render(const ScreenRect& area, Fn drawScene);
+    // Draws 'area' band by band like render() but hands each band to
+    // takeBand(pixels, stride, slice) instead of the display: slice.w pixels
+    // a row in the panel's byte order, rows 'stride' pixels apart
+    template <typename Fn, typename Sink>
+    void capture(const ScreenRect& area, Fn drawScene, Sink takeBand);
+    // Waits for the last band to leave
+    void finish();
+
+private:
+    TFT_eSPI& m_tft;
+    ProfiledSprite m_bandA;
+    ProfiledSprite m_bandB;
+    TFT_eSprite* const m_bands[MAX_BANDS];
+    const int16_t m_bandHeight;
+    int16_t m_bandWidth;
+    uint8_t m_bandCount;
+    uint8_t m_next;
+    bool m_dmaReady;
+    bool m_overlap;
+
+    template <typename Fn>
+    TFT_eSprite& draw(const ScreenRect& slice, Fn drawScene);
+    void push(TFT_eSprite& band, const ScreenRect& slice);
+};
+
+template <typename Fn>
+TFT_eSprite& BandCompositor::draw(const ScreenRect& slice, Fn drawScene) {
+    TFT_eSprite& band = *m_bands[m_next];
+
+    // Shift the datum so screen coordinates land in the band, and clip to
+    // the slice so nothing spills into pixels that won't be pushed
+    band.setViewport(-slice.x, -slice.y, slice.right(), slice.bottom(), true);
+    UI_PROFILE_CLIP(slice);
+    drawScene(static_cast<TFT_eSPI&>(band), slice);
+    band.resetViewport();
+    return band;
+}
+
+template <typename Fn>
+uint16_t BandCompositor::render(const ScreenRect& area, Fn drawScene) {
+    uint16_t windows = 0;
+    for (int16_t top = area.y; top < area.bottom(); top += m_bandHeight) {
+        ScreenRect slice{area.x, top, area.w, (int16_t)min<int>(m_bandHeight, area.bottom() - top)};
+        push(draw(slice, drawScene), slice);
+        windows++;
+    }
+    return windows;
+}
+
+template <typename Fn, typename Sink>
+void BandCompositor::capture(const ScreenRect& area, Fn drawScene, Sink takeBand) {
+    // The band drawn into may still be on its way to the display
+    finish();
+    for (int16_t top = area.y; top < area.bottom(); top += m_bandHeight) {
+        ScreenRect slice{area.x, top, area.w, (int16_t)min<int>(m_bandHeight, area.bottom() - top)};
+        TFT_eSprite& band = draw(slice, drawScene);
+        takeBand(static_cast<const uint16_t*>(band.getPointer()), m_bandWidth, slice);
+    }
+    UI_PROFILE_UNCLIP();
+}
@@ -1,129 +1,244 @@
-#pragma once
-
-#include <Arduino.h>
-#include <SPI.h>
-#include <XPT2046_Touchscreen.h>
-#include <TFT_eSPI.h>
-#include <WiFi.h>
-#include <time.h>
-#include <vector>
-#include "PomodoroManager.h"
-#include "AudioManager.h"
-
-// Touch Screen Pin Definitions
-static constexpr uint8_t PIN_TOUCH_MISO = 39;
-static constexpr uint8_t PIN_TOUCH_MOSI = 32;
-static constexpr uint8_t PIN_TOUCH_SCLK = 25;
-static constexpr uint8_t PIN_TOUCH_CS   = 33;
-static constexpr uint8_t PIN_TOUCH_IRQ  = 36;
-
-// LED Pin Definitions
-static constexpr uint8_t PIN_LED_BLUE  = 17;
-static constexpr uint8_t PIN_LED_RED   = 4;
-static constexpr uint8_t PIN_LED_GREEN = 16;
-
-// UI Constants
-static constexpr uint16_t SLIDER_HEIGHT = 25;
-static constexpr uint16_t SLIDER_WIDTH = 180;
-static constexpr uint16_t SLIDER_X = 70;
-static constexpr uint16_t HEADER_HEIGHT = 30;
-static constexpr uint16_t MARGIN = 10;
-
-// Custom Colors
-static constexpr uint16_t UI_BACKGROUND = TFT_BLACK;
-static constexpr uint16_t UI_ACCENT = TFT_SKYBLUE;
-static constexpr uint16_t UI_SECONDARY = 0x4208;
-static constexpr uint16_t UI_TEXT = TFT_WHITE;
-static constexpr uint16_t UI_SUBTEXT = 0x8C71;
-static constexpr uint16_t SLIDER_BG = 0x2124;
-static constexpr uint16_t TEMP_WARN = TFT_ORANGE;
-static constexpr uint16_t TEMP_CRITICAL = TFT_RED;
-
-class Slider {
-public:
-    Slider(int x, int y, const String& label, uint16_t color = UI_ACCENT);
-    void draw(TFT_eSPI& tft);
-    bool updateValue(int16_t touchX, int16_t touchY);
-    uint8_t getValue() const { return m_value; }
-
-private:
-    const int m_x;
-    const int m_y;
-    uint8_t m_value;
-    const String m_label;
-    const uint16_t m_color;
-};
-
-class CYD {
-public:
-    explicit CYD(AudioManager& audio);
-    
-    // Core functionality
-    void begin();
-    void update();
-    
-    // WiFi management
-    bool connectWiFi(const char* ssid, const char* password, uint32_t timeout = 20000);
-    void disconnectWiFi();
-    bool isWiFiConnected() const;
-    
-    // LED control
-    void setLED(uint8_t r, uint8_t g, uint8_t b);
-    void setLEDColor(uint32_t color);
-    void turnOffLED();
-    
-    // Time management
-    void syncTime();
-    String getCurrentTime() const;
-    String getCurrentDate() const;
-    
-    // UI methods
-    void drawUI();
-
-private:
-    // Hardware components
-    TFT_eSPI m_tft;
-    SPIClass m_touchSPI;
-    XPT2046_Touchscreen m_touchscreen;
-    AudioManager& m_audioManager;
-    
-    // UI components
-    Slider m_brightnessSlider;
-    Slider m_colorTempSlider;
-    PomodoroManager* m_pomodoroManager;
-    
-    // State variables
-    bool m_wifiConnected;
-    bool m_timeInitialized;
-    bool m_inPomodoroMode;
-    float m_currentTemp;
-    
-    // Timing variables
-    unsigned long m_lastTimeUpdate;
-    unsigned long m_lastTempUpdate;
-    
-    // Temperature history
-    std::vector<float> m_temperatureHistory;
-    
-    // Initialization methods
-    void initLEDs();
-    void initDisplay();
-    void initTouch();
-    
-    // UI helper methods
-    void drawHeader();
-    void drawMainMenu();
-    void updateTimeDisplay();
-    void updateTemperatureDisplay();
-    void handleTouch();
-    void getTouchScreenCoordinates(int16_t& x, int16_t& y);
-    
-    // Temperature simulation
-    float getDummyTemperature();
-    
-    // Pomodoro management
-    void togglePomodoroMode();
-    
-    // Light control
-    void sendLightingValues(uint8_t brightness, uint8_t colorTemp);
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <XPT2046_Touchscreen.h>
+#include <TFT_eSPI.h>
+#include <WiFi.h>
+#include <time.h>
+#include "PomodoroManager.h"
+#include "AudioManager.h"
+#include "FlashKVStore.h"
+#include "TemperatureLog.h"
+#include "DamageTracker.h"
+#include "Widget.h"
+#include "BandCompositor.h"
+#include "ScreenCache.h"
+#include "TouchSampler.h"
+#include "TouchFilter.h"
+#include "TouchCalibration.h"
+#include "GestureRecognizer.h"
+#include "GlyphClock.h"
+#include "UiProfiler.h"
+#include "TouchLatency.h"
+#include "TouchTrace.h"
+#include "LvglScreens.h"
+
+// Touch Screen Pin Definitions
+static constexpr uint8_t PIN_TOUCH_MISO = 39;
+static constexpr uint8_t PIN_TOUCH_MOSI = 32;
+static constexpr uint8_t PIN_TOUCH_SCLK = 25;
+static constexpr uint8_t PIN_TOUCH_CS   = 33;
+static constexpr uint8_t PIN_TOUCH_IRQ  = 36;
+
+// LED Pin Definitions
+static constexpr uint8_t PIN_LED_BLUE  = 17;
+static constexpr uint8_t PIN_LED_RED   = 4;
+static constexpr uint8_t PIN_LED_GREEN = 16;
+
+// UI Constants
+static constexpr uint16_t SLIDER_HEIGHT = 25;
+static constexpr uint16_t SLIDER_WIDTH = 180;
+static constexpr uint16_t SLIDER_X = 70;
+static constexpr uint16_t HEADER_HEIGHT = 30;
+static constexpr uint16_t MARGIN = 10;
+
+// Custom Colors
+static constexpr uint16_t UI_BACKGROUND = TFT_BLACK;
+static constexpr uint16_t UI_ACCENT = TFT_SKYBLUE;
+static constexpr uint16_t UI_SECONDARY = 0x4208;
+static constexpr uint16_t UI_TEXT = TFT_WHITE;
+static constexpr uint16_t UI_SUBTEXT = 0x8C71;
+static constexpr uint16_t SLIDER_BG = 0x2124;
+static constexpr uint16_t TEMP_WARN = TFT_ORANGE;
+static constexpr uint16_t TEMP_CRITICAL = TFT_RED;
+
+// Labelled 0-100% slider; touches anywhere on the track set the value
+class Slider : public Widget {
+public:
+    Slider(int x, int y, const String& label, uint16_t color = UI_ACCENT);
+    void draw(TFT_eSPI& tft) override;
+    // Label and empty track are static, fill and value an overlay
+    void drawStatic(TFT_eSPI& tft) override;
+    void drawOverlay(TFT_eSPI& tft) override;
+    // Value under a touch at touchX; true if it changed
+    bool updateValue(int16_t touchX);
+    uint8_t getValue() const { return m_value; }
+    void setValue(uint8_t value);
+
+private:
+    const int m_x;
+    const int m_y;
+    uint8_t m_value;
+    const String m_label;
+    const uint16_t m_color;
+    
+    void drawTrack(TFT_eSPI& tft);
+    void drawFill(TFT_eSPI& tft);
+    static int16_t fillWidth(uint8_t value);
+    static String valueText(uint8_t value);
+    int16_t valueTop() const { return m_y + SLIDER_HEIGHT/2 - 8; }
+};
+
+class CYD {
+public:
+    CYD(AudioManager& audio, FlashKVStore& settings, TemperatureLog& temperatureLog);
+    
+    // Core functionality
+    void begin();
+    void update();
+    
+    // WiFi management
+    bool connectWiFi(const char* ssid, const char* password, uint32_t timeout = 20000);
+    void disconnectWiFi();
+    bool isWiFiConnected() const;
+    bool lastWiFiAttemptFailed();
+    
+    // LED control
+    void setLED(uint8_t r, uint8_t g, uint8_t b);
+    void setLEDColor(uint32_t color);
+    void turnOffLED();
+    
+    // Time management
+    void syncTime();
+    String getCurrentTime() const;
+    String getCurrentDate() const;
+    
+    // UI methods
+    void drawUI();
+    // Time the last switch to or from the Pomodoro screen took to draw, and
+    // how many switches there were
+    uint32_t lastSwitchMicros() const { return m_lastSwitchMicros; }
+    uint32_t switchCount() const { return m_switchCount; }
+    
+    // Persistent settings
+    void loadSettings();
+    
+    // Touch: calibration asks for three targets to be touched, from the
+    // main screen of the hand-drawn UI; false if it can't start
+    bool startTouchCalibration();
+    void setTouchSmoothing(bool enabled);
+    // Touch traces: recording keeps every screen touch handled from here on
+    // in the trace, replaying feeds the trace back in place of the panel at
+    // 'speed' times its pace. Either ends with stopTouchTrace(), a replay
+    // also at its last record.
+    bool startTouchRecording(TouchTrace& trace);
+    bool startTouchReplay(TouchTrace& trace, uint8_t speed);
+    void stopTouchTrace();
+    bool isRecordingTouch() const { return m_touchRecording != nullptr; }
+    bool isReplayingTouch() const { return m_touchReplayer.isActive(); }
+
+private:
+    // Hardware components
+    ProfiledTFT m_tft;
+    BandCompositor m_compositor;
+    ScreenCache m_screenCache;
+#if UI_LVGL
+    LvglPort m_lvgl;
+    LvglMainScreen m_mainScreen;
+#endif
+    SPIClass m_touchSPI;
+    XPT2046_Touchscreen m_touchscreen;
+    TouchSampler m_touchSampler;
+    TouchFilter m_touchFilter;
+    TouchCalibration m_touchCalibration;
+    GestureRecognizer m_gestures;
+    TouchTrace* m_touchRecording;
+    TouchReplayer m_touchReplayer;
+    AudioManager& m_audioManager;
+    FlashKVStore& m_settings;
+    TemperatureLog& m_temperatureLog;
+    
+    // UI components
+    DamageTracker m_damage;
+    WidgetTree m_widgets;
+    Slider m_brightnessSlider;
+    Slider m_colorTempSlider;
+    Button m_pomodoroButton;
+    PomodoroManager* m_pomodoroManager;
+    
+    // State variables
+    bool m_wifiConnected;
+    bool m_timeInitialized;
+    bool m_inPomodoroMode;
+    float m_currentTemp;
+    
+    // Timing variables
+    unsigned long m_lastTimeUpdate;
+    unsigned long m_lastTempUpdate;
+    unsigned long m_lightingChangeTime;
+    bool m_lightingDirty;
+    
+    // Touch state of the last sample handled, and the slider it is dragging
+    bool m_touchHeld;
+    int16_t m_touchX;
+    int16_t m_touchY;
+    Slider* m_dragSlider;
+    bool m_calibrateOnLift;
+    // Target being touched while calibrating, -1 otherwise, and the raw
+    // positions read so far
+    int8_t m_calibrationTarget;
+    TouchPoint m_calibrationRaw[TouchCalibration::POINTS];
+    
+    // Last 24h range, refreshed from the temperature log now and then
+    TemperatureLog::Summary m_temperatureDay;
+    unsigned long m_lastSummaryUpdate;
+    
+    // What the main screen shows; changes to these are drawn as damage
+    String m_shownTime;
+    bool m_shownWiFi;
+    String m_shownTemp;
+    uint16_t m_shownTempColor;
+    String m_shownRange;
+    bool m_frameTimesReported;
+    uint32_t m_lastSwitchMicros;
+    uint32_t m_switchCount;
+    // Header clock ticks are pushed glyph by glyph
+    GlyphAtlas m_headerGlyphs;
+    GlyphClock m_headerClock;
+    
+    // Initialization methods
+    void initLEDs();
+    void initDisplay();
+    void initTouch();
+    
+    // UI helper methods. The draw methods paint the shown state, or some of
+    // its layers (DrawLayers), and may be clipped to a damaged region.
+    void drawMainScene(TFT_eSPI& gfx, const ScreenRect& clip);
+    void drawMainLayers(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers);
+    void drawHeader(TFT_eSPI& gfx, uint8_t layers);
+    void drawTemperature(TFT_eSPI& gfx, uint8_t layers);
+    void flushDamage();
+    void reportFrameTimes();
+    void updateTimeDisplay();
+    void refreshHeaderState();
+    void updateTemperatureDisplay();
+    void handleTouch();
+    void handleGesture(const GestureEvent& event);
+    void updateDragSlider(int16_t screenX);
+    void handleCalibrationTouch(bool pressed, const TouchPoint& raw);
+    void drawCalibrationTarget();
+    void touchToScreen(const TouchPoint& raw, int16_t& x, int16_t& y);
+    // Ends the touch in progress without handling anything for it
+    void dropTouch();
+    
+    // Temperature simulation and history
+    float getDummyTemperature();
+    void sampleTemperature();
+    void refreshTemperatureSummary();
+    
+    // Pomodoro management
+    void togglePomodoroMode();
+    
+    // Light control
+    void sendLightingValues(uint8_t brightness, uint8_t colorTemp);
+    void saveLightingValues();
+    
+#if UI_LVGL
+    // The LVGL screen shows the same state; widgets report back through these
+    void syncMainScreen();
+    static bool readTouch(int16_t& x, int16_t& y, void* context);
+    static void onLightingChanged(uint8_t brightness, uint8_t colorTemp, void* context);
+    static void onPomodoroPressed(void* context);
+#endif
 }; 
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected, same as zlib). Pass the previous result
+// back in as 'crc' to checksum data in pieces.
+inline uint32_t crc32Update(const void* data, size_t length, uint32_t crc = 0) {
+    static const uint32_t NIBBLE_TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = NIBBLE_TABLE[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = NIBBLE_TABLE[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
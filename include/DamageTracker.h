@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "ScreenRect.h"
+#include "BandCompositor.h"
+
+// Log every repainted frame to Serial
+#ifndef UI_DAMAGE_LOG
+#define UI_DAMAGE_LOG 0
+#endif
+
+// Screen regions invalidated since the last frame. State changes add the
+// rectangles that actually look different; overlapping or nearby ones are
+// merged, and flush() repaints just those, all inside one SPI transaction:
+// through a BandCompositor when one is attached, so each pixel is pushed
+// once, or else straight to the display through a clipping viewport.
+//
+// Callers also say which area the old full-element redraw would have
+// covered, so each frame reports the pixels and SPI bytes it saved.
+class DamageTracker {
+public:
+    static constexpr uint8_t MAX_RECTS = 8;
+    // Merging costs at most this many extra pixels; about what a separate
+    // address window (CASET/RASET/RAMWR) costs on the bus
+    static constexpr uint16_t MERGE_SLACK_PIXELS = 64;
+    static constexpr uint8_t WINDOW_OVERHEAD_BYTES = 11;
+
+    struct FrameStats {
+        uint8_t rects;
+        uint16_t windows;         // address windows opened, at least one per rect
+        uint32_t pixels;
+        uint8_t legacyRects;
+        uint32_t legacyPixels;
+        uint32_t micros;          // time spent in flush(), up to the last pixel sent
+
+        uint32_t spiBytes() const { return pixels * 2 + windows * WINDOW_OVERHEAD_BYTES; }
+        uint32_t legacySpiBytes() const { return legacyPixels * 2 + legacyRects * WINDOW_OVERHEAD_BYTES; }
+    };
+
+    struct Stats {
+        uint32_t frames;
+        uint64_t spiBytes;
+        uint64_t legacySpiBytes;
+    };
+
+    DamageTracker();
+
+    // Screen size after rotation; damage is clipped to it
+    void setScreenSize(int16_t width, int16_t height);
+    // Used by flush() while it is ready
+    void setCompositor(BandCompositor* compositor) { m_compositor = compositor; }
+
+    // 'legacy' is what the element's old full redraw covered; it defaults to
+    // the damage itself
+    void add(const ScreenRect& rect);
+    void add(const ScreenRect& rect, const ScreenRect& legacy);
+    void addScreen();
+    bool pending() const { return m_count > 0; }
+    // Drops pending damage, e.g. when another screen takes over the display
+    void clear();
+
+    // Area that changes when 'before' is replaced by 'after', drawn with the
+    // top of the text at y and x anchored per datum (TL, TC or TR). Fonts
+    // have no kerning, so only glyphs from the first difference on are
+    // covered while the text doesn't move.
+    static ScreenRect textChange(TFT_eSPI& tft, const String& before, const String& after,
+                           int16_t x, int16_t y, uint8_t datum, uint8_t font);
+
+    // Calls drawScene(canvas, clip) for every merged rectangle (once per
+    // compositor band) with drawing clipped to 'clip'. The scene draws its
+    // background too, in screen coordinates whatever the canvas.
+    template <typename Fn>
+    void flush(TFT_eSPI& tft, Fn drawScene);
+
+    const FrameStats& lastFrame() const { return m_lastFrame; }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    ScreenRect m_screen;
+    BandCompositor* m_compositor;
+    ScreenRect m_rects[MAX_RECTS];
+    uint8_t m_count;
+    ScreenRect m_legacy[MAX_RECTS];
+    uint8_t m_legacyCount;
+    FrameStats m_lastFrame;
+    Stats m_stats;
+
+    void insert(ScreenRect rect);
+    void addLegacy(const ScreenRect& rect);
+    void finishFrame(uint16_t windows, uint32_t elapsedMicros);
+};
+
+template <typename Fn>
+void DamageTracker::flush(TFT_eSPI& tft, Fn drawScene) {
+    if (m_count == 0) {
+        clear();
+        return;
+    }
+
+    unsigned long start = micros();
+    uint16_t windows = 0;
+
+    // startWrite() keeps CS asserted across all the draw calls below
+    tft.startWrite();
+    for (uint8_t i = 0; i < m_count; i++) {
+        const ScreenRect& rect = m_rects[i];
+        if (m_compositor && m_compositor->isReady()) {
+            windows += m_compositor->render(rect, drawScene);
+            continue;
+        }
+        tft.setViewport(rect.x, rect.y, rect.w, rect.h, false);
+        UI_PROFILE_CLIP(rect);
+        drawScene(tft, rect);
+        tft.resetViewport();
+        windows++;
+    }
+    if (m_compositor) {
+        m_compositor->finish();
+    }
+    tft.endWrite();
+    UI_PROFILE_UNCLIP();
+
+    finishFrame(windows, micros() - start);
+}
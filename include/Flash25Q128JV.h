@@ -1,63 +1,241 @@
-#ifndef FLASH_25Q128JV_H
-#define FLASH_25Q128JV_H
-
-#include <Arduino.h>
-#include <SPI.h>
-
-// Flash memory commands
-#define FLASH_CMD_READ_ID          0x9F
-#define FLASH_CMD_READ_STATUS      0x05
-#define FLASH_CMD_WRITE_ENABLE     0x06
-#define FLASH_CMD_WRITE_DISABLE    0x04
-#define FLASH_CMD_READ_DATA        0x03
-#define FLASH_CMD_PAGE_PROGRAM     0x02
-#define FLASH_CMD_SECTOR_ERASE     0x20
-#define FLASH_CMD_CHIP_ERASE       0xC7
-
-// Flash memory specifications
-#define FLASH_PAGE_SIZE            256
-#define FLASH_SECTOR_SIZE          4096
-#define FLASH_CHIP_SIZE           (16 * 1024 * 1024)  // 16MB (128Mbit)
-
-// Pin definitions from the image
-#define FLASH_CS_PIN              19  // SCS/CMD
-#define FLASH_MOSI_PIN           22   // SWP/SD3
-#define FLASH_MISO_PIN           21   // SHD/SD2
-#define FLASH_SCK_PIN            20   // SCK/CLK
-
-class Flash25Q128JV {
-public:
-    Flash25Q128JV();
-    
-    // Initialization
-    bool begin();
-    
-    // Basic operations
-    uint32_t readID();
-    uint8_t readStatus();
-    bool isBusy();
-    void waitUntilReady();
-    
-    // Read/Write operations
-    bool read(uint32_t address, uint8_t* buffer, uint32_t length);
-    bool write(uint32_t address, const uint8_t* buffer, uint32_t length);
-    bool eraseSector(uint32_t address);
-    bool eraseChip();
-    
-    // Test functions
-    bool performSelfTest();
-    void printFlashInfo();
-
-private:
-    SPIClass* _spi;
-    bool _initialized;
-    
-    void writeEnable();
-    void writeDisable();
-    void select();
-    void deselect();
-    
-    bool writePageInternal(uint32_t address, const uint8_t* buffer, uint32_t length);
-};
-
+#ifndef FLASH_25Q128JV_H
+#define FLASH_25Q128JV_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Flash memory commands
+#define FLASH_CMD_READ_ID          0x9F
+#define FLASH_CMD_READ_STATUS      0x05
+#define FLASH_CMD_WRITE_ENABLE     0x06
+#define FLASH_CMD_WRITE_DISABLE    0x04
+#define FLASH_CMD_READ_DATA        0x03
+#define FLASH_CMD_FAST_READ        0x0B
+#define FLASH_CMD_FAST_READ_DUAL   0x3B
+#define FLASH_CMD_FAST_READ_QUAD   0x6B
+#define FLASH_CMD_READ_STATUS2     0x35
+#define FLASH_CMD_WRITE_STATUS2    0x31
+#define FLASH_CMD_PAGE_PROGRAM     0x02
+#define FLASH_CMD_SECTOR_ERASE     0x20
+#define FLASH_CMD_BLOCK_ERASE_32K  0x52
+#define FLASH_CMD_BLOCK_ERASE_64K  0xD8
+#define FLASH_CMD_CHIP_ERASE       0xC7
+#define FLASH_CMD_SUSPEND          0x75
+#define FLASH_CMD_RESUME           0x7A
+#define FLASH_CMD_WRITE_STATUS     0x01
+#define FLASH_CMD_READ_SFDP        0x5A
+#define FLASH_CMD_ENTER_4BYTE      0xB7
+
+// Flash memory specifications. The storage layouts (FlashLayout.h) are built
+// on these; the driver itself uses the geometry found in the chip's SFDP
+// tables and only falls back to these values for parts without SFDP.
+#define FLASH_PAGE_SIZE            256
+#define FLASH_SECTOR_SIZE          4096
+#define FLASH_BLOCK32_SIZE         (32 * 1024)
+#define FLASH_BLOCK64_SIZE         (64 * 1024)
+#define FLASH_CHIP_SIZE           (16 * 1024 * 1024)  // 16MB (128Mbit)
+
+// JEDEC IDs (manufacturer, memory type, capacity)
+#define FLASH_JEDEC_ID_W25Q128JV_IQ  0xEF4018
+#define FLASH_JEDEC_ID_W25Q128JV_IM  0xEF7018
+
+// Serial Flash Discoverable Parameters (JESD216)
+#define FLASH_SFDP_SIGNATURE       0x50444653  // "SFDP"
+#define FLASH_SFDP_BFPT_ID         0xFF00      // JEDEC Basic Flash Parameter Table
+#define FLASH_SFDP_MAX_DWORDS      20
+
+// Status register bits
+#define FLASH_STATUS_BUSY          0x01
+#define FLASH_STATUS1_QE           0x40  // QE on parts with SFDP QE scheme 2
+#define FLASH_STATUS2_QE           0x02
+#define FLASH_STATUS2_SUS          0x80
+
+// Suspend latency (tSUS): BUSY clears at most this long after 0x75, and a
+// new suspend must not be issued sooner than this after a resume
+#define FLASH_SUSPEND_US           20
+
+// SPI clocks. The ID probe in begin() always runs at the safe init clock,
+// everything after that uses the configurable operating clock.
+#define FLASH_SPI_INIT_CLOCK       1000000
+#define FLASH_SPI_DEFAULT_CLOCK    20000000
+
+// Widest data phase the SPI host can clock. The Arduino SPIClass on the ESP32
+// only drives MOSI/MISO, so dual/quad output reads fall back to Fast Read
+// unless the bus provides setDataLines() (the host simulator does).
+#ifndef FLASH_SPI_DATA_LINES
+#define FLASH_SPI_DATA_LINES       1
+#endif
+
+// Pin definitions from the image
+#define FLASH_CS_PIN              19  // SCS/CMD
+#define FLASH_MOSI_PIN           22   // SWP/SD3
+#define FLASH_MISO_PIN           21   // SHD/SD2
+#define FLASH_SCK_PIN            20   // SCK/CLK
+
+// Typical erase times (W25Q128JV datasheet), used to plan range erases
+#define FLASH_SECTOR_ERASE_MS      45
+#define FLASH_BLOCK32_ERASE_MS     120
+#define FLASH_BLOCK64_ERASE_MS     150
+
+// Outcome of eraseRange()
+struct FlashEraseReport {
+    uint32_t elapsedMs;
+    uint32_t blankCheckMs;
+    uint16_t blocks64;
+    uint16_t blocks32;
+    uint16_t sectors;
+    uint16_t skippedSectors;   // already blank, not erased
+};
+
+struct FlashEraseType {
+    uint32_t size;         // 0 if the slot is unused
+    uint8_t opcode;
+    uint16_t typicalMs;
+};
+
+// Command set and geometry of the attached part, read from its SFDP Basic
+// Flash Parameter Table at begin() or taken from the W25Q128JV datasheet
+// for known parts without one
+struct FlashParameters {
+    uint32_t jedecId;
+    bool fromSfdp;
+    uint8_t sfdpMajor;
+    uint8_t sfdpMinor;
+    uint32_t chipSize;
+    uint16_t pageSize;
+    uint8_t addressBytes;          // 3 or 4
+    bool enter4ByteMode;           // 0xB7 switches the part to 4 byte addresses
+    FlashEraseType erase[4];       // ascending size
+    uint8_t dualReadOpcode;        // 1-1-2 fast read, 0 if unsupported
+    uint8_t dualReadDummy;         // dummy + mode clocks, in bytes
+    uint8_t quadReadOpcode;        // 1-1-4 fast read, 0 if unsupported
+    uint8_t quadReadDummy;
+    uint8_t quadEnable;            // JESD216 QE requirement code (BFPT DWORD 15)
+    bool suspendSupported;
+    uint8_t suspendOpcode;
+    uint8_t resumeOpcode;
+    uint16_t pageProgramUs;
+};
+
+enum FlashReadMode : uint8_t {
+    FLASH_READ_STANDARD,     // 0x03, no dummy cycles, max 50MHz
+    FLASH_READ_FAST,         // 0x0B, 8 dummy clocks
+    FLASH_READ_DUAL_OUTPUT,  // 0x3B, data phase on IO0/IO1
+    FLASH_READ_QUAD_OUTPUT   // 0x6B, data phase on IO0-IO3, needs QE
+};
+
+// Urgent reads suspend a program or sector/block erase in progress instead
+// of waiting for it (up to 150ms for a 64KB block). Chip erase can't be
+// suspended, and bytes the operation is changing read undefined while it
+// is, so reads of those wait like any other.
+enum FlashPriority : uint8_t {
+    FLASH_PRIORITY_NORMAL,
+    FLASH_PRIORITY_URGENT
+};
+
+class Flash25Q128JV {
+public:
+    Flash25Q128JV();
+    
+    // Initialization. Reads the SFDP tables and selects the fastest read
+    // mode the part and the bus support; setReadMode() afterwards overrides.
+    bool begin();
+    const FlashParameters& getParameters() const { return _params; }
+    uint32_t getCapacity() const { return _params.chipSize; }
+    
+    // Basic operations
+    uint32_t readID();
+    uint8_t readStatus();
+    bool isBusy();
+    void waitUntilReady();
+    // True while the operation keeping the chip busy is an erase, which may
+    // also be one another task started and suspended
+    bool isErasing() const { return _pendingOp == OP_ERASE || _pendingOp == OP_CHIP_ERASE; }
+    
+    // Read/Write operations
+    bool read(uint32_t address, uint8_t* buffer, uint32_t length,
+              FlashPriority priority = FLASH_PRIORITY_NORMAL);
+    bool write(uint32_t address, const uint8_t* buffer, uint32_t length);
+    bool eraseSector(uint32_t address);
+    bool eraseChip();
+    
+    // Erases a sector-aligned range with the cheapest mix of 64KB/32KB block
+    // and 4KB sector erases, skipping sectors that are already blank
+    bool eraseRange(uint32_t address, uint32_t length, FlashEraseReport* report = nullptr);
+    bool isBlank(uint32_t address, uint32_t length);
+    
+    // Non-blocking primitives: issue the command and return while the chip
+    // is still busy. Callers poll isBusy() before issuing the next command.
+    // Every call takes the driver lock, so reads from other tasks can be
+    // served while one task waits on these. An operation another task
+    // started is waited for first, except that a page program outside a
+    // running sector/block erase is made right away under an erase suspend
+    // (and has finished when startPageProgram() sets *finished).
+    bool startPageProgram(uint32_t address, const uint8_t* buffer, uint32_t length,
+                          bool* finished = nullptr);
+    bool startSectorErase(uint32_t address);
+    bool startBlockErase(uint32_t address, uint32_t blockSize);
+    bool startChipErase();
+    
+    // Read path configuration
+    bool setReadMode(FlashReadMode mode);
+    FlashReadMode getReadMode() const { return _readMode; }
+    void setClock(uint32_t hz) { _clockHz = hz; }
+    uint32_t getClock() const { return _clockHz; }
+    
+    // Number of program/erase suspensions made for urgent reads, and of
+    // erase suspensions made for page programs
+    uint32_t getSuspendCount() const { return _suspendCount; }
+    
+    // Test functions
+    bool performSelfTest();
+    void printFlashInfo();
+
+private:
+    SPIClass* _spi;
+    bool _initialized;
+    uint32_t _clockHz;
+    FlashReadMode _readMode;
+    FlashParameters _params;
+    
+    // Operation started by a start*() call that may still be running
+    enum PendingOp : uint8_t { OP_NONE, OP_PROGRAM, OP_ERASE, OP_CHIP_ERASE };
+    
+    SemaphoreHandle_t _lock;
+    volatile PendingOp _pendingOp;
+    // Bytes the pending operation changes: suspended, they read undefined
+    uint32_t _pendingAddress;
+    uint32_t _pendingSize;
+    bool _suspended;
+    unsigned long _resumeMicros;
+    uint32_t _suspendCount;
+    
+    void writeEnable();
+    void writeDisable();
+    void select();
+    void deselect();
+    
+    uint8_t readStatus2();
+    bool readSfdp(uint32_t address, uint8_t* buffer, uint32_t length);
+    bool loadSfdpParameters(uint32_t jedecId);
+    bool loadDefaultParameters(uint32_t jedecId);
+    uint8_t putAddress(uint8_t* out, uint32_t address) const;
+    const FlashEraseType* findEraseType(uint32_t size) const;
+    uint16_t eraseTimeMs(uint32_t size) const;
+    bool enableQuadIO();
+    bool suspend();
+    void resume();
+    void waitForOperation(PendingOp pending);
+    bool programPage(uint32_t address, const uint8_t* buffer, uint32_t length, bool& finished);
+    bool programWhileSuspended(uint32_t address, const uint8_t* buffer, uint32_t length, bool& finished);
+    void sendPageProgram(uint32_t address, const uint8_t* buffer, uint32_t length);
+    void readInternal(uint32_t address, uint8_t* buffer, uint32_t length);
+    bool sendErase(uint8_t command, uint32_t address, uint32_t size);
+    void readDataPhase(uint8_t* buffer, uint32_t length, uint8_t lines);
+    
+    bool writePageInternal(uint32_t address, const uint8_t* buffer, uint32_t length);
+};
+
 #endif 
\ No newline at end of file
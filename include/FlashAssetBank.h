@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Flash25Q128JV.h"
+#include "FlashAsyncQueue.h"
+
+// Location of one asset inside the bank
+struct FlashAsset {
+    uint32_t address;   // absolute flash address
+    uint32_t length;
+    uint32_t crc;
+};
+
+// Read-only bank of named assets (sounds, fonts, images) packed into one
+// image by tools/pack_assets.py:
+//
+//   header  magic "YSAB", version, entry count, index CRC, image size
+//   index   entries sorted by name: name[32], offset, length, crc32, flags
+//   data    each asset starts on a 256 byte page boundary
+//
+// begin() loads the index into RAM; lookups are a binary search and reads
+// go straight from flash into the caller's buffer.
+class FlashAssetBank {
+public:
+    static constexpr uint16_t MAX_ASSETS = 64;
+    static constexpr uint8_t MAX_NAME_LENGTH = 31;
+    static constexpr uint16_t HEADER_SIZE = 32;
+    static constexpr uint16_t ENTRY_SIZE = 48;
+
+    FlashAssetBank(Flash25Q128JV& flash, uint32_t baseAddress, uint32_t capacity);
+    
+    bool begin();
+    bool isReady() const { return m_ready; }
+    uint16_t count() const { return m_count; }
+    uint32_t imageSize() const { return m_imageSize; }
+    
+    bool find(const char* name, FlashAsset& asset) const;
+    bool exists(const char* name) const;
+    bool read(const FlashAsset& asset, uint32_t offset, uint8_t* buffer, uint32_t length);
+    bool verify(const FlashAsset& asset);
+    
+    // Streaming install of a packed image. The header page is held back and
+    // programmed last, so an interrupted install leaves no valid bank. With
+    // a queue set, the erases and programs wait their turn behind the other
+    // flash users' requests on its worker.
+    void setQueue(FlashAsyncQueue* queue) { m_queue = queue; }
+    bool matches(const uint8_t* header) const;
+    bool beginInstall(uint32_t imageSize);
+    bool writeInstall(const uint8_t* data, uint32_t length);
+    bool finishInstall();
+    
+    void printInfo() const;
+
+private:
+    struct Entry {
+        char name[MAX_NAME_LENGTH + 1];
+        uint32_t offset;
+        uint32_t length;
+        uint32_t crc;
+    };
+
+    Flash25Q128JV& m_flash;
+    FlashAsyncQueue* m_queue;
+    const uint32_t m_baseAddress;
+    const uint32_t m_capacity;
+    bool m_ready;
+    uint16_t m_count;
+    uint32_t m_imageSize;
+    uint32_t m_indexCrc;
+    Entry* m_entries;
+    
+    // Install state
+    uint8_t* m_headerPage;
+    uint32_t m_installSize;
+    uint32_t m_installPosition;
+
+    int16_t indexOf(const char* name) const;
+    bool program(uint32_t address, const uint8_t* data, uint32_t length);
+};
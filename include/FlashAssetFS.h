@@ -0,0 +1,13 @@
+#pragma once
+
+#include <FS.h>
+#include <FSImpl.h>
+#include "FlashAssetBank.h"
+
+// Read-only fs::FS view of a FlashAssetBank, so code written against the
+// Arduino FS API (the audio library's connecttoFS) can stream assets from
+// the NOR flash. File reads go straight from flash into the caller's buffer.
+class FlashAssetFS : public fs::FS {
+public:
+    explicit FlashAssetFS(FlashAssetBank& bank);
+};
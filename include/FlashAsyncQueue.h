@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "Flash25Q128JV.h"
+
+enum FlashOp : uint8_t {
+    FLASH_OP_READ,
+    FLASH_OP_PROGRAM,
+    FLASH_OP_ERASE_SECTOR,
+    FLASH_OP_ERASE_RANGE,
+    FLASH_OP_ERASE_CHIP
+};
+
+enum FlashRequestState : uint8_t {
+    FLASH_REQ_INVALID,   // unknown or already collected handle
+    FLASH_REQ_QUEUED,
+    FLASH_REQ_RUNNING,
+    FLASH_REQ_DONE,
+    FLASH_REQ_FAILED
+};
+
+// Runs on the flash worker task, keep it short
+typedef void (*FlashCallback)(int32_t handle, bool ok, void* context);
+
+// Request queue in front of Flash25Q128JV. A worker task pinned to core 0
+// executes reads, programs and erases and sleeps through the busy periods,
+// so the UI loop on core 1 never waits on the chip. Other tasks may still
+// use the driver directly: FLASH_PRIORITY_URGENT reads suspend the worker's
+// operation, and a page program outside a running erase goes in under an
+// erase suspend, so neither waits for the erase to finish.
+class FlashAsyncQueue {
+public:
+    static constexpr uint8_t MAX_REQUESTS = 8;
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_PRIORITY = 1;
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    explicit FlashAsyncQueue(Flash25Q128JV& flash);
+    
+    bool begin();
+    
+    // Submission returns a handle, or -1 if the queue is full or the request
+    // is invalid. Buffers must stay valid until the request completes.
+    int32_t submitRead(uint32_t address, uint8_t* buffer, uint32_t length,
+                       FlashCallback callback = nullptr, void* context = nullptr);
+    int32_t submitProgram(uint32_t address, const uint8_t* buffer, uint32_t length,
+                          FlashCallback callback = nullptr, void* context = nullptr);
+    int32_t submitEraseSector(uint32_t address,
+                              FlashCallback callback = nullptr, void* context = nullptr);
+    // Flash25Q128JV::eraseRange() on the worker; the report, if any, is
+    // filled in before the request completes
+    int32_t submitEraseRange(uint32_t address, uint32_t length, FlashEraseReport* report = nullptr,
+                             FlashCallback callback = nullptr, void* context = nullptr);
+    int32_t submitEraseChip(FlashCallback callback = nullptr, void* context = nullptr);
+    
+    // Polling a finished request returns DONE/FAILED once and frees the slot.
+    // A request submitted with a callback can be polled the same way, but
+    // its slot may be reused for a new request once the callback has run.
+    FlashRequestState poll(int32_t handle);
+    FlashRequestState wait(int32_t handle, uint32_t timeoutMs = portMAX_DELAY);
+    
+    // Submit and wait, for callers that need the outcome before going on.
+    // They queue behind earlier requests, waiting for a free slot if need
+    // be, and run on the caller before begin(). Not for use in callbacks.
+    bool program(uint32_t address, const uint8_t* buffer, uint32_t length);
+    bool eraseSector(uint32_t address);
+    bool eraseRange(uint32_t address, uint32_t length, FlashEraseReport* report = nullptr);
+    
+    uint8_t pending() const { return m_pending; }
+
+private:
+    struct Request {
+        FlashOp op;
+        volatile FlashRequestState state;
+        uint8_t generation;
+        uint32_t address;
+        uint8_t* buffer;
+        uint32_t length;
+        FlashEraseReport* report;
+        FlashCallback callback;
+        void* context;
+    };
+
+    Flash25Q128JV& m_flash;
+    Request m_requests[MAX_REQUESTS];
+    QueueHandle_t m_queue;
+    SemaphoreHandle_t m_lock;
+    TaskHandle_t m_task;
+    volatile uint8_t m_pending;
+
+    int32_t submit(FlashOp op, uint32_t address, uint8_t* buffer, uint32_t length,
+                   FlashEraseReport* report, FlashCallback callback, void* context);
+    bool runToCompletion(FlashOp op, uint32_t address, uint8_t* buffer, uint32_t length,
+                         FlashEraseReport* report);
+    Request* lookup(int32_t handle);
+    
+    static void taskEntry(void* param);
+    void run();
+    bool execute(Request& request);
+    void waitWhileBusy(bool longOperation);
+};
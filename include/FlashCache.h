@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Flash25Q128JV.h"
+
+// Write-back cache of whole 4KB sectors in front of Flash25Q128JV.
+//
+// Reads fill a bounded LRU of sectors, so hot regions are served from RAM.
+// Writes land in the cached sector image with the same AND semantics as a
+// page program and only mark pages dirty; flush() then programs every dirty
+// page once, however many small writes hit it. A write to an uncached sector
+// doesn't read it first: the line starts as 0xFF and the flash contents are
+// ANDed in if it is ever read, which gives the same bytes the chip would
+// hold after programming.
+//
+// Nothing reaches the chip until flush(), sync() or an eviction. Not thread
+// safe; use it from one task.
+class FlashCache {
+public:
+    static constexpr uint8_t DEFAULT_SECTORS = 4;   // 16KB of RAM
+    static constexpr uint8_t MAX_SECTORS = 16;
+
+    // Hits and misses count sector lookups, so a read spanning two
+    // sectors counts twice
+    struct Stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t bypassedReads;    // whole-sector misses read straight through
+        uint32_t writes;
+        uint32_t pagePrograms;     // dirty pages written back
+        uint32_t evictions;
+    };
+
+    explicit FlashCache(Flash25Q128JV& flash, uint8_t sectorCount = DEFAULT_SECTORS);
+    ~FlashCache();
+
+    // Allocates the sector buffers; false if there isn't enough heap
+    bool begin();
+    uint32_t memoryUsage() const;
+
+    bool read(uint32_t address, uint8_t* buffer, uint32_t length);
+    bool write(uint32_t address, const uint8_t* buffer, uint32_t length);
+    // Erases through the driver and keeps a cached copy of the sector coherent
+    bool eraseSector(uint32_t address);
+
+    // Programs all dirty pages; the sectors stay cached
+    bool flush();
+    // flush() and drop every line, for when the chip was written around the cache
+    bool sync();
+    // Drops cached sectors in the range without writing them back
+    void invalidate(uint32_t address, uint32_t length);
+
+    uint16_t dirtyPageCount() const;
+    const Stats& stats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+
+private:
+    struct Line {
+        uint32_t address;      // sector base
+        uint32_t lastUse;
+        uint16_t dirtyPages;   // one bit per 256 byte page
+        bool valid;
+        bool filled;           // flash contents merged in, readable
+    };
+
+    Flash25Q128JV& m_flash;
+    const uint8_t m_sectorCount;
+    Line* m_lines;
+    uint8_t* m_data;
+    uint32_t m_useCounter;
+    Stats m_stats;
+
+    uint8_t* lineData(const Line* line) const;
+    Line* lookup(uint32_t sector);
+    Line* allocate(uint32_t sector);
+    bool fill(Line* line);
+    bool writeBack(Line* line);
+    void touch(Line* line) { line->lastUse = ++m_useCounter; }
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Flash25Q128JV.h"
+#include "FlashAsyncQueue.h"
+
+// Append-only key-value log over a ring of flash sectors. An update appends
+// one record (a single page program) instead of erasing; the newest record
+// for a key wins. When the ring is about to run out of erased sectors the
+// oldest sector's live records are copied forward and the sector is erased,
+// so every sector is erased once per lap of the ring.
+//
+// Records never cross a page and carry a CRC, so a record torn by a power
+// cut is skipped on the next mount and the previous value stays visible.
+// Keys are indexed in RAM (open addressing) and lookups never scan flash.
+//
+// With a FlashAsyncQueue the collection's sector erase runs on the flash
+// worker; appends to the active sector go on meanwhile (the driver programs
+// them under an erase suspend), and only reusing the erased sector waits.
+class FlashKVStore {
+public:
+    static constexpr uint8_t MAX_KEY_LENGTH = 15;
+    static constexpr uint16_t MAX_VALUE_LENGTH = 200;
+    static constexpr uint16_t INDEX_CAPACITY = 64;
+    static constexpr uint8_t MAX_SECTORS = 32;
+
+    struct Stats {
+        uint16_t liveKeys;
+        uint16_t liveBytes;
+        uint32_t appendedRecords;
+        uint32_t skippedWrites;     // put() with an unchanged value
+        uint32_t corruptRecords;    // torn records found while mounting
+        uint32_t sectorErases;
+        uint32_t gcRuns;
+        uint32_t maxEraseCount;     // most worn sector in the ring
+    };
+
+    FlashKVStore(Flash25Q128JV& flash, uint32_t baseAddress, uint8_t sectorCount);
+    
+    // Scans the ring and rebuilds the index. Returns false if the flash
+    // is not available; the store then ignores writes.
+    bool begin();
+    bool isReady() const { return m_ready; }
+    bool format();
+    // Used for sector erases from then on
+    void setQueue(FlashAsyncQueue* queue) { m_queue = queue; }
+    
+    bool put(const char* key, const void* value, uint16_t length);
+    // Returns the stored length (which may exceed maxLength), or -1 if missing
+    int32_t get(const char* key, void* value, uint16_t maxLength);
+    bool remove(const char* key);
+    bool contains(const char* key) const;
+    
+    bool putUInt(const char* key, uint32_t value);
+    uint32_t getUInt(const char* key, uint32_t defaultValue);
+    
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct IndexEntry {
+        uint32_t hash;      // 0 marks an empty slot
+        uint32_t address;   // record address, ADDRESS_DELETED for a tombstone
+        uint16_t size;      // aligned record size, for live byte accounting
+        char key[MAX_KEY_LENGTH + 1];
+    };
+
+    static constexpr uint32_t ADDRESS_DELETED = 0xFFFFFFFF;
+
+    Flash25Q128JV& m_flash;
+    FlashAsyncQueue* m_queue;
+    const uint32_t m_baseAddress;
+    const uint8_t m_sectorCount;
+    bool m_ready;
+    
+    // Erase still running on the queue's worker, -1 if none
+    int32_t m_eraseHandle;
+    int8_t m_erasingSector;
+    
+    // Ring state; sequence 0 marks an erased (free) sector
+    uint32_t m_sequence[MAX_SECTORS];
+    uint32_t m_eraseCount[MAX_SECTORS];
+    int8_t m_activeSector;
+    uint32_t m_head;
+    uint32_t m_nextSequence;
+    
+    IndexEntry m_index[INDEX_CAPACITY];
+    Stats m_stats;
+
+    uint32_t sectorAddress(uint8_t sector) const;
+    int8_t sectorOf(uint32_t address) const;
+    uint8_t freeSectorCount() const;
+    int8_t oldestSector() const;
+    
+    bool scanSector(uint8_t sector, uint32_t& end);
+    bool activateSector(uint8_t sector);
+    bool eraseRingSector(uint8_t sector);
+    bool finishErase();
+    bool collect(uint8_t sector);
+    bool reserve(uint16_t size);
+    bool append(uint8_t magic, const char* key, const void* value, uint16_t length, uint32_t& address);
+    bool readRecord(uint32_t address, uint8_t* record, uint16_t& size, bool verify);
+    
+    static uint32_t hashKey(const char* key);
+    int16_t findSlot(const char* key) const;
+    void indexSet(const char* key, uint32_t address, uint16_t size);
+    void indexDelete(const char* key);
+};
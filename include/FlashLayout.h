@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Flash25Q128JV.h"
+
+// Partitioning of the external 16MB NOR. Every region starts on a 64KB
+// block boundary. Sector 0 is left to Flash25Q128JV::performSelfTest().
+
+// Settings key-value log (FlashKVStore)
+static constexpr uint32_t FLASH_SETTINGS_ADDR    = 0x010000;
+static constexpr uint8_t  FLASH_SETTINGS_SECTORS = 8;
+
+// Temperature history ring (TemperatureLog), ~10 days at one sample per 2s
+static constexpr uint32_t FLASH_TEMPLOG_ADDR     = 0x080000;
+static constexpr uint16_t FLASH_TEMPLOG_SECTORS  = 128;
+
+// Packed asset image (FlashAssetBank), built by tools/pack_assets.py
+static constexpr uint32_t FLASH_ASSETS_ADDR      = 0x100000;
+static constexpr uint32_t FLASH_ASSETS_SIZE      = 0x700000;
+
+// Recorded touch trace (TouchTrace), ~110s of touching at 200 samples/s
+static constexpr uint32_t FLASH_TOUCH_TRACE_ADDR = 0x800000;
+static constexpr uint32_t FLASH_TOUCH_TRACE_SIZE = 0x040000;
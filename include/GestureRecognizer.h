@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum GestureType : uint8_t {
+    GESTURE_DOWN,
+    GESTURE_MOVE,           // moved, still within the tap slop or after a long press
+    GESTURE_DRAG,           // moved, once the press has left the tap slop
+    GESTURE_LONG_PRESS,     // held still for LONG_PRESS_MS
+    GESTURE_TAP,            // lifted, neither dragged nor long-pressed
+    GESTURE_SWIPE,          // lifted from a fast, mostly horizontal drag
+    GESTURE_UP
+};
+
+// Positions in screen pixels, velocity in pixels per second over the last
+// few samples. A swipe's direction is the sign of velocityX.
+struct GestureEvent {
+    GestureType type;
+    int16_t x;
+    int16_t y;
+    int16_t startX;
+    int16_t startY;
+    int16_t velocityX;
+    int16_t velocityY;
+    uint32_t micros;
+};
+
+// Turns the filtered touch stream into gestures. Each press yields DOWN,
+// then MOVE or DRAG events as it moves, at most one LONG_PRESS, and on
+// lifting TAP or SWIPE (if either applies) followed by UP, so a consumer
+// still knows what the press grabbed when it learns how it ended. Events
+// wait in a queue until the UI reads them; consecutive moves of the same
+// type are merged into the latest, so a slow frame costs no presses or lifts.
+class GestureRecognizer {
+public:
+    // A power of two
+    static constexpr uint8_t QUEUE_SIZE = 16;
+    // How far a press may wander and still be a tap or long press
+    static constexpr int16_t TAP_SLOP_PX = 8;
+    static constexpr uint32_t LONG_PRESS_MS = 600;
+    static constexpr int16_t SWIPE_MIN_DISTANCE_PX = 60;
+    static constexpr int16_t SWIPE_MIN_SPEED_PX_S = 300;
+    // Velocity is measured over the last VELOCITY_SAMPLES positions
+    static constexpr uint8_t VELOCITY_SAMPLES = 8;
+
+    GestureRecognizer();
+
+    // Feeds one sample: pressed with its screen position, or a release
+    void add(bool pressed, int16_t x, int16_t y, uint32_t micros);
+    // Ends the current press without a TAP or SWIPE, e.g. when the screen
+    // under it goes away; queued events are dropped
+    void cancel();
+
+    // Takes the oldest event; false if there is none
+    bool read(GestureEvent& event);
+    // Events lost to a full queue
+    uint32_t dropped() const { return m_dropped; }
+
+private:
+    static_assert((QUEUE_SIZE & (QUEUE_SIZE - 1)) == 0, "queue indices wrap");
+
+    enum State : uint8_t {
+        STATE_IDLE,
+        STATE_PRESSED,          // within the slop, not long-pressed yet
+        STATE_DRAGGING,
+        STATE_LONG_PRESSED,
+        STATE_CANCELLED         // ignored until the finger lifts
+    };
+
+    State m_state;
+    int16_t m_startX;
+    int16_t m_startY;
+    uint32_t m_startMicros;
+    int16_t m_lastX;
+    int16_t m_lastY;
+    // Recent positions for the velocity, oldest overwritten first
+    int16_t m_historyX[VELOCITY_SAMPLES];
+    int16_t m_historyY[VELOCITY_SAMPLES];
+    uint32_t m_historyMicros[VELOCITY_SAMPLES];
+    uint8_t m_historyNext;
+    uint8_t m_historyCount;
+
+    GestureEvent m_queue[QUEUE_SIZE];
+    uint8_t m_head;
+    uint8_t m_tail;
+    uint32_t m_dropped;
+
+    void addHistory(int16_t x, int16_t y, uint32_t micros);
+    void velocity(int16_t& vx, int16_t& vy) const;
+    void emit(GestureType type, uint32_t micros);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Clock glyphs of one TFT_eSPI font pre-rendered in one colour pair, as
+// RGB565 cells in the panel's byte order. Cells are font height tall,
+// background included, and can be pushed straight to the display without
+// clearing or rendering anything first.
+//
+// Built on first use: font 7 takes about 32KB, font 2 about 3KB.
+class GlyphAtlas {
+public:
+    static constexpr const char* GLYPHS = "0123456789:";
+    static constexpr uint8_t GLYPH_COUNT = 11;
+
+    GlyphAtlas(uint8_t font, uint16_t color, uint16_t background);
+    ~GlyphAtlas();
+
+    // Renders the glyphs once; false if the heap is short, and it isn't
+    // tried again
+    bool build(TFT_eSPI& tft);
+    bool isReady() const { return m_pixels != nullptr; }
+
+    uint8_t font() const { return m_font; }
+    int16_t height() const { return m_height; }
+    // Cell of 'c', width() by height() pixels, row by row; nullptr if 'c'
+    // isn't in the atlas
+    const uint16_t* glyph(char c) const;
+    int16_t width(char c) const;
+    uint32_t memoryUsage() const;
+
+private:
+    const uint8_t m_font;
+    const uint16_t m_color;
+    const uint16_t m_background;
+    uint16_t* m_pixels;
+    bool m_failed;
+    int16_t m_height;
+    uint8_t m_widths[GLYPH_COUNT];
+    uint32_t m_offsets[GLYPH_COUNT];
+
+    int8_t indexOf(char c) const;
+};
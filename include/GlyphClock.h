@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "GlyphAtlas.h"
+#include "DamageTracker.h"
+#include "UiProfiler.h"
+
+// A line of clock text on the display, updated glyph by glyph from an atlas.
+// update() compares the new text with what the screen shows and, where a
+// glyph changed, pushes just the pixels that differ between the old and the
+// new cell: one address window per glyph, nothing rendered, nothing cleared.
+// A seconds tick in font 2 is a few hundred bytes on the bus.
+//
+// Text the atlas can't lay out the same way (another length, other glyphs,
+// a glyph of another width) is left to the caller's normal redraw.
+class GlyphClock {
+public:
+    GlyphClock(GlyphAtlas& atlas, int16_t x, int16_t y, uint8_t datum);
+
+    // The screen was repainted and now shows 'shown' at this position
+    void reset(const String& shown);
+    // The screen no longer shows the clock; update() fails until reset()
+    void invalidate() { m_valid = false; }
+
+    // Pushes the changed glyphs inside the current SPI transaction, if any;
+    // false if the caller has to redraw the text itself
+    bool update(TFT_eSPI& tft, const String& text);
+
+    // Bus cost of the last update()
+    uint32_t lastSpiBytes() const { return m_lastSpiBytes; }
+
+private:
+    GlyphAtlas& m_atlas;
+    const int16_t m_x;
+    const int16_t m_y;
+    const uint8_t m_datum;
+    String m_shown;
+    bool m_valid;
+    uint32_t m_lastSpiBytes;
+
+    bool sameLayout(const String& text) const;
+    uint32_t pushChange(TFT_eSPI& tft, int16_t x, char before, char after);
+};
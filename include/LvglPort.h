@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "BandCompositor.h"
+
+// Build the screens from LVGL widgets (include/lv_conf.h) instead of the
+// hand-drawn scenes; see the esp32dev-lvgl environment
+#ifndef UI_LVGL
+#define UI_LVGL 0
+#endif
+
+#if UI_LVGL
+#include <lvgl.h>
+
+// LVGL display and input drivers for the CYD. LVGL renders invalidated areas
+// into two partial buffers of a tenth of the screen each; the flush callback
+// pushes one with DMA while LVGL renders the next into the other, the same
+// overlap BandCompositor gets for the hand-drawn screens.
+class LvglPort {
+public:
+    static constexpr uint8_t BUFFER_FRACTION = 10;
+
+    // Screen coordinates of the current touch; false while not touched
+    typedef bool (*TouchReader)(int16_t& x, int16_t& y, void* context);
+
+    explicit LvglPort(TFT_eSPI& tft);
+
+    // Initialises LVGL for the display's current rotation; false if the draw
+    // buffers can't be allocated
+    bool begin(TouchReader reader, void* context);
+    // Runs due LVGL timers: input reads, animations and screen refreshes
+    void handle();
+    bool isReady() const { return m_display != nullptr; }
+
+    uint32_t bufferBytes() const { return m_bufferBytes; }
+    // LVGL heap use and fragmentation, plus the draw buffers
+    void printMemoryUsage();
+
+private:
+    TFT_eSPI& m_tft;
+    lv_display_t* m_display;
+    lv_indev_t* m_touch;
+    uint8_t* m_buffers[2];
+    uint32_t m_bufferBytes;
+    bool m_dma;
+    bool m_writing;
+    TouchReader m_touchReader;
+    void* m_touchContext;
+    lv_point_t m_lastPoint;
+
+    static uint32_t tick();
+    static void flush(lv_display_t* display, const lv_area_t* area, uint8_t* pixels);
+    static void readTouch(lv_indev_t* indev, lv_indev_data_t* data);
+};
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+#include "LvglPort.h"
+#include "ScreenRect.h"
+
+#if UI_LVGL
+// LVGL builds of the main and Pomodoro screens. They only hold widgets:
+// CYD and PomodoroManager keep the state, push what changed into them and get
+// user input back through the handlers. Both screens are created once and
+// swapped with lv_screen_load(); LVGL repaints just the invalidated widgets.
+
+class LvglMainScreen {
+public:
+    typedef void (*LightingHandler)(uint8_t brightness, uint8_t colorTemp, void* context);
+    typedef void (*PressHandler)(void* context);
+
+    LvglMainScreen();
+
+    void create(LightingHandler onLighting, PressHandler onPomodoro, void* context);
+    void load();
+
+    // Setters only touch LVGL when the value differs, so callers can push
+    // their whole state every frame
+    void setTime(const String& time);
+    void setWiFi(bool connected);
+    void setTemperature(const String& text, uint16_t color);
+    void setRange(const String& text);
+    void setLighting(uint8_t brightness, uint8_t colorTemp);
+
+private:
+    lv_obj_t* m_screen;
+    lv_obj_t* m_time;
+    lv_obj_t* m_wifi;
+    lv_obj_t* m_temperature;
+    lv_obj_t* m_range;
+    lv_obj_t* m_sliders[2];
+    lv_obj_t* m_sliderValues[2];
+    bool m_wifiShown;
+    uint16_t m_temperatureColor;
+    LightingHandler m_onLighting;
+    PressHandler m_onPomodoro;
+    void* m_context;
+
+    lv_obj_t* createSlider(int16_t y, const char* label, uint16_t color, uint8_t index);
+    static void sliderChanged(lv_event_t* event);
+    static void pomodoroClicked(lv_event_t* event);
+};
+
+class LvglPomodoroScreen {
+public:
+    // 'action' is a PomodoroManager::Action; ACTION_NONE for a touch outside
+    // any button, which still silences the alarm
+    typedef void (*ActionHandler)(uint8_t action, void* context);
+
+    LvglPomodoroScreen();
+
+    void create(ActionHandler onAction, void* context);
+    void load();
+
+    void showSetup(uint16_t workMinutes, uint16_t breakMinutes);
+    // 'progress' in pixels of the 240 pixel bar
+    void showTimer(bool workTime, const String& time, int progress);
+
+private:
+    lv_obj_t* m_screen;
+    lv_obj_t* m_setup;
+    lv_obj_t* m_timer;
+    lv_obj_t* m_workMinutes;
+    lv_obj_t* m_breakMinutes;
+    lv_obj_t* m_session;
+    lv_obj_t* m_time;
+    lv_obj_t* m_progress;
+    int8_t m_shownSession;
+    ActionHandler m_onAction;
+    void* m_context;
+
+    lv_obj_t* createAdjustRow(int16_t y, const char* label, uint8_t lessAction, uint8_t moreAction);
+    void createActionButton(lv_obj_t* parent, const ScreenRect& area, const char* label, uint16_t color,
+                            uint8_t action);
+    static void clicked(lv_event_t* event);
+};
+#endif
@@ -1,53 +1,123 @@
-#pragma once
-
-#include <Arduino.h>
-#include <TFT_eSPI.h>
-#include "AudioManager.h"
-
-class PomodoroManager {
-public:
-    // Constants
-    static constexpr uint16_t BUTTON_HEIGHT = 40;
-    static constexpr uint16_t BUTTON_WIDTH = 60;
-    static constexpr uint16_t TIME_Y = 80;
-    static constexpr uint16_t DEFAULT_WORK_MINUTES = 50;
-    static constexpr uint16_t DEFAULT_BREAK_MINUTES = 10;
-    static constexpr uint16_t ALARM_INTERVAL_MS = 500;
-
-    PomodoroManager(TFT_eSPI& tft, AudioManager& audio);
-    
-    // Core functionality
-    void begin();
-    void update();
-    void handleTouch(int16_t x, int16_t y);
-    
-    // State queries
-    bool isActive() const { return m_isActive; }
-
-private:
-    // References to external components
-    TFT_eSPI& m_tft;
-    AudioManager& m_audio;
-    
-    // Timer settings
-    uint16_t m_workMinutes;
-    uint16_t m_breakMinutes;
-    uint32_t m_currentSeconds;
-    
-    // State flags
-    bool m_isWorkTime;
-    bool m_isRunning;
-    bool m_isActive;
-    bool m_isAlarmSounding;
-    
-    // Timing variables
-    unsigned long m_lastUpdate;
-    unsigned long m_lastAlarmTime;
-
-    // UI helper methods
-    void drawTimeAdjustButtons(int y, const char* label, int minutes);
-    void drawButton(int x, int y, int w, int h, const char* label, uint16_t color);
-    void drawInterface();
-    void drawTimer(bool fullRedraw);
-    String formatTime(int seconds) const;
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "AudioManager.h"
+#include "FlashKVStore.h"
+#include "DamageTracker.h"
+#include "ScreenCache.h"
+#include "GlyphClock.h"
+#include "Widget.h"
+#include "LvglScreens.h"
+
+class PomodoroManager {
+public:
+    // Constants
+    static constexpr uint16_t BUTTON_HEIGHT = 40;
+    static constexpr uint16_t BUTTON_WIDTH = 60;
+    static constexpr uint16_t TIME_Y = 80;
+    static constexpr uint16_t DEFAULT_WORK_MINUTES = 50;
+    static constexpr uint16_t DEFAULT_BREAK_MINUTES = 10;
+    static constexpr uint16_t ALARM_INTERVAL_MS = 500;
+
+    // What a touch asks for, whichever screen build it landed on
+    enum Action : uint8_t {
+        ACTION_NONE,
+        ACTION_EXIT,
+        ACTION_WORK_LESS,
+        ACTION_WORK_MORE,
+        ACTION_BREAK_LESS,
+        ACTION_BREAK_MORE,
+        ACTION_START,
+        ACTION_STOP
+    };
+
+    // Screens are drawn through the shared compositor while it is ready,
+    // their static layers from the shared screen cache
+    PomodoroManager(TFT_eSPI& tft, BandCompositor& compositor, ScreenCache& screenCache, AudioManager& audio,
+                    FlashKVStore& settings);
+    
+    // Core functionality
+    void begin();
+    void update();
+    void handleTouch(int16_t x, int16_t y);
+    // Any action, ACTION_NONE included, first silences a sounding alarm
+    void handleAction(Action action);
+    
+    // State queries
+    bool isActive() const { return m_isActive; }
+    bool isRunning() const { return m_isRunning; }
+
+private:
+    // References to external components
+    TFT_eSPI& m_tft;
+    AudioManager& m_audio;
+    FlashKVStore& m_settings;
+    ScreenCache& m_screenCache;
+    DamageTracker m_damage;
+#if UI_LVGL
+    LvglPomodoroScreen m_screen;
+#endif
+    
+    // Timer settings
+    uint16_t m_workMinutes;
+    uint16_t m_breakMinutes;
+    uint32_t m_currentSeconds;
+    
+    // State flags
+    bool m_isWorkTime;
+    bool m_isRunning;
+    bool m_isActive;
+    bool m_isAlarmSounding;
+    
+    // Timing variables
+    unsigned long m_lastUpdate;
+    unsigned long m_lastAlarmTime;
+    
+    // Setup and timer screens, each with its own hit-test index. Button
+    // tags are the Action they stand for.
+    WidgetTree m_setupWidgets;
+    Label m_setupTitle;
+    Label m_workTitle;
+    Button m_workLess;
+    Label m_workLabel;
+    Button m_workMore;
+    Label m_breakTitle;
+    Button m_breakLess;
+    Label m_breakLabel;
+    Button m_breakMore;
+    Button m_startButton;
+    Button m_exitButton;
+    WidgetTree m_timerWidgets;
+    Label m_sessionTitle;
+    Button m_stopButton;
+    ProgressBar m_progressBar;
+    
+    // What the countdown shows, to repaint only what changed
+    String m_shownTime;
+    // Countdown ticks are pushed glyph by glyph
+    GlyphAtlas m_timeGlyphs;
+    GlyphClock m_timeClock;
+
+    // UI helper methods. The draw methods paint the current screen, or some
+    // of its layers (DrawLayers), and may be clipped to a damaged region.
+    void drawScene(TFT_eSPI& gfx, const ScreenRect& clip);
+    void drawLayers(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers);
+    void drawTimerScene(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers);
+    void captureScreen();
+    ScreenCache::Screen currentScreen() const {
+        return m_isRunning ? ScreenCache::SCREEN_POMODORO_TIMER : ScreenCache::SCREEN_POMODORO_SETUP;
+    }
+    void drawInterface();
+    void drawTimer(bool fullRedraw);
+    void showMinutes(Label& label, uint16_t minutes);
+    WidgetTree& activeWidgets() { return m_isRunning ? m_timerWidgets : m_setupWidgets; }
+    void flushDamage();
+    Action actionAt(int16_t x, int16_t y);
+#if UI_LVGL
+    static void onScreenAction(uint8_t action, void* context);
+#endif
+    int progressWidth() const;
+    String formatTime(int seconds) const;
+    void saveDurations();
 }; 
\ No newline at end of file
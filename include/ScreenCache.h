@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "BandCompositor.h"
+
+// Static layers of whole screens (backgrounds, captions, buttons and
+// tracks that never change), rendered once through the band compositor and
+// kept run-length encoded in RAM. Screens then repaint any region by
+// decoding the cached rows into the band, instead of clearing it and
+// drawing every element again, and draw only their dynamic elements on
+// top: a screen switch streams the whole cached screen through the bands
+// with just the overlays drawn, each pixel still sent once.
+//
+// Runs are 16-bit words in the panel's byte order and never cross a row,
+// so any row can be decoded on its own. A header with the top bit clear
+// repeats the next word that many times; with it set, that many pixels
+// follow verbatim. The flat screens here take a few KB each.
+class ScreenCache {
+public:
+    enum Screen : uint8_t {
+        SCREEN_MAIN,
+        SCREEN_POMODORO_SETUP,
+        SCREEN_POMODORO_TIMER,
+        SCREEN_COUNT
+    };
+
+    // Heap all cached screens may take together, row index included
+    static constexpr uint32_t MAX_BYTES = 48 * 1024;
+    static constexpr int16_t MAX_WIDTH = 320;
+
+    ScreenCache(TFT_eSPI& tft, BandCompositor& compositor);
+    ~ScreenCache();
+
+    bool has(Screen screen) const { return m_entries[screen].runs != nullptr; }
+    // Renders drawLayer(canvas, clip) over the whole screen, once, and
+    // keeps it. False without a ready compositor, or if the runs don't fit
+    // the budget, in which case it isn't tried again.
+    template <typename Fn>
+    bool capture(Screen screen, Fn drawLayer);
+    // Copies the cached pixels under 'clip' into the canvas, in screen
+    // coordinates like the scenes draw; false if the screen isn't cached
+    bool draw(Screen screen, TFT_eSPI& gfx, const ScreenRect& clip) const;
+    uint32_t memoryUsage() const;
+
+private:
+    static constexpr uint16_t LITERAL = 0x8000;
+    static constexpr uint16_t MAX_RUN = 0x7FFF;
+    // Shorter repeats stay in the literal around them
+    static constexpr uint16_t MIN_REPEAT = 3;
+    // Row offsets are 16-bit
+    static_assert(MAX_BYTES / 2 <= 0xFFFF, "run offsets must fit 16 bits");
+
+    struct Entry {
+        uint16_t* rows;      // offset of each row's first run
+        uint16_t* runs;
+        uint32_t bytes;      // rows and runs, one allocation
+        bool failed;
+    };
+
+    // Encodes pixels into runs, or with no output just counts the words
+    class Encoder {
+    public:
+        Encoder(uint16_t* rows, uint16_t* runs);
+        void addBand(const uint16_t* pixels, int16_t stride, const ScreenRect& slice);
+        uint32_t words() const { return m_words; }
+
+    private:
+        uint16_t* const m_rows;
+        uint16_t* const m_runs;
+        uint32_t m_words;
+        uint16_t m_repeatColor;
+        uint16_t m_repeatLength;
+        uint32_t m_literalHeader;
+        uint16_t m_literalLength;
+
+        void add(uint16_t pixel);
+        void endRow();
+        void endRepeat();
+        void addLiteral(uint16_t pixel);
+        void endLiteral();
+        void emit(uint16_t word);
+    };
+
+    TFT_eSPI& m_tft;
+    BandCompositor& m_compositor;
+    Entry m_entries[SCREEN_COUNT];
+};
+
+template <typename Fn>
+bool ScreenCache::capture(Screen screen, Fn drawLayer) {
+    Entry& entry = m_entries[screen];
+    if (entry.runs || entry.failed) return has(screen);
+    if (!m_compositor.isReady() || m_tft.width() > MAX_WIDTH) return false;
+
+    // The layer is drawn twice: once to size the runs, once to fill them,
+    // so nothing bigger than the result is ever allocated
+    ScreenRect area{0, 0, (int16_t)m_tft.width(), (int16_t)m_tft.height()};
+    Encoder counter(nullptr, nullptr);
+    m_compositor.capture(area, drawLayer, [&](const uint16_t* pixels, int16_t stride, const ScreenRect& slice) {
+        counter.addBand(pixels, stride, slice);
+    });
+
+    uint32_t bytes = (area.h + counter.words()) * sizeof(uint16_t);
+    uint16_t* block = memoryUsage() + bytes <= MAX_BYTES ? static_cast<uint16_t*>(malloc(bytes)) : nullptr;
+    if (!block) {
+        Serial.printf("Screen %u not cached: %lu bytes\n", screen, (unsigned long)bytes);
+        entry.failed = true;
+        return false;
+    }
+
+    Encoder writer(block, block + area.h);
+    m_compositor.capture(area, drawLayer, [&](const uint16_t* pixels, int16_t stride, const ScreenRect& slice) {
+        writer.addBand(pixels, stride, slice);
+    });
+    entry.rows = block;
+    entry.runs = block + area.h;
+    entry.bytes = bytes;
+    Serial.printf("Screen %u cached: %lu bytes\n", screen, (unsigned long)bytes);
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Axis-aligned screen rectangle in pixels; empty when w or h is not positive
+struct ScreenRect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+
+    int16_t right() const { return x + w; }
+    int16_t bottom() const { return y + h; }
+    uint32_t area() const { return empty() ? 0 : (uint32_t)w * h; }
+    bool empty() const { return w <= 0 || h <= 0; }
+
+    bool intersects(const ScreenRect& other) const {
+        return !empty() && !other.empty() &&
+               x < other.right() && other.x < right() && y < other.bottom() && other.y < bottom();
+    }
+
+    bool contains(const ScreenRect& other) const {
+        return other.x >= x && other.y >= y && other.right() <= right() && other.bottom() <= bottom();
+    }
+
+    ScreenRect intersected(const ScreenRect& other) const {
+        int16_t left = max(x, other.x);
+        int16_t top = max(y, other.y);
+        return ScreenRect{left, top, (int16_t)(min(right(), other.right()) - left),
+                          (int16_t)(min(bottom(), other.bottom()) - top)};
+    }
+
+    ScreenRect united(const ScreenRect& other) const {
+        if (empty()) return other;
+        if (other.empty()) return *this;
+
+        int16_t left = min(x, other.x);
+        int16_t top = min(y, other.y);
+        return ScreenRect{left, top, (int16_t)(max(right(), other.right()) - left),
+                          (int16_t)(max(bottom(), other.bottom()) - top)};
+    }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Flash25Q128JV.h"
+#include "FlashAsyncQueue.h"
+
+// Bounded temperature history: the most recent samples in a RAM ring, and
+// everything else in a ring of flash sectors that wraps over the oldest
+// data once full.
+//
+// Samples are stored in 0.1°C steps and packed into page-sized blocks as
+// zigzag varint value deltas, plus a time delta only where the sampling
+// period changes: about one byte per sample. Each block header carries its
+// time span and min/max/sum, and a RAM index keeps the start time of every
+// sector. Range queries therefore
+// only read the page headers of sectors that overlap the range, and only
+// decode blocks that straddle its edges (or all overlapping blocks when
+// individual samples are visited).
+//
+// A block is programmed once it is full, so up to one block of samples
+// lives only in RAM; call flush() before a planned restart. With a
+// FlashAsyncQueue the block's program, and the erase of the sector it
+// opens, run on the flash worker; queries wait for them to land.
+class TemperatureLog {
+public:
+    static constexpr uint16_t RAM_SAMPLES = 150;    // 5 minutes at one sample per 2s
+    static constexpr uint16_t MAX_SECTORS = 128;
+
+    struct Sample {
+        uint32_t time;           // seconds, never decreasing
+        int16_t deciCelsius;
+    };
+
+    struct Summary {
+        uint32_t count;
+        float minimum;
+        float maximum;
+        float mean;
+    };
+
+    struct Stats {
+        uint32_t samples;
+        uint32_t blocksWritten;
+        uint32_t sectorErases;
+        uint32_t headersRead;    // block headers read by queries
+        uint32_t blocksDecoded;  // full blocks read and decoded by queries
+        uint32_t corruptBlocks;  // skipped on mount or query (torn by a power cut)
+    };
+
+    // Return false to stop the query early
+    typedef bool (*SampleVisitor)(const Sample& sample, void* context);
+
+    TemperatureLog(Flash25Q128JV& flash, uint32_t baseAddress, uint16_t sectorCount);
+
+    // Finds the newest block in the ring. Without flash only the RAM ring is kept.
+    bool begin();
+    bool isReady() const { return m_ready; }
+    // Used for block programs and sector erases from then on
+    void setQueue(FlashAsyncQueue* queue) { m_queue = queue; }
+
+    // Samples stamped earlier than the previous one are clamped to it
+    void add(uint32_t time, float celsius);
+    bool flush();
+
+    // Newest samples from RAM, oldest first; returns how many were copied
+    uint16_t recent(Sample* samples, uint16_t maxCount) const;
+
+    // Visits samples with from <= time <= to, oldest first; returns how many
+    uint32_t query(uint32_t from, uint32_t to, SampleVisitor visitor, void* context);
+    bool summarize(uint32_t from, uint32_t to, Summary& summary);
+
+    uint32_t oldestTime() const;
+    uint32_t newestTime() const { return m_lastTime; }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    static constexpr uint16_t PAGES_PER_SECTOR = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+
+    struct SectorIndex {
+        uint32_t sequence;       // of the first block, 0 if the sector holds no blocks
+        uint32_t firstTime;
+    };
+
+    Flash25Q128JV& m_flash;
+    FlashAsyncQueue* m_queue;
+    const uint32_t m_baseAddress;
+    const uint16_t m_sectorCount;
+    bool m_ready;
+
+    SectorIndex m_index[MAX_SECTORS];
+    uint16_t m_headSector;
+    uint8_t m_headPage;          // next page to program in the head sector
+    uint32_t m_nextSequence;
+
+    // Block being filled, in its on-flash layout
+    uint8_t m_block[FLASH_PAGE_SIZE];
+    int16_t m_blockLastValue;
+    uint32_t m_blockTimeDelta;
+
+    // Last block handed to the queue, and its requests still running
+    uint8_t m_writing[FLASH_PAGE_SIZE];
+    int32_t m_eraseHandle;
+    int32_t m_writeHandle;
+
+    Sample m_recent[RAM_SAMPLES];
+    uint16_t m_recentStart;
+    uint16_t m_recentCount;
+    uint32_t m_lastTime;
+    Stats m_stats;
+
+    uint32_t pageAddress(uint16_t sector, uint8_t page) const;
+    uint16_t oldestSector() const;
+    bool blockEmpty() const;
+    void startBlock(uint32_t time, int16_t value);
+    bool appendToBlock(uint32_t time, int16_t value);
+    bool writeBlock();
+    bool finishWrite();
+    bool prepareSector(uint16_t sector);
+
+    template <typename Fn>
+    void forEachBlock(uint32_t from, uint32_t to, Fn fn);
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FlashKVStore.h"
+#include "TouchFilter.h"
+
+// Affine map from filtered panel positions to screen pixels, solved from
+// three touched targets. It takes out the panel's offset, scale, skew and
+// rotation against the display; the nominal map (raw 3800..200 across the
+// screen on both axes) applies until a calibration is stored.
+class TouchCalibration {
+public:
+    static constexpr uint8_t POINTS = 3;
+
+    TouchCalibration();
+
+    // Solves for the map that takes each raw point to its screen point;
+    // false, leaving the map as it was, if the raw points are collinear
+    bool solve(const TouchPoint raw[POINTS], const int16_t screenX[POINTS], const int16_t screenY[POINTS]);
+    void reset();
+    // Screen position of a raw point, not clamped to the screen
+    void apply(const TouchPoint& raw, int16_t& x, int16_t& y) const;
+
+    // Persisted in the settings store; load() keeps the current map if
+    // none is stored
+    bool load(FlashKVStore& settings);
+    bool save(FlashKVStore& settings) const;
+    void print() const;
+
+private:
+    // x = (a * rx + b * ry + c) / 2^16, y = (d * rx + e * ry + f) / 2^16
+    // with rx, ry in raw counts with TouchFilter::FRACTION_BITS
+    int32_t m_matrix[6];
+};
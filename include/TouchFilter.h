@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TouchSampler.h"
+
+// Panel position in raw XPT2046 counts with FRACTION_BITS of fraction
+struct TouchPoint {
+    int32_t x;
+    int32_t y;
+};
+
+// Turns the sampler's raw readings into a steady position, in fixed point
+// throughout:
+//  1. the median of the last MEDIAN_SAMPLES readings per axis drops the
+//     single-sample spikes resistive panels produce;
+//  2. the last AVERAGE_SAMPLES medians are averaged weighted by pressure,
+//     since light readings (a finger landing or lifting) are the noisiest;
+//  3. optionally a 1-Euro filter (Casiez et al.) smooths what jitter is
+//     left while the finger rests and lets fast moves through with little
+//     lag, its cutoff rising with the speed.
+// Readings lighter than MIN_PRESSURE never start a press; during one they
+// are skipped, and only the sampler's release sample ends it.
+class TouchFilter {
+public:
+    static constexpr uint8_t FRACTION_BITS = 4;
+    static constexpr uint16_t MIN_PRESSURE = 500;
+    static constexpr uint8_t MEDIAN_SAMPLES = 5;
+    static constexpr uint8_t AVERAGE_SAMPLES = 4;
+    // 1-Euro cutoff at rest, its increase per 1000 counts/s of speed, and
+    // the cutoff of the speed estimate, in mHz
+    static constexpr uint32_t MIN_CUTOFF_MHZ = 1000;
+    static constexpr uint32_t BETA_MHZ = 20000;
+    static constexpr uint32_t SPEED_CUTOFF_MHZ = 3000;
+
+    explicit TouchFilter(bool smoothing = true);
+
+    bool smoothing() const { return m_smoothing; }
+    void setSmoothing(bool enabled) { m_smoothing = enabled; }
+
+    // Feeds the next sample; true with the filtered position while pressed
+    bool add(const TouchSample& sample, TouchPoint& point);
+    void reset();
+
+private:
+    // One axis of the 1-Euro filter
+    class OneEuro {
+    public:
+        void reset() { m_started = false; }
+        int32_t filter(int32_t value, uint32_t elapsedMicros);
+
+    private:
+        bool m_started;
+        int32_t m_value;
+        int32_t m_speed;      // per second
+
+        static uint32_t alpha(uint32_t cutoffMilliHz, uint32_t elapsedMicros);
+        // The share alpha (Q16) of difference, rounded
+        static int32_t blend(int32_t difference, uint32_t alpha);
+    };
+
+    bool m_smoothing;
+    bool m_pressed;
+    uint32_t m_lastMicros;
+    // Both windows are rings: the next slot to fill, and how many are filled
+    // in this press
+    uint8_t m_rawNext;
+    uint8_t m_rawCount;
+    int16_t m_rawX[MEDIAN_SAMPLES];
+    int16_t m_rawY[MEDIAN_SAMPLES];
+    uint8_t m_medianNext;
+    uint8_t m_medianCount;
+    int16_t m_medianX[AVERAGE_SAMPLES];
+    int16_t m_medianY[AVERAGE_SAMPLES];
+    uint16_t m_pressure[AVERAGE_SAMPLES];
+    TouchPoint m_point;
+    OneEuro m_euroX;
+    OneEuro m_euroY;
+
+    static int16_t median(const int16_t* values, uint8_t count);
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Time from a touch sample to what it causes, reported over Serial with the
+// "lat" command. Costs a micros() read or two per handled touch event and
+// per drawn frame; nothing at all when 0.
+#ifndef TOUCH_LATENCY
+#define TOUCH_LATENCY 1
+#endif
+
+#if TOUCH_LATENCY
+// Follows the oldest touch sample handled in a frame through the rest of
+// it. Every sample carries the time the sampler task read it off the
+// panel; when the UI dispatches the event built from it, the sample
+// becomes the frame's pending touch, until the frame's pixels are all sent
+// (draw done) or the frame ends without drawing. Lighting commands sent
+// meanwhile are charged to it too. Each stage keeps a histogram:
+//  - dispatch: sample read to its event handled, queueing and the loop's
+//    16ms frame gate;
+//  - draw: event handled to the last pixel of the frame it changed sent;
+//  - photon: sample read to the last pixel sent, the two above together;
+//  - send: sample read to the lighting command going out.
+class TouchLatency {
+public:
+    enum Stage : uint8_t {
+        STAGE_DISPATCH,
+        STAGE_DRAW,
+        STAGE_PHOTON,
+        STAGE_SEND,
+        STAGE_COUNT
+    };
+
+    static constexpr uint8_t BUCKET_COUNT = 12;
+
+    static void dispatched(uint32_t acquiredMicros);
+    static void drawn();
+    static void sent();
+    // Closes the frame; a pending touch that drew nothing is dropped
+    static void endFrame();
+
+    static void print();
+    static void reset();
+
+private:
+    struct Histogram {
+        uint32_t count;
+        uint64_t totalMicros;
+        uint32_t maxMicros;
+        uint32_t buckets[BUCKET_COUNT];
+    };
+
+    static Histogram s_stages[STAGE_COUNT];
+    static bool s_pending;
+    static bool s_sent;
+    static uint32_t s_acquiredMicros;
+    static uint32_t s_dispatchedMicros;
+
+    static void record(Stage stage, uint32_t micros);
+    // Upper bound of the bucket the p-th percentile falls in
+    static uint32_t percentileBound(const Histogram& histogram, uint8_t p);
+    static const char* stageName(Stage stage);
+};
+
+#define TOUCH_LATENCY_DISPATCHED(acquiredMicros) TouchLatency::dispatched(acquiredMicros)
+#define TOUCH_LATENCY_DRAWN() TouchLatency::drawn()
+#define TOUCH_LATENCY_SENT() TouchLatency::sent()
+#define TOUCH_LATENCY_END_FRAME() TouchLatency::endFrame()
+#else
+#define TOUCH_LATENCY_DISPATCHED(acquiredMicros)
+#define TOUCH_LATENCY_DRAWN()
+#define TOUCH_LATENCY_SENT()
+#define TOUCH_LATENCY_END_FRAME()
+#endif
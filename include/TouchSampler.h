@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <XPT2046_Touchscreen.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+// One reading of the panel, as XPT2046_Touchscreen reports it: raw
+// coordinates after rotation and the pressure. A sample with z 0 marks the
+// finger lifting, at the last pressed position.
+struct TouchSample {
+    uint32_t micros;
+    int16_t x;
+    int16_t y;
+    uint16_t z;
+};
+
+// Touch acquisition driven by the XPT2046's PENIRQ line, which the
+// controller pulls low when the panel is pressed. The falling edge wakes a
+// sampler task on core 0 that reads the controller at a fixed rate until
+// the finger lifts, queues a release sample and goes back to waiting for
+// the interrupt, so the touch bus is silent while nobody touches the
+// screen. Samples reach the UI loop through a lock-free single-producer,
+// single-consumer ring: reading them is a few loads, no SPI and no locks.
+class TouchSampler {
+public:
+    // A power of two; 160ms of samples, ten UI frames
+    static constexpr uint8_t RING_SIZE = 32;
+    static constexpr uint32_t SAMPLE_INTERVAL_MS = 5;
+    static constexpr uint32_t TASK_STACK_SIZE = 3072;
+    // Above the FlashAsyncQueue worker, which shares core 0
+    static constexpr UBaseType_t TASK_PRIORITY = 2;
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    TouchSampler(XPT2046_Touchscreen& touchscreen, uint8_t irqPin);
+
+    // The touchscreen must be started; from then on only the sampler task
+    // talks to it
+    bool begin();
+
+    // Takes the oldest sample not read yet; false if there is none. Only
+    // one task may read.
+    bool read(TouchSample& sample);
+    // Samples lost to a full ring; a release is retried until it fits
+    uint32_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static_assert((RING_SIZE & (RING_SIZE - 1)) == 0 && RING_SIZE <= 128, "ring indices wrap at 256");
+
+    XPT2046_Touchscreen& m_touchscreen;
+    const uint8_t m_irqPin;
+    TaskHandle_t m_task;
+    TouchSample m_ring[RING_SIZE];
+    // Free-running indices, written by one side each
+    std::atomic<uint8_t> m_head;
+    std::atomic<uint8_t> m_tail;
+    std::atomic<uint32_t> m_dropped;
+    // Set while the task waits for a press; edges while it samples are the
+    // controller's own conversions and are ignored
+    std::atomic<bool> m_armed;
+
+    static void onPenDown(void* context);
+    static void taskEntry(void* param);
+    void run();
+    void samplePress();
+    bool push(const TouchSample& sample);
+};
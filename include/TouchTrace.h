@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Flash25Q128JV.h"
+
+// One reading of a recorded touch stream: the screen position after
+// filtering and calibration, and the pressure; z 0 marks a lift
+struct TouchRecord {
+    uint32_t micros;
+    int16_t x;
+    int16_t y;
+    uint16_t z;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(TouchRecord) == 12, "records are stored as they are laid out");
+
+// A recorded touch stream in its own flash region: a header, then the
+// records back to back. Exported to SD the file has the same layout, so
+// traces move between the device, the card and the host benchmarks as
+// they are. Recording erases the whole region up front (blocking, about
+// half a second for 256KB) so appends only ever program pages, a page at
+// a time from a RAM buffer.
+class TouchTrace {
+public:
+    static constexpr uint32_t MAGIC = 0x43525454;    // "TTRC"
+    static constexpr uint16_t VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t count;
+        uint32_t durationMicros;    // first record to last
+    };
+
+    static_assert(sizeof(Header) == 16, "the header is stored as it is laid out");
+
+    TouchTrace(Flash25Q128JV& flash, uint32_t address, uint32_t size);
+
+    // Picks up the trace stored last, if any
+    bool begin();
+    // A header this version can replay
+    static bool isValid(const Header& header);
+
+    // Drops the stored trace and starts a new one
+    bool startRecording();
+    // False once the region is full or when not recording
+    bool append(const TouchRecord& record);
+    // Writes out the rest and the header; a trace that ends with the finger
+    // down gets a lift added
+    bool stopRecording();
+    bool isRecording() const { return m_recording; }
+
+    // The stored trace; empty while recording
+    const Header& header() const { return m_header; }
+    uint32_t count() const { return m_recording ? 0 : m_header.count; }
+    uint32_t capacity() const { return (m_size - sizeof(Header)) / sizeof(TouchRecord); }
+    bool read(uint32_t index, TouchRecord& record);
+
+private:
+    Flash25Q128JV& m_flash;
+    const uint32_t m_address;
+    const uint32_t m_size;
+    Header m_header;
+    bool m_recording;
+    TouchRecord m_last;
+    // Bytes waiting to be programmed from m_writeAddress on; never past the
+    // end of that page
+    uint8_t m_buffer[FLASH_PAGE_SIZE];
+    uint16_t m_buffered;
+    uint32_t m_writeAddress;
+
+    bool flushBuffer();
+};
+
+// Feeds a stored trace back in at its recorded pace, or 'speed' times
+// faster. Record times are moved onto the replay clock, so the UI sees the
+// touches as if they had just been read off the panel.
+class TouchReplayer {
+public:
+    TouchReplayer();
+
+    bool start(TouchTrace& trace, uint8_t speed, uint32_t nowMicros);
+    void stop() { m_trace = nullptr; }
+    bool isActive() const { return m_trace != nullptr; }
+
+    // The next record due by nowMicros; false if none is yet. The replay
+    // stops after the last record.
+    bool next(uint32_t nowMicros, TouchRecord& record);
+
+private:
+    TouchTrace* m_trace;
+    uint32_t m_index;
+    uint8_t m_speed;
+    uint32_t m_startMicros;
+    uint32_t m_firstMicros;
+    TouchRecord m_pending;
+    bool m_hasPending;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "ScreenRect.h"
+
+// Count draw calls, pixels, bus bytes and time per UI caller, reported over
+// Serial with the "prof" command. Costs two micros() reads per drawn
+// element and a few adds per primitive; nothing at all when 0.
+#ifndef UI_PROFILE
+#define UI_PROFILE 0
+#endif
+
+#if UI_PROFILE
+// Rendering cost per caller. Each caller's drawing runs inside a Scope;
+// the Profiled canvases below count the primitives it issues. Per-frame
+// times go into a rolling window per caller, reported as percentiles and a
+// histogram.
+class UiProfiler {
+public:
+    enum Section : uint8_t {
+        SECTION_OTHER,
+        SECTION_BACKGROUND,
+        SECTION_HEADER,
+        SECTION_SLIDERS,
+        SECTION_TEMPERATURE,
+        SECTION_MENU,
+        SECTION_POMODORO_SETUP,
+        SECTION_POMODORO_TIMER,
+        SECTION_CLOCK,
+        SECTION_BAND_PUSH,
+        SECTION_COUNT
+    };
+
+    static constexpr uint8_t WINDOW_FRAMES = 64;
+    static constexpr uint8_t BUCKET_COUNT = 10;
+
+    // Times its section and makes it the one primitives are charged to
+    class Scope {
+    public:
+        explicit Scope(Section section);
+        ~Scope();
+    private:
+        Section m_previous;
+        unsigned long m_start;
+    };
+
+    // Charges one draw primitive. Primitives nest (a sprite's drawChar()
+    // fills rectangles), so only the outermost one counts.
+    class Primitive {
+    public:
+        Primitive() : m_outermost(s_depth++ == 0) {}
+        ~Primitive() { s_depth--; }
+        void count(int32_t x, int32_t y, int32_t w, int32_t h, bool onBus);
+    private:
+        const bool m_outermost;
+    };
+
+    // Screen area the current drawing is clipped to; pixels outside it
+    // aren't counted
+    static void setClip(const ScreenRect& clip) { s_clip = clip; }
+    static void resetClip();
+    // Pixels pushed to the display other than by primitives
+    static void addBusBytes(uint32_t bytes);
+
+    // Closes the frame: callers that drew something get a sample
+    static void endFrame();
+    static void print();
+    static void reset();
+
+private:
+    struct Counters {
+        uint32_t calls;
+        uint32_t pixels;
+        uint32_t busBytes;
+        uint32_t micros;
+    };
+
+    struct Totals {
+        uint32_t frames;
+        uint64_t calls;
+        uint64_t pixels;
+        uint64_t busBytes;
+        uint32_t window[WINDOW_FRAMES];    // microseconds of the last frames
+        uint8_t windowNext;
+        uint8_t windowCount;
+    };
+
+    static Section s_current;
+    static uint8_t s_depth;
+    static ScreenRect s_clip;
+    static Counters s_frame[SECTION_COUNT];
+    static Totals s_totals[SECTION_COUNT];
+    static uint32_t s_frames;
+
+    static const char* sectionName(Section section);
+};
+
+// A TFT_eSPI or TFT_eSprite that charges its primitives to the current
+// section. Only the primitives TFT_eSPI dispatches virtually are seen;
+// everything the screens draw comes down to them.
+template <class Base, bool ON_BUS>
+class Profiled : public Base {
+public:
+    using Base::Base;
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color) override {
+        UiProfiler::Primitive primitive;
+        primitive.count(x, y, 1, 1, ON_BUS);
+        Base::drawPixel(x, y, color);
+    }
+
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override {
+        UiProfiler::Primitive primitive;
+        primitive.count(x, y, w, 1, ON_BUS);
+        Base::drawFastHLine(x, y, w, color);
+    }
+
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override {
+        UiProfiler::Primitive primitive;
+        primitive.count(x, y, 1, h, ON_BUS);
+        Base::drawFastVLine(x, y, h, color);
+    }
+
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override {
+        UiProfiler::Primitive primitive;
+        primitive.count(x, y, w, h, ON_BUS);
+        Base::fillRect(x, y, w, h, color);
+    }
+
+    int16_t drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font) override {
+        UiProfiler::Primitive primitive;
+        int16_t width = Base::drawChar(uniCode, x, y, font);
+        primitive.count(x, y, width, this->fontHeight(font), ON_BUS);
+        return width;
+    }
+};
+
+typedef Profiled<TFT_eSPI, true> ProfiledTFT;
+typedef Profiled<TFT_eSprite, false> ProfiledSprite;
+
+#define UI_PROFILE_SCOPE(section) UiProfiler::Scope uiProfileScope(UiProfiler::section)
+#define UI_PROFILE_CLIP(rect) UiProfiler::setClip(rect)
+#define UI_PROFILE_UNCLIP() UiProfiler::resetClip()
+#define UI_PROFILE_BUS_BYTES(bytes) UiProfiler::addBusBytes(bytes)
+#define UI_PROFILE_END_FRAME() UiProfiler::endFrame()
+#else
+typedef TFT_eSPI ProfiledTFT;
+typedef TFT_eSprite ProfiledSprite;
+
+#define UI_PROFILE_SCOPE(section)
+#define UI_PROFILE_CLIP(rect)
+#define UI_PROFILE_UNCLIP()
+#define UI_PROFILE_BUS_BYTES(bytes)
+#define UI_PROFILE_END_FRAME()
+#endif
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "ScreenRect.h"
+#include "DamageTracker.h"
+
+class WidgetTree;
+
+// Parts of a screen to draw: the static layer a ScreenCache keeps, the
+// overlays drawn over it, or both
+enum DrawLayers : uint8_t {
+    LAYER_STATIC = 1,
+    LAYER_OVERLAY = 2,
+    LAYER_ALL = LAYER_STATIC | LAYER_OVERLAY
+};
+
+// A retained element of a screen: where it is, what it shows and which of
+// its pixels are out of date. State setters only record damage; the owning
+// WidgetTree hands it to a DamageTracker and draws the widgets it touches.
+class Widget {
+public:
+    // Separate areas kept per frame, e.g. a slider's fill end and its
+    // digits; more are merged into the closest
+    static constexpr uint8_t MAX_DAMAGE_RECTS = 2;
+
+    explicit Widget(const ScreenRect& bounds, uint8_t tag = 0);
+    virtual ~Widget() {}
+
+    // Everything draw() may paint
+    const ScreenRect& bounds() const { return m_bounds; }
+    // Free for the owner, e.g. the action a button stands for
+    uint8_t tag() const { return m_tag; }
+
+    bool isVisible() const { return m_visible; }
+    void setVisible(bool visible);
+    // Only touchable widgets are hit-tested, over their hit area (the
+    // bounds unless set)
+    bool isTouchable() const { return m_touchable; }
+    void setTouchable(bool touchable);
+    const ScreenRect& hitArea() const { return m_hitArea; }
+    void setHitArea(const ScreenRect& area);
+
+    // Repaint all of the widget, or just 'area', with the next frame
+    void invalidate() { invalidate(m_bounds); }
+    void invalidate(const ScreenRect& area);
+    bool isDirty() const { return m_damageCount > 0; }
+
+    // Paints the current state over the background, which the scene has
+    // already drawn; drawing may be clipped
+    virtual void draw(TFT_eSPI& gfx) = 0;
+
+    // Screens may cache a static layer (see ScreenCache): what
+    // drawStatic() paints, with drawOverlay() drawing the rest over it. By
+    // default a widget is all static, or all overlay once setStatic(false);
+    // static parts must not change while their screen is cached.
+    bool isStatic() const { return m_static; }
+    void setStatic(bool isStatic) { m_static = isStatic; }
+    virtual void drawStatic(TFT_eSPI& gfx);
+    virtual void drawOverlay(TFT_eSPI& gfx);
+
+protected:
+    // Display of the tree the widget belongs to, for text metrics; nullptr
+    // until it is added to one
+    TFT_eSPI* display() const;
+
+private:
+    friend class WidgetTree;
+
+    const ScreenRect m_bounds;
+    ScreenRect m_hitArea;
+    ScreenRect m_damage[MAX_DAMAGE_RECTS];
+    uint8_t m_damageCount;
+    WidgetTree* m_tree;
+    const uint8_t m_tag;
+    bool m_visible;
+    bool m_touchable;
+    bool m_static;
+};
+
+// Rounded button with a centred font 2 caption
+class Button : public Widget {
+public:
+    Button(const ScreenRect& bounds, const char* label, uint16_t color, uint8_t tag = 0);
+    void setLabel(const char* label);
+    void setColor(uint16_t color);
+    void draw(TFT_eSPI& gfx) override;
+
+private:
+    const char* m_label;
+    uint16_t m_color;
+};
+
+// One line of text with its top at y and x anchored per datum (TL, TC or
+// TR); the bounds are the most it may cover. Text changes repaint only the
+// glyphs from the first difference on.
+class Label : public Widget {
+public:
+    Label(const ScreenRect& bounds, int16_t x, int16_t y, uint8_t datum, uint8_t font, uint16_t color,
+          const String& text = String());
+    const String& text() const { return m_text; }
+    void setText(const String& text);
+    void setColor(uint16_t color);
+    void draw(TFT_eSPI& gfx) override;
+
+private:
+    const int16_t m_x;
+    const int16_t m_y;
+    const uint8_t m_datum;
+    const uint8_t m_font;
+    uint16_t m_color;
+    String m_text;
+};
+
+// Horizontal pill-shaped bar filled from the left. A fill change repaints
+// only the strip between the old and new ends.
+class ProgressBar : public Widget {
+public:
+    ProgressBar(const ScreenRect& bounds, uint16_t trackColor, uint16_t fillColor);
+    // Part of 'bar' that differs when a fill pill drawn with fillRoundRect()
+    // goes from 'before' to 'after' pixels wide: from a radius left of the
+    // shorter end to the longer one
+    static ScreenRect fillChange(const ScreenRect& bar, int16_t before, int16_t after);
+    int16_t fillWidth() const { return m_fillWidth; }
+    void setFillWidth(int16_t width);
+    void setFillColor(uint16_t color);
+    void draw(TFT_eSPI& gfx) override;
+    // The empty track is static, the fill an overlay
+    void drawStatic(TFT_eSPI& gfx) override;
+    void drawOverlay(TFT_eSPI& gfx) override;
+
+private:
+    const uint16_t m_trackColor;
+    uint16_t m_fillColor;
+    int16_t m_fillWidth;
+};
+
+// The widgets of one screen, drawn in the order they were added (later
+// ones on top). Touches are dispatched through a spatial index: the
+// touchable widgets' edges cut the screen into horizontal slabs, each slab
+// into runs owned by the topmost widget there, so a hit test is two binary
+// searches. The index is rebuilt on the first hit test after a widget is
+// added, shown, hidden or moves its hit area.
+class WidgetTree {
+public:
+    static constexpr uint8_t MAX_WIDGETS = 16;
+    static constexpr uint8_t MAX_TARGETS = 8;
+
+    explicit WidgetTree(TFT_eSPI& tft);
+
+    // False when full; widgets must outlive the tree
+    bool add(Widget& widget);
+    TFT_eSPI& display() const { return m_tft; }
+
+    // Topmost visible, touchable widget whose hit area holds (x, y)
+    Widget* hitTest(int16_t x, int16_t y);
+
+    // Hands every widget's pending damage to 'damage', its bounds as the
+    // legacy area a full redraw would have covered
+    void collectDamage(DamageTracker& damage);
+    // Drops pending damage, e.g. when the whole screen is redrawn anyway
+    void clearDamage();
+    // Draws the given layers of the visible widgets that intersect 'clip'
+    void draw(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers = LAYER_ALL);
+
+private:
+    friend class Widget;
+
+    static constexpr uint8_t NO_WIDGET = 0xFF;
+    static constexpr uint8_t MAX_EDGES = 2 * MAX_TARGETS;
+    // A slab holds at most 2 * MAX_TARGETS runs, the last one empty
+    static constexpr uint16_t MAX_RUNS = (MAX_EDGES - 1) * MAX_EDGES;
+
+    TFT_eSPI& m_tft;
+    Widget* m_widgets[MAX_WIDGETS];
+    uint8_t m_count;
+
+    bool m_indexStale;
+    int16_t m_slabTop[MAX_EDGES];       // slab i spans [m_slabTop[i], m_slabTop[i + 1])
+    uint8_t m_edgeCount;
+    uint16_t m_slabRuns[MAX_EDGES];     // first run of each slab, then the end
+    int16_t m_runStart[MAX_RUNS];       // run spans up to the next one's start
+    uint8_t m_runWidget[MAX_RUNS];
+    uint16_t m_runCount;
+
+    void rebuildIndex();
+};
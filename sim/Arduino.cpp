@@ -0,0 +1,157 @@
+#include "Arduino.h"
+#include "SimHost.h"
+
+#include <map>
+
+HardwareSerial Serial;
+
+namespace {
+
+uint64_t s_nowNs = 0;
+bool s_serialEcho = false;
+std::map<uint8_t, sim::SpiDevice*> s_spiDevices;
+sim::SpiDevice* s_selected = nullptr;
+// Pins read high until driven low, like the board's pulled-up inputs
+bool s_pinLow[64];
+
+struct Interrupt {
+    void (*handler)(void*);
+    void* arg;
+    int mode;
+};
+Interrupt s_interrupts[64];
+
+// Defaults are estimates for the Arduino-ESP32 2.x HAL at 240MHz
+sim::SpiCostModel s_spiCost = {3000, 1800, 600};
+
+}
+
+namespace sim {
+
+uint64_t nowNs() {
+    return s_nowNs;
+}
+
+void advanceNs(uint64_t ns) {
+    s_nowNs += ns;
+}
+
+void attachSpiDevice(uint8_t csPin, SpiDevice* device) {
+    s_spiDevices[csPin] = device;
+}
+
+void detachSpiDevice(uint8_t csPin) {
+    auto it = s_spiDevices.find(csPin);
+    if (it == s_spiDevices.end()) return;
+    if (s_selected == it->second) s_selected = nullptr;
+    s_spiDevices.erase(it);
+}
+
+SpiDevice* selectedSpiDevice() {
+    return s_selected;
+}
+
+SpiCostModel& spiCostModel() {
+    return s_spiCost;
+}
+
+void setSerialEcho(bool enabled) {
+    s_serialEcho = enabled;
+}
+
+void setPinLevel(uint8_t pin, uint8_t level) {
+    if (pin >= sizeof(s_pinLow) || s_pinLow[pin] == (level == LOW)) return;
+    s_pinLow[pin] = level == LOW;
+
+    const Interrupt& interrupt = s_interrupts[pin];
+    int edge = level == LOW ? FALLING : RISING;
+    if (interrupt.handler && (interrupt.mode & edge)) {
+        interrupt.handler(interrupt.arg);
+    }
+}
+
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < sizeof(s_pinLow)) s_pinLow[pin] = val == LOW;
+
+    auto it = s_spiDevices.find(pin);
+    if (it == s_spiDevices.end()) return;
+
+    if (val == LOW && s_selected != it->second) {
+        s_selected = it->second;
+        s_selected->select();
+    } else if (val == HIGH && s_selected == it->second) {
+        s_selected->deselect();
+        s_selected = nullptr;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < sizeof(s_pinLow) && s_pinLow[pin] ? LOW : HIGH;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    if (pin < sizeof(s_pinLow)) s_interrupts[pin] = Interrupt{handler, arg, mode};
+}
+
+unsigned long millis() {
+    return (unsigned long)(s_nowNs / 1000000ULL);
+}
+
+unsigned long micros() {
+    return (unsigned long)(s_nowNs / 1000ULL);
+}
+
+void delay(uint32_t ms) {
+    sim::sleepNs((uint64_t)ms * 1000000ULL);
+}
+
+void delayMicroseconds(uint32_t us) {
+    s_nowNs += (uint64_t)us * 1000ULL;
+}
+
+long random(long howbig) {
+    return howbig > 0 ? rand() % howbig : 0;
+}
+
+long random(long howsmall, long howbig) {
+    return howbig > howsmall ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+    srand((unsigned int)seed);
+}
+
+int HardwareSerial::available() {
+    return 0;
+}
+
+int HardwareSerial::read() {
+    return -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (s_serialEcho) fputc(c, stdout);
+    return 1;
+}
+
+size_t HardwareSerial::print(const char* s) {
+    if (s_serialEcho) fputs(s, stdout);
+    return strlen(s);
+}
+
+size_t HardwareSerial::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = s_serialEcho ? vprintf(format, args) : vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+    return n > 0 ? (size_t)n : 0;
+}
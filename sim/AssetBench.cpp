@@ -0,0 +1,226 @@
+#include "Crc32.h"
+#include "Flash25Q128JV.h"
+#include "FlashAssetBank.h"
+#include "FlashAssetFS.h"
+#include "FlashAsyncQueue.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// The asset bank end to end: an image packed the way tools/pack_assets.py
+// packs it is installed the way installAssetsFromSD() streams it off the
+// card, then every asset is read back through FlashAssetFS, as the audio
+// library's connecttoFS() reads it, and compared with the image. Usage:
+//   assets [IMAGE.bin]
+// IMAGE.bin, as written by pack_assets.py, is installed instead of the
+// built-in set of synthetic sounds, font and splash screen. Erases and
+// programs go through the flash worker, as main.cpp sets the bank up.
+namespace {
+
+constexpr uint32_t BANK_MAGIC = 0x42415359;   // "YSAB"
+constexpr uint16_t BANK_VERSION = 1;
+constexpr uint32_t CHUNK_SIZE = 1024;         // installAssetsFromSD()'s buffer
+constexpr uint8_t NAME_SIZE = FlashAssetBank::MAX_NAME_LENGTH + 1;
+
+struct SourceFile {
+    const char* name;
+    uint32_t size;
+};
+
+const SourceFile BUILT_IN[] = {
+    {"/beep.mp3", 3100},
+    {"/alarm.mp3", 41800},
+    {"/tick.wav", 700},
+    {"/font16.bin", 12288},
+    {"/splash.raw", 320 * 240 * 2},
+};
+
+void putLittle32(std::vector<uint8_t>& out, size_t at, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) out[at + i] = value >> (8 * i);
+}
+
+uint32_t getLittle32(const std::vector<uint8_t>& in, size_t at) {
+    return in[at] | (in[at + 1] << 8) | (in[at + 2] << 16) | ((uint32_t)in[at + 3] << 24);
+}
+
+uint32_t alignUp(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// pack() of tools/pack_assets.py: index sorted by name, each asset on a page
+// boundary, the gaps 0xFF
+std::vector<uint8_t> pack(std::vector<std::pair<std::string, std::vector<uint8_t>>> files) {
+    std::sort(files.begin(), files.end());
+    uint32_t indexEnd = FlashAssetBank::HEADER_SIZE + FlashAssetBank::ENTRY_SIZE * files.size();
+    std::vector<uint8_t> image(indexEnd, 0);
+
+    uint32_t offset = alignUp(indexEnd, FLASH_PAGE_SIZE);
+    for (size_t i = 0; i < files.size(); i++) {
+        const std::vector<uint8_t>& blob = files[i].second;
+        size_t entry = FlashAssetBank::HEADER_SIZE + FlashAssetBank::ENTRY_SIZE * i;
+        memcpy(&image[entry], files[i].first.c_str(), std::min<size_t>(files[i].first.size(), NAME_SIZE - 1));
+        putLittle32(image, entry + NAME_SIZE, offset);
+        putLittle32(image, entry + NAME_SIZE + 4, blob.size());
+        putLittle32(image, entry + NAME_SIZE + 8, crc32Update(blob.data(), blob.size()));
+
+        image.resize(offset, 0xFF);
+        image.insert(image.end(), blob.begin(), blob.end());
+        offset = alignUp(offset + blob.size(), FLASH_PAGE_SIZE);
+    }
+
+    putLittle32(image, 0, BANK_MAGIC);
+    image[4] = BANK_VERSION;
+    image[6] = files.size();
+    putLittle32(image, 8, crc32Update(&image[FlashAssetBank::HEADER_SIZE], indexEnd - FlashAssetBank::HEADER_SIZE));
+    putLittle32(image, 12, image.size());
+    memset(&image[16], 0xFF, 16);
+    return image;
+}
+
+std::vector<uint8_t> packBuiltIn() {
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+    std::mt19937 random(1);
+    for (const SourceFile& file : BUILT_IN) {
+        std::vector<uint8_t> blob(file.size);
+        for (uint8_t& byte : blob) byte = random();
+        files.emplace_back(file.name, blob);
+    }
+    return pack(files);
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+// installAssetsFromSD() with the image in place of the card: skipped when
+// the bank already holds it
+enum InstallResult { INSTALLED, SKIPPED, FAILED };
+
+InstallResult install(FlashAssetBank& bank, const std::vector<uint8_t>& image, uint32_t stopAfter = UINT32_MAX) {
+    if (image.size() < FlashAssetBank::HEADER_SIZE || bank.matches(image.data())) {
+        return SKIPPED;
+    }
+    bool ok = bank.beginInstall(image.size());
+    for (uint32_t position = 0; ok && position < image.size() && position < stopAfter; position += CHUNK_SIZE) {
+        ok = bank.writeInstall(&image[position], std::min<uint32_t>(CHUNK_SIZE, image.size() - position));
+    }
+    if (stopAfter < image.size()) {
+        return FAILED;
+    }
+    return ok && bank.finishInstall() ? INSTALLED : FAILED;
+}
+
+struct ReadBack {
+    uint32_t assets = 0;
+    uint32_t bytes = 0;
+    uint32_t mismatches = 0;
+    uint64_t ns = 0;
+};
+
+// Every index entry of the image opened by name through the FS and read in
+// chunks, then once more from its middle after a seek
+void readBack(FlashAssetBank& bank, const std::vector<uint8_t>& image, ReadBack& result) {
+    FlashAssetFS fs(bank);
+    uint16_t count = image[6] | (image[7] << 8);
+    std::vector<uint8_t> buffer(CHUNK_SIZE);
+
+    for (uint16_t i = 0; i < count; i++) {
+        size_t entry = FlashAssetBank::HEADER_SIZE + FlashAssetBank::ENTRY_SIZE * i;
+        char name[NAME_SIZE] = {};
+        memcpy(name, &image[entry], NAME_SIZE - 1);
+        uint32_t offset = getLittle32(image, entry + NAME_SIZE);
+        uint32_t length = getLittle32(image, entry + NAME_SIZE + 4);
+        const uint8_t* expected = &image[offset];
+
+        uint64_t start = sim::nowNs();
+        File file = fs.open(name);
+        bool ok = file && file.size() == length;
+        uint32_t position = 0;
+        while (ok && file.available()) {
+            size_t read = file.read(buffer.data(), buffer.size());
+            ok = read > 0 && memcmp(buffer.data(), expected + position, read) == 0;
+            position += read;
+        }
+        ok = ok && position == length && file.seek(length / 2);
+        size_t tail = ok ? file.read(buffer.data(), buffer.size()) : 0;
+        ok = ok && memcmp(buffer.data(), expected + length / 2, tail) == 0;
+        file.close();
+        result.ns += sim::nowNs() - start;
+
+        result.assets++;
+        result.bytes += position;
+        if (!ok) {
+            result.mismatches++;
+            printf("  %s reads back wrong\n", name);
+        }
+    }
+}
+
+}
+
+int runAssetBench(int argc, char** argv) {
+    std::vector<uint8_t> image;
+    if (argc > 1) {
+        if (!readFile(argv[1], image) || image.size() < FlashAssetBank::HEADER_SIZE) {
+            printf("cannot read %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        image = packBuiltIn();
+    }
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    FlashAsyncQueue queue(flash);
+    queue.begin();
+    FlashAssetBank bank(flash, FLASH_ASSETS_ADDR, FLASH_ASSETS_SIZE);
+    bank.setQueue(&queue);
+    bank.begin();
+    uint64_t start = sim::nowNs();
+    InstallResult installed = install(bank, image);
+    uint64_t installNs = sim::nowNs() - start;
+    printf("Install: %u bytes, %u assets, %s in %.0f ms (modeled time)\n", (unsigned)image.size(),
+           bank.count(), installed == INSTALLED ? "installed" : "FAILED", installNs / 1e6);
+
+    // The next boot finds the bank as the install left it
+    FlashAssetBank booted(flash, FLASH_ASSETS_ADDR, FLASH_ASSETS_SIZE);
+    booted.setQueue(&queue);
+    bool mounted = booted.begin();
+    ReadBack readBackResult;
+    readBack(booted, image, readBackResult);
+    printf("Read back through FlashAssetFS: %u assets, %u bytes, %u mismatched, %.2f MB/s\n",
+           readBackResult.assets, readBackResult.bytes, readBackResult.mismatches,
+           readBackResult.ns ? readBackResult.bytes / (readBackResult.ns / 1e9) / 1e6 : 0.0);
+    printf("Same image on the next boot: %s\n", install(booted, image) == SKIPPED ? "skipped" : "REINSTALLED");
+
+    // A reset halfway through installing another image must not leave a
+    // bank to trust; a different index CRC is all matches() looks at
+    image[8] ^= 0x01;
+    install(booted, image, image.size() / 2);
+    FlashAssetBank afterCut(flash, FLASH_ASSETS_ADDR, FLASH_ASSETS_SIZE);
+    bool cutMounted = afterCut.begin();
+    printf("Install cut at half: %s\n", cutMounted ? "BANK STILL MOUNTS" : "no bank");
+
+    printf("protocol errors: %u\n", chip.stats().protocolErrors);
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return mounted && installed == INSTALLED && readBackResult.mismatches == 0 && !cutMounted ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Collects samples (e.g. latencies) for percentile reporting in benchmarks
+class BenchSamples {
+public:
+    void add(double value) {
+        m_values.push_back(value);
+        m_sorted = false;
+    }
+
+    void clear() {
+        m_values.clear();
+        m_sorted = true;
+    }
+
+    size_t count() const { return m_values.size(); }
+
+    // Nearest-rank percentile, p in [0, 100]
+    double percentile(double p) {
+        if (m_values.empty()) return 0;
+        sort();
+        size_t rank = (size_t)(p / 100.0 * m_values.size() + 0.5);
+        rank = std::min(std::max<size_t>(rank, 1), m_values.size());
+        return m_values[rank - 1];
+    }
+
+    double max() { return percentile(100); }
+
+    double mean() const {
+        if (m_values.empty()) return 0;
+        double sum = 0;
+        for (double value : m_values) sum += value;
+        return sum / m_values.size();
+    }
+
+private:
+    std::vector<double> m_values;
+    bool m_sorted = true;
+
+    void sort() {
+        if (m_sorted) return;
+        std::sort(m_values.begin(), m_values.end());
+        m_sorted = true;
+    }
+};
@@ -0,0 +1,66 @@
+#include "Flash25Q128JV.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+// Reflashing an asset region: eraseRange() against the per-sector loop the
+// asset installer used before, over a few typical starting states.
+namespace {
+
+constexpr uint32_t REGION = FLASH_ASSETS_ADDR;
+constexpr uint32_t REGION_SIZE = 1024 * 1024;
+
+void fill(W25QSim& chip, const char* pattern) {
+    uint8_t* memory = chip.memory() + REGION;
+    memset(memory, 0xFF, REGION_SIZE);
+
+    for (uint32_t sector = 0; sector < REGION_SIZE / FLASH_SECTOR_SIZE; sector++) {
+        bool programmed = false;
+        if (strcmp(pattern, "full") == 0) programmed = true;
+        if (strcmp(pattern, "first-300k") == 0) programmed = sector * FLASH_SECTOR_SIZE < 300 * 1024;
+        if (strcmp(pattern, "scattered") == 0) programmed = (sector * 7) % 10 == 0;
+        if (programmed) memory[sector * FLASH_SECTOR_SIZE + 17] = 0x00;
+    }
+}
+
+}
+
+int runEraseRangeBench(int, char**) {
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    printf("Erasing a %u KB asset region (modeled time)\n\n", REGION_SIZE / 1024);
+    printf("%-12s %12s %12s %8s   %s\n", "state", "sector loop", "eraseRange", "speedup", "plan");
+
+    const char* patterns[] = {"full", "first-300k", "scattered", "blank"};
+    bool allBlank = true;
+    for (const char* pattern : patterns) {
+        fill(chip, pattern);
+        uint64_t start = sim::nowNs();
+        for (uint32_t offset = 0; offset < REGION_SIZE; offset += FLASH_SECTOR_SIZE) {
+            flash.eraseSector(REGION + offset);
+        }
+        uint64_t loopNs = sim::nowNs() - start;
+
+        fill(chip, pattern);
+        FlashEraseReport report;
+        start = sim::nowNs();
+        flash.eraseRange(REGION, REGION_SIZE, &report);
+        uint64_t rangeNs = sim::nowNs() - start;
+
+        bool ok = flash.isBlank(REGION, REGION_SIZE);
+        allBlank = allBlank && ok;
+        printf("%-12s %10.0fms %10.0fms %7.1fx   %ux64K %ux32K %ux4K, %u skipped, %ums blank check%s\n",
+               pattern, loopNs / 1e6, rangeNs / 1e6, (double)loopNs / rangeNs,
+               report.blocks64, report.blocks32, report.sectors, report.skippedSectors,
+               (unsigned)report.blankCheckMs, ok ? "" : "  NOT BLANK");
+    }
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return allBlank ? 0 : 1;
+}
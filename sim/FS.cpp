@@ -0,0 +1,66 @@
+#include "FS.h"
+#include "FSImpl.h"
+
+// As Arduino-ESP32's FS.cpp: a File or FS without an implementation behind
+// it does nothing
+namespace fs {
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    return _p ? _p->write(buf, size) : 0;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    return _p ? _p->read(buf, size) : 0;
+}
+
+int File::available() {
+    return _p ? (int)(_p->size() - _p->position()) : 0;
+}
+
+void File::flush() {
+    if (_p) _p->flush();
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    return _p && _p->seek(pos, mode);
+}
+
+size_t File::position() const {
+    return _p ? _p->position() : 0;
+}
+
+size_t File::size() const {
+    return _p ? _p->size() : 0;
+}
+
+void File::close() {
+    if (_p) {
+        _p->close();
+        _p = nullptr;
+    }
+}
+
+File::operator bool() const {
+    return _p && *_p;
+}
+
+const char* File::path() const {
+    return _p ? _p->path() : nullptr;
+}
+
+const char* File::name() const {
+    return _p ? _p->name() : nullptr;
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    if (!_impl || !path || path[0] != '/') {
+        return File();
+    }
+    return File(_impl->open(path, mode, create));
+}
+
+bool FS::exists(const char* path) {
+    return _impl && path && _impl->exists(path);
+}
+
+}
@@ -0,0 +1,124 @@
+#include "FlashCache.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+// FlashCache against the bare driver: small appends (a log writing 16 byte
+// samples) and small reads from a hot region (font/icon lookups), plus a
+// content check that both paths leave the same bytes on the chip.
+namespace {
+
+constexpr uint32_t REGION = FLASH_ASSETS_ADDR;
+constexpr uint32_t RECORD_SIZE = 16;
+constexpr uint32_t APPENDS = 4096;
+constexpr uint32_t FLUSH_EVERY = 64;
+constexpr uint32_t HOT_SET = 12 * 1024;
+constexpr uint32_t HOT_READS = 20000;
+constexpr uint32_t HOT_READ_SIZE = 32;
+
+struct Run {
+    uint64_t ns;
+    uint32_t pagePrograms;
+    uint64_t busBytes;
+};
+
+void makeRecord(uint32_t i, uint8_t* record) {
+    for (uint32_t b = 0; b < RECORD_SIZE; b++) {
+        record[b] = (uint8_t)(i * 31 + b);
+    }
+}
+
+template <typename Fn>
+Run measure(W25QSim& chip, Fn fn) {
+    chip.resetStats();
+    uint64_t start = sim::nowNs();
+    fn();
+    return Run{sim::nowNs() - start, chip.stats().pagePrograms,
+               chip.stats().bytesRead + chip.stats().bytesProgrammed};
+}
+
+void printRow(const char* name, const Run& run, uint32_t operations) {
+    printf("  %-22s %9.1fms %8.1fus/op %9u %10.1fKB\n", name, run.ns / 1e6,
+           run.ns / 1e3 / operations, run.pagePrograms, run.busBytes / 1024.0);
+}
+
+}
+
+int runFlashCacheBench(int argc, char** argv) {
+    uint8_t sectors = argc > 1 ? (uint8_t)atoi(argv[1]) : FlashCache::DEFAULT_SECTORS;
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    FlashCache cache(flash, sectors);
+    if (!cache.begin()) {
+        return 1;
+    }
+
+    uint32_t appendBytes = APPENDS * RECORD_SIZE;
+    flash.eraseRange(REGION, appendBytes * 2);
+    uint8_t record[RECORD_SIZE];
+
+    printf("FlashCache, %u sectors (%u bytes of RAM), modeled time\n\n", sectors, cache.memoryUsage());
+    printf("  %-22s %11s %12s %9s %12s\n", "workload", "total", "per op", "programs", "bus traffic");
+
+    // Appends: each direct write is its own WREN + page program + busy wait
+    Run direct = measure(chip, [&] {
+        for (uint32_t i = 0; i < APPENDS; i++) {
+            makeRecord(i, record);
+            flash.write(REGION + i * RECORD_SIZE, record, RECORD_SIZE);
+        }
+    });
+    printRow("append, direct", direct, APPENDS);
+
+    Run cached = measure(chip, [&] {
+        for (uint32_t i = 0; i < APPENDS; i++) {
+            makeRecord(i, record);
+            cache.write(REGION + appendBytes + i * RECORD_SIZE, record, RECORD_SIZE);
+            if ((i + 1) % FLUSH_EVERY == 0) cache.flush();
+        }
+        cache.flush();
+    });
+    char name[32];
+    snprintf(name, sizeof(name), "append, flush/%u", FLUSH_EVERY);
+    printRow(name, cached, APPENDS);
+
+    bool same = memcmp(chip.memory() + REGION, chip.memory() + REGION + appendBytes, appendBytes) == 0;
+
+    // Hot reads: scattered small reads over a few sectors
+    uint8_t buffer[HOT_READ_SIZE];
+    srand(7);
+    Run directReads = measure(chip, [&] {
+        for (uint32_t i = 0; i < HOT_READS; i++) {
+            flash.read(REGION + rand() % (HOT_SET - HOT_READ_SIZE), buffer, HOT_READ_SIZE);
+        }
+    });
+    printRow("hot reads, direct", directReads, HOT_READS);
+
+    cache.sync();
+    cache.resetStats();
+    srand(7);
+    Run cachedReads = measure(chip, [&] {
+        for (uint32_t i = 0; i < HOT_READS; i++) {
+            cache.read(REGION + rand() % (HOT_SET - HOT_READ_SIZE), buffer, HOT_READ_SIZE);
+        }
+    });
+    printRow("hot reads, cached", cachedReads, HOT_READS);
+
+    const FlashCache::Stats& stats = cache.stats();
+    printf("\n  append speedup       %.1fx (%.1f records per page program)\n",
+           (double)direct.ns / cached.ns, (double)APPENDS / max<uint32_t>(cached.pagePrograms, 1));
+    printf("  hot read speedup     %.1fx (%u hits, %u misses, %.1f%% hit rate)\n",
+           (double)directReads.ns / cachedReads.ns, stats.hits, stats.misses,
+           100.0 * stats.hits / max<uint32_t>(stats.hits + stats.misses, 1));
+    printf("  chip contents        %s\n", same ? "identical" : "DIFFERENT");
+    printf("  protocol errors      %u\n", chip.stats().protocolErrors);
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return same ? 0 : 1;
+}
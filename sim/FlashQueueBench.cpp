@@ -0,0 +1,167 @@
+#include "BenchStats.h"
+#include "Flash25Q128JV.h"
+#include "FlashAsyncQueue.h"
+#include "FlashKVStore.h"
+#include "SimBench.h"
+#include "TemperatureLog.h"
+#include "W25QSim.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// The UI loop's 16ms frame gate while the settings store collects sectors
+// and the temperature log opens new ones. Each frame saves a setting and
+// logs a few samples, as a slider drag with the sensor running fast would.
+// Run once with every program and erase made by the loop, as before the
+// flash worker, and once through FlashAsyncQueue as main.cpp sets it up;
+// the loop's time per frame and the frame intervals show what the erases
+// cost it. Usage:
+//   flash-queue [frames]
+namespace {
+
+constexpr uint32_t FRAME_MS = 16;
+constexpr uint32_t KV_ADDRESS = 0x100000;
+constexpr uint8_t KV_SECTORS = 3;
+constexpr uint32_t LOG_ADDRESS = 0x200000;
+constexpr uint16_t LOG_SECTORS = 2;
+constexpr uint8_t SAMPLES_PER_FRAME = 4;
+
+struct Run {
+    const char* name;
+    uint32_t frames = 0;
+    uint32_t lateFrames = 0;      // more than a millisecond past the gate
+    uint32_t maxIntervalMs = 0;
+    BenchSamples stallMs;         // loop time spent on storage per frame
+    uint32_t erases = 0;
+    uint32_t suspends = 0;
+    uint32_t protocolErrors = 0;
+    uint32_t undefinedReads = 0;
+    uint32_t lastValue = 0;
+    uint32_t storedValue = 0;
+    uint32_t loggedSamples = 0;
+
+    explicit Run(const char* name) : name(name) {}
+};
+
+bool countSample(const TemperatureLog::Sample&, void* context) {
+    (*static_cast<uint32_t*>(context))++;
+    return true;
+}
+
+// One board's worth of storage; the queue's worker never exits, so boards
+// run with a queue are kept to the end
+struct Storage {
+    W25QSim chip;
+    Flash25Q128JV flash;
+    FlashAsyncQueue queue;
+    FlashKVStore settings;
+    TemperatureLog log;
+
+    Storage()
+        : queue(flash)
+        , settings(flash, KV_ADDRESS, KV_SECTORS)
+        , log(flash, LOG_ADDRESS, LOG_SECTORS) {
+    }
+};
+
+void run(Storage& storage, bool useQueue, uint32_t frames, Run& result) {
+    // Leftovers in the log's sectors, so every sector it opens needs an erase
+    memset(storage.chip.memory() + LOG_ADDRESS, 0x00, LOG_SECTORS * FLASH_SECTOR_SIZE);
+    sim::attachSpiDevice(FLASH_CS_PIN, &storage.chip);
+    if (!storage.flash.begin()) {
+        printf("flash init failed\n");
+        return;
+    }
+    if (useQueue) {
+        storage.queue.begin();
+        storage.settings.setQueue(&storage.queue);
+        storage.log.setQueue(&storage.queue);
+    }
+    storage.settings.begin();
+    storage.log.begin();
+    storage.chip.resetStats();
+
+    randomSeed(1);
+    uint32_t time = 1767225600;
+    float temperature = 23.0f;
+    unsigned long lastFrame = millis();
+
+    // main.cpp's loop(), with delay(1) standing in for audio and serial
+    while (result.frames < frames) {
+        unsigned long now = millis();
+        if (now - lastFrame >= FRAME_MS) {
+            uint32_t interval = now - lastFrame;
+            result.maxIntervalMs = max(result.maxIntervalMs, interval);
+            if (interval > FRAME_MS + 1) result.lateFrames++;
+            lastFrame = now;
+
+            uint64_t start = sim::nowNs();
+            result.lastValue = random(0, 256);
+            storage.settings.putUInt("brightness", result.lastValue);
+            for (uint8_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+                temperature = constrain(temperature + random(-30, 31) / 10.0f, 18.0f, 28.0f);
+                storage.log.add(time += 2, temperature);
+            }
+            result.stallMs.add((sim::nowNs() - start) / 1e6);
+            result.frames++;
+        }
+        delay(1);
+    }
+
+    result.erases = storage.settings.stats().sectorErases + storage.log.stats().sectorErases;
+    result.suspends = storage.flash.getSuspendCount();
+    result.protocolErrors = storage.chip.stats().protocolErrors;
+    result.undefinedReads = storage.chip.stats().undefinedReads;
+
+    // What a reboot would find
+    storage.log.flush();
+    FlashKVStore settings(storage.flash, KV_ADDRESS, KV_SECTORS);
+    TemperatureLog log(storage.flash, LOG_ADDRESS, LOG_SECTORS);
+    settings.begin();
+    log.begin();
+    result.storedValue = settings.getUInt("brightness", UINT32_MAX);
+    log.query(0, UINT32_MAX, countSample, &result.loggedSamples);
+    sim::detachSpiDevice(FLASH_CS_PIN);
+}
+
+void print(Run& run) {
+    printf("%-16s %7u %6u %7u %10.2f %9.2f %7u %9u\n", run.name, run.frames, run.erases, run.lateFrames,
+           run.stallMs.percentile(99), run.stallMs.max(), run.maxIntervalMs, run.suspends);
+}
+
+}
+
+int runFlashQueueBench(int argc, char** argv) {
+    uint32_t frames = argc > 1 ? atoi(argv[1]) : 6000;
+    if (frames == 0) {
+        printf("usage: flash-queue [frames]\n");
+        return 1;
+    }
+
+    // Storage stays up to the end: the queue's worker task never exits
+    static Storage direct;
+    static Storage queued;
+    Run runs[] = {Run("loop erases"), Run("flash queue")};
+    run(direct, false, frames, runs[0]);
+    run(queued, true, frames, runs[1]);
+
+    printf("%u frames, a setting saved and %u samples logged in each (modeled time)\n", frames,
+           SAMPLES_PER_FRAME);
+    printf("Stall is the loop's time on storage in a frame, gap the time between frames (ms)\n");
+    printf("%-16s %7s %6s %7s %10s %9s %7s %9s\n", "storage", "frames", "erases", "late", "stall p99", "max",
+           "gap max", "suspends");
+    for (Run& run : runs) {
+        print(run);
+    }
+    printf("\n");
+
+    bool ok = true;
+    for (Run& run : runs) {
+        bool intact = run.storedValue == run.lastValue && run.loggedSamples == runs[0].loggedSamples;
+        printf("%s: setting %s, %u samples after remount, %u protocol errors, %u undefined bytes read\n",
+               run.name, run.storedValue == run.lastValue ? "kept" : "LOST", run.loggedSamples,
+               run.protocolErrors, run.undefinedReads);
+        ok = ok && intact && run.protocolErrors == 0 && run.undefinedReads == 0;
+    }
+    return ok ? 0 : 1;
+}
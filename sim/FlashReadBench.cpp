@@ -0,0 +1,96 @@
+#include "Flash25Q128JV.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+// Compares the read path against the original implementation: 0x03 READ at
+// 1MHz with one SPI.transfer() call per byte.
+namespace {
+
+void legacyRead(uint32_t address, uint8_t* buffer, uint32_t length) {
+    SPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(FLASH_CS_PIN, LOW);
+    SPI.transfer(FLASH_CMD_READ_DATA);
+    SPI.transfer((address >> 16) & 0xFF);
+    SPI.transfer((address >> 8) & 0xFF);
+    SPI.transfer(address & 0xFF);
+    for (uint32_t i = 0; i < length; i++) {
+        buffer[i] = SPI.transfer(0);
+    }
+    digitalWrite(FLASH_CS_PIN, HIGH);
+    SPI.endTransaction();
+}
+
+const char* modeName(FlashReadMode mode) {
+    switch (mode) {
+        case FLASH_READ_STANDARD:    return "read 0x03";
+        case FLASH_READ_FAST:        return "fast 0x0B";
+        case FLASH_READ_DUAL_OUTPUT: return "dual 0x3B";
+        case FLASH_READ_QUAD_OUTPUT: return "quad 0x6B";
+    }
+    return "?";
+}
+
+double mbPerSecond(uint32_t bytes, uint64_t ns) {
+    return ns ? (bytes / (1024.0 * 1024.0)) / (ns / 1e9) : 0;
+}
+
+}
+
+int runFlashReadBench(int argc, char** argv) {
+    uint32_t length = argc > 1 ? (uint32_t)atoi(argv[1]) * 1024 : 64 * 1024;
+    const uint32_t address = 0x100000;
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    for (uint32_t i = 0; i < length; i++) {
+        chip.memory()[address + i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> buffer(length);
+
+    uint64_t start = sim::nowNs();
+    legacyRead(address, buffer.data(), length);
+    uint64_t legacyNs = sim::nowNs() - start;
+
+    printf("Reading %u KB (modeled ESP32 + W25Q128JV time)\n\n", length / 1024);
+    printf("%-12s %9s %10s %9s %8s\n", "mode", "clock", "time", "MB/s", "speedup");
+    printf("%-12s %6.1fMHz %8.2fms %9.3f %7.1fx\n", "legacy loop", 1.0, legacyNs / 1e6,
+           mbPerSecond(length, legacyNs), 1.0);
+
+    const FlashReadMode modes[] = {
+        FLASH_READ_STANDARD, FLASH_READ_FAST, FLASH_READ_DUAL_OUTPUT, FLASH_READ_QUAD_OUTPUT};
+    const uint32_t clocks[] = {1000000, 10000000, 20000000, 40000000, 80000000};
+
+    for (FlashReadMode mode : modes) {
+        if (!flash.setReadMode(mode)) {
+            printf("%-12s unavailable\n", modeName(mode));
+            continue;
+        }
+        for (uint32_t clock : clocks) {
+            // 0x03 is only specified up to 50MHz
+            if (mode == FLASH_READ_STANDARD && clock > 50000000) continue;
+
+            flash.setClock(clock);
+            memset(buffer.data(), 0, length);
+            uint32_t errors = chip.stats().protocolErrors;
+
+            start = sim::nowNs();
+            flash.read(address, buffer.data(), length);
+            uint64_t ns = sim::nowNs() - start;
+
+            bool ok = chip.stats().protocolErrors == errors &&
+                      memcmp(buffer.data(), chip.memory() + address, length) == 0;
+            printf("%-12s %6.1fMHz %8.2fms %9.3f %7.1fx%s\n", modeName(mode), clock / 1e6, ns / 1e6,
+                   mbPerSecond(length, ns), (double)legacyNs / ns, ok ? "" : "  DATA MISMATCH");
+        }
+    }
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return 0;
+}
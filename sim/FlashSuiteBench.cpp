@@ -0,0 +1,200 @@
+#include "BenchStats.h"
+#include "Flash25Q128JV.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+// Throughput and per-operation latency of Flash25Q128JV for the access
+// patterns the firmware uses, plus an integrity pass of unaligned writes
+// checked against a shadow copy. Usage:
+//   flash-suite [typical|max|jitter] [image-file]
+namespace {
+
+constexpr uint32_t REGION = FLASH_ASSETS_ADDR;
+constexpr uint32_t REGION_SIZE = 2 * 1024 * 1024;
+
+struct Pattern {
+    const char* name;
+    uint32_t operations;
+    uint32_t size;
+};
+
+struct Outcome {
+    BenchSamples latencyUs;
+    uint64_t bytes = 0;
+    uint64_t ns = 0;
+};
+
+void printHeader() {
+    printf("  %-20s %6s %9s %9s %9s %9s %9s\n", "pattern", "ops", "MB/s", "p50 us", "p99 us",
+           "max us", "mean us");
+}
+
+void printRow(const char* name, Outcome& outcome) {
+    printf("  %-20s %6zu %9.3f %9.1f %9.1f %9.1f %9.1f\n", name, outcome.latencyUs.count(),
+           outcome.bytes / (outcome.ns / 1e9) / (1024.0 * 1024.0),
+           outcome.latencyUs.percentile(50), outcome.latencyUs.percentile(99),
+           outcome.latencyUs.max(), outcome.latencyUs.mean());
+}
+
+// Times fn(i) once per operation
+template <typename Fn>
+void measure(Outcome& outcome, uint32_t operations, uint32_t bytesPerOp, Fn fn) {
+    uint64_t start = sim::nowNs();
+    for (uint32_t i = 0; i < operations; i++) {
+        uint64_t t0 = sim::nowNs();
+        fn(i);
+        outcome.latencyUs.add((sim::nowNs() - t0) / 1000.0);
+    }
+    outcome.ns = sim::nowNs() - start;
+    outcome.bytes = (uint64_t)operations * bytesPerOp;
+}
+
+uint32_t randomOffset(uint32_t span, uint32_t align) {
+    return ((uint32_t)random(0, span / align)) * align;
+}
+
+// Random unaligned writes into an erased region, mirrored into a shadow copy
+// with program (AND) semantics, then read back in random unaligned chunks
+bool integrityPass(Flash25Q128JV& flash, uint32_t& writes) {
+    const uint32_t span = 256 * 1024;
+    std::vector<uint8_t> shadow(span, 0xFF);
+    std::vector<uint8_t> data(FLASH_PAGE_SIZE * 3);
+
+    flash.eraseRange(REGION, span);
+    for (writes = 0; writes < 2000; writes++) {
+        uint32_t length = random(1, data.size());
+        uint32_t offset = random(0, span - length);
+        for (uint32_t i = 0; i < length; i++) {
+            data[i] = random(0, 256);
+            shadow[offset + i] &= data[i];
+        }
+        if (!flash.write(REGION + offset, data.data(), length)) return false;
+    }
+
+    for (uint32_t offset = 0; offset < span;) {
+        uint32_t length = min<uint32_t>(random(1, 5000), span - offset);
+        if (!flash.read(REGION + offset, data.data(), min<uint32_t>(length, data.size()))) return false;
+        if (memcmp(data.data(), &shadow[offset], min<uint32_t>(length, data.size())) != 0) return false;
+        offset += min<uint32_t>(length, data.size());
+    }
+    return true;
+}
+
+}
+
+int runFlashSuiteBench(int argc, char** argv) {
+    W25QSim chip;
+    W25QSim::TimingMode mode = W25QSim::TIMING_TYPICAL;
+    const char* modeName = "typical";
+    if (argc > 1) {
+        modeName = argv[1];
+        if (strcmp(argv[1], "max") == 0) mode = W25QSim::TIMING_MAX;
+        else if (strcmp(argv[1], "jitter") == 0) mode = W25QSim::TIMING_JITTER;
+        else if (strcmp(argv[1], "typical") != 0) {
+            printf("unknown timing mode '%s' (typical, max, jitter)\n", argv[1]);
+            return 1;
+        }
+    }
+    if (argc > 2 && !chip.attachImage(argv[2])) {
+        printf("cannot load image %s\n", argv[2]);
+        return 1;
+    }
+    chip.setTimingMode(mode);
+
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+    randomSeed(42);
+
+    printf("Flash25Q128JV at %.0fMHz, read mode %d, %s timing (modeled time)\n",
+           flash.getClock() / 1e6, flash.getReadMode(), modeName);
+
+    std::vector<uint8_t> buffer(64 * 1024);
+    for (size_t i = 0; i < buffer.size(); i++) buffer[i] = (uint8_t)(i * 7);
+
+    printf("\nRead\n");
+    printHeader();
+    const Pattern reads[] = {
+        {"sequential 64KB", 32, 64 * 1024},
+        {"sequential 4KB", 256, 4096},
+        {"random 256B", 2000, 256},
+        {"random 16B", 5000, 16},
+    };
+    for (const Pattern& pattern : reads) {
+        Outcome outcome;
+        uint32_t cursor = 0;
+        bool sequential = strncmp(pattern.name, "sequential", 10) == 0;
+        measure(outcome, pattern.operations, pattern.size, [&](uint32_t) {
+            uint32_t offset = sequential ? cursor : randomOffset(REGION_SIZE - pattern.size, 1);
+            cursor = (cursor + pattern.size) % REGION_SIZE;
+            flash.read(REGION + offset, buffer.data(), pattern.size);
+        });
+        printRow(pattern.name, outcome);
+    }
+
+    printf("\nProgram (into erased flash)\n");
+    printHeader();
+    const Pattern programs[] = {
+        {"sequential 4KB", 64, 4096},
+        {"sequential 256B", 512, 256},
+        {"random 16B", 1000, 16},
+    };
+    for (const Pattern& pattern : programs) {
+        flash.eraseRange(REGION, REGION_SIZE / 2);
+        Outcome outcome;
+        bool sequential = strncmp(pattern.name, "sequential", 10) == 0;
+        measure(outcome, pattern.operations, pattern.size, [&](uint32_t i) {
+            uint32_t offset = sequential ? i * pattern.size : randomOffset(REGION_SIZE / 2 - pattern.size, 1);
+            flash.write(REGION + offset, buffer.data(), pattern.size);
+        });
+        printRow(pattern.name, outcome);
+    }
+
+    printf("\nErase\n");
+    printHeader();
+    const Pattern erases[] = {
+        {"4KB sector", 32, FLASH_SECTOR_SIZE},
+        {"32KB block", 16, FLASH_BLOCK32_SIZE},
+        {"64KB block", 16, FLASH_BLOCK64_SIZE},
+    };
+    for (const Pattern& pattern : erases) {
+        Outcome outcome;
+        measure(outcome, pattern.operations, pattern.size, [&](uint32_t i) {
+            uint32_t address = REGION + (i * pattern.size) % REGION_SIZE;
+            flash.startBlockErase(address, pattern.size);
+            flash.waitUntilReady();
+        });
+        printRow(pattern.name, outcome);
+    }
+
+    printf("\nRead-modify-write of one 4KB sector (erase + 16 page programs)\n");
+    printHeader();
+    {
+        Outcome outcome;
+        measure(outcome, 32, FLASH_SECTOR_SIZE, [&](uint32_t i) {
+            uint32_t address = REGION + randomOffset(REGION_SIZE, FLASH_SECTOR_SIZE);
+            flash.read(address, buffer.data(), FLASH_SECTOR_SIZE);
+            buffer[i % FLASH_SECTOR_SIZE] ^= 0x01;
+            flash.eraseSector(address);
+            flash.write(address, buffer.data(), FLASH_SECTOR_SIZE);
+        });
+        printRow("update 4KB", outcome);
+    }
+
+    uint32_t writes = 0;
+    bool intact = integrityPass(flash, writes);
+    printf("\nIntegrity: %u unaligned writes across page boundaries %s\n", writes,
+           intact ? "read back intact" : "MISMATCH");
+    printf("Protocol errors: %u\n", chip.stats().protocolErrors);
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    if (argc > 2 && !chip.saveImage()) {
+        printf("cannot save image %s\n", argv[2]);
+        return 1;
+    }
+    return intact ? 0 : 1;
+}
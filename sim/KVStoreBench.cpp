@@ -0,0 +1,164 @@
+#include "FlashKVStore.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+#include <map>
+#include <string>
+
+// Settings-style workload against FlashKVStore: a handful of small keys
+// updated at random, compared with rewriting a settings sector per change.
+namespace {
+
+const char* const KEYS[] = {
+    "light.bright", "light.temp", "pomo.work", "pomo.break", "wifi.ok", "wifi.sync"
+};
+constexpr uint8_t KEY_COUNT = sizeof(KEYS) / sizeof(KEYS[0]);
+constexpr uint32_t RATED_ERASE_CYCLES = 100000;
+
+bool verify(FlashKVStore& store, const std::map<std::string, uint32_t>& expected) {
+    for (const auto& item : expected) {
+        if (store.getUInt(item.first.c_str(), ~item.second) != item.second) {
+            printf("  mismatch for %s\n", item.first.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int runKVStoreBench(int argc, char** argv) {
+    uint32_t updates = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    FlashKVStore store(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+    store.begin();
+
+    std::map<std::string, uint32_t> expected;
+    srand(1);
+    chip.resetStats();
+    uint64_t start = sim::nowNs();
+    uint64_t worstNs = 0;
+
+    for (uint32_t i = 0; i < updates; i++) {
+        const char* key = KEYS[rand() % KEY_COUNT];
+        uint32_t value = rand() % 101;
+
+        uint64_t t0 = sim::nowNs();
+        if (!store.putUInt(key, value)) {
+            printf("put failed at update %u\n", i);
+            return 1;
+        }
+        worstNs = max<uint64_t>(worstNs, sim::nowNs() - t0);
+        expected[key] = value;
+    }
+
+    uint64_t totalNs = sim::nowNs() - start;
+    const W25QSim::Stats& flashStats = chip.stats();
+    const FlashKVStore::Stats& kvStats = store.stats();
+
+    uint32_t maxWear = 0;
+    uint32_t firstSector = FLASH_SETTINGS_ADDR / FLASH_SECTOR_SIZE;
+    for (uint32_t s = firstSector; s < firstSector + FLASH_SETTINGS_SECTORS; s++) {
+        maxWear = max(maxWear, chip.sectorEraseCount(s));
+    }
+
+    printf("FlashKVStore: %u updates over %u keys, %u sector ring\n\n", updates, KEY_COUNT,
+           FLASH_SETTINGS_SECTORS);
+    printf("  appended records     %u (%u unchanged values skipped)\n",
+           (unsigned)kvStats.appendedRecords, (unsigned)kvStats.skippedWrites);
+    printf("  page programs        %u (%.3f per update)\n", flashStats.pagePrograms,
+           (double)flashStats.pagePrograms / updates);
+    printf("  sector erases        %u (%.4f per update, %u GC runs)\n", flashStats.sectorErases,
+           (double)flashStats.sectorErases / updates, (unsigned)kvStats.gcRuns);
+    printf("  mean update time     %.3f ms\n", totalNs / 1e6 / updates);
+    printf("  worst update time    %.3f ms\n", worstNs / 1e6);
+    printf("  most worn sector     %u erases\n", maxWear);
+    if (maxWear) {
+        printf("  projected endurance  %.0f updates to %u cycles\n",
+               (double)updates * RATED_ERASE_CYCLES / maxWear, RATED_ERASE_CYCLES);
+    }
+
+    // Baseline: erase the settings sector and rewrite the record block
+    uint8_t block[64];
+    memset(block, 0x5A, sizeof(block));
+    uint64_t t0 = sim::nowNs();
+    const uint32_t baselineUpdates = 20;
+    for (uint32_t i = 0; i < baselineUpdates; i++) {
+        flash.eraseSector(FLASH_SETTINGS_ADDR);
+        flash.write(FLASH_SETTINGS_ADDR, block, sizeof(block));
+    }
+    double baselineMs = (sim::nowNs() - t0) / 1e6 / baselineUpdates;
+    printf("\nErase-rewrite baseline\n");
+    printf("  mean update time     %.3f ms (%.0fx slower)\n", baselineMs,
+           baselineMs / (totalNs / 1e6 / updates));
+    printf("  projected endurance  %u updates to %u cycles\n\n", RATED_ERASE_CYCLES, RATED_ERASE_CYCLES);
+
+    // The baseline trashed the first ring sector; rebuild on a fresh chip image
+    // by replaying the shadow copy, then check mount and recovery
+    store.format();
+    for (const auto& item : expected) {
+        store.putUInt(item.first.c_str(), item.second);
+    }
+    for (uint32_t i = 0; i < 3000; i++) {
+        const char* key = KEYS[rand() % KEY_COUNT];
+        uint32_t value = rand() % 101;
+        store.putUInt(key, value);
+        expected[key] = value;
+    }
+
+    FlashKVStore remounted(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+    t0 = sim::nowNs();
+    remounted.begin();
+    printf("Mount\n");
+    printf("  mount time           %.2f ms\n", (sim::nowNs() - t0) / 1e6);
+    printf("  values intact        %s\n", verify(remounted, expected) ? "yes" : "NO");
+
+    // Power cut in the middle of an update: the old value must survive
+    uint32_t previous = expected["pomo.work"];
+    chip.armTornProgram(6);
+    remounted.putUInt("pomo.work", previous + 1);
+    FlashKVStore recovered(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+    recovered.begin();
+    bool rolledBack = recovered.getUInt("pomo.work", 0) == previous;
+    bool writable = recovered.putUInt("pomo.work", previous + 2) &&
+                    recovered.getUInt("pomo.work", 0) == previous + 2;
+    expected["pomo.work"] = previous + 2;
+    printf("  torn update          %s, %u corrupt record(s) skipped\n",
+           rolledBack && writable && verify(recovered, expected) ? "recovered" : "NOT RECOVERED",
+           (unsigned)recovered.stats().corruptRecords);
+
+    // A cut that loses a record's magic byte but lands the rest: the first
+    // one moves the log head to a page start, the second leaves that page
+    // start reading erased with programmed bytes behind it
+    bool survived = true;
+    for (uint32_t cut = 0; cut < 2; cut++) {
+        uint32_t value = expected["pomo.work"];
+        FlashKVStore torn(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+        torn.begin();
+        chip.armTornProgram(FLASH_PAGE_SIZE, 1);
+        torn.putUInt("pomo.work", value + 1);
+        
+        FlashKVStore afterCut(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+        afterCut.begin();
+        survived = survived && afterCut.getUInt("pomo.work", 0) == value &&
+                   afterCut.putUInt("pomo.work", value + 2);
+        expected["pomo.work"] = value + 2;
+        
+        FlashKVStore afterWrite(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+        afterWrite.begin();
+        survived = survived && verify(afterWrite, expected);
+    }
+    printf("  torn page start      %s\n", survived ? "recovered" : "NOT RECOVERED");
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return 0;
+}
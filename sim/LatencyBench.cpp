@@ -0,0 +1,63 @@
+#include "AudioManager.h"
+#include "CYD.h"
+#include "Flash25Q128JV.h"
+#include "FlashKVStore.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "SimHost.h"
+#include "TemperatureLog.h"
+#include "TouchLatency.h"
+#include "TouchSession.h"
+#include "W25QSim.h"
+
+// Touch-to-photon latency of the real CYD code, with touches replayed on
+// the simulated panel: each reading drives PENIRQ and the sampler task, the
+// loop runs CYD::update() every 16ms as main.cpp does, and TouchLatency
+// reports the stages as it does on the device. The input is a trace of
+// raw panel readings, "<ms> <x> <y> <z>" per line with z 0 for a lift, or
+// a built-in session of taps, drags and swipes.
+int runLatencyBench(int argc, char** argv) {
+    std::vector<sim::PanelReading> trace;
+    if (argc > 1) {
+        if (!sim::loadPanelReadings(argv[1], trace)) {
+            printf("cannot read %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        trace = sim::builtInTouchSession();
+    }
+    if (trace.empty()) {
+        printf("empty trace\n");
+        return 1;
+    }
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash begin() failed\n");
+        return 1;
+    }
+    FlashKVStore settings(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+    settings.begin();
+    TemperatureLog temperatureLog(flash, FLASH_TEMPLOG_ADDR, FLASH_TEMPLOG_SECTORS);
+    temperatureLog.begin();
+    AudioManager audio;
+
+    randomSeed(1);
+    CYD cyd(audio, settings, temperatureLog);
+    cyd.begin();
+    cyd.loadSettings();
+    cyd.drawUI();
+    TouchLatency::reset();
+
+    uint32_t start = millis();
+    uint32_t frames = sim::runTouchSession(cyd, trace, 500);
+
+    printf("Replayed %u readings over %.1f s, %u frames of 16ms\n\n", (unsigned)trace.size(),
+           (millis() - start) / 1000.0, (unsigned)frames);
+    sim::setSerialEcho(true);
+    TouchLatency::print();
+    sim::setSerialEcho(false);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "SD.h"
+#include "SimHost.h"
+#include "WiFi.h"
+#include "XPT2046_Touchscreen.h"
+
+WiFiClass WiFi;
+SDFS SD;
+
+namespace {
+
+// Below this the controller reports no touch, as XPT2046_Touchscreen does
+constexpr int16_t Z_THRESHOLD = 400;
+// PENIRQ as the CYD wires it
+constexpr uint8_t TOUCH_IRQ_PIN = 36;
+
+TS_Point s_touch;
+
+}
+
+namespace sim {
+
+void setTouch(int16_t x, int16_t y, int16_t z) {
+    s_touch = TS_Point(x, y, z);
+    setPinLevel(TOUCH_IRQ_PIN, z > 0 ? LOW : HIGH);
+}
+
+void releaseTouch() {
+    s_touch = TS_Point();
+    setPinLevel(TOUCH_IRQ_PIN, HIGH);
+}
+
+}
+
+TS_Point XPT2046_Touchscreen::getPoint() {
+    // Too light a touch reads as none
+    return s_touch.z >= Z_THRESHOLD ? s_touch : TS_Point(s_touch.x, s_touch.y, 0);
+}
+
+bool XPT2046_Touchscreen::touched() {
+    return s_touch.z >= Z_THRESHOLD;
+}
+
+bool XPT2046_Touchscreen::tirqTouched() {
+    // PENIRQ is low while the panel is pressed at all
+    return s_touch.z > 0;
+}
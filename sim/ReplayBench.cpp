@@ -0,0 +1,235 @@
+#include "AudioManager.h"
+#include "CYD.h"
+#include "Flash25Q128JV.h"
+#include "FlashKVStore.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "SimHost.h"
+#include "SimImage.h"
+#include "TemperatureLog.h"
+#include "TouchSession.h"
+#include "TouchTrace.h"
+#include "W25QSim.h"
+
+#include <cstring>
+#include <memory>
+
+// Touch record and replay end to end: the built-in session is touched on
+// the simulated panel while CYD records it into the flash trace, then the
+// trace is replayed through fresh boards, at its own pace and faster, the
+// way "touch rec" and "touch play" run on the device. Each pass reports
+// what the UI cost and whether it ended on the same screen. Usage:
+//   replay [TRACE.trc] [--speed N] [--save PATH]
+// TRACE.trc, as saved by "touch save" or --save, is replayed instead of
+// recording the built-in session.
+namespace {
+
+constexpr uint32_t SETTLE_MS = 500;
+
+struct Options {
+    const char* tracePath = nullptr;
+    const char* savePath = nullptr;
+    uint8_t speed = 4;
+};
+
+// Flash, settings and UI of one device, booted as main.cpp does
+struct Board {
+    W25QSim chip;
+    Flash25Q128JV flash;
+    FlashKVStore settings;
+    TemperatureLog temperatureLog;
+    TouchTrace trace;
+    AudioManager audio;
+    CYD cyd;
+
+    Board()
+        : settings(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS)
+        , temperatureLog(flash, FLASH_TEMPLOG_ADDR, FLASH_TEMPLOG_SECTORS)
+        , trace(flash, FLASH_TOUCH_TRACE_ADDR, FLASH_TOUCH_TRACE_SIZE)
+        , cyd(audio, settings, temperatureLog) {
+    }
+
+    bool begin() {
+        sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+        if (!flash.begin()) return false;
+        settings.begin();
+        temperatureLog.begin();
+        trace.begin();
+        randomSeed(1);
+        cyd.begin();
+        cyd.loadSettings();
+        cyd.drawUI();
+        return true;
+    }
+};
+
+struct Pass {
+    const char* name;
+    uint32_t frames;
+    BenchSamples updateMicros;
+    sim::DrawCost cost;
+    sim::Image screen;
+
+    explicit Pass(const char* name) : name(name), frames(0), cost() {}
+};
+
+// The trace as a file: its header, then the records, as "touch save" writes
+std::vector<uint8_t> exportTrace(TouchTrace& trace) {
+    std::vector<uint8_t> bytes;
+    const TouchTrace::Header& header = trace.header();
+    const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+    bytes.insert(bytes.end(), headerBytes, headerBytes + sizeof(header));
+    TouchRecord record;
+    for (uint32_t i = 0; i < trace.count() && trace.read(i, record); i++) {
+        const uint8_t* recordBytes = reinterpret_cast<const uint8_t*>(&record);
+        bytes.insert(bytes.end(), recordBytes, recordBytes + sizeof(record));
+    }
+    return bytes;
+}
+
+// As "touch load" does
+bool importTrace(TouchTrace& trace, const std::vector<uint8_t>& bytes) {
+    TouchTrace::Header header;
+    if (bytes.size() < sizeof(header)) return false;
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (!TouchTrace::isValid(header) || bytes.size() < sizeof(header) + header.count * sizeof(TouchRecord) ||
+        !trace.startRecording()) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header.count; i++) {
+        TouchRecord record;
+        memcpy(&record, bytes.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+        if (!trace.append(record)) return false;
+    }
+    return trace.stopRecording();
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+bool writeFile(const char* path, const std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+// The main screen's temperature readout follows a simulated sensor, not the
+// touches; blanked so passes that ran at other times compare equal
+void maskTemperature(sim::Image& screen) {
+    for (int16_t y = 150; y < 200 && y < screen.height; y++) {
+        for (int16_t x = SLIDER_X - 5; x < SLIDER_X - 5 + SLIDER_WIDTH + 100 && x < screen.width; x++) {
+            screen.pixels[y * screen.width + x] = 0;
+        }
+    }
+}
+
+// Runs the loop over a session, from the panel or a replay already started
+void runPass(Board& board, const std::vector<sim::PanelReading>& readings, Pass& pass) {
+    sim::resetDrawCosts();
+    pass.frames = sim::runTouchSession(board.cyd, readings, SETTLE_MS, &pass.updateMicros);
+    pass.cost = sim::totalDrawCost();
+    int16_t width, height;
+    const uint16_t* pixels = sim::displayPixels(&width, &height);
+    pass.screen = sim::captureImage(pixels, width, height);
+    maskTemperature(pass.screen);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            int speed = atoi(argv[++i]);
+            if (speed < 1 || speed > 255) return false;
+            options.speed = speed;
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            options.savePath = argv[++i];
+        } else if (argv[i][0] != '-' && !options.tracePath) {
+            options.tracePath = argv[i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int runReplayBench(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printf("usage: replay [TRACE.trc] [--speed N] [--save PATH]\n");
+        return 1;
+    }
+
+    // Boards stay up to the end: their sampler tasks never exit
+    std::vector<std::unique_ptr<Board>> boards;
+    std::vector<std::unique_ptr<Pass>> passes;
+    std::vector<uint8_t> traceFile;
+
+    if (options.tracePath) {
+        if (!readFile(options.tracePath, traceFile)) {
+            printf("cannot read %s\n", options.tracePath);
+            return 1;
+        }
+    } else {
+        boards.emplace_back(new Board());
+        Board& board = *boards.back();
+        if (!board.begin() || !board.cyd.startTouchRecording(board.trace)) {
+            printf("cannot record on the simulated board\n");
+            return 1;
+        }
+        passes.emplace_back(new Pass("live, recording"));
+        runPass(board, sim::builtInTouchSession(), *passes.back());
+        board.cyd.stopTouchTrace();
+        traceFile = exportTrace(board.trace);
+        printf("Recorded %u touches over %.1f s into %u bytes of flash\n", (unsigned)board.trace.count(),
+               board.trace.header().durationMicros / 1000000.0, (unsigned)traceFile.size());
+    }
+    if (options.savePath && !writeFile(options.savePath, traceFile)) {
+        printf("cannot write %s\n", options.savePath);
+        return 1;
+    }
+
+    static char fastName[32];
+    snprintf(fastName, sizeof(fastName), "replay %ux", (unsigned)options.speed);
+    const uint8_t speeds[] = {1, options.speed};
+    const char* names[] = {"replay 1x", fastName};
+    for (int i = 0; i < 2; i++) {
+        boards.emplace_back(new Board());
+        Board& board = *boards.back();
+        if (!board.begin() || !importTrace(board.trace, traceFile) ||
+            !board.cyd.startTouchReplay(board.trace, speeds[i])) {
+            printf("cannot replay the trace\n");
+            return 1;
+        }
+        passes.emplace_back(new Pass(names[i]));
+        runPass(board, {}, *passes.back());
+    }
+
+    // Against the first pass; a faster replay may draw less on the way, but
+    // should end on the same screen
+    printf("\npass               frames  update ms: mean    p99    max   Mpx drawn   SPI KB   end screen\n");
+    for (std::unique_ptr<Pass>& pass : passes) {
+        sim::ImageDiff diff = sim::diffImages(passes.front()->screen, pass->screen);
+        printf("%-18s %6u %16.2f %6.2f %6.2f %11.2f %8.1f   ", pass->name, (unsigned)pass->frames,
+               pass->updateMicros.mean() / 1000.0, pass->updateMicros.percentile(99) / 1000.0,
+               pass->updateMicros.max() / 1000.0, pass->cost.pixels / 1e6, pass->cost.busBytes / 1024.0);
+        if (pass == passes.front()) {
+            printf("reference\n");
+        } else if (diff.sizeMismatch || diff.pixels > 0) {
+            printf("%u px differ\n", (unsigned)diff.pixels);
+        } else {
+            printf("same\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "SPI.h"
+#include "SimHost.h"
+
+SPIClass SPI(VSPI);
+
+SPIClass::SPIClass(uint8_t spi_bus)
+    : _bus(spi_bus)
+    , _clock(1000000)
+    , _dataLines(1)
+    , _inTransaction(false) {
+}
+
+void SPIClass::begin(int8_t, int8_t, int8_t, int8_t) {
+}
+
+void SPIClass::end() {
+}
+
+void SPIClass::beginTransaction(SPISettings settings) {
+    _clock = settings._clock ? settings._clock : 1000000;
+    _inTransaction = true;
+    sim::advanceNs(sim::spiCostModel().transactionNs / 2);
+}
+
+void SPIClass::endTransaction() {
+    _inTransaction = false;
+    sim::advanceNs(sim::spiCostModel().transactionNs / 2);
+}
+
+uint8_t SPIClass::exchange(uint8_t data) {
+    // Eight bits spread over the active data lines
+    sim::advanceNs((8ULL * 1000000000ULL) / ((uint64_t)_clock * _dataLines));
+
+    sim::SpiDevice* device = sim::selectedSpiDevice();
+    return device ? device->exchange(data, _dataLines) : 0xFF;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    sim::advanceNs(sim::spiCostModel().callNs);
+    return exchange(data);
+}
+
+void SPIClass::transfer(void* data, uint32_t size) {
+    transferBytes((const uint8_t*)data, (uint8_t*)data, size);
+}
+
+void SPIClass::transferBytes(const uint8_t* data, uint8_t* out, uint32_t size) {
+    const sim::SpiCostModel& cost = sim::spiCostModel();
+    sim::advanceNs(cost.callNs + (uint64_t)cost.fifoChunkNs * ((size + 63) / 64));
+
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t rx = exchange(data ? data[i] : 0xFF);
+        if (out) out[i] = rx;
+    }
+}
+
+void SPIClass::writeBytes(const uint8_t* data, uint32_t size) {
+    transferBytes(data, nullptr, size);
+}
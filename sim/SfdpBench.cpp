@@ -0,0 +1,140 @@
+#include "Flash25Q128JV.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+// begin() against a few simulated parts that differ in their SFDP tables:
+// what the driver configures, what the probe costs, and whether reads,
+// erases and programs work right up to the top of each chip.
+namespace {
+
+constexpr uint32_t READ_SIZE = 64 * 1024;
+constexpr uint32_t ERASE_SIZE = 256 * 1024;
+
+struct Profile {
+    const char* name;
+    uint32_t size;
+    uint32_t jedecId;
+    void (*setup)(W25QSim& chip);
+};
+
+const Profile PROFILES[] = {
+    {"W25Q128JV", 16 * 1024 * 1024, 0xEF4018, [](W25QSim&) {}},
+    // QE written as the second byte of 0x01, like GigaDevice parts
+    {"GD25Q128-like", 16 * 1024 * 1024, 0xC84018, [](W25QSim& chip) {
+        chip.setSfdpDword(15, 1 << 20);
+    }},
+    // Above 16MB: 3 or 4 byte addressing, switched with 0xB7
+    {"W25Q256-like", 32 * 1024 * 1024, 0xEF4019, [](W25QSim&) {}},
+    // Single-line reads only, no 32KB erase, no suspend
+    {"basic 8MB", 8 * 1024 * 1024, 0x204017, [](W25QSim& chip) {
+        chip.setSfdpDword(1, chip.sfdpDword(1) & ~((1u << 16) | (1u << 22)));
+        chip.setSfdpDword(8, 0x0000200C);
+        chip.setSfdpDword(12, chip.sfdpDword(12) | 0x80000000);
+    }},
+    // Known ID, no SFDP: datasheet defaults
+    {"W25Q128 no SFDP", 16 * 1024 * 1024, 0xEF4018, [](W25QSim& chip) { chip.sfdp().clear(); }},
+    // Unknown ID, no SFDP: must refuse to start
+    {"unknown no SFDP", 16 * 1024 * 1024, 0x1F8501, [](W25QSim& chip) { chip.sfdp().clear(); }},
+};
+
+const char* modeName(FlashReadMode mode) {
+    switch (mode) {
+        case FLASH_READ_STANDARD:    return "read";
+        case FLASH_READ_FAST:        return "fast";
+        case FLASH_READ_DUAL_OUTPUT: return "dual";
+        case FLASH_READ_QUAD_OUTPUT: return "quad";
+    }
+    return "?";
+}
+
+double mbPerSecond(uint32_t bytes, uint64_t ns) {
+    return ns ? (bytes / (1024.0 * 1024.0)) / (ns / 1e9) : 0;
+}
+
+// Programs the last page of the chip through the driver and checks the bytes
+// landed there (and not at a truncated 3 byte address)
+bool verifyTopPage(Flash25Q128JV& flash, W25QSim& chip) {
+    uint32_t page = chip.size() - FLASH_PAGE_SIZE;
+    uint8_t pattern[FLASH_PAGE_SIZE];
+    for (uint32_t i = 0; i < sizeof(pattern); i++) pattern[i] = (uint8_t)(i * 13 + 1);
+
+    if (!flash.eraseSector(page) || !flash.write(page, pattern, sizeof(pattern))) {
+        return false;
+    }
+    uint8_t readBack[FLASH_PAGE_SIZE];
+    if (!flash.read(page, readBack, sizeof(readBack)) || memcmp(readBack, pattern, sizeof(pattern)) != 0 ||
+        memcmp(chip.memory() + page, pattern, sizeof(pattern)) != 0) {
+        return false;
+    }
+
+    // Above 16MB the same page at the 3 byte alias must be untouched
+    if (chip.size() > (1u << 24)) {
+        const uint8_t* alias = chip.memory() + (page & 0xFFFFFF);
+        for (uint32_t i = 0; i < FLASH_PAGE_SIZE; i++) {
+            if (alias[i] != 0xFF) return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int runSfdpBench(int, char**) {
+    printf("%-16s %-8s %5s %6s %7s %-28s %4s %8s %7s   %s\n", "part", "source", "size", "addr",
+           "probe", "erase types", "read", "MB/s", "suspend", "erase plan / top page");
+
+    for (const Profile& profile : PROFILES) {
+        W25QSim chip(profile.size, profile.jedecId);
+        profile.setup(chip);
+        sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+
+        Flash25Q128JV flash;
+        uint64_t start = sim::nowNs();
+        bool started = flash.begin();
+        uint64_t probeNs = sim::nowNs() - start;
+        if (!started) {
+            printf("%-16s begin() failed after %.1fms, as expected for an unidentified part\n",
+                   profile.name, probeNs / 1e6);
+            sim::detachSpiDevice(FLASH_CS_PIN);
+            continue;
+        }
+
+        const FlashParameters& params = flash.getParameters();
+        char source[16];
+        if (params.fromSfdp) {
+            snprintf(source, sizeof(source), "SFDP %u.%u", params.sfdpMajor, params.sfdpMinor);
+        } else {
+            snprintf(source, sizeof(source), "defaults");
+        }
+        char erases[48] = "";
+        for (const FlashEraseType& type : params.erase) {
+            if (type.size == 0) continue;
+            char entry[24];
+            snprintf(entry, sizeof(entry), "%uK/%ums ", (unsigned)(type.size / 1024), type.typicalMs);
+            strncat(erases, entry, sizeof(erases) - strlen(erases) - 1);
+        }
+
+        // Sequential read from the top of the chip
+        std::vector<uint8_t> buffer(READ_SIZE);
+        start = sim::nowNs();
+        flash.read(flash.getCapacity() - READ_SIZE, buffer.data(), READ_SIZE);
+        uint64_t readNs = sim::nowNs() - start;
+
+        // Erase the top 256KB with its first 32KB programmed: one 32KB erase
+        // where the part has one, a 64KB erase otherwise
+        uint32_t region = flash.getCapacity() - ERASE_SIZE;
+        memset(chip.memory() + region, 0x00, FLASH_BLOCK32_SIZE);
+        FlashEraseReport report;
+        bool erased = flash.eraseRange(region, ERASE_SIZE, &report) && flash.isBlank(region, ERASE_SIZE);
+
+        bool verified = verifyTopPage(flash, chip);
+        printf("%-16s %-8s %4uM %5uB %5.1fms %-28s %4s %8.2f %7s   %ux64K %ux32K %ux4K%s, top page %s\n",
+               profile.name, source, (unsigned)(params.chipSize >> 20), params.addressBytes,
+               probeNs / 1e6, erases, modeName(flash.getReadMode()), mbPerSecond(READ_SIZE, readNs),
+               params.suspendSupported ? "yes" : "no", report.blocks64, report.blocks32, report.sectors,
+               erased ? "" : " NOT BLANK", verified ? "ok" : "FAILED");
+
+        sim::detachSpiDevice(FLASH_CS_PIN);
+    }
+    return 0;
+}
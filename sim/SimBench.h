@@ -0,0 +1,17 @@
+#pragma once
+
+// Benchmarks of the host build, dispatched by name from sim/main.cpp
+int runFlashReadBench(int argc, char** argv);
+int runKVStoreBench(int argc, char** argv);
+int runEraseRangeBench(int argc, char** argv);
+int runSuspendBench(int argc, char** argv);
+int runFlashCacheBench(int argc, char** argv);
+int runFlashSuiteBench(int argc, char** argv);
+int runTemperatureLogBench(int argc, char** argv);
+int runSfdpBench(int argc, char** argv);
+int runUiBench(int argc, char** argv);
+int runTouchBench(int argc, char** argv);
+int runLatencyBench(int argc, char** argv);
+int runReplayBench(int argc, char** argv);
+int runAssetBench(int argc, char** argv);
+int runFlashQueueBench(int argc, char** argv);
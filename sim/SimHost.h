@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+
+// Virtual time and device wiring for the host build. Nothing on the host
+// actually waits: delay(), SPI clocking and the modeled chip operations all
+// advance one nanosecond clock, which the benchmarks read back.
+namespace sim {
+
+uint64_t nowNs();
+void advanceNs(uint64_t ns);
+
+// FreeRTOS tasks (sim/include/freertos/task.h) take turns with the loop, one
+// running at a time. Sleeping, by delay() or vTaskDelay(), runs every task
+// due before the sleep ends, at its wake-up time; a task woken from an
+// interrupt runs as soon as the handler returns, as it would on the other
+// core.
+void sleepNs(uint64_t ns);
+void runDueTasks();
+
+// Drives an input pin from outside the chip, e.g. an interrupt line.
+// Handlers attached for the edge run before this returns.
+void setPinLevel(uint8_t pin, uint8_t level);
+
+// A device on a simulated SPI bus, selected by its chip-select pin
+class SpiDevice {
+public:
+    virtual ~SpiDevice() {}
+    virtual void select() = 0;
+    virtual void deselect() = 0;
+    // One byte slot; 'lines' is the data-phase width the host is clocking
+    virtual uint8_t exchange(uint8_t mosi, uint8_t lines) = 0;
+};
+
+void attachSpiDevice(uint8_t csPin, SpiDevice* device);
+void detachSpiDevice(uint8_t csPin);
+SpiDevice* selectedSpiDevice();
+
+// Estimated software cost of the Arduino-ESP32 SPI driver at 240MHz. The
+// wire time is computed from the clock; these cover what happens around it.
+struct SpiCostModel {
+    uint32_t transactionNs;  // beginTransaction() + endTransaction() (bus lock, clock setup)
+    uint32_t callNs;         // fixed cost of one transfer()/transferBytes() call
+    uint32_t fifoChunkNs;    // refilling the 64 byte hardware FIFO inside a bulk call
+};
+
+SpiCostModel& spiCostModel();
+
+// The display (sim/include/TFT_eSPI.h) renders into RAM and charges every
+// drawing call what it would cost on the ST7789 link: an address window
+// (CASET/RASET/RAMWR, 11 bytes) per span it opens plus two bytes a pixel.
+// Sprite drawing stays in RAM and only costs CPU time.
+struct DisplayCostModel {
+    uint32_t spiHz;          // panel clock, SPI_FREQUENCY in platformio.ini
+    uint32_t transactionNs;  // CS and bus lock around a call outside startWrite()
+    uint32_t windowNs;       // D/C toggles and FIFO turnaround per address window
+    uint32_t callNs;         // fixed CPU cost of one drawing call
+    uint32_t ramPixelNs;     // CPU cost of a pixel written into a sprite
+};
+
+DisplayCostModel& displayCostModel();
+
+// Public TFT_eSPI entry points the costs are charged to. Nested calls
+// (drawString() drawing characters, fillRoundRect() filling spans) are
+// charged to the outermost one.
+enum DrawOp : uint8_t {
+    DRAW_FILL_SCREEN,
+    DRAW_FILL_RECT,
+    DRAW_FILL_ROUND_RECT,
+    DRAW_FILL_CIRCLE,
+    DRAW_PIXEL,
+    DRAW_FAST_HLINE,
+    DRAW_FAST_VLINE,
+    DRAW_STRING,
+    DRAW_CHAR,
+    DRAW_PUSH_IMAGE,
+    DRAW_PUSH_IMAGE_DMA,
+    DRAW_PUSH_PIXELS,
+    DRAW_PUSH_SPRITE,
+    DRAW_OP_COUNT
+};
+
+struct DrawCost {
+    uint32_t calls;
+    uint32_t windows;        // address windows opened on the panel
+    uint64_t pixels;         // written anywhere, panel or sprite
+    uint64_t busBytes;       // sent to the panel, commands included
+    uint64_t busNs;          // wire and transaction time
+};
+
+// Contents of the display init() was last called on, RGB565 at its current
+// rotation; nullptr before any init()
+const uint16_t* displayPixels(int16_t* width, int16_t* height);
+
+const char* drawOpName(DrawOp op);
+const DrawCost& drawCost(DrawOp op);
+DrawCost totalDrawCost();
+void resetDrawCosts();
+
+// Resistive touch panel. Points are given the way XPT2046_Touchscreen's
+// getPoint() reports them (raw 0-4095 after rotation); z 0 releases.
+// PENIRQ, on the CYD's GPIO 36, is low while the panel is pressed at all.
+void setTouch(int16_t x, int16_t y, int16_t z);
+void releaseTouch();
+
+// Serial output from the firmware is dropped unless echo is enabled
+void setSerialEcho(bool enabled);
+
+}
@@ -0,0 +1,486 @@
+#include "SimImage.h"
+#include "Crc32.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+void putBig32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+uint32_t getBig32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    putBig32(out, data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBig32(out, crc32Update(out.data() + start, out.size() - start));
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Length and distance codes of RFC 1951, from symbol 257 and 0
+const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                    6145, 8193, 12289, 16385, 24577};
+const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Deflate (RFC 1951) as one fixed Huffman block, with greedy LZ77 matches
+// found through a hash of the next three bytes. Screens are mostly flat
+// fills, which this takes to a few percent of their size.
+class Deflater {
+public:
+    std::vector<uint8_t> run(const std::vector<uint8_t>& in) {
+        const uint32_t WINDOW = 32768;
+        const uint32_t MAX_CHAIN = 32;
+        std::vector<int32_t> head(1 << HASH_BITS, -1);
+        std::vector<int32_t> previous(in.size(), -1);
+
+        putBits(1, 1);      // last block
+        putBits(1, 2);      // fixed Huffman codes
+        size_t pos = 0;
+        while (pos < in.size()) {
+            uint32_t bestLength = 0, bestDistance = 0;
+            if (pos + 3 <= in.size()) {
+                uint32_t hash = hashAt(in, pos);
+                uint32_t limit = std::min<size_t>(258, in.size() - pos);
+                int32_t candidate = head[hash];
+                for (uint32_t chain = 0; candidate >= 0 && pos - candidate <= WINDOW && chain < MAX_CHAIN;
+                     chain++, candidate = previous[candidate]) {
+                    uint32_t length = 0;
+                    while (length < limit && in[candidate + length] == in[pos + length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = pos - candidate;
+                        if (length == limit) break;
+                    }
+                }
+            }
+
+            uint32_t advance = bestLength >= 3 ? bestLength : 1;
+            if (bestLength >= 3) {
+                putMatch(bestLength, bestDistance);
+            } else {
+                putSymbol(in[pos]);
+            }
+            // Every position passed over goes into the hash chains
+            for (uint32_t i = 0; i < advance; i++, pos++) {
+                if (pos + 3 > in.size()) continue;
+                uint32_t hash = hashAt(in, pos);
+                previous[pos] = head[hash];
+                head[hash] = pos;
+            }
+        }
+        putSymbol(256);
+        if (m_bit) m_out.push_back(m_byte);
+        return m_out;
+    }
+
+private:
+    static constexpr uint32_t HASH_BITS = 15;
+
+    std::vector<uint8_t> m_out;
+    uint8_t m_byte = 0;
+    uint8_t m_bit = 0;
+
+    static uint32_t hashAt(const std::vector<uint8_t>& in, size_t pos) {
+        uint32_t value = in[pos] | (in[pos + 1] << 8) | (in[pos + 2] << 16);
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Extra bits and stored fields go least significant bit first
+    void putBits(uint32_t value, uint8_t count) {
+        for (uint8_t i = 0; i < count; i++) {
+            m_byte |= ((value >> i) & 1) << m_bit;
+            if (++m_bit == 8) {
+                m_out.push_back(m_byte);
+                m_byte = 0;
+                m_bit = 0;
+            }
+        }
+    }
+
+    // Huffman codes go most significant bit first
+    void putCode(uint32_t code, uint8_t length) {
+        for (uint8_t i = length; i-- > 0; ) putBits((code >> i) & 1, 1);
+    }
+
+    // The fixed literal/length code (RFC 1951, 3.2.6)
+    void putSymbol(uint32_t symbol) {
+        if (symbol < 144) putCode(0x30 + symbol, 8);
+        else if (symbol < 256) putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280) putCode(symbol - 256, 7);
+        else putCode(0xC0 + symbol - 280, 8);
+    }
+
+    void putMatch(uint32_t length, uint32_t distance) {
+        uint8_t code = 28;
+        while (LENGTH_BASE[code] > length) code--;
+        putSymbol(257 + code);
+        putBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+        code = 29;
+        while (DISTANCE_BASE[code] > distance) code--;
+        putCode(code, 5);
+        putBits(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+    }
+};
+
+// Inflate (RFC 1951): stored, fixed and dynamic Huffman blocks
+class Inflater {
+public:
+    Inflater(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_pos(0), m_bit(0) {}
+
+    bool run(std::vector<uint8_t>& out) {
+        bool last = false;
+        while (!last) {
+            last = bits(1);
+            uint32_t type = bits(2);
+            bool ok = type == 0 ? stored(out)
+                    : type == 1 ? compressed(out, fixedTables())
+                    : type == 2 ? dynamic(out)
+                    : false;
+            if (!ok || m_pos > m_size) return false;
+        }
+        return true;
+    }
+
+private:
+    struct Huffman {
+        uint16_t counts[16];
+        uint16_t symbols[320];
+    };
+
+    struct Tables {
+        Huffman literals;
+        Huffman distances;
+    };
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos;
+    uint8_t m_bit;
+
+    uint32_t bits(uint8_t count) {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t byte = m_pos < m_size ? m_data[m_pos] : 0;
+            value |= (uint32_t)((byte >> m_bit) & 1) << i;
+            if (++m_bit == 8) {
+                m_bit = 0;
+                m_pos++;
+            }
+        }
+        return value;
+    }
+
+    static void build(Huffman& h, const uint8_t* lengths, uint16_t count) {
+        uint16_t offsets[16];
+        memset(h.counts, 0, sizeof(h.counts));
+        for (uint16_t i = 0; i < count; i++) h.counts[lengths[i]]++;
+        h.counts[0] = 0;
+        offsets[1] = 0;
+        for (uint8_t len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + h.counts[len];
+        for (uint16_t i = 0; i < count; i++) {
+            if (lengths[i]) h.symbols[offsets[lengths[i]]++] = i;
+        }
+    }
+
+    int decode(const Huffman& h) {
+        int code = 0, first = 0, index = 0;
+        for (uint8_t len = 1; len < 16; len++) {
+            code |= bits(1);
+            int count = h.counts[len];
+            if (code - count < first) return h.symbols[index + (code - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    bool stored(std::vector<uint8_t>& out) {
+        if (m_bit) {
+            m_bit = 0;
+            m_pos++;
+        }
+        if (m_pos + 4 > m_size) return false;
+        uint16_t length = m_data[m_pos] | (m_data[m_pos + 1] << 8);
+        m_pos += 4;
+        if (m_pos + length > m_size) return false;
+        out.insert(out.end(), m_data + m_pos, m_data + m_pos + length);
+        m_pos += length;
+        return true;
+    }
+
+    static const Tables& fixedTables() {
+        static Tables tables;
+        static bool built = false;
+        if (!built) {
+            uint8_t lengths[288];
+            for (int i = 0; i < 144; i++) lengths[i] = 8;
+            for (int i = 144; i < 256; i++) lengths[i] = 9;
+            for (int i = 256; i < 280; i++) lengths[i] = 7;
+            for (int i = 280; i < 288; i++) lengths[i] = 8;
+            build(tables.literals, lengths, 288);
+            memset(lengths, 5, 30);
+            build(tables.distances, lengths, 30);
+            built = true;
+        }
+        return tables;
+    }
+
+    bool dynamic(std::vector<uint8_t>& out) {
+        static const uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        uint16_t literalCount = bits(5) + 257;
+        uint16_t distanceCount = bits(5) + 1;
+        uint16_t codeCount = bits(4) + 4;
+        if (literalCount > 286 || distanceCount > 30) return false;
+
+        uint8_t lengths[320] = {};
+        for (uint16_t i = 0; i < codeCount; i++) lengths[ORDER[i]] = bits(3);
+        Huffman codes;
+        build(codes, lengths, 19);
+
+        uint8_t all[320] = {};
+        uint16_t n = 0;
+        while (n < literalCount + distanceCount) {
+            int symbol = decode(codes);
+            if (symbol < 0) return false;
+            if (symbol < 16) {
+                all[n++] = symbol;
+                continue;
+            }
+            uint8_t repeat = 0;
+            uint32_t times;
+            if (symbol == 16) {
+                if (n == 0) return false;
+                repeat = all[n - 1];
+                times = 3 + bits(2);
+            } else if (symbol == 17) {
+                times = 3 + bits(3);
+            } else {
+                times = 11 + bits(7);
+            }
+            if (n + times > (uint32_t)(literalCount + distanceCount)) return false;
+            while (times--) all[n++] = repeat;
+        }
+
+        Tables tables;
+        build(tables.literals, all, literalCount);
+        build(tables.distances, all + literalCount, distanceCount);
+        return compressed(out, tables);
+    }
+
+    bool compressed(std::vector<uint8_t>& out, const Tables& tables) {
+        while (true) {
+            int symbol = decode(tables.literals);
+            if (symbol < 0 || m_pos > m_size) return false;
+            if (symbol < 256) {
+                out.push_back(symbol);
+                continue;
+            }
+            if (symbol == 256) return true;
+
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            uint32_t length = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+            int distanceSymbol = decode(tables.distances);
+            if (distanceSymbol < 0 || distanceSymbol >= 30) return false;
+            uint32_t distance = DISTANCE_BASE[distanceSymbol] + bits(DISTANCE_EXTRA[distanceSymbol]);
+            if (distance > out.size()) return false;
+            size_t from = out.size() - distance;
+            for (uint32_t i = 0; i < length; i++) out.push_back(out[from + i]);
+        }
+    }
+};
+
+uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+}
+
+namespace sim {
+
+Image captureImage(const uint16_t* pixels, int16_t width, int16_t height) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(pixels, pixels + (size_t)width * height);
+    return image;
+}
+
+bool writePng(const char* path, const Image& image) {
+    // Filter byte 0, then RGB888 expanded from RGB565
+    std::vector<uint8_t> raw;
+    raw.reserve((size_t)image.height * (image.width * 3 + 1));
+    for (int16_t y = 0; y < image.height; y++) {
+        raw.push_back(0);
+        for (int16_t x = 0; x < image.width; x++) {
+            uint16_t c = image.pixels[(size_t)y * image.width + x];
+            uint8_t r = c >> 11, g = (c >> 5) & 0x3F, b = c & 0x1F;
+            raw.push_back((r << 3) | (r >> 2));
+            raw.push_back((g << 2) | (g >> 4));
+            raw.push_back((b << 3) | (b >> 2));
+        }
+    }
+
+    // zlib stream of one deflate block
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    std::vector<uint8_t> deflated = Deflater().run(raw);
+    zlib.insert(zlib.end(), deflated.begin(), deflated.end());
+    putBig32(zlib, adler32(raw));
+
+    std::vector<uint8_t> header;
+    putBig32(header, image.width);
+    putBig32(header, image.height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});    // 8 bit RGB, no interlace
+
+    std::vector<uint8_t> file(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+    putChunk(file, "IHDR", header);
+    putChunk(file, "IDAT", zlib);
+    putChunk(file, "IEND", {});
+
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        return false;
+    }
+    bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+    return fclose(out) == 0 && written;
+}
+
+bool readPng(const char* path, Image& image) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        return false;
+    }
+    std::vector<uint8_t> file;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) file.insert(file.end(), buffer, buffer + n);
+    fclose(in);
+    if (file.size() < 8 || memcmp(file.data(), PNG_SIGNATURE, 8) != 0) {
+        return false;
+    }
+
+    uint32_t width = 0, height = 0;
+    uint8_t channels = 0;
+    std::vector<uint8_t> zlib;
+    for (size_t pos = 8; pos + 12 <= file.size(); ) {
+        uint32_t length = getBig32(&file[pos]);
+        const uint8_t* type = &file[pos + 4];
+        const uint8_t* data = &file[pos + 8];
+        if (pos + 12 + length > file.size()) return false;
+        if (memcmp(type, "IHDR", 4) == 0) {
+            width = getBig32(data);
+            height = getBig32(data + 4);
+            uint8_t depth = data[8], colorType = data[9], interlace = data[12];
+            if (depth != 8 || interlace != 0 || (colorType != 2 && colorType != 6)) return false;
+            channels = colorType == 2 ? 3 : 4;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            zlib.insert(zlib.end(), data, data + length);
+        }
+        pos += 12 + length;
+    }
+    if (!channels || width == 0 || height == 0 || width > 4096 || height > 4096 || zlib.size() < 6) {
+        return false;
+    }
+
+    std::vector<uint8_t> raw;
+    Inflater inflater(zlib.data() + 2, zlib.size() - 2);
+    size_t stride = width * channels;
+    if (!inflater.run(raw) || raw.size() < height * (stride + 1)) {
+        return false;
+    }
+
+    // Undo the per-row filters in place
+    std::vector<uint8_t> previous(stride, 0);
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height);
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t filter = raw[y * (stride + 1)];
+        uint8_t* row = &raw[y * (stride + 1) + 1];
+        for (size_t i = 0; i < stride; i++) {
+            uint8_t left = i >= channels ? row[i - channels] : 0;
+            uint8_t up = previous[i];
+            uint8_t upLeft = i >= channels ? previous[i - channels] : 0;
+            switch (filter) {
+                case 1: row[i] += left; break;
+                case 2: row[i] += up; break;
+                case 3: row[i] += (left + up) / 2; break;
+                case 4: row[i] += paeth(left, up, upLeft); break;
+            }
+        }
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* p = row + x * channels;
+            image.pixels[(size_t)y * width + x] = ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+        }
+        previous.assign(row, row + stride);
+    }
+    return true;
+}
+
+ImageDiff diffImages(const Image& expected, const Image& actual, Image* highlight) {
+    ImageDiff diff = {};
+    diff.left = actual.width;
+    diff.top = actual.height;
+    diff.right = -1;
+    diff.bottom = -1;
+    if (expected.width != actual.width || expected.height != actual.height) {
+        diff.sizeMismatch = true;
+        return diff;
+    }
+
+    if (highlight) {
+        *highlight = actual;
+    }
+    for (int16_t y = 0; y < actual.height; y++) {
+        for (int16_t x = 0; x < actual.width; x++) {
+            size_t i = (size_t)y * actual.width + x;
+            uint16_t c = actual.pixels[i];
+            bool differs = c != expected.pixels[i];
+            if (differs) {
+                diff.pixels++;
+                diff.left = std::min(diff.left, x);
+                diff.top = std::min(diff.top, y);
+                diff.right = std::max(diff.right, x);
+                diff.bottom = std::max(diff.bottom, y);
+            }
+            if (highlight) {
+                // Quarter brightness: shift each channel, drop the carried bits
+                highlight->pixels[i] = differs ? 0xF81F : (uint16_t)((c >> 2) & 0x39E7);
+            }
+        }
+    }
+    return diff;
+}
+
+}
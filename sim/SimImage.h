@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Screen captures of the host display, saved and loaded as PNG so golden
+// images can be viewed and diffed with ordinary tools
+namespace sim {
+
+struct Image {
+    int16_t width = 0;
+    int16_t height = 0;
+    std::vector<uint16_t> pixels;    // RGB565, row by row
+};
+
+// Copies width x height RGB565 pixels
+Image captureImage(const uint16_t* pixels, int16_t width, int16_t height);
+
+// Writes 8-bit RGB; compression is left to tools like optipng
+bool writePng(const char* path, const Image& image);
+// Reads 8-bit RGB or RGBA, non-interlaced, as written by writePng() or
+// recompressed by another tool
+bool readPng(const char* path, Image& image);
+
+struct ImageDiff {
+    bool sizeMismatch;
+    uint32_t pixels;                  // pixels that differ
+    int16_t left, top, right, bottom; // bounding box, right/bottom inclusive
+};
+
+// Compares two captures. With 'highlight', also builds a view of 'actual'
+// dimmed to a quarter, with the differing pixels in magenta.
+ImageDiff diffImages(const Image& expected, const Image& actual, Image* highlight = nullptr);
+
+}
@@ -0,0 +1,170 @@
+#include "BenchStats.h"
+#include "Flash25Q128JV.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "W25QSim.h"
+
+// Read latency while a background task keeps the chip busy with programs or
+// erases, the way an asset install or settings GC does on the device. Normal
+// reads queue behind the running operation, urgent reads suspend it.
+namespace {
+
+constexpr uint32_t READ_SIZE = 1024;          // one audio/asset chunk
+constexpr uint32_t READ_COUNT = 2000;
+constexpr uint32_t MEAN_READ_GAP_US = 5000;   // reads arrive ~200 per second
+constexpr uint32_t READ_REGION = FLASH_ASSETS_ADDR + 0x400000;
+constexpr uint32_t WRITE_REGION = FLASH_ASSETS_ADDR;
+constexpr uint32_t WRITE_REGION_SIZE = 1024 * 1024;
+
+struct Workload {
+    const char* name;
+    uint32_t step;      // bytes covered by one operation
+    uint32_t pollUs;    // how often the background task checks isBusy()
+};
+
+const Workload WORKLOADS[] = {
+    {"page program", FLASH_PAGE_SIZE, 50},
+    {"4KB erase", FLASH_SECTOR_SIZE, 1000},
+    {"64KB erase", FLASH_BLOCK64_SIZE, 1000},
+};
+
+struct Result {
+    BenchSamples latencyUs;
+    uint32_t operations;
+    uint64_t elapsedNs;
+    uint32_t suspends;
+    uint32_t badReads;
+};
+
+// Background task: starts the next operation whenever it notices the chip is
+// done, so the chip is busy nearly all the time
+class Background {
+public:
+    Background(Flash25Q128JV& flash, W25QSim& chip, const Workload& workload)
+        : m_flash(flash), m_chip(chip), m_workload(workload), m_offset(0), m_operations(0) {
+        memset(m_page, 0x5A, sizeof(m_page));
+    }
+
+    // Let the background task run until virtual time 'untilNs'
+    void runUntil(uint64_t untilNs) {
+        while (true) {
+            uint64_t now = sim::nowNs();
+            uint64_t pollNs = (uint64_t)m_workload.pollUs * 1000;
+            uint64_t readyNs = m_chip.isBusy() ? m_chip.busyUntilNs() + pollNs : now;
+            if (readyNs >= untilNs) break;
+            if (readyNs > now) sim::advanceNs(readyNs - now);
+            if (!m_flash.isBusy()) startNext();
+        }
+        if (untilNs > sim::nowNs()) sim::advanceNs(untilNs - sim::nowNs());
+    }
+
+    uint32_t operations() const { return m_operations; }
+    // Where the operation started last begins
+    uint32_t lastAddress() const {
+        return WRITE_REGION + (m_offset + WRITE_REGION_SIZE - m_workload.step) % WRITE_REGION_SIZE;
+    }
+
+private:
+    Flash25Q128JV& m_flash;
+    W25QSim& m_chip;
+    const Workload& m_workload;
+    uint32_t m_offset;
+    uint32_t m_operations;
+    uint8_t m_page[FLASH_PAGE_SIZE];
+
+    void startNext() {
+        uint32_t address = WRITE_REGION + m_offset;
+        if (m_workload.step == FLASH_PAGE_SIZE) {
+            // Keep programming the same page; the model doesn't care that it's not blank
+            m_flash.startPageProgram(address, m_page, sizeof(m_page));
+        } else {
+            m_flash.startBlockErase(address, m_workload.step);
+        }
+        m_offset = (m_offset + m_workload.step) % WRITE_REGION_SIZE;
+        m_operations++;
+    }
+};
+
+uint32_t randomGapUs() {
+    // Exponential inter-arrival times around the mean
+    double u = (random(1, 1000000)) / 1000000.0;
+    return (uint32_t)(-log(u) * MEAN_READ_GAP_US);
+}
+
+// With 'overlapping', every read is of the start of the erase running last,
+// which must wait for it and read erased bytes
+void run(Flash25Q128JV& flash, W25QSim& chip, const Workload& workload, FlashPriority priority, Result& result,
+         bool overlapping = false) {
+    static uint8_t buffer[READ_SIZE];
+    randomSeed(1234);
+    Background background(flash, chip, workload);
+    uint32_t suspendsBefore = flash.getSuspendCount();
+    uint64_t start = sim::nowNs();
+    result.badReads = 0;
+
+    for (uint32_t i = 0; i < READ_COUNT; i++) {
+        background.runUntil(sim::nowNs() + (uint64_t)randomGapUs() * 1000);
+
+        uint32_t address = overlapping ? background.lastAddress() : READ_REGION + random(0, 256) * READ_SIZE;
+        uint64_t issued = sim::nowNs();
+        flash.read(address, buffer, READ_SIZE, priority);
+        result.latencyUs.add((sim::nowNs() - issued) / 1000.0);
+        if (overlapping && (buffer[0] != 0xFF || memcmp(buffer, buffer + 1, READ_SIZE - 1) != 0)) {
+            result.badReads++;
+        }
+    }
+
+    // Let the last operation finish so both runs account for it
+    flash.waitUntilReady();
+    result.elapsedNs = sim::nowNs() - start;
+    result.operations = background.operations();
+    result.suspends = flash.getSuspendCount() - suspendsBefore;
+}
+
+void printRow(const char* priority, Result& result) {
+    printf("  %-8s %9.0f %9.0f %9.0f %9.0f %10.0f/s %9u\n", priority,
+           result.latencyUs.percentile(50), result.latencyUs.percentile(99),
+           result.latencyUs.percentile(99.9), result.latencyUs.max(),
+           result.operations / (result.elapsedNs / 1e9), result.suspends);
+}
+
+}
+
+int runSuspendBench(int, char**) {
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    printf("%u reads of %u bytes against a busy chip (modeled time, latency in us)\n",
+           READ_COUNT, READ_SIZE);
+
+    for (const Workload& workload : WORKLOADS) {
+        printf("\nBackground %s\n", workload.name);
+        printf("  %-8s %9s %9s %9s %9s %12s %9s\n", "priority", "p50", "p99", "p99.9", "max", "ops", "suspends");
+
+        Result normal;
+        run(flash, chip, workload, FLASH_PRIORITY_NORMAL, normal);
+        printRow("normal", normal);
+
+        Result urgent;
+        run(flash, chip, workload, FLASH_PRIORITY_URGENT, urgent);
+        printRow("urgent", urgent);
+    }
+
+    // Suspending can't help these: the driver has to wait instead
+    printf("\nUrgent reads of the sector a 4KB erase is running on\n");
+    printf("  %-8s %9s %9s %9s %9s %12s %9s\n", "priority", "p50", "p99", "p99.9", "max", "ops", "suspends");
+    Result overlapping;
+    run(flash, chip, WORKLOADS[1], FLASH_PRIORITY_URGENT, overlapping, true);
+    printRow("urgent", overlapping);
+    printf("  %u of %u reads not erased\n", overlapping.badReads, READ_COUNT);
+
+    printf("\nprotocol errors: %u, bytes read from a suspended operation: %u\n", chip.stats().protocolErrors,
+           chip.stats().undefinedReads);
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return 0;
+}
@@ -0,0 +1,724 @@
+#include "TFT_eSPI.h"
+#include "SimHost.h"
+
+namespace {
+
+// CASET + 4, RASET + 4, RAMWR
+constexpr uint32_t WINDOW_BYTES = 11;
+
+// Defaults: the board's 55MHz clock, Arduino-ESP32 2.x at 240MHz
+sim::DisplayCostModel s_displayCost = {55000000, 2000, 250, 300, 4};
+sim::DrawCost s_costs[sim::DRAW_OP_COUNT];
+
+const char* const OP_NAMES[sim::DRAW_OP_COUNT] = {
+    "fillScreen", "fillRect", "fillRoundRect", "fillCircle", "drawPixel", "drawFastHLine",
+    "drawFastVLine", "drawString", "drawChar", "pushImage", "pushImageDMA", "pushPixels", "pushSprite",
+};
+
+// Entry point the current calls are charged to
+sim::DrawOp s_op = sim::DRAW_FILL_RECT;
+uint8_t s_depth = 0;
+
+const TFT_eSPI* s_display = nullptr;
+
+inline uint16_t swap16(uint16_t value) {
+    return (uint16_t)((value << 8) | (value >> 8));
+}
+
+uint64_t wireNs(uint64_t bytes) {
+    return bytes * 8ULL * 1000000000ULL / s_displayCost.spiHz;
+}
+
+// 5x7 glyphs for ' ' to '~', one byte per column, top row in bit 0
+const uint8_t GLYPHS_5X7[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3C},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+    {0x00, 0x7F, 0x10, 0x28, 0x44}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08},
+};
+
+// How each font is made from the 5x7 glyphs: the width of a glyph column
+// in quarter pixels, the height the seven rows are stretched to, the top
+// margin and the gap after each glyph. Font 1 is fixed-width like
+// TFT_eSPI's GLCD font, the others proportional.
+struct BitmapFont {
+    uint8_t font;
+    uint8_t columnQuarters;
+    uint8_t glyphHeight;
+    uint8_t height;
+    uint8_t top;
+    uint8_t gap;
+};
+
+const BitmapFont BITMAP_FONTS[] = {
+    {1, 4, 7, 8, 0, 1},
+    {2, 6, 11, 16, 2, 1},
+    {4, 10, 18, 26, 4, 1},
+    {6, 20, 35, 48, 6, 2},
+    {8, 40, 56, 75, 9, 5},
+};
+
+const BitmapFont* bitmapFont(uint8_t font) {
+    for (const BitmapFont& entry : BITMAP_FONTS) {
+        if (entry.font == font) return &entry;
+    }
+    return nullptr;
+}
+
+// Font 7: 48 pixel seven-segment digits
+constexpr int16_t SEGMENT_HEIGHT = 48;
+constexpr int16_t SEGMENT_DIGIT_WIDTH = 32;
+constexpr int16_t SEGMENT_NARROW_WIDTH = 12;
+constexpr int16_t SEGMENT_THICKNESS = 5;
+// a (top), b, c (right), d (bottom), e, f (left), g (middle)
+const uint8_t SEGMENTS[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+bool segmentPixel(uint16_t c, int16_t x, int16_t y) {
+    const int16_t t = SEGMENT_THICKNESS;
+    if (c == ':') {
+        return x >= 4 && x < 8 && ((y >= 14 && y < 18) || (y >= 31 && y < 35));
+    }
+    if (c == '.') {
+        return x >= 4 && x < 8 && y >= 40 && y < 44;
+    }
+    uint8_t segments = c == '-' ? 0x40 : (c >= '0' && c <= '9') ? SEGMENTS[c - '0'] : 0;
+    const int16_t left = 3, right = SEGMENT_DIGIT_WIDTH - 4, top = 2, middle = SEGMENT_HEIGHT / 2,
+                  bottom = SEGMENT_HEIGHT - 3;
+    bool horizontal = x > left && x < right;
+    bool upper = y > top && y < middle;
+    bool lower = y > middle && y < bottom;
+    if ((segments & 0x01) && horizontal && y >= top && y < top + t) return true;
+    if ((segments & 0x40) && horizontal && y >= middle - t / 2 && y <= middle + t / 2) return true;
+    if ((segments & 0x08) && horizontal && y > bottom - t && y <= bottom) return true;
+    if ((segments & 0x20) && upper && x >= left - 1 && x < left - 1 + t) return true;
+    if ((segments & 0x10) && lower && x >= left - 1 && x < left - 1 + t) return true;
+    if ((segments & 0x02) && upper && x > right - t && x <= right) return true;
+    if ((segments & 0x04) && lower && x > right - t && x <= right) return true;
+    return false;
+}
+
+// Column span of a 5x7 glyph; a blank glyph is given a space's width
+void glyphColumns(uint16_t c, uint8_t& first, uint8_t& last) {
+    const uint8_t* columns = GLYPHS_5X7[c - ' '];
+    first = 0;
+    last = 2;
+    while (first < 5 && columns[first] == 0) first++;
+    if (first == 5) {
+        first = 0;
+        return;
+    }
+    last = 4;
+    while (columns[last] == 0) last--;
+}
+
+// Whether pixel (x, y) of a character cell is set
+bool glyphPixel(uint16_t c, uint8_t font, int16_t x, int16_t y) {
+    if (font == 7) {
+        return segmentPixel(c, x, y);
+    }
+    const BitmapFont* bitmap = bitmapFont(font);
+    if (!bitmap || y < bitmap->top || y >= bitmap->top + bitmap->glyphHeight) {
+        return false;
+    }
+    uint8_t first = 0, last = 4;
+    if (font != 1) glyphColumns(c, first, last);
+    int16_t column = first + x * 4 / bitmap->columnQuarters;
+    if (column > last) {
+        return false;
+    }
+    return (GLYPHS_5X7[c - ' '][column] >> ((y - bitmap->top) * 7 / bitmap->glyphHeight)) & 1;
+}
+
+// Next code point of a UTF-8 string
+uint16_t decodeUtf8(const char*& text) {
+    uint8_t c = (uint8_t)*text++;
+    if (c < 0x80) return c;
+    if ((c & 0xE0) == 0xC0 && (text[0] & 0xC0) == 0x80) {
+        return ((c & 0x1F) << 6) | (*text++ & 0x3F);
+    }
+    if ((c & 0xF0) == 0xE0 && (text[0] & 0xC0) == 0x80 && (text[1] & 0xC0) == 0x80) {
+        uint16_t code = ((c & 0x0F) << 12) | ((text[0] & 0x3F) << 6) | (text[1] & 0x3F);
+        text += 2;
+        return code;
+    }
+    return c;
+}
+
+}
+
+namespace sim {
+
+DisplayCostModel& displayCostModel() {
+    return s_displayCost;
+}
+
+const uint16_t* displayPixels(int16_t* width, int16_t* height) {
+    if (!s_display) {
+        return nullptr;
+    }
+    *width = s_display->width();
+    *height = s_display->height();
+    return s_display->framebuffer();
+}
+
+const char* drawOpName(DrawOp op) {
+    return op < DRAW_OP_COUNT ? OP_NAMES[op] : "?";
+}
+
+const DrawCost& drawCost(DrawOp op) {
+    return s_costs[op];
+}
+
+DrawCost totalDrawCost() {
+    DrawCost total = {};
+    for (const DrawCost& cost : s_costs) {
+        total.calls += cost.calls;
+        total.windows += cost.windows;
+        total.pixels += cost.pixels;
+        total.busBytes += cost.busBytes;
+        total.busNs += cost.busNs;
+    }
+    return total;
+}
+
+void resetDrawCosts() {
+    memset(s_costs, 0, sizeof(s_costs));
+}
+
+}
+
+class TFT_eSPI::Call {
+public:
+    Call(TFT_eSPI& tft, sim::DrawOp op) : m_outermost(s_depth++ == 0) {
+        if (!m_outermost) {
+            return;
+        }
+        s_op = op;
+        s_costs[op].calls++;
+        sim::advanceNs(s_displayCost.callNs);
+        // Outside startWrite() every call takes the bus for itself
+        if (tft._onBus && tft._writeDepth == 0) {
+            tft.waitForBus();
+            s_costs[op].busNs += s_displayCost.transactionNs;
+            sim::advanceNs(s_displayCost.transactionNs);
+        }
+    }
+    ~Call() { s_depth--; }
+
+private:
+    const bool m_outermost;
+};
+
+TFT_eSPI::TFT_eSPI(int16_t width, int16_t height)
+    : _pixels(nullptr)
+    , _width(width)
+    , _height(height)
+    , _onBus(true)
+    , _panelWidth(width)
+    , _panelHeight(height)
+    , _rotation(0)
+    , _textFont(1)
+    , _textDatum(TL_DATUM)
+    , _textColor(TFT_WHITE)
+    , _textBackground(TFT_WHITE)
+    , _swapBytes(false)
+    , _writeDepth(0)
+    , _winX(0), _winY(0), _winW(0), _winH(0)
+    , _winNext(0)
+    , _dmaReady(false)
+    , _dmaDoneNs(0) {
+    resetViewport();
+}
+
+TFT_eSPI::~TFT_eSPI() {
+    if (s_display == this) {
+        s_display = nullptr;
+    }
+    free(_pixels);
+}
+
+void TFT_eSPI::init() {
+    // The panel's RAM is the framebuffer; rotation only changes how it is
+    // addressed, as on the ST7789
+    if (!_pixels) {
+        _pixels = static_cast<uint16_t*>(calloc((size_t)_panelWidth * _panelHeight, sizeof(uint16_t)));
+    }
+    s_display = this;
+}
+
+void TFT_eSPI::setRotation(uint8_t rotation) {
+    _rotation = rotation & 3;
+    bool landscape = _rotation & 1;
+    _width = landscape ? _panelHeight : _panelWidth;
+    _height = landscape ? _panelWidth : _panelHeight;
+    resetViewport();
+}
+
+void TFT_eSPI::startWrite() {
+    if (_onBus && _writeDepth++ == 0) {
+        waitForBus();
+        sim::advanceNs(s_displayCost.transactionNs);
+    }
+}
+
+void TFT_eSPI::endWrite() {
+    if (_onBus && _writeDepth > 0) {
+        _writeDepth--;
+    }
+}
+
+void TFT_eSPI::waitForBus() {
+    // The panel link is busy until a DMA transfer in flight is done
+    if (_dmaDoneNs > sim::nowNs()) {
+        sim::advanceNs(_dmaDoneNs - sim::nowNs());
+    }
+}
+
+void TFT_eSPI::chargeWindow(uint32_t pixels) {
+    sim::DrawCost& cost = s_costs[s_op];
+    uint64_t bytes = WINDOW_BYTES + (uint64_t)pixels * 2;
+    uint64_t ns = wireNs(bytes) + s_displayCost.windowNs;
+    cost.windows++;
+    cost.pixels += pixels;
+    cost.busBytes += bytes;
+    cost.busNs += ns;
+    sim::advanceNs(ns);
+}
+
+void TFT_eSPI::chargeRam(uint32_t pixels) {
+    s_costs[s_op].pixels += pixels;
+    sim::advanceNs((uint64_t)pixels * s_displayCost.ramPixelNs);
+}
+
+void TFT_eSPI::writeRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    x += _xDatum;
+    y += _yDatum;
+    int32_t left = max(x, _vpX), top = max(y, _vpY);
+    int32_t right = min(x + w, _vpW), bottom = min(y + h, _vpH);
+    if (!_pixels || left >= right || top >= bottom) {
+        return;
+    }
+
+    uint16_t stored = _onBus ? (uint16_t)color : swap16((uint16_t)color);
+    for (int32_t row = top; row < bottom; row++) {
+        uint16_t* line = _pixels + row * _width;
+        for (int32_t col = left; col < right; col++) {
+            line[col] = stored;
+        }
+    }
+    uint32_t pixels = (uint32_t)(right - left) * (bottom - top);
+    if (_onBus) {
+        chargeWindow(pixels);
+    } else {
+        chargeRam(pixels);
+    }
+}
+
+void TFT_eSPI::writeBlock(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data, int32_t stride,
+                          bool swapped) {
+    if (!_pixels) {
+        return;
+    }
+    for (int32_t row = 0; row < h; row++) {
+        if (y + row < 0 || y + row >= _height) continue;
+        for (int32_t col = 0; col < w; col++) {
+            if (x + col < 0 || x + col >= _width) continue;
+            uint16_t value = data[row * stride + col];
+            // The panel keeps colors, sprites keep the panel's byte order
+            bool stored = _onBus ? !swapped : swapped;
+            _pixels[(y + row) * _width + x + col] = stored ? value : swap16(value);
+        }
+    }
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    Call call(*this, sim::DRAW_PIXEL);
+    writeRect(x, y, 1, 1, color);
+}
+
+void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+    Call call(*this, sim::DRAW_FAST_HLINE);
+    writeRect(x, y, w, 1, color);
+}
+
+void TFT_eSPI::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {
+    Call call(*this, sim::DRAW_FAST_VLINE);
+    writeRect(x, y, 1, h, color);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    Call call(*this, sim::DRAW_FILL_RECT);
+    writeRect(x, y, w, h, color);
+}
+
+void TFT_eSPI::fillScreen(uint32_t color) {
+    Call call(*this, sim::DRAW_FILL_SCREEN);
+    fillRect(0, 0, _width, _height, color);
+}
+
+void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color) {
+    Call call(*this, sim::DRAW_FILL_ROUND_RECT);
+    // Same spans as TFT_eSPI: the middle as one rectangle, the rounded top
+    // and bottom as a horizontal line per row
+    fillRect(x, y + r, w, h - r - r, color);
+
+    int32_t x0 = x + r;
+    int32_t yBottom = y + h - r - 1;
+    int32_t yTop = y + r;
+    int32_t delta = w - r - r;
+    int32_t f = 1 - r;
+    int32_t ddFx = 1;
+    int32_t ddFy = -r - r;
+    int32_t dy = 0;
+    while (dy < r) {
+        if (f >= 0) {
+            drawFastHLine(x0 - dy, yBottom + r, dy + dy + delta, color);
+            drawFastHLine(x0 - dy, yTop - r, dy + dy + delta, color);
+            r--;
+            ddFy += 2;
+            f += ddFy;
+        }
+        dy++;
+        ddFx += 2;
+        f += ddFx;
+        drawFastHLine(x0 - r, yBottom + dy, r + r + delta, color);
+        drawFastHLine(x0 - r, yTop - dy, r + r + delta, color);
+    }
+}
+
+void TFT_eSPI::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+    Call call(*this, sim::DRAW_FILL_CIRCLE);
+    int32_t x = 0;
+    int32_t dx = 1;
+    int32_t dy = r + r;
+    int32_t p = -(r >> 1);
+    drawFastHLine(x0 - r, y0, dy + 1, color);
+    while (x < r) {
+        if (p >= 0) {
+            drawFastHLine(x0 - x, y0 + r, dx, color);
+            drawFastHLine(x0 - x, y0 - r, dx, color);
+            dy -= 2;
+            p -= dy;
+            r--;
+        }
+        dx += 2;
+        p += dx;
+        x++;
+        drawFastHLine(x0 - r, y0 + x, dy + 1, color);
+        drawFastHLine(x0 - r, y0 - x, dy + 1, color);
+    }
+}
+
+int16_t TFT_eSPI::fontHeight(int16_t font) {
+    if (font == 7) return SEGMENT_HEIGHT;
+    const BitmapFont* bitmap = bitmapFont(font);
+    return bitmap ? bitmap->height : 0;
+}
+
+int16_t TFT_eSPI::charWidth(uint16_t c, uint8_t font) const {
+    // As on the device, the built-in fonts only cover printable ASCII
+    if (c < ' ' || c > '~') {
+        return 0;
+    }
+    if (font == 7) {
+        if (c >= '0' && c <= '9') return SEGMENT_DIGIT_WIDTH;
+        if (c == '-') return SEGMENT_DIGIT_WIDTH;
+        if (c == ':' || c == '.' || c == ' ') return SEGMENT_NARROW_WIDTH;
+        return 0;
+    }
+    const BitmapFont* bitmap = bitmapFont(font);
+    if (!bitmap) {
+        return 0;
+    }
+    if (font == 1) {
+        return 6;
+    }
+    uint8_t first, last;
+    glyphColumns(c, first, last);
+    return ((last - first + 1) * bitmap->columnQuarters + 3) / 4 + bitmap->gap;
+}
+
+int16_t TFT_eSPI::textWidth(const char* text, uint8_t font) {
+    int16_t width = 0;
+    while (*text) {
+        width += charWidth(decodeUtf8(text), font);
+    }
+    return width;
+}
+
+int16_t TFT_eSPI::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font) {
+    Call call(*this, sim::DRAW_CHAR);
+    int16_t width = charWidth(uniCode, font);
+    int16_t height = fontHeight(font);
+    if (width == 0) {
+        return 0;
+    }
+
+    if (_textBackground != _textColor) {
+        // The whole cell goes out through one window
+        uint16_t* cell = static_cast<uint16_t*>(malloc((size_t)width * height * sizeof(uint16_t)));
+        for (int16_t row = 0; row < height; row++) {
+            for (int16_t col = 0; col < width; col++) {
+                cell[row * width + col] = glyphPixel(uniCode, font, col, row) ? _textColor : _textBackground;
+            }
+        }
+        int32_t left = x + _xDatum, top = y + _yDatum;
+        int32_t clipLeft = max(left, _vpX), clipTop = max(top, _vpY);
+        int32_t clipRight = min(left + width, _vpW), clipBottom = min(top + height, _vpH);
+        if (clipLeft < clipRight && clipTop < clipBottom) {
+            int32_t w = clipRight - clipLeft, h = clipBottom - clipTop;
+            writeBlock(clipLeft, clipTop, w, h, cell + (clipTop - top) * width + (clipLeft - left), width, false);
+            if (_onBus) {
+                chargeWindow(w * h);
+            } else {
+                chargeRam(w * h);
+            }
+        }
+        free(cell);
+        return width;
+    }
+
+    // Transparent: a span per run of set pixels
+    for (int16_t row = 0; row < height; row++) {
+        int16_t col = 0;
+        while (col < width) {
+            if (!glyphPixel(uniCode, font, col, row)) {
+                col++;
+                continue;
+            }
+            int16_t start = col;
+            while (col < width && glyphPixel(uniCode, font, col, row)) col++;
+            writeRect(x + start, y + row, col - start, 1, _textColor);
+        }
+    }
+    return width;
+}
+
+int16_t TFT_eSPI::drawString(const char* text, int32_t x, int32_t y, uint8_t font) {
+    Call call(*this, sim::DRAW_STRING);
+    int16_t width = textWidth(text, font);
+    int16_t height = fontHeight(font);
+    int16_t baseline = font == 7 ? SEGMENT_HEIGHT - 3 : height;
+    if (const BitmapFont* bitmap = bitmapFont(font)) {
+        baseline = bitmap->top + bitmap->glyphHeight;
+    }
+
+    switch (_textDatum) {
+        case TC_DATUM: x -= width / 2; break;
+        case TR_DATUM: x -= width; break;
+        case ML_DATUM: y -= height / 2; break;
+        case MC_DATUM: x -= width / 2; y -= height / 2; break;
+        case MR_DATUM: x -= width; y -= height / 2; break;
+        case BL_DATUM: y -= height; break;
+        case BC_DATUM: x -= width / 2; y -= height; break;
+        case BR_DATUM: x -= width; y -= height; break;
+        case L_BASELINE: y -= baseline; break;
+        case C_BASELINE: x -= width / 2; y -= baseline; break;
+        case R_BASELINE: x -= width; y -= baseline; break;
+    }
+
+    while (*text) {
+        x += drawChar(decodeUtf8(text), x, y, font);
+    }
+    return width;
+}
+
+void TFT_eSPI::setViewport(int32_t x, int32_t y, int32_t w, int32_t h, bool vpDatum) {
+    // Clipped to the screen, as TFT_eSPI does
+    _xDatum = vpDatum ? x : 0;
+    _yDatum = vpDatum ? y : 0;
+    _vpX = max<int32_t>(x, 0);
+    _vpY = max<int32_t>(y, 0);
+    _vpW = min<int32_t>(x + w, _width);
+    _vpH = min<int32_t>(y + h, _height);
+}
+
+void TFT_eSPI::resetViewport() {
+    _xDatum = _yDatum = 0;
+    _vpX = _vpY = 0;
+    _vpW = _width;
+    _vpH = _height;
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+    Call call(*this, sim::DRAW_PUSH_PIXELS);
+    _winX = x;
+    _winY = y;
+    _winW = max<int32_t>(w, 0);
+    _winH = max<int32_t>(h, 0);
+    _winNext = 0;
+    chargeWindow(0);
+}
+
+void TFT_eSPI::pushPixels(const void* data, uint32_t len) {
+    Call call(*this, sim::DRAW_PUSH_PIXELS);
+    const uint16_t* words = static_cast<const uint16_t*>(data);
+    uint32_t capacity = (uint32_t)_winW * _winH;
+    for (uint32_t i = 0; i < len && _winNext < capacity; i++, _winNext++) {
+        writeBlock(_winX + _winNext % _winW, _winY + _winNext / _winW, 1, 1, words + i, 1, !_swapBytes);
+    }
+
+    // Pixel data only; the window was charged by setAddrWindow()
+    sim::DrawCost& cost = s_costs[s_op];
+    uint64_t ns = wireNs((uint64_t)len * 2);
+    cost.pixels += len;
+    cost.busBytes += (uint64_t)len * 2;
+    cost.busNs += ns;
+    sim::advanceNs(ns);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data) {
+    Call call(*this, sim::DRAW_PUSH_IMAGE);
+    x += _xDatum;
+    y += _yDatum;
+    int32_t left = max(x, _vpX), top = max(y, _vpY);
+    int32_t right = min(x + w, _vpW), bottom = min(y + h, _vpH);
+    if (left >= right || top >= bottom) {
+        return;
+    }
+    writeBlock(left, top, right - left, bottom - top, data + (top - y) * w + (left - x), w, !_swapBytes);
+    if (_onBus) {
+        chargeWindow((uint32_t)(right - left) * (bottom - top));
+    } else {
+        chargeRam((uint32_t)(right - left) * (bottom - top));
+    }
+}
+
+bool TFT_eSPI::initDMA(bool) {
+    _dmaReady = _onBus;
+    return _dmaReady;
+}
+
+bool TFT_eSPI::dmaBusy() {
+    return _dmaDoneNs > sim::nowNs();
+}
+
+void TFT_eSPI::dmaWait() {
+    waitForBus();
+}
+
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data, uint16_t*) {
+    if (!_dmaReady) {
+        pushImage(x, y, w, h, data);
+        return;
+    }
+
+    // Waits for the previous transfer, then sets this one going; the pixels
+    // land now, the clock catches up with the wire time later
+    Call call(*this, sim::DRAW_PUSH_IMAGE_DMA);
+    waitForBus();
+    x += _xDatum;
+    y += _yDatum;
+    int32_t left = max(x, _vpX), top = max(y, _vpY);
+    int32_t right = min(x + w, _vpW), bottom = min(y + h, _vpH);
+    if (left >= right || top >= bottom) {
+        return;
+    }
+    writeBlock(left, top, right - left, bottom - top, data + (top - y) * w + (left - x), w, !_swapBytes);
+
+    uint32_t pixels = (uint32_t)(right - left) * (bottom - top);
+    uint64_t bytes = WINDOW_BYTES + (uint64_t)pixels * 2;
+    uint64_t ns = wireNs(bytes) + s_displayCost.windowNs;
+    sim::DrawCost& cost = s_costs[s_op];
+    cost.windows++;
+    cost.pixels += pixels;
+    cost.busBytes += bytes;
+    cost.busNs += ns;
+    _dmaDoneNs = sim::nowNs() + ns;
+}
+
+uint16_t TFT_eSPI::readPixel(int32_t x, int32_t y) {
+    x += _xDatum;
+    y += _yDatum;
+    if (!_pixels || x < 0 || y < 0 || x >= _width || y >= _height) {
+        return 0;
+    }
+    uint16_t value = _pixels[y * _width + x];
+    return _onBus ? value : swap16(value);
+}
+
+TFT_eSprite::TFT_eSprite(TFT_eSPI* tft)
+    : TFT_eSPI(0, 0)
+    , _tft(tft) {
+    _onBus = false;
+}
+
+TFT_eSprite::~TFT_eSprite() {
+    deleteSprite();
+}
+
+void* TFT_eSprite::setColorDepth(int8_t) {
+    // Only 16 bit sprites are used
+    return _pixels;
+}
+
+void* TFT_eSprite::createSprite(int16_t width, int16_t height, uint8_t) {
+    if (_pixels) {
+        return _pixels;
+    }
+    _pixels = static_cast<uint16_t*>(calloc((size_t)width * height, sizeof(uint16_t)));
+    if (_pixels) {
+        _width = width;
+        _height = height;
+    }
+    resetViewport();
+    return _pixels;
+}
+
+void TFT_eSprite::deleteSprite() {
+    free(_pixels);
+    _pixels = nullptr;
+    _width = _height = 0;
+    resetViewport();
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y) {
+    pushSprite(x, y, 0, 0, _width, _height);
+}
+
+bool TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh) {
+    if (!_pixels || sx < 0 || sy < 0 || sw <= 0 || sh <= 0 || sx + sw > _width || sy + sh > _height) {
+        return false;
+    }
+
+    // One window on the parent display, straight from the sprite buffer
+    TFT_eSPI& tft = *_tft;
+    Call call(tft, sim::DRAW_PUSH_SPRITE);
+    int32_t left = max(tx + tft._xDatum, tft._vpX), top = max(ty + tft._yDatum, tft._vpY);
+    int32_t right = min(tx + tft._xDatum + sw, tft._vpW), bottom = min(ty + tft._yDatum + sh, tft._vpH);
+    if (left >= right || top >= bottom) {
+        return true;
+    }
+    const uint16_t* source = _pixels + (sy + top - ty - tft._yDatum) * _width + (sx + left - tx - tft._xDatum);
+    tft.writeBlock(left, top, right - left, bottom - top, source, _width, true);
+    tft.chargeWindow((uint32_t)(right - left) * (bottom - top));
+    return true;
+}
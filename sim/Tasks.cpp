@@ -0,0 +1,198 @@
+#include "Arduino.h"
+#include "SimHost.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Each task is a host thread, but only one thread runs at a time: the loop
+// hands a task the turn and waits until it blocks again, so tasks see
+// virtual time and shared state exactly as a sequence of events.
+struct SimTask {
+    TaskFunction_t entry;
+    void* param;
+    std::condition_variable turn;
+    bool running;
+    uint64_t wakeNs;         // NEVER while waiting without a timeout
+    uint32_t notifications;
+    bool waitingForNotify;
+};
+
+struct SimQueue {
+    uint32_t length;
+    uint32_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+    SimTask* receiver;       // blocked in xQueueReceive()
+};
+
+namespace {
+
+constexpr uint64_t NEVER = UINT64_MAX;
+constexpr uint64_t NS_PER_TICK = 1000000ULL * portTICK_PERIOD_MS;
+
+// Never destroyed: tasks are still blocked on them when the program exits
+std::mutex& s_lock = *new std::mutex;
+std::condition_variable& s_loopTurn = *new std::condition_variable;
+std::vector<SimTask*>& s_tasks = *new std::vector<SimTask*>;
+SimTask* s_current = nullptr;
+
+// Gives 'task' the turn and waits for it to block
+void runTask(SimTask* task) {
+    std::unique_lock<std::mutex> lock(s_lock);
+    s_current = task;
+    task->running = true;
+    task->turn.notify_one();
+    s_loopTurn.wait(lock, [task] { return !task->running; });
+    s_current = nullptr;
+}
+
+// Called on the task's own thread: hands the turn back until woken
+void block(SimTask* task, uint64_t wakeNs) {
+    std::unique_lock<std::mutex> lock(s_lock);
+    task->wakeNs = wakeNs;
+    task->running = false;
+    s_loopTurn.notify_one();
+    task->turn.wait(lock, [task] { return task->running; });
+}
+
+void taskThread(SimTask* task) {
+    {
+        std::unique_lock<std::mutex> lock(s_lock);
+        task->turn.wait(lock, [task] { return task->running; });
+    }
+    task->entry(task->param);
+    // A FreeRTOS task must not return; park it for good
+    block(task, NEVER);
+}
+
+// Earliest task due by 'untilNs', nullptr if none
+SimTask* nextDue(uint64_t untilNs) {
+    SimTask* next = nullptr;
+    for (SimTask* task : s_tasks) {
+        if (task->wakeNs <= untilNs && (!next || task->wakeNs < next->wakeNs)) {
+            next = task;
+        }
+    }
+    return next;
+}
+
+void runTasksUntil(uint64_t untilNs) {
+    while (SimTask* task = nextDue(untilNs)) {
+        if (task->wakeNs > sim::nowNs()) {
+            sim::advanceNs(task->wakeNs - sim::nowNs());
+        }
+        runTask(task);
+    }
+}
+
+}
+
+namespace sim {
+
+void sleepNs(uint64_t ns) {
+    uint64_t untilNs = nowNs() + ns;
+    if (s_current) {
+        // delay() on a task is vTaskDelay()
+        block(s_current, untilNs);
+        return;
+    }
+    runTasksUntil(untilNs);
+    if (nowNs() < untilNs) {
+        advanceNs(untilNs - nowNs());
+    }
+}
+
+void runDueTasks() {
+    if (!s_current) {
+        runTasksUntil(nowNs());
+    }
+}
+
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t entry, const char*, uint32_t, void* param, UBaseType_t,
+                                   TaskHandle_t* created, BaseType_t) {
+    SimTask* task = new SimTask{entry, param, {}, false, sim::nowNs(), 0, false};
+    s_tasks.push_back(task);
+    std::thread(taskThread, task).detach();
+    if (created) *created = task;
+    // Starts on its own core right away
+    sim::runDueTasks();
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(sim::nowNs() / NS_PER_TICK);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim::sleepNs((uint64_t)ticks * NS_PER_TICK);
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    *previousWake += period;
+    uint64_t wakeNs = (uint64_t)*previousWake * NS_PER_TICK;
+    if (s_current && wakeNs > sim::nowNs()) {
+        block(s_current, wakeNs);
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    SimTask* task = s_current;
+    if (!task) return 0;
+    if (task->notifications == 0 && ticksToWait > 0) {
+        task->waitingForNotify = true;
+        block(task, ticksToWait == portMAX_DELAY ? NEVER : sim::nowNs() + (uint64_t)ticksToWait * NS_PER_TICK);
+        task->waitingForNotify = false;
+    }
+    uint32_t count = task->notifications;
+    if (count > 0) {
+        task->notifications = clearOnExit ? 0 : count - 1;
+    }
+    return count;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    task->notifications++;
+    if (task->waitingForNotify) {
+        task->wakeNs = sim::nowNs();
+        if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new SimQueue{(uint32_t)length, (uint32_t)itemSize, {}, nullptr};
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t) {
+    if (queue->items.size() >= queue->length) {
+        return pdFALSE;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    if (queue->receiver) {
+        queue->receiver->wakeNs = sim::nowNs();
+        sim::runDueTasks();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    SimTask* task = s_current;
+    if (queue->items.empty() && task && ticksToWait > 0) {
+        queue->receiver = task;
+        block(task, ticksToWait == portMAX_DELAY ? NEVER : sim::nowNs() + (uint64_t)ticksToWait * NS_PER_TICK);
+        queue->receiver = nullptr;
+    }
+    if (queue->items.empty()) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
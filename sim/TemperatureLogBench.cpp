@@ -0,0 +1,143 @@
+#include "Flash25Q128JV.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "TemperatureLog.h"
+#include "W25QSim.h"
+
+#include <vector>
+
+// Days of 2 second temperature samples through TemperatureLog: storage
+// density, wrap-around, remount, and what range queries cost in flash reads.
+namespace {
+
+constexpr uint32_t START_TIME = 1767225600;   // 2026-01-01
+constexpr uint32_t SAMPLE_PERIOD = 2;
+constexpr uint32_t HOUR = 3600;
+constexpr uint32_t DAY = 24 * HOUR;
+
+struct Reference {
+    std::vector<TemperatureLog::Sample> samples;
+    size_t mismatches = 0;
+    size_t position = 0;
+};
+
+bool compare(const TemperatureLog::Sample& sample, void* context) {
+    Reference* reference = static_cast<Reference*>(context);
+    // Skip reference samples older than the log still holds
+    while (reference->position < reference->samples.size() &&
+           reference->samples[reference->position].time < sample.time) {
+        reference->position++;
+    }
+    if (reference->position >= reference->samples.size() ||
+        reference->samples[reference->position].deciCelsius != sample.deciCelsius) {
+        reference->mismatches++;
+    }
+    reference->position++;
+    return true;
+}
+
+bool countOnly(const TemperatureLog::Sample&, void* context) {
+    (*static_cast<uint32_t*>(context))++;
+    return true;
+}
+
+// Same random walk as CYD::getDummyTemperature()
+float nextTemperature(float last) {
+    return constrain(last + random(-10, 11) / 10.0f, 18.0f, 28.0f);
+}
+
+template <typename Fn>
+void timed(const char* name, TemperatureLog& log, Fn fn) {
+    TemperatureLog::Stats before = log.stats();
+    uint64_t start = sim::nowNs();
+    uint32_t result = fn();
+    uint64_t ns = sim::nowNs() - start;
+    printf("  %-24s %8u %9.2fms %8u headers %6u blocks decoded\n", name, result, ns / 1e6,
+           log.stats().headersRead - before.headersRead, log.stats().blocksDecoded - before.blocksDecoded);
+}
+
+}
+
+int runTemperatureLogBench(int argc, char** argv) {
+    uint32_t days = argc > 1 ? (uint32_t)atoi(argv[1]) : 16;
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash init failed\n");
+        return 1;
+    }
+
+    TemperatureLog log(flash, FLASH_TEMPLOG_ADDR, FLASH_TEMPLOG_SECTORS);
+    log.begin();
+    randomSeed(3);
+
+    Reference reference;
+    uint32_t total = days * DAY / SAMPLE_PERIOD;
+    float temperature = 23.0f;
+    uint64_t addNs = 0;
+    for (uint32_t i = 0; i < total; i++) {
+        temperature = nextTemperature(temperature);
+        uint32_t time = START_TIME + i * SAMPLE_PERIOD;
+        uint64_t start = sim::nowNs();
+        log.add(time, temperature);
+        addNs += sim::nowNs() - start;
+        reference.samples.push_back(TemperatureLog::Sample{time, (int16_t)lroundf(temperature * 10)});
+    }
+    log.flush();
+
+    const TemperatureLog::Stats& stats = log.stats();
+    uint32_t capacity = FLASH_TEMPLOG_SECTORS * FLASH_SECTOR_SIZE;
+    uint32_t retainedSeconds = log.newestTime() - log.oldestTime();
+    double bytesPerSample = (double)stats.blocksWritten * FLASH_PAGE_SIZE / total;
+
+    printf("TemperatureLog: %u days at one sample per %us, %u KB ring\n\n", days, SAMPLE_PERIOD, capacity / 1024);
+    printf("  samples                %u\n", stats.samples);
+    printf("  flash per sample       %.2f bytes (vs %u for a raw time+float)\n", bytesPerSample, 8);
+    printf("  blocks written         %u, %u sector erases\n", stats.blocksWritten, stats.sectorErases);
+    printf("  history retained       %.1f days (oldest sample dropped once the ring wraps)\n",
+           retainedSeconds / (double)DAY);
+    printf("  add() cost             %.1fus average, including block programs and erases\n", addNs / 1e3 / total);
+    printf("  RAM                    %zu bytes\n", sizeof(TemperatureLog));
+
+    // Remount from flash and check every retained sample
+    TemperatureLog mounted(flash, FLASH_TEMPLOG_ADDR, FLASH_TEMPLOG_SECTORS);
+    uint64_t mountStart = sim::nowNs();
+    mounted.begin();
+    uint64_t mountNs = sim::nowNs() - mountStart;
+    uint32_t verified = mounted.query(0, UINT32_MAX, compare, &reference);
+    printf("  mount                  %.2fms\n", mountNs / 1e6);
+    printf("  remount check          %u samples, %zu mismatches\n\n", verified, reference.mismatches);
+
+    uint32_t now = mounted.newestTime();
+    printf("  %-24s %8s %11s\n", "query", "result", "time");
+    timed("samples, last hour", mounted, [&] {
+        uint32_t count = 0;
+        mounted.query(now - HOUR, now, countOnly, &count);
+        return count;
+    });
+    timed("samples, one day ago 1h", mounted, [&] {
+        uint32_t count = 0;
+        mounted.query(now - DAY - HOUR, now - DAY, countOnly, &count);
+        return count;
+    });
+    timed("summary, last 24h", mounted, [&] {
+        TemperatureLog::Summary summary;
+        mounted.summarize(now - DAY, now, summary);
+        return summary.count;
+    });
+    timed("summary, last 7 days", mounted, [&] {
+        TemperatureLog::Summary summary;
+        mounted.summarize(now - 7 * DAY, now, summary);
+        return summary.count;
+    });
+    timed("samples, full scan", mounted, [&] {
+        uint32_t count = 0;
+        mounted.query(0, UINT32_MAX, countOnly, &count);
+        return count;
+    });
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    return reference.mismatches == 0 ? 0 : 1;
+}
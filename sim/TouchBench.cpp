@@ -0,0 +1,177 @@
+#include "BenchStats.h"
+#include "SimBench.h"
+#include "TouchCalibration.h"
+#include "TouchFilter.h"
+
+#include <cmath>
+#include <random>
+
+// The touch pipeline on synthetic XPT2046 readings at the sampler's 200Hz:
+// how far the reported position strays from the finger while it rests,
+// lags it while it drags, and what a 3-point calibration takes out on a
+// panel mounted skewed against the display. The baseline is the fixed
+// map() the firmware used before, which took every reading as it came.
+namespace {
+
+constexpr uint32_t SAMPLE_MICROS = 5000;
+constexpr int16_t SCREEN_WIDTH = 320;
+constexpr int16_t SCREEN_HEIGHT = 240;
+// Reading noise, the share of readings that are spikes, and how many
+// readings at either end of a press are light and twice as noisy
+constexpr double NOISE_COUNTS = 8;
+constexpr double SPIKE_SHARE = 0.03;
+constexpr double SPIKE_COUNTS = 400;
+constexpr int LIGHT_SAMPLES = 4;
+
+// Raw counts of a screen position on the nominal panel
+double nominalRaw(double screen, int16_t size) {
+    return 3800 - screen * 3600 / size;
+}
+
+// A press at the position path(t), t in seconds, for 'seconds'
+struct Press {
+    const char* name;
+    double seconds;
+    void (*path)(double t, double& x, double& y);
+};
+
+const Press PRESSES[] = {
+    {"hold", 1.0, [](double, double& x, double& y) { x = 160; y = 120; }},
+    // Past 255 readings: the filter windows have wrapped many times over
+    {"hold 2s", 2.0, [](double, double& x, double& y) { x = 160; y = 120; }},
+    {"drag 200px/s", 1.0, [](double t, double& x, double& y) { x = 60 + 200 * t; y = 120; }},
+    {"drag 800px/s", 0.3, [](double t, double& x, double& y) { x = 40 + 800 * t; y = 120; }},
+};
+
+enum Pipeline { PIPELINE_MAP, PIPELINE_FILTER, PIPELINE_SMOOTHED, PIPELINE_COUNT };
+const char* const PIPELINE_NAMES[PIPELINE_COUNT] = {"map()", "median+avg", "+1-Euro"};
+
+struct Result {
+    BenchSamples error;       // px from the finger, every reading
+    BenchSamples lag;         // px behind it along x, after the first 50ms
+    int presses = 0;          // press starts seen; one is right
+};
+
+Result runPress(const Press& press, Pipeline pipeline, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0, NOISE_COUNTS);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    TouchFilter filter(pipeline == PIPELINE_SMOOTHED);
+    TouchCalibration nominal;
+    Result result;
+    bool wasPressed = false;
+    int samples = (int)(press.seconds * 1e6 / SAMPLE_MICROS);
+    for (int i = 0; i < samples; i++) {
+        double t = i * SAMPLE_MICROS / 1e6;
+        double trueX, trueY;
+        press.path(t, trueX, trueY);
+
+        bool light = i < LIGHT_SAMPLES || i >= samples - LIGHT_SAMPLES;
+        double spread = light ? 2 : 1;
+        double rawX = nominalRaw(trueX, SCREEN_WIDTH) + noise(random) * spread;
+        double rawY = nominalRaw(trueY, SCREEN_HEIGHT) + noise(random) * spread;
+        if (uniform(random) < SPIKE_SHARE) {
+            rawX += uniform(random) < 0.5 ? SPIKE_COUNTS : -SPIKE_COUNTS;
+        }
+        TouchSample sample = {i * SAMPLE_MICROS, (int16_t)lround(rawX), (int16_t)lround(rawY),
+                              (uint16_t)(light ? 300 + 100 * (uniform(random) < 0.5 ? 1 : 3) : 1200)};
+
+        bool pressed;
+        int16_t x, y;
+        if (pipeline == PIPELINE_MAP) {
+            pressed = sample.z > 500;
+            x = constrain(map(sample.x, 3800, 200, 0, 320), 0, 319);
+            y = constrain(map(sample.y, 3800, 200, 0, 240), 0, 239);
+        } else {
+            TouchPoint point;
+            pressed = filter.add(sample, point);
+            nominal.apply(point, x, y);
+        }
+        if (pressed && !wasPressed) result.presses++;
+        wasPressed = pressed;
+        if (!pressed) continue;
+
+        result.error.add(std::hypot(x - trueX, y - trueY));
+        if (t >= 0.05) result.lag.add(trueX - x);
+    }
+    return result;
+}
+
+// A panel rotated 1.5 degrees, offset and unevenly scaled against the
+// display: raw counts of a screen position
+void skewedRaw(double x, double y, double& rawX, double& rawY) {
+    const double angle = 1.5 * M_PI / 180;
+    double u = x * std::cos(angle) - y * std::sin(angle);
+    double v = x * std::sin(angle) + y * std::cos(angle);
+    rawX = 3710 - u * 3480 / SCREEN_WIDTH;
+    rawY = 3870 - v * 3650 / SCREEN_HEIGHT;
+}
+
+// Filtered position of a half-second press at (x, y) on the skewed panel
+TouchPoint pressSkewed(double x, double y, std::mt19937& random) {
+    std::normal_distribution<double> noise(0, NOISE_COUNTS);
+    TouchFilter filter;
+    TouchPoint point = {0, 0};
+    double rawX, rawY;
+    skewedRaw(x, y, rawX, rawY);
+    for (uint32_t i = 0; i < 100; i++) {
+        TouchSample sample = {i * SAMPLE_MICROS, (int16_t)lround(rawX + noise(random)),
+                              (int16_t)lround(rawY + noise(random)), 1200};
+        filter.add(sample, point);
+    }
+    return point;
+}
+
+// Largest error over a 9x7 grid of noiseless touches
+double gridError(const TouchCalibration& calibration) {
+    double worst = 0;
+    for (int gx = 0; gx <= 8; gx++) {
+        for (int gy = 0; gy <= 6; gy++) {
+            double x = 8 + gx * 38, y = 6 + gy * 38;
+            double rawX, rawY;
+            skewedRaw(x, y, rawX, rawY);
+            TouchPoint point = {(int32_t)lround(rawX * (1 << TouchFilter::FRACTION_BITS)),
+                                (int32_t)lround(rawY * (1 << TouchFilter::FRACTION_BITS))};
+            int16_t sx, sy;
+            calibration.apply(point, sx, sy);
+            worst = std::max(worst, std::hypot(sx - x, sy - y));
+        }
+    }
+    return worst;
+}
+
+}
+
+int runTouchBench(int, char**) {
+    printf("Readings every %lums, noise %.0f counts (x2 when light), %.0f%% spikes of %.0f counts\n\n",
+           (unsigned long)(SAMPLE_MICROS / 1000), NOISE_COUNTS, SPIKE_SHARE * 100, SPIKE_COUNTS);
+    printf("%-14s %-11s %8s %8s %8s %9s %8s\n", "press", "pipeline", "mean px", "p99 px", "max px",
+           "lag px", "presses");
+    for (const Press& press : PRESSES) {
+        for (int pipeline = 0; pipeline < PIPELINE_COUNT; pipeline++) {
+            Result result = runPress(press, (Pipeline)pipeline, 12345);
+            printf("%-14s %-11s %8.2f %8.2f %8.2f %9.2f %8d\n", press.name, PIPELINE_NAMES[pipeline],
+                   result.error.mean(), result.error.percentile(99), result.error.max(),
+                   result.lag.mean(), result.presses);
+        }
+    }
+
+    // Calibration: the same three targets CYD asks for
+    const int16_t targetX[TouchCalibration::POINTS] = {32, 288, 160};
+    const int16_t targetY[TouchCalibration::POINTS] = {24, 120, 216};
+    std::mt19937 random(678);
+    TouchPoint raw[TouchCalibration::POINTS];
+    for (uint8_t i = 0; i < TouchCalibration::POINTS; i++) {
+        raw[i] = pressSkewed(targetX[i], targetY[i], random);
+    }
+    TouchCalibration calibration;
+    printf("\nSkewed panel (1.5 deg, offset, uneven scale), worst error over a 9x7 grid:\n");
+    printf("  nominal map      %6.2f px\n", gridError(calibration));
+    bool solved = calibration.solve(raw, targetX, targetY);
+    printf("  3-point solve    %6.2f px%s\n", gridError(calibration), solved ? "" : " (solve FAILED)");
+
+    const TouchPoint line[TouchCalibration::POINTS] = {{100, 100}, {200, 200}, {300, 300}};
+    printf("  collinear points %s\n", calibration.solve(line, targetX, targetY) ? "ACCEPTED" : "rejected");
+    return solved ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include "TouchSession.h"
+
+#include "CYD.h"
+#include "SimHost.h"
+
+#include <cstdio>
+
+namespace {
+
+constexpr uint32_t FRAME_MS = 16;
+// A reading is changed this often while the finger moves
+constexpr uint32_t MOVE_STEP_MS = 8;
+
+// Raw counts of a screen position on the nominal panel
+int16_t rawFor(int16_t screen, int16_t size) {
+    return 3800 - (int32_t)screen * 3600 / size;
+}
+
+void press(std::vector<sim::PanelReading>& readings, uint32_t& ms, int16_t fromX, int16_t fromY, int16_t toX,
+           int16_t toY, uint32_t moveMs, uint32_t holdMs) {
+    for (uint32_t t = 0; t <= moveMs; t += MOVE_STEP_MS) {
+        int16_t x = fromX + (int32_t)(toX - fromX) * t / max<uint32_t>(moveMs, 1);
+        int16_t y = fromY + (int32_t)(toY - fromY) * t / max<uint32_t>(moveMs, 1);
+        readings.push_back({ms + t, rawFor(x, 320), rawFor(y, 240), 1200});
+    }
+    ms += moveMs + holdMs;
+    readings.push_back({ms, 0, 0, 0});
+    ms += 400;
+}
+
+}
+
+namespace sim {
+
+std::vector<PanelReading> builtInTouchSession() {
+    std::vector<PanelReading> readings;
+    uint32_t ms = 200;
+    const int16_t brightnessY = 45 + SLIDER_HEIGHT / 2;
+    const int16_t colorTempY = 100 + SLIDER_HEIGHT / 2;
+    for (int i = 0; i < 5; i++) {
+        int16_t x = SLIDER_X + SLIDER_WIDTH * (20 + 15 * i) / 100;
+        press(readings, ms, x, brightnessY, x, brightnessY, 0, 80);
+    }
+    press(readings, ms, SLIDER_X + 20, brightnessY, SLIDER_X + 160, brightnessY, 600, 100);
+    press(readings, ms, SLIDER_X + 150, colorTempY, SLIDER_X + 30, colorTempY, 300, 100);
+    press(readings, ms, 60, 210, 60, 210, 0, 80);          // Pomodoro button
+    press(readings, ms, 230, 90, 230, 90, 0, 80);          // work +
+    press(readings, ms, 90, 170, 90, 170, 0, 80);          // break -
+    press(readings, ms, 20, 15, 20, 15, 0, 80);            // exit
+    press(readings, ms, 280, 170, 100, 170, 96, 0);        // swipe to the Pomodoro screen
+    press(readings, ms, 60, 130, 240, 130, 96, 0);         // and back
+    return readings;
+}
+
+bool loadPanelReadings(const char* path, std::vector<PanelReading>& readings) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char line[128];
+    while (fgets(line, sizeof(line), file)) {
+        unsigned long ms;
+        int x, y, z;
+        if (line[0] == '#' || sscanf(line, "%lu %d %d %d", &ms, &x, &y, &z) != 4) continue;
+        readings.push_back({(uint32_t)ms, (int16_t)x, (int16_t)y, (int16_t)z});
+    }
+    fclose(file);
+    return true;
+}
+
+uint32_t runTouchSession(CYD& cyd, const std::vector<PanelReading>& readings, uint32_t settleMs,
+                         BenchSamples* updateMicros) {
+    // The loop's frame gate and the readings, in time order, from here on
+    uint32_t start = millis();
+    uint32_t nextFrame = start;
+    size_t next = 0;
+    uint32_t frames = 0;
+    uint32_t end = start + (readings.empty() ? 0 : readings.back().ms) + settleMs;
+    while (millis() < end || cyd.isReplayingTouch()) {
+        uint32_t nextReading = next < readings.size() ? start + readings[next].ms : UINT32_MAX;
+        uint32_t now = millis();
+        if (nextReading <= nextFrame) {
+            if (nextReading > now) delay(nextReading - now);
+            const PanelReading& reading = readings[next++];
+            if (reading.z > 0) {
+                setTouch(reading.x, reading.y, reading.z);
+            } else {
+                releaseTouch();
+            }
+            continue;
+        }
+        if (nextFrame > now) delay(nextFrame - now);
+        uint32_t frameStart = millis();
+        uint32_t updateStart = micros();
+        cyd.update();
+        if (updateMicros) updateMicros->add(micros() - updateStart);
+        TOUCH_LATENCY_END_FRAME();
+        frames++;
+        nextFrame = frameStart + FRAME_MS;
+        if (cyd.isReplayingTouch()) {
+            end = max<uint32_t>(end, millis() + settleMs);
+        }
+    }
+    return frames;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "BenchStats.h"
+
+#include <cstdint>
+#include <vector>
+
+class CYD;
+
+// Touch sessions for the benchmarks that drive the real CYD loop: readings
+// for the simulated panel, built in or from a text trace, and the loop that
+// plays them while running CYD::update() as main.cpp does
+namespace sim {
+
+// A raw panel reading at 'ms' into the session; z 0 lifts the finger
+struct PanelReading {
+    uint32_t ms;
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+// Taps and drags on both sliders, the Pomodoro screen's buttons and a swipe
+// there and back, about 8s
+std::vector<PanelReading> builtInTouchSession();
+
+// "<ms> <x> <y> <z>" per line, '#' comments
+bool loadPanelReadings(const char* path, std::vector<PanelReading>& readings);
+
+// Runs the loop's 16ms frames with the readings applied in time order, until
+// 'settleMs' after the last reading and after any touch replay has ended.
+// Returns the frames run; the time update() took in each, if asked for.
+uint32_t runTouchSession(CYD& cyd, const std::vector<PanelReading>& readings, uint32_t settleMs,
+                         BenchSamples* updateMicros = nullptr);
+
+}
@@ -0,0 +1,283 @@
+#include "AudioManager.h"
+#include "CYD.h"
+#include "Flash25Q128JV.h"
+#include "FlashKVStore.h"
+#include "FlashLayout.h"
+#include "SimBench.h"
+#include "SimImage.h"
+#include "TemperatureLog.h"
+#include "W25QSim.h"
+
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+
+// The real CYD and Pomodoro screens rendered into the host display: what a
+// scripted session of taps and ticks costs on the SPI link, step by step,
+// with a PNG capture of the screen after each step, then the host CPU time
+// of a full redraw. Usage:
+//   ui [--out DIR] [--golden DIR] [--baseline US]
+// --out writes DIR/<step>.png; --golden compares every step against
+// DIR/<step>.png, writes a <step>.diff.png next to the capture when they
+// differ (with --out) and fails the run. --baseline takes the redraw time a
+// UI_PROFILE=0 build printed and reports what this build's profiler adds.
+namespace {
+
+struct Options {
+    const char* outDir = nullptr;
+    const char* goldenDir = nullptr;
+    double baselineMicros = 0;
+};
+
+struct Step {
+    const char* name;
+    void (*run)(CYD& cyd);
+};
+
+// Inverse of the uncalibrated raw-to-screen map in TouchCalibration: the
+// first raw count, from the 3800 edge, that lands on 'screen'
+int16_t rawFor(int16_t screen, bool vertical) {
+    TouchCalibration nominal;
+    for (int16_t raw = 3800; raw >= 200; raw--) {
+        TouchPoint point = {raw << TouchFilter::FRACTION_BITS, raw << TouchFilter::FRACTION_BITS};
+        int16_t x, y;
+        nominal.apply(point, x, y);
+        if ((vertical ? y : x) >= screen) return raw;
+    }
+    return 200;
+}
+
+// A short press: one update() sees it, the next one the release
+void tap(CYD& cyd, int16_t x, int16_t y) {
+    delay(150);
+    sim::setTouch(rawFor(x, false), rawFor(y, true), 1200);
+    cyd.update();
+    sim::releaseTouch();
+    delay(20);
+    cyd.update();
+}
+
+// Press at fromX, slide to toX over 'frames' 16ms UI frames, then lift after
+// a pause long enough for the touch smoothing to catch up, as a finger does
+void drag(CYD& cyd, int16_t fromX, int16_t toX, int16_t y, int frames) {
+    const int HOLD_FRAMES = 4;
+    delay(150);
+    for (int frame = 0; frame <= frames + HOLD_FRAMES; frame++) {
+        int16_t x = fromX + (toX - fromX) * min(frame, frames) / frames;
+        sim::setTouch(rawFor(x, false), rawFor(y, true), 1200);
+        cyd.update();
+        delay(16);
+    }
+    sim::releaseTouch();
+    cyd.update();
+}
+
+// A quick horizontal flick from fromX to toX, lifted while still moving
+void swipe(CYD& cyd, int16_t fromX, int16_t toX, int16_t y) {
+    const int FRAMES = 6;
+    delay(150);
+    for (int frame = 0; frame <= FRAMES; frame++) {
+        int16_t x = fromX + (toX - fromX) * frame / FRAMES;
+        sim::setTouch(rawFor(x, false), rawFor(y, true), 1200);
+        cyd.update();
+        delay(16);
+    }
+    sim::releaseTouch();
+    delay(20);
+    cyd.update();
+}
+
+void wait(CYD& cyd, uint32_t ms) {
+    delay(ms);
+    cyd.update();
+}
+
+const Step STEPS[] = {
+    {"boot",           [](CYD& cyd) { cyd.begin(); cyd.loadSettings(); cyd.drawUI(); }},
+    {"main-redraw",    [](CYD& cyd) { cyd.drawUI(); }},
+    {"brightness-60",  [](CYD& cyd) { tap(cyd, SLIDER_X + SLIDER_WIDTH * 60 / 100, 45 + SLIDER_HEIGHT / 2); }},
+    {"color-temp-25",  [](CYD& cyd) { tap(cyd, SLIDER_X + SLIDER_WIDTH * 25 / 100, 100 + SLIDER_HEIGHT / 2); }},
+    {"brightness-drag",[](CYD& cyd) { drag(cyd, SLIDER_X + SLIDER_WIDTH * 60 / 100, SLIDER_X + SLIDER_WIDTH * 20 / 100,
+                                           45 + SLIDER_HEIGHT / 2, 30); }},
+    {"temperature",    [](CYD& cyd) { wait(cyd, 2100); }},
+    {"pomodoro-open",  [](CYD& cyd) { tap(cyd, 60, 210); }},
+    {"work-plus",      [](CYD& cyd) { tap(cyd, 230, 90); }},
+    {"break-minus",    [](CYD& cyd) { tap(cyd, 90, 170); }},
+    {"start",          [](CYD& cyd) { tap(cyd, 160, 210); }},
+    {"countdown-tick", [](CYD& cyd) { wait(cyd, 1000); }},
+    {"countdown-10s",  [](CYD& cyd) { for (int i = 0; i < 10; i++) wait(cyd, 1000); }},
+    {"stop",           [](CYD& cyd) { tap(cyd, 160, 210); }},
+    {"pomodoro-exit",  [](CYD& cyd) { tap(cyd, 20, 15); }},
+    {"swipe-open",     [](CYD& cyd) { swipe(cyd, 280, 100, 170); }},
+    {"swipe-back",     [](CYD& cyd) { swipe(cyd, 60, 240, 130); }},
+};
+
+std::string pathFor(const char* dir, const char* step, const char* suffix) {
+    return std::string(dir) + "/" + step + suffix;
+}
+
+// "ok", "missing" or a summary of the difference
+std::string compareGolden(const Options& options, const char* step, const sim::Image& capture) {
+    sim::Image golden;
+    if (!sim::readPng(pathFor(options.goldenDir, step, ".png").c_str(), golden)) {
+        return "missing";
+    }
+    sim::Image highlight;
+    sim::ImageDiff diff = sim::diffImages(golden, capture, &highlight);
+    if (diff.sizeMismatch) {
+        return "size differs";
+    }
+    if (diff.pixels == 0) {
+        return "ok";
+    }
+    if (options.outDir) {
+        sim::writePng(pathFor(options.outDir, step, ".diff.png").c_str(), highlight);
+    }
+    char summary[64];
+    snprintf(summary, sizeof(summary), "%u px differ in %dx%d at (%d,%d)", diff.pixels,
+             diff.right - diff.left + 1, diff.bottom - diff.top + 1, diff.left, diff.top);
+    return summary;
+}
+
+// Host CPU time of one full redraw, the best of a few batches. The modeled
+// wire time leaves out the CPU work the profiler's hooks add; this doesn't,
+// and with no bus waits in it, it overstates their share of a device frame.
+double redrawCpuMicros(CYD& cyd) {
+    const int BATCHES = 30;
+    const int REDRAWS = 20;
+    double best = 0;
+    for (int batch = 0; batch < BATCHES; batch++) {
+        timespec start, end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+        for (int i = 0; i < REDRAWS; i++) {
+            cyd.drawUI();
+        }
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        double micros = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e3 / REDRAWS;
+        if (batch == 0 || micros < best) best = micros;
+    }
+    return best;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            options.outDir = argv[++i];
+        } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            options.goldenDir = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            options.baselineMicros = atof(argv[++i]);
+        } else {
+            printf("usage: ui [--out DIR] [--golden DIR] [--baseline US]\n");
+            return false;
+        }
+    }
+    if (options.outDir) {
+        mkdir(options.outDir, 0755);
+    }
+    return true;
+}
+
+}
+
+int runUiBench(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    W25QSim chip;
+    sim::attachSpiDevice(FLASH_CS_PIN, &chip);
+    Flash25Q128JV flash;
+    if (!flash.begin()) {
+        printf("flash begin() failed\n");
+        return 1;
+    }
+    FlashKVStore settings(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+    settings.begin();
+    TemperatureLog temperatureLog(flash, FLASH_TEMPLOG_ADDR, FLASH_TEMPLOG_SECTORS);
+    temperatureLog.begin();
+    AudioManager audio;
+
+    // Same temperature walk every run
+    randomSeed(1);
+    CYD cyd(audio, settings, temperatureLog);
+
+    const sim::DisplayCostModel& model = sim::displayCostModel();
+    printf("Display: %.0fMHz SPI, %u bytes per address window\n\n", model.spiHz / 1e6,
+           (unsigned)DamageTracker::WINDOW_OVERHEAD_BYTES);
+    printf("%-16s %6s %6s %9s %9s %9s %9s  %s\n", "step", "calls", "windows", "panel px", "SPI KB",
+           "wire ms", "step ms", options.goldenDir ? "golden" : "");
+
+    sim::DrawCost totals[sim::DRAW_OP_COUNT] = {};
+    int mismatches = 0;
+    // Mode switches as CYD times them, without the tap around them
+    std::string switches;
+    for (const Step& step : STEPS) {
+        sim::resetDrawCosts();
+        uint32_t switchCount = cyd.switchCount();
+        uint64_t start = sim::nowNs();
+        step.run(cyd);
+        uint64_t ns = sim::nowNs() - start;
+        if (cyd.switchCount() != switchCount) {
+            char line[64];
+            snprintf(line, sizeof(line), "  %-14s %9.2f ms\n", step.name, cyd.lastSwitchMicros() / 1e3);
+            switches += line;
+        }
+
+        sim::DrawCost cost = sim::totalDrawCost();
+        for (uint8_t op = 0; op < sim::DRAW_OP_COUNT; op++) {
+            const sim::DrawCost& opCost = sim::drawCost((sim::DrawOp)op);
+            totals[op].calls += opCost.calls;
+            totals[op].windows += opCost.windows;
+            totals[op].pixels += opCost.pixels;
+            totals[op].busBytes += opCost.busBytes;
+            totals[op].busNs += opCost.busNs;
+        }
+
+        int16_t width = 0, height = 0;
+        const uint16_t* pixels = sim::displayPixels(&width, &height);
+        sim::Image capture = sim::captureImage(pixels, width, height);
+        if (options.outDir) {
+            sim::writePng(pathFor(options.outDir, step.name, ".png").c_str(), capture);
+        }
+        std::string golden;
+        if (options.goldenDir) {
+            golden = compareGolden(options, step.name, capture);
+            if (golden != "ok") mismatches++;
+        }
+
+        uint64_t panelPixels = (cost.busBytes - cost.windows * DamageTracker::WINDOW_OVERHEAD_BYTES) / 2;
+        printf("%-16s %6u %6u %9llu %9.1f %9.2f %9.2f  %s\n", step.name, cost.calls, cost.windows,
+               (unsigned long long)panelPixels, cost.busBytes / 1024.0, cost.busNs / 1e6, ns / 1e6,
+               golden.c_str());
+    }
+
+    printf("\nPer call, all steps:\n");
+    printf("  %-14s %7s %8s %10s %9s %9s\n", "call", "calls", "windows", "pixels", "SPI KB", "wire ms");
+    for (uint8_t op = 0; op < sim::DRAW_OP_COUNT; op++) {
+        const sim::DrawCost& cost = totals[op];
+        if (cost.calls == 0) continue;
+        printf("  %-14s %7u %8u %10llu %9.1f %9.2f\n", sim::drawOpName((sim::DrawOp)op), cost.calls,
+               cost.windows, (unsigned long long)cost.pixels, cost.busBytes / 1024.0, cost.busNs / 1e6);
+    }
+
+    if (!switches.empty()) {
+        printf("\nScreen switches:\n%s", switches.c_str());
+    }
+
+    double redrawMicros = redrawCpuMicros(cyd);
+    printf("\nFull redraw, host CPU: %.1f us (UI_PROFILE=%d)\n", redrawMicros, UI_PROFILE);
+    if (options.baselineMicros > 0) {
+        double overhead = (redrawMicros / options.baselineMicros - 1) * 100;
+        printf("  profiler overhead    %+.2f%% over %.1f us, %s the 1%% budget\n", overhead,
+               options.baselineMicros, overhead < 1 ? "within" : "OVER");
+    }
+
+    sim::detachSpiDevice(FLASH_CS_PIN);
+    if (options.goldenDir) {
+        printf("\n%d of %zu steps differ from %s\n", mismatches, sizeof(STEPS) / sizeof(STEPS[0]),
+               options.goldenDir);
+    }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,501 @@
+#include "W25QSim.h"
+#include "Flash25Q128JV.h"
+
+#include <cstdio>
+#include <cstring>
+
+W25QSim::W25QSim(uint32_t size, uint32_t jedecId)
+    : m_memory(size, 0xFF)
+    , m_jedecId(jedecId)
+    // Typical and maximum values from the W25Q128JV datasheet
+    , m_timing{400, 45000, 120000, 150000, 40000, 10000, 20}
+    , m_maxTiming{3000, 400000, 1600000, 2000000, 200000, 15000, 20}
+    , m_timingMode(TIMING_TYPICAL)
+    , m_jitter(1)
+    , m_stats{}
+    , m_sectorErases(size / FLASH_SECTOR_SIZE, 0)
+    , m_tornProgramBytes(-1)
+    , m_tornDropBytes(0)
+    , m_writeEnabled(false)
+    , m_status2(0)
+    , m_addressBytes(3)
+    , m_busyUntilNs(0)
+    , m_busySuspendable(false)
+    , m_suspended(false)
+    , m_suspendedRemainingNs(0)
+    , m_operationAddress(0)
+    , m_operationLength(0)
+    , m_operationIsErase(false)
+    , m_suspendedAddress(0)
+    , m_suspendedLength(0)
+    , m_suspendedErase(false)
+    , m_resumedAtNs(0)
+    , m_selected(false)
+    , m_ignoreFrame(false)
+    , m_opcode(0)
+    , m_position(0)
+    , m_address(0)
+    , m_pendingStatus{0, 0}
+    , m_pageBuffer(FLASH_PAGE_SIZE, 0xFF)
+    , m_pageBytes(0) {
+    loadDefaultSfdp();
+}
+
+W25QSim::~W25QSim() {
+    if (!m_imagePath.empty()) {
+        saveImage();
+    }
+}
+
+bool W25QSim::attachImage(const char* path) {
+    m_imagePath = path;
+    memset(m_memory.data(), 0xFF, m_memory.size());
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return true;  // created on the first save
+    }
+    size_t loaded = fread(m_memory.data(), 1, m_memory.size(), file);
+    fclose(file);
+    return loaded <= m_memory.size();
+}
+
+bool W25QSim::saveImage() {
+    if (m_imagePath.empty()) {
+        return false;
+    }
+
+    FILE* file = fopen(m_imagePath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(m_memory.data(), 1, m_memory.size(), file) == m_memory.size();
+    return fclose(file) == 0 && ok;
+}
+
+namespace {
+
+constexpr uint32_t SFDP_BFPT_OFFSET = 0x80;
+constexpr uint8_t SFDP_BFPT_DWORDS = 16;
+
+// BFPT erase time field: (count + 1) * unit, unit 1ms/16ms/128ms/1s
+uint32_t encodeEraseTime(uint32_t us) {
+    static const uint32_t UNITS_MS[] = {1, 16, 128, 1000};
+    uint32_t ms = (us + 999) / 1000;
+    for (uint8_t unit = 0; unit < 4; unit++) {
+        uint32_t count = (ms + UNITS_MS[unit] - 1) / UNITS_MS[unit];
+        if (count <= 32) return (unit << 5) | (count > 0 ? count - 1 : 0);
+    }
+    return 0x7F;
+}
+
+}
+
+void W25QSim::loadDefaultSfdp() {
+    m_sfdp.assign(SFDP_BFPT_OFFSET + SFDP_BFPT_DWORDS * 4, 0xFF);
+
+    // SFDP header: signature, revision 1.6, one parameter header
+    const uint8_t header[] = {'S', 'F', 'D', 'P', 0x06, 0x01, 0x00, 0xFF,
+                              0x00, 0x06, 0x01, SFDP_BFPT_DWORDS,
+                              SFDP_BFPT_OFFSET, 0x00, 0x00, 0xFF};
+    memcpy(m_sfdp.data(), header, sizeof(header));
+
+    uint64_t bits = (uint64_t)m_memory.size() * 8;
+    bool large = m_memory.size() > (1u << 24);
+
+    // 4KB erase 0x20, 1-1-2 and 1-1-4 reads, 3 byte (or 3/4 byte) addressing
+    setSfdpDword(1, 0xFFF920E5 | (large ? 1u << 17 : 0));
+    setSfdpDword(2, (uint32_t)(bits - 1));
+    setSfdpDword(3, 0x6B08EB44);   // 1-1-4: 0x6B, 8 dummy clocks
+    setSfdpDword(4, 0xBB423B08);   // 1-1-2: 0x3B, 8 dummy clocks
+    setSfdpDword(5, 0xFFFFFFEE);
+    setSfdpDword(6, 0xFF00FFFF);
+    setSfdpDword(7, 0xFF00FFFF);
+    setSfdpDword(8, 0x520F200C);   // 4KB 0x20, 32KB 0x52
+    setSfdpDword(9, 0xFF00D810);   // 64KB 0xD8
+    setSfdpDword(10, (encodeEraseTime(m_timing.sectorEraseUs) << 4) |
+                     (encodeEraseTime(m_timing.block32EraseUs) << 11) |
+                     (encodeEraseTime(m_timing.block64EraseUs) << 18));
+    // Page size 2^8, page program time in 64us units
+    uint32_t programCount = (m_timing.pageProgramUs + 63) / 64;
+    setSfdpDword(11, (8 << 4) | ((programCount - 1) << 8) | (1 << 13));
+    setSfdpDword(12, 0x6C03C1E5);   // bit 31 clear: suspend supported
+    setSfdpDword(13, 0x757A757A);                // suspend 0x75, resume 0x7A
+    setSfdpDword(14, 0xFFFFFFFF);
+    setSfdpDword(15, 5 << 20);                   // QE in SR2 bit 1, written with 0x31
+    setSfdpDword(16, 0xFFFFFFFF);
+}
+
+uint32_t W25QSim::sfdpDword(uint8_t dword) const {
+    uint32_t offset = SFDP_BFPT_OFFSET + (dword - 1) * 4;
+    if (offset + 4 > m_sfdp.size()) return 0xFFFFFFFF;
+    return m_sfdp[offset] | (m_sfdp[offset + 1] << 8) | (m_sfdp[offset + 2] << 16) |
+           ((uint32_t)m_sfdp[offset + 3] << 24);
+}
+
+void W25QSim::setSfdpDword(uint8_t dword, uint32_t value) {
+    uint32_t offset = SFDP_BFPT_OFFSET + (dword - 1) * 4;
+    if (offset + 4 > m_sfdp.size()) return;
+    for (uint8_t i = 0; i < 4; i++) {
+        m_sfdp[offset + i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+void W25QSim::setTimingMode(TimingMode mode, uint32_t seed) {
+    m_timingMode = mode;
+    m_jitter.seed(seed);
+}
+
+uint64_t W25QSim::operationNs(uint32_t typicalUs, uint32_t maxUs) {
+    double us = typicalUs;
+    if (m_timingMode == TIMING_MAX) {
+        us = maxUs;
+    } else if (m_timingMode == TIMING_JITTER) {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        if (unit(m_jitter) < 0.005) {
+            us = typicalUs + unit(m_jitter) * (maxUs - typicalUs);
+        } else {
+            us = typicalUs * (0.75 + 0.5 * unit(m_jitter));
+        }
+    }
+    return (uint64_t)(us * 1000);
+}
+
+void W25QSim::resetStats() {
+    m_stats = Stats{};
+}
+
+void W25QSim::armTornProgram(uint32_t keepBytes, uint32_t dropBytes) {
+    m_tornProgramBytes = keepBytes;
+    m_tornDropBytes = dropBytes;
+}
+
+bool W25QSim::isBusy() const {
+    return sim::nowNs() < m_busyUntilNs;
+}
+
+uint8_t W25QSim::status1() const {
+    uint8_t status = 0;
+    if (isBusy()) status |= FLASH_STATUS_BUSY;
+    if (m_writeEnabled) status |= 0x02;
+    return status;
+}
+
+void W25QSim::startBusy(uint64_t durationNs, bool suspendable) {
+    m_busyUntilNs = sim::nowNs() + durationNs;
+    m_busySuspendable = suspendable;
+}
+
+void W25QSim::suspend() {
+    uint64_t now = sim::nowNs();
+    uint64_t latencyNs = (uint64_t)m_timing.suspendUs * 1000;
+
+    // Ignored when idle, e.g. the operation finished just before
+    if (!isBusy()) {
+        return;
+    }
+
+    // Only programs and sector/block erases suspend, and not within tSUS of
+    // the last resume
+    if (!m_busySuspendable || m_suspended ||
+        (m_resumedAtNs != 0 && now - m_resumedAtNs < latencyNs)) {
+        m_stats.protocolErrors++;
+        return;
+    }
+
+    // An operation that finishes within tSUS just completes
+    if (m_busyUntilNs <= now + latencyNs) {
+        return;
+    }
+
+    m_suspendedRemainingNs = m_busyUntilNs - now - latencyNs;
+    m_busyUntilNs = now + latencyNs;
+    m_busySuspendable = false;
+    m_suspended = true;
+    m_suspendedAddress = m_operationAddress;
+    m_suspendedLength = m_operationLength;
+    m_suspendedErase = m_operationIsErase;
+    m_stats.suspends++;
+}
+
+void W25QSim::resume() {
+    if (!m_suspended || isBusy()) {
+        m_stats.protocolErrors++;
+        return;
+    }
+
+    // A page programmed during the suspend doesn't change what resumes
+    m_suspended = false;
+    m_operationAddress = m_suspendedAddress;
+    m_operationLength = m_suspendedLength;
+    m_operationIsErase = m_suspendedErase;
+    m_resumedAtNs = sim::nowNs();
+    startBusy(m_suspendedRemainingNs, true);
+}
+
+bool W25QSim::allowedWhileSuspended(uint8_t opcode) const {
+    switch (opcode) {
+        case FLASH_CMD_PAGE_PROGRAM:
+            // Only an erase suspend; the page is checked once addressed
+            return m_suspendedErase;
+        case FLASH_CMD_SECTOR_ERASE:
+        case FLASH_CMD_BLOCK_ERASE_32K:
+        case FLASH_CMD_BLOCK_ERASE_64K:
+        case FLASH_CMD_CHIP_ERASE:
+        case 0x60:
+        case FLASH_CMD_WRITE_STATUS:
+        case FLASH_CMD_WRITE_STATUS2:
+        case FLASH_CMD_SUSPEND:
+            return false;
+        default:
+            return true;
+    }
+}
+
+void W25QSim::select() {
+    m_selected = true;
+    m_ignoreFrame = false;
+    m_position = 0;
+    m_address = 0;
+    m_pageBytes = 0;
+
+    // WEL clears once the operation that consumed it has finished
+    if (!isBusy() && !m_suspended && m_busyUntilNs != 0) {
+        m_writeEnabled = false;
+        m_busyUntilNs = 0;
+    }
+}
+
+bool W25QSim::takeAddressByte(uint32_t position, uint8_t mosi) {
+    if (position > m_addressBytes) return false;
+    m_address = ((m_address << 8) | mosi) % m_memory.size();
+    return true;
+}
+
+uint8_t W25QSim::readData(uint8_t lines, uint8_t expectedLines) {
+    // The chip only drives IO1..IO3 for the opcode that asked for them
+    if (lines != expectedLines || (expectedLines == 4 && !(m_status2 & FLASH_STATUS2_QE))) {
+        m_stats.protocolErrors++;
+        m_ignoreFrame = true;
+        return 0xFF;
+    }
+
+    uint8_t value = m_memory[m_address];
+    // Programs and erases are applied when they start, so a suspended one
+    // has to be hidden: an address hash stands in for the half-done cells
+    if (m_suspended && m_address - m_suspendedAddress < m_suspendedLength) {
+        value = (uint8_t)((m_address * 2654435761u) >> 24);
+        m_stats.undefinedReads++;
+    }
+    m_address = (m_address + 1) % m_memory.size();
+    m_stats.bytesRead++;
+    return value;
+}
+
+uint8_t W25QSim::exchange(uint8_t mosi, uint8_t lines) {
+    if (!m_selected || m_ignoreFrame) {
+        return 0xFF;
+    }
+
+    uint32_t position = m_position++;
+
+    if (position == 0) {
+        m_opcode = mosi;
+        // While busy only the status registers can be read (and the
+        // operation suspended); while suspended nothing may start another
+        bool rejected = isBusy()
+            ? m_opcode != FLASH_CMD_READ_STATUS && m_opcode != FLASH_CMD_READ_STATUS2 && m_opcode != FLASH_CMD_SUSPEND
+            : m_suspended && !allowedWhileSuspended(m_opcode);
+        if (rejected) {
+            m_stats.protocolErrors++;
+            m_ignoreFrame = true;
+        }
+        return 0xFF;
+    }
+
+    switch (m_opcode) {
+        case FLASH_CMD_READ_ID:
+            if (position > 3) return 0xFF;
+            return (m_jedecId >> (8 * (3 - position))) & 0xFF;
+
+        case FLASH_CMD_READ_STATUS:
+            m_stats.statusPolls++;
+            return status1();
+
+        case FLASH_CMD_READ_STATUS2:
+            return m_status2 | (m_suspended ? FLASH_STATUS2_SUS : 0);
+
+        case FLASH_CMD_WRITE_STATUS:
+        case FLASH_CMD_WRITE_STATUS2:
+            if (position <= 2) m_pendingStatus[position - 1] = mosi;
+            return 0xFF;
+
+        case FLASH_CMD_READ_SFDP:
+            // Always 3 address bytes and 8 dummy clocks
+            if (position <= 3) {
+                m_address = (m_address << 8) | mosi;
+                return 0xFF;
+            }
+            if (position == 4) return 0xFF;
+            return m_address < m_sfdp.size() ? m_sfdp[m_address++] : 0xFF;
+
+        case FLASH_CMD_READ_DATA:
+        case FLASH_CMD_FAST_READ:
+        case FLASH_CMD_FAST_READ_DUAL:
+        case FLASH_CMD_FAST_READ_QUAD: {
+            if (takeAddressByte(position, mosi)) return 0xFF;
+            uint32_t firstData = m_addressBytes + (m_opcode == FLASH_CMD_READ_DATA ? 1 : 2);
+            if (position < firstData) return 0xFF;  // dummy byte
+            uint8_t expectedLines = 1;
+            if (m_opcode == FLASH_CMD_FAST_READ_DUAL) expectedLines = 2;
+            if (m_opcode == FLASH_CMD_FAST_READ_QUAD) expectedLines = 4;
+            return readData(lines, expectedLines);
+        }
+
+        case FLASH_CMD_PAGE_PROGRAM:
+            if (takeAddressByte(position, mosi)) {
+                if (position == m_addressBytes) {
+                    memset(m_pageBuffer.data(), 0xFF, m_pageBuffer.size());
+                    // Not into the range a suspended erase is clearing
+                    if (m_suspended && m_address - m_suspendedAddress < m_suspendedLength) {
+                        m_stats.protocolErrors++;
+                        m_ignoreFrame = true;
+                    }
+                }
+                return 0xFF;
+            }
+            // Data past the page end wraps to the start of the same page
+            m_pageBuffer[(m_address + m_pageBytes) % FLASH_PAGE_SIZE] &= mosi;
+            m_pageBytes++;
+            return 0xFF;
+
+        case FLASH_CMD_SECTOR_ERASE:
+        case FLASH_CMD_BLOCK_ERASE_32K:
+        case FLASH_CMD_BLOCK_ERASE_64K:
+            takeAddressByte(position, mosi);
+            return 0xFF;
+
+        default:
+            return 0xFF;
+    }
+}
+
+void W25QSim::commitPageProgram() {
+    uint32_t pageBase = m_address & ~(uint32_t)(FLASH_PAGE_SIZE - 1);
+    uint32_t landed = FLASH_PAGE_SIZE;
+    uint32_t dropped = 0;
+    if (m_tornProgramBytes >= 0) {
+        landed = min<uint32_t>(m_tornProgramBytes, min<uint32_t>(m_pageBytes, FLASH_PAGE_SIZE));
+        dropped = m_tornDropBytes;
+        m_tornProgramBytes = -1;
+        m_tornDropBytes = 0;
+    }
+    // Bytes are counted from the program start address, wrapping in the page
+    for (uint32_t i = dropped; i < landed; i++) {
+        uint32_t offset = (m_address + i) % FLASH_PAGE_SIZE;
+        m_memory[pageBase + offset] &= m_pageBuffer[offset];
+    }
+    m_operationAddress = pageBase;
+    m_operationLength = FLASH_PAGE_SIZE;
+    m_operationIsErase = false;
+    m_stats.pagePrograms++;
+    m_stats.bytesProgrammed += min<uint32_t>(m_pageBytes, FLASH_PAGE_SIZE);
+    startBusy(operationNs(m_timing.pageProgramUs, m_maxTiming.pageProgramUs), true);
+}
+
+void W25QSim::eraseRegion(uint32_t address, uint32_t length) {
+    uint32_t base = address & ~(length - 1);
+    memset(&m_memory[base], 0xFF, length);
+    m_operationAddress = base;
+    m_operationLength = length;
+    m_operationIsErase = true;
+    for (uint32_t sector = base / FLASH_SECTOR_SIZE; sector < (base + length) / FLASH_SECTOR_SIZE; sector++) {
+        m_sectorErases[sector]++;
+    }
+}
+
+void W25QSim::deselect() {
+    m_selected = false;
+    if (m_ignoreFrame) return;
+
+    // Operations execute on the rising edge of CS
+    switch (m_opcode) {
+        case FLASH_CMD_WRITE_ENABLE:
+            if (m_position == 1) m_writeEnabled = true;
+            break;
+
+        case FLASH_CMD_WRITE_DISABLE:
+            if (m_position == 1) m_writeEnabled = false;
+            break;
+
+        case FLASH_CMD_WRITE_STATUS:
+            // SR1 is not modelled; the two byte form also writes SR2
+            if (m_writeEnabled && (m_position == 2 || m_position == 3)) {
+                if (m_position == 3) m_status2 = m_pendingStatus[1];
+                startBusy(operationNs(m_timing.writeStatusUs, m_maxTiming.writeStatusUs), false);
+            }
+            break;
+
+        case FLASH_CMD_WRITE_STATUS2:
+            if (m_writeEnabled && m_position == 2) {
+                m_status2 = m_pendingStatus[0];
+                startBusy(operationNs(m_timing.writeStatusUs, m_maxTiming.writeStatusUs), false);
+            }
+            break;
+
+        case FLASH_CMD_ENTER_4BYTE:
+        case 0xE9:   // exit 4 byte mode
+            if (m_position == 1 && m_memory.size() > (1u << 24)) {
+                m_addressBytes = m_opcode == FLASH_CMD_ENTER_4BYTE ? 4 : 3;
+            }
+            break;
+
+        case FLASH_CMD_PAGE_PROGRAM:
+            if (m_writeEnabled && m_position > m_addressBytes + 1u) commitPageProgram();
+            break;
+
+        case FLASH_CMD_SECTOR_ERASE:
+            if (m_writeEnabled && m_position == m_addressBytes + 1u) {
+                eraseRegion(m_address, FLASH_SECTOR_SIZE);
+                m_stats.sectorErases++;
+                startBusy(operationNs(m_timing.sectorEraseUs, m_maxTiming.sectorEraseUs), true);
+            }
+            break;
+
+        case FLASH_CMD_BLOCK_ERASE_32K:
+            if (m_writeEnabled && m_position == m_addressBytes + 1u) {
+                eraseRegion(m_address, FLASH_BLOCK32_SIZE);
+                m_stats.blockErases++;
+                startBusy(operationNs(m_timing.block32EraseUs, m_maxTiming.block32EraseUs), true);
+            }
+            break;
+
+        case FLASH_CMD_BLOCK_ERASE_64K:
+            if (m_writeEnabled && m_position == m_addressBytes + 1u) {
+                eraseRegion(m_address, FLASH_BLOCK64_SIZE);
+                m_stats.blockErases++;
+                startBusy(operationNs(m_timing.block64EraseUs, m_maxTiming.block64EraseUs), true);
+            }
+            break;
+
+        case FLASH_CMD_SUSPEND:
+            if (m_position == 1) suspend();
+            break;
+
+        case FLASH_CMD_RESUME:
+            if (m_position == 1) resume();
+            break;
+
+        case FLASH_CMD_CHIP_ERASE:
+        case 0x60:
+            if (m_writeEnabled && m_position == 1) {
+                eraseRegion(0, m_memory.size());
+                m_stats.chipErases++;
+                startBusy(operationNs(m_timing.chipEraseMs * 1000, m_maxTiming.chipEraseMs * 1000), false);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
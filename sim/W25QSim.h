@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "SimHost.h"
+
+// Behavioural model of a W25Q128JV on the simulated SPI bus: command decoding,
+// status register, write-enable latch, page-program wrap and busy periods in
+// virtual time. Commands that arrive while the chip is busy are ignored just
+// like on the real part (and counted as protocol errors). Programs and
+// sector/block erases can be suspended (0x75) to serve reads and resumed
+// (0x7A) where they left off; during an erase suspend pages outside the
+// erased range can be programmed.
+//
+// The chip answers Read SFDP (0x5A) with a JESD216B Basic Flash Parameter
+// Table derived from its size and timing. Benchmarks can edit the table (or
+// clear it) to stand in for other parts. Parts above 16MB accept 0xB7/0xE9 to
+// switch between 3 and 4 byte addresses.
+//
+// The array lives in RAM and can be backed by an image file, so a flash
+// layout survives between runs or can be inspected with host tools.
+class W25QSim : public sim::SpiDevice {
+public:
+    // How long program/erase operations take: the datasheet typical values,
+    // the datasheet maximums, or typical +-25% with a small chance of
+    // anything up to the maximum, as a stress model for timeouts and tails
+    enum TimingMode {
+        TIMING_TYPICAL,
+        TIMING_MAX,
+        TIMING_JITTER
+    };
+
+    struct Timing {
+        uint32_t pageProgramUs;   // tPP
+        uint32_t sectorEraseUs;   // tSE (4KB)
+        uint32_t block32EraseUs;  // tBE1
+        uint32_t block64EraseUs;  // tBE2
+        uint32_t chipEraseMs;     // tCE
+        uint32_t writeStatusUs;   // tW
+        uint32_t suspendUs;       // tSUS
+    };
+
+    struct Stats {
+        uint64_t bytesRead;
+        uint64_t bytesProgrammed;
+        uint32_t pagePrograms;
+        uint32_t sectorErases;
+        uint32_t blockErases;
+        uint32_t chipErases;
+        uint32_t statusPolls;
+        uint32_t suspends;
+        uint32_t protocolErrors;
+        uint32_t undefinedReads;    // bytes read from a suspended operation's range
+    };
+
+    static constexpr uint32_t DEFAULT_SIZE = 16 * 1024 * 1024;
+    static constexpr uint32_t DEFAULT_JEDEC_ID = 0xEF4018;
+
+    explicit W25QSim(uint32_t size = DEFAULT_SIZE, uint32_t jedecId = DEFAULT_JEDEC_ID);
+    ~W25QSim();
+
+    // Backs the array with an image file: loads it if it exists (a missing
+    // file or tail reads as erased) and writes it back on saveImage() and
+    // destruction
+    bool attachImage(const char* path);
+    bool saveImage();
+
+    // SpiDevice
+    void select() override;
+    void deselect() override;
+    uint8_t exchange(uint8_t mosi, uint8_t lines) override;
+
+    // SFDP space; empty for a part that doesn't implement it. DWORDs of the
+    // Basic Flash Parameter Table are counted from 1 as in JESD216.
+    std::vector<uint8_t>& sfdp() { return m_sfdp; }
+    uint32_t sfdpDword(uint8_t dword) const;
+    void setSfdpDword(uint8_t dword, uint32_t value);
+    void loadDefaultSfdp();
+    uint8_t addressBytes() const { return m_addressBytes; }
+
+    // Direct backdoor access for test setup and verification
+    uint8_t* memory() { return m_memory.data(); }
+    uint32_t size() const { return (uint32_t)m_memory.size(); }
+
+    bool isBusy() const;
+    bool isSuspended() const { return m_suspended; }
+    // End of the current busy period (in the past once the chip is idle)
+    uint64_t busyUntilNs() const { return m_busyUntilNs; }
+    Timing& timing() { return m_timing; }
+    Timing& maxTiming() { return m_maxTiming; }
+    void setTimingMode(TimingMode mode, uint32_t seed = 1);
+    TimingMode timingMode() const { return m_timingMode; }
+    const Stats& stats() const { return m_stats; }
+    void resetStats();
+    
+    // Wear per 4KB sector since construction
+    uint32_t sectorEraseCount(uint32_t sector) const { return m_sectorErases[sector]; }
+    
+    // Power-cut injection: the next page program only lands its first
+    // 'keepBytes' bytes, like a supply dropping out mid-program, less the
+    // first 'dropBytes' of them: the array doesn't program in byte order
+    void armTornProgram(uint32_t keepBytes, uint32_t dropBytes = 0);
+
+private:
+    std::vector<uint8_t> m_memory;
+    uint32_t m_jedecId;
+    Timing m_timing;
+    Timing m_maxTiming;
+    TimingMode m_timingMode;
+    std::mt19937 m_jitter;
+    Stats m_stats;
+    std::string m_imagePath;
+    std::vector<uint32_t> m_sectorErases;
+    int32_t m_tornProgramBytes;
+    uint32_t m_tornDropBytes;
+    std::vector<uint8_t> m_sfdp;
+
+    // Register state
+    bool m_writeEnabled;
+    uint8_t m_status2;
+    uint8_t m_addressBytes;
+    uint64_t m_busyUntilNs;
+    bool m_busySuspendable;
+    bool m_suspended;
+    uint64_t m_suspendedRemainingNs;
+    // Bytes the last program/erase changes; they read undefined while it is
+    // suspended, the array being neither the old data nor the new
+    uint32_t m_operationAddress;
+    uint32_t m_operationLength;
+    bool m_operationIsErase;
+    uint32_t m_suspendedAddress;
+    uint32_t m_suspendedLength;
+    bool m_suspendedErase;
+    uint64_t m_resumedAtNs;
+
+    // Current command frame
+    bool m_selected;
+    bool m_ignoreFrame;
+    uint8_t m_opcode;
+    uint32_t m_position;
+    uint32_t m_address;
+    uint8_t m_pendingStatus[2];
+    std::vector<uint8_t> m_pageBuffer;
+    uint32_t m_pageBytes;
+
+    uint8_t status1() const;
+    uint64_t operationNs(uint32_t typicalUs, uint32_t maxUs);
+    void startBusy(uint64_t durationNs, bool suspendable);
+    void suspend();
+    void resume();
+    bool allowedWhileSuspended(uint8_t opcode) const;
+    bool takeAddressByte(uint32_t position, uint8_t mosi);
+    uint8_t readData(uint8_t lines, uint8_t expectedLines);
+    void commitPageProgram();
+    void eraseRegion(uint32_t address, uint32_t length);
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+// Host stand-in for the subset of the Arduino-ESP32 core used by the
+// firmware. Time is virtual (see SimHost.h): delay() and bus traffic advance
+// a clock instead of sleeping, so benchmarks report modeled device time.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdarg>
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define INPUT_PULLUP   0x05
+
+#define MSBFIRST 1
+#define LSBFIRST 0
+
+#define RISING   0x01
+#define FALLING  0x02
+#define CHANGE   0x03
+
+#define IRAM_ATTR
+
+// ESP32 dev board default SPI chip select
+static const uint8_t SS = 5;
+
+#define F(string_literal) (string_literal)
+
+using std::min;
+using std::max;
+
+template <typename T, typename L, typename H>
+inline T constrain(T amt, L low, H high) {
+    return amt < low ? (T)low : (amt > high ? (T)high : amt);
+}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// Handlers run when sim::setPinLevel() (SimHost.h) makes the edge
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void yield() {}
+
+// SNTP is not simulated; time() stays the host's clock
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class String {
+public:
+    String() {}
+    String(const char* s) : m_s(s ? s : "") {}
+    String(const std::string& s) : m_s(s) {}
+    String(char c) : m_s(1, c) {}
+    String(int v) : m_s(std::to_string(v)) {}
+    String(unsigned int v) : m_s(std::to_string(v)) {}
+    String(long v) : m_s(std::to_string(v)) {}
+    String(unsigned long v) : m_s(std::to_string(v)) {}
+    String(unsigned char v) : m_s(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { format(v, decimals); }
+    String(double v, unsigned int decimals = 2) { format(v, decimals); }
+
+    const char* c_str() const { return m_s.c_str(); }
+    unsigned int length() const { return (unsigned int)m_s.size(); }
+    char operator[](unsigned int i) const { return i < m_s.size() ? m_s[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+    String substring(unsigned int from) const { return from < m_s.size() ? String(m_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        return from < m_s.size() && to > from ? String(m_s.substr(from, to - from)) : String();
+    }
+    int toInt() const { return atoi(m_s.c_str()); }
+    bool equals(const String& o) const { return m_s == o.m_s; }
+
+    String& operator+=(const String& o) { m_s += o.m_s; return *this; }
+    String& operator+=(const char* o) { m_s += o; return *this; }
+    String& operator+=(char c) { m_s += c; return *this; }
+    bool operator==(const String& o) const { return m_s == o.m_s; }
+    bool operator!=(const String& o) const { return m_s != o.m_s; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.m_s + b.m_s); }
+    friend String operator+(const String& a, const char* b) { return String(a.m_s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.m_s); }
+
+private:
+    std::string m_s;
+
+    void format(double v, unsigned int decimals) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, v);
+        m_s = buffer;
+    }
+};
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+    int available();
+    int read();
+    size_t write(uint8_t c);
+    size_t print(const char* s);
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c);
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + print("\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush() {}
+};
+
+extern HardwareSerial Serial;
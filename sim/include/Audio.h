@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for ESP32-audioI2S. Every file "plays" and finishes at
+// once; nothing is decoded.
+
+#include "Arduino.h"
+#include "FS.h"
+
+#define I2S_DAC_CHANNEL_RIGHT_EN 1
+#define I2S_DAC_CHANNEL_LEFT_EN  2
+#define I2S_DAC_CHANNEL_BOTH_EN  3
+
+class Audio {
+public:
+    Audio(bool = false, uint8_t = I2S_DAC_CHANNEL_BOTH_EN) {}
+
+    bool setVolume(uint8_t volume) {
+        _volume = volume;
+        return true;
+    }
+    bool connecttoFS(fs::FS&, const char*) { return true; }
+    bool connecttoSD(const char*) { return true; }
+    uint32_t stopSong() { return 0; }
+    void loop() {}
+    bool isRunning() { return false; }
+
+private:
+    uint8_t _volume = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 filesystem API: File and FS forward to
+// a FileImpl/FSImpl as on the device, so FlashAssetFS builds and runs here.
+// The SD card's filesystem has no implementation, so it has no files.
+
+#include "Arduino.h"
+
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+class FSImpl;
+typedef std::shared_ptr<FSImpl> FSImplPtr;
+
+class File {
+public:
+    File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+    size_t write(const uint8_t* buf, size_t size);
+    size_t read(uint8_t* buf, size_t size);
+    int available();
+    void flush();
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    const char* path() const;
+    const char* name() const;
+
+protected:
+    FileImplPtr _p;
+};
+
+class FS {
+public:
+    FS(FSImplPtr impl = FSImplPtr()) : _impl(impl) {}
+    virtual ~FS() {}
+
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+    bool exists(const char* path);
+
+protected:
+    FSImplPtr _impl;
+};
+
+}
+
+using fs::File;
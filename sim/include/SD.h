@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for the ESP32 SD library: there is never a card.
+
+#include "FS.h"
+#include "SPI.h"
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+class SDFS : public fs::FS {
+public:
+    bool begin(uint8_t = 5, SPIClass& = SPI, uint32_t = 4000000) { return false; }
+    void end() {}
+    sdcard_type_t cardType() { return CARD_NONE; }
+    uint64_t cardSize() { return 0; }
+};
+
+extern SDFS SD;
@@ -0,0 +1,58 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 SPIClass. Bytes are routed to the
+// simulated device whose chip-select pin is currently low, and every call
+// advances the virtual clock by the modeled bus and driver cost.
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+
+#define FSPI 1
+#define HSPI 2
+#define VSPI 3
+
+class SPISettings {
+public:
+    SPISettings() : _clock(1000000), _bitOrder(MSBFIRST), _dataMode(SPI_MODE0) {}
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+        : _clock(clock), _bitOrder(bitOrder), _dataMode(dataMode) {}
+    uint32_t _clock;
+    uint8_t _bitOrder;
+    uint8_t _dataMode;
+};
+
+class SPIClass {
+public:
+    explicit SPIClass(uint8_t spi_bus = HSPI);
+
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1);
+    void end();
+
+    void beginTransaction(SPISettings settings);
+    void endTransaction();
+
+    uint8_t transfer(uint8_t data);
+    void transfer(void* data, uint32_t size);
+    void transferBytes(const uint8_t* data, uint8_t* out, uint32_t size);
+    void writeBytes(const uint8_t* data, uint32_t size);
+
+    // Host extension: width of the data phase (1, 2 or 4 lines). Only the
+    // simulated bus can switch this; see FLASH_SPI_DATA_LINES.
+    void setDataLines(uint8_t lines) { _dataLines = lines; }
+
+    uint32_t getClock() const { return _clock; }
+
+private:
+    uint8_t _bus;
+    uint32_t _clock;
+    uint8_t _dataLines;
+    bool _inTransaction;
+
+    uint8_t exchange(uint8_t data);
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,212 @@
+#pragma once
+
+// Host stand-in for the subset of TFT_eSPI used by the firmware. The panel
+// is a framebuffer in RAM, so screens can be dumped and compared, and every
+// call is charged what it would cost on the SPI link (see SimHost.h).
+//
+// Fonts 1, 2, 4, 6 and 8 are drawn from a 5x7 bitmap font scaled up to the
+// real fonts' heights, font 7 as seven-segment digits. Heights match
+// TFT_eSPI and widths are close, so layouts and damage rectangles come out
+// about the same; the glyphs themselves only look like the real ones.
+
+#include "Arduino.h"
+
+// Panel wiring, normally set in platformio.ini
+#ifndef TFT_SCLK
+#define TFT_SCLK 14
+#endif
+#ifndef TFT_MISO
+#define TFT_MISO 12
+#endif
+#ifndef TFT_MOSI
+#define TFT_MOSI 13
+#endif
+#ifndef TFT_CS
+#define TFT_CS 15
+#endif
+#ifndef TFT_WIDTH
+#define TFT_WIDTH 240
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 320
+#endif
+
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_OLIVE       0x7BE0
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK        0xFE19
+#define TFT_BROWN       0x9A60
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#define TFT_VIOLET      0x915C
+
+// Text datums
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+#define L_BASELINE 9
+#define C_BASELINE 10
+#define R_BASELINE 11
+
+class TFT_eSPI {
+public:
+    TFT_eSPI(int16_t width = TFT_WIDTH, int16_t height = TFT_HEIGHT);
+    virtual ~TFT_eSPI();
+
+    void init();
+    void begin() { init(); }
+    void setRotation(uint8_t rotation);
+    uint8_t getRotation() const { return _rotation; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    void startWrite();
+    void endWrite();
+
+    // Primitives TFT_eSPI dispatches virtually; sprites and the profiler
+    // build on these
+    virtual void drawPixel(int32_t x, int32_t y, uint32_t color);
+    virtual void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color);
+    virtual void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color);
+    virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    virtual int16_t drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font);
+
+    void fillScreen(uint32_t color);
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color);
+
+    // Text. With one color, text is drawn transparently; with a background
+    // each character cell is filled.
+    void setTextColor(uint16_t color) { _textColor = _textBackground = color; }
+    void setTextColor(uint16_t color, uint16_t background, bool = false) {
+        _textColor = color;
+        _textBackground = background;
+    }
+    void setTextDatum(uint8_t datum) { _textDatum = datum; }
+    uint8_t getTextDatum() const { return _textDatum; }
+    void setTextFont(uint8_t font) { _textFont = font; }
+    int16_t drawString(const char* text, int32_t x, int32_t y, uint8_t font);
+    int16_t drawString(const char* text, int32_t x, int32_t y) { return drawString(text, x, y, _textFont); }
+    int16_t drawString(const String& text, int32_t x, int32_t y, uint8_t font) {
+        return drawString(text.c_str(), x, y, font);
+    }
+    int16_t drawString(const String& text, int32_t x, int32_t y) { return drawString(text.c_str(), x, y, _textFont); }
+    int16_t textWidth(const char* text, uint8_t font);
+    int16_t textWidth(const char* text) { return textWidth(text, _textFont); }
+    int16_t textWidth(const String& text, uint8_t font) { return textWidth(text.c_str(), font); }
+    int16_t textWidth(const String& text) { return textWidth(text.c_str(), _textFont); }
+    int16_t fontHeight(int16_t font);
+    int16_t fontHeight() { return fontHeight(_textFont); }
+
+    // Clipping and datum shift; with vpDatum the origin moves to (x, y)
+    void setViewport(int32_t x, int32_t y, int32_t w, int32_t h, bool vpDatum = true);
+    void resetViewport();
+
+    // Raw pixel pushes. Data is in the panel's byte order (as in sprites)
+    // unless setSwapBytes(true).
+    void setSwapBytes(bool swap) { _swapBytes = swap; }
+    bool getSwapBytes() const { return _swapBytes; }
+    void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+    void pushPixels(const void* data, uint32_t len);
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data);
+
+    // DMA transfers run while the caller carries on; the clock only catches
+    // up with them in dmaWait() or at the next transfer
+    bool initDMA(bool ctrl_cs = false);
+    void deInitDMA() { dmaWait(); _dmaReady = false; }
+    bool dmaBusy();
+    void dmaWait();
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data, uint16_t* buffer = nullptr);
+
+    uint16_t readPixel(int32_t x, int32_t y);
+
+    // Host extension: the panel contents, width() x height() RGB565
+    const uint16_t* framebuffer() const { return _pixels; }
+
+protected:
+    // Charges the calls made inside it to the outermost public entry point
+    class Call;
+
+    // Where primitives land: the panel framebuffer, or a sprite's buffer in
+    // panel byte order
+    uint16_t* _pixels;
+    int16_t _width;
+    int16_t _height;
+    bool _onBus;
+
+    // Writes a clipped, datum-shifted rectangle
+    void writeRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    // Writes a block of pixels in panel byte order, no viewport applied
+    void writeBlock(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data, int32_t stride,
+                    bool swapped);
+    void chargeWindow(uint32_t pixels);
+    void chargeRam(uint32_t pixels);
+
+    friend class TFT_eSprite;
+
+private:
+    const int16_t _panelWidth;
+    const int16_t _panelHeight;
+    uint8_t _rotation;
+    uint8_t _textFont;
+    uint8_t _textDatum;
+    uint16_t _textColor;
+    uint16_t _textBackground;
+    bool _swapBytes;
+    uint8_t _writeDepth;
+
+    int32_t _vpX, _vpY, _vpW, _vpH;    // clip area, right/bottom exclusive
+    int32_t _xDatum, _yDatum;
+
+    // setAddrWindow() target and the next pixel pushPixels() writes
+    int32_t _winX, _winY, _winW, _winH;
+    uint32_t _winNext;
+
+    bool _dmaReady;
+    uint64_t _dmaDoneNs;
+
+    void waitForBus();
+    int16_t charWidth(uint16_t uniCode, uint8_t font) const;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+    explicit TFT_eSprite(TFT_eSPI* tft);
+    ~TFT_eSprite() override;
+
+    void* setColorDepth(int8_t bits);
+    void* createSprite(int16_t width, int16_t height, uint8_t frames = 1);
+    void deleteSprite();
+    bool created() const { return _pixels != nullptr; }
+    void* getPointer() { return _pixels; }
+    void fillSprite(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+
+    // Copies the sprite, or a part of it, to the parent display
+    void pushSprite(int32_t x, int32_t y);
+    bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+private:
+    TFT_eSPI* const _tft;
+};
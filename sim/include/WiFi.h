@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 WiFi class. There is no network:
+// begin() connects at once, so the UI shows the connected state.
+
+#include "Arduino.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+public:
+    wl_status_t begin(const char*, const char* = nullptr) { return _status = WL_CONNECTED; }
+    bool disconnect(bool = false) {
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+    wl_status_t status() const { return _status; }
+
+private:
+    wl_status_t _status = WL_DISCONNECTED;
+};
+
+extern WiFiClass WiFi;
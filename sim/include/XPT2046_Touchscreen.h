@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for the XPT2046 touch controller library. The panel reports
+// whatever sim::setTouch() last set (see SimHost.h).
+
+#include "SPI.h"
+
+class TS_Point {
+public:
+    TS_Point() : x(0), y(0), z(0) {}
+    TS_Point(int16_t x, int16_t y, int16_t z) : x(x), y(y), z(z) {}
+    int16_t x, y, z;
+};
+
+class XPT2046_Touchscreen {
+public:
+    XPT2046_Touchscreen(uint8_t csPin, uint8_t irqPin = 255) : _csPin(csPin), _irqPin(irqPin) {}
+
+    bool begin(SPIClass& = SPI) { return true; }
+    void setRotation(uint8_t rotation) { _rotation = rotation; }
+
+    TS_Point getPoint();
+    bool touched();
+    bool tirqTouched();
+
+private:
+    uint8_t _csPin;
+    uint8_t _irqPin;
+    uint8_t _rotation = 1;
+};
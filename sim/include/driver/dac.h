@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF DAC driver
+
+typedef enum { DAC_CHANNEL_1 = 0, DAC_CHANNEL_2 = 1 } dac_channel_t;
+
+inline int dac_output_enable(dac_channel_t) { return 0; }
+inline int dac_output_disable(dac_channel_t) { return 0; }
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS types the firmware uses. Tasks
+// (freertos/task.h) take turns on virtual time, see SimHost.h.
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE        0
+#define pdTRUE         1
+#define pdPASS         pdTRUE
+#define pdFAIL         pdFALSE
+#define portMAX_DELAY  ((TickType_t)0xFFFFFFFF)
+
+// 1 kHz tick, as on the ESP32
+#define portTICK_PERIOD_MS  ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
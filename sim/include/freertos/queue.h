@@ -0,0 +1,15 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Fixed-size item queues. A task receiving from an empty queue blocks until
+// an item arrives or the wait times out; a send from the loop hands the
+// woken task the turn right away, as its own core would. Sends never block:
+// a full queue fails them.
+
+struct SimQueue;
+typedef SimQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Mutexes only count their holders on the host: tasks never run
+// concurrently, so a take can never block.
+struct SimSemaphore {
+    uint32_t depth;
+};
+
+typedef SimSemaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return new SimSemaphore{0};
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t) {
+    semaphore->depth++;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    if (semaphore->depth == 0) return pdFALSE;
+    semaphore->depth--;
+    return pdTRUE;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new SimSemaphore{0};
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xSemaphoreTakeRecursive(semaphore, ticks);
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return xSemaphoreGiveRecursive(semaphore);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Tasks run on host threads but never concurrently: each runs until it
+// blocks, then hands back to the loop (see sim::sleepNs() in SimHost.h).
+
+struct SimTask;
+typedef SimTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t entry, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period);
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+
+// The task gives up the turn and is due again at once
+#define taskYIELD() vTaskDelay(0)
+
+namespace sim {
+void runDueTasks();
+}
+
+// Runs the woken task, as the scheduler would once the handler returns
+#define portYIELD_FROM_ISR() sim::runDueTasks()
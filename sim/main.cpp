@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <cstring>
+#include "SimBench.h"
+
+// Host build entry point: pio run -e native && .pio/build/native/program <bench>
+namespace {
+
+struct BenchEntry {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* help;
+};
+
+const BenchEntry BENCHES[] = {
+    {"flash-read", runFlashReadBench, "Flash25Q128JV read throughput per mode and clock vs the legacy byte loop"},
+    {"kv-store",   runKVStoreBench,   "FlashKVStore update cost, wear and power-cut recovery"},
+    {"erase-range", runEraseRangeBench, "eraseRange() block planning vs a per-sector erase loop"},
+    {"suspend",    runSuspendBench,   "Read tail latency during programs/erases, normal vs urgent (suspend) reads"},
+    {"flash-cache", runFlashCacheBench, "FlashCache write coalescing and hot-read hit rate vs the bare driver"},
+    {"flash-suite", runFlashSuiteBench, "Read/program/erase MB/s and latency percentiles per access pattern"},
+    {"temp-log",   runTemperatureLogBench, "TemperatureLog density, wrap-around and range query cost"},
+    {"sfdp",       runSfdpBench,      "begin() auto-configuration from SFDP across simulated parts"},
+    {"ui",         runUiBench,        "SPI cost and screen captures of a scripted CYD session, golden image diffs"},
+    {"touch",      runTouchBench,     "Touch filter jitter and drag lag vs the fixed map(), calibration of a skewed panel"},
+    {"latency",    runLatencyBench,   "Touch-to-photon latency per stage, replaying a touch trace through CYD"},
+    {"replay",     runReplayBench,    "Touch record to the flash trace and replay through fresh boards, cost per pass"},
+    {"assets",     runAssetBench,     "Asset image packed, installed into FlashAssetBank and read back through FlashAssetFS"},
+    {"flash-queue", runFlashQueueBench, "UI loop frame gate during settings and log erases, loop vs FlashAsyncQueue"},
+};
+
+void printUsage(const char* program) {
+    printf("usage: %s <bench> [args]\n\n", program);
+    for (const BenchEntry& bench : BENCHES) {
+        printf("  %-14s %s\n", bench.name, bench.help);
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    for (const BenchEntry& bench : BENCHES) {
+        if (strcmp(argv[1], bench.name) == 0) {
+            return bench.run(argc - 1, argv + 1);
+        }
+    }
+
+    printUsage(argv[0]);
+    return 1;
+}
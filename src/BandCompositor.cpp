@@ -0,0 +1,91 @@
+#include "BandCompositor.h"
+#include "DamageTracker.h"
+
+BandCompositor::BandCompositor(TFT_eSPI& tft, int16_t bandHeight)
+    : m_tft(tft)
+    , m_bandA(&tft)
+    , m_bandB(&tft)
+    , m_bands{&m_bandA, &m_bandB}
+    , m_bandHeight(bandHeight)
+    , m_bandWidth(0)
+    , m_bandCount(0)
+    , m_next(0)
+    , m_dmaReady(false)
+    , m_overlap(true) {
+}
+
+BandCompositor::~BandCompositor() {
+    finish();
+    for (TFT_eSprite* band : m_bands) {
+        band->deleteSprite();
+    }
+}
+
+bool BandCompositor::begin() {
+    finish();
+    m_bandWidth = m_tft.width();
+    m_bandCount = 0;
+    m_next = 0;
+    for (TFT_eSprite* band : m_bands) {
+        band->deleteSprite();
+    }
+
+    // A second band only pays off with DMA; a short heap keeps just one
+    for (TFT_eSprite* band : m_bands) {
+        band->setColorDepth(16);
+        if (band->createSprite(m_bandWidth, m_bandHeight) == nullptr) break;
+        m_bandCount++;
+#if !UI_DMA
+        break;
+#endif
+    }
+
+#if UI_DMA
+    // Sprites keep pixels in the panel's byte order, so pushImageDMA() can
+    // send the band buffers as they are
+    if (m_bandCount > 0 && !m_dmaReady) {
+        m_dmaReady = m_tft.initDMA();
+    }
+#endif
+    return isReady();
+}
+
+uint32_t BandCompositor::memoryUsage() const {
+    return (uint32_t)m_bandCount * m_bandWidth * m_bandHeight * 2;
+}
+
+void BandCompositor::push(TFT_eSprite& band, const ScreenRect& slice) {
+    UI_PROFILE_SCOPE(SECTION_BAND_PUSH);
+    UI_PROFILE_BUS_BYTES(slice.area() * 2 + DamageTracker::WINDOW_OVERHEAD_BYTES);
+#if UI_DMA
+    if (overlapping()) {
+        // DMA sends w*h contiguous pixels, so pack the slice's rows together;
+        // they start at column 0 of each band row and only move down
+        uint16_t* pixels = static_cast<uint16_t*>(band.getPointer());
+        if (slice.w != m_bandWidth) {
+            for (int16_t row = 1; row < slice.h; row++) {
+                memmove(pixels + row * slice.w, pixels + row * m_bandWidth, slice.w * sizeof(uint16_t));
+            }
+        }
+
+        // Queues the transfer, waiting only for the previous band, which went
+        // out of the other buffer; the next band is drawn while this one is
+        // on the wire
+        m_tft.pushImageDMA(slice.x, slice.y, slice.w, slice.h, pixels);
+        m_next = (m_next + 1) % m_bandCount;
+        return;
+    }
+    if (m_dmaReady) {
+        m_tft.dmaWait();
+    }
+#endif
+    band.pushSprite(slice.x, slice.y, 0, 0, slice.w, slice.h);
+}
+
+void BandCompositor::finish() {
+#if UI_DMA
+    if (m_dmaReady) {
+        m_tft.dmaWait();
+    }
+#endif
+}
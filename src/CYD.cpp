@@ -1,366 +1,919 @@
-#include "CYD.h"
-
-// Slider implementation
-Slider::Slider(int x, int y, const String& label, uint16_t color)
-    : m_x(x)
-    , m_y(y)
-    , m_value(0)
-    , m_label(label)
-    , m_color(color) {
-}
-
-void Slider::draw(TFT_eSPI& tft) {
-    tft.setTextColor(UI_SUBTEXT);
-    tft.drawString(m_label, m_x, m_y - 15, 2);
-    tft.fillRoundRect(m_x, m_y, SLIDER_WIDTH, SLIDER_HEIGHT, SLIDER_HEIGHT/2, SLIDER_BG);
-    
-    int fillWidth = (SLIDER_WIDTH * m_value) / 100;
-    if(fillWidth > 0) {
-        tft.fillRoundRect(m_x, m_y, fillWidth, SLIDER_HEIGHT, SLIDER_HEIGHT/2, m_color);
-    }
-    
-    String valText = String(m_value) + "%";
-    tft.setTextColor(UI_TEXT);
-    tft.drawString(valText, m_x + SLIDER_WIDTH + 10, m_y + (SLIDER_HEIGHT/2) - 8, 2);
-}
-
-bool Slider::updateValue(int16_t touchX, int16_t touchY) {
-    if (touchY >= m_y && touchY <= m_y + SLIDER_HEIGHT &&
-        touchX >= m_x && touchX <= m_x + SLIDER_WIDTH) {
-        m_value = ((touchX - m_x) * 100) / SLIDER_WIDTH;
-        m_value = constrain(m_value, 0, 100);
-        return true;
-    }
-    return false;
-}
-
-// CYD implementation
-CYD::CYD(AudioManager& audio)
-    : m_touchSPI(VSPI)
-    , m_touchscreen(PIN_TOUCH_CS, PIN_TOUCH_IRQ)
-    , m_audioManager(audio)
-    , m_brightnessSlider(SLIDER_X, 45, "Brightness", UI_ACCENT)
-    , m_colorTempSlider(SLIDER_X, 100, "Color Temperature", UI_SECONDARY)
-    , m_pomodoroManager(nullptr)
-    , m_wifiConnected(false)
-    , m_timeInitialized(false)
-    , m_inPomodoroMode(false)
-    , m_currentTemp(23.0f)
-    , m_lastTimeUpdate(0)
-    , m_lastTempUpdate(0) {
-}
-
-void CYD::begin() {
-    Serial.println(F("CYD initialization starting..."));
-    
-    // Initialize SPI for display first
-    SPI.begin(TFT_SCLK, TFT_MISO, TFT_MOSI, TFT_CS);
-    Serial.println(F("Display SPI initialized"));
-    
-    // Initialize display
-    initDisplay();
-    Serial.println(F("Display initialized"));
-    
-    // Initialize touch with delay to allow display to stabilize
-    delay(100);
-    initTouch();
-    Serial.println(F("Touch initialized"));
-    
-    // Initialize LEDs
-    initLEDs();
-    Serial.println(F("LEDs initialized"));
-    
-    Serial.println(F("CYD initialization complete"));
-}
-
-void CYD::initLEDs() {
-    pinMode(PIN_LED_RED, OUTPUT);
-    pinMode(PIN_LED_GREEN, OUTPUT);
-    pinMode(PIN_LED_BLUE, OUTPUT);
-    turnOffLED();
-}
-
-void CYD::initDisplay() {
-    m_tft.init();
-    m_tft.setRotation(3);
-    m_tft.fillScreen(TFT_BLACK);
-}
-
-void CYD::initTouch() {
-    Serial.println(F("Initializing touch screen..."));
-    
-    // Initialize dedicated SPI for touch
-    m_touchSPI.begin(PIN_TOUCH_SCLK, PIN_TOUCH_MISO, PIN_TOUCH_MOSI, PIN_TOUCH_CS);
-    
-    // Set touch SPI to lower speed
-    m_touchSPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
-    m_touchSPI.endTransaction();
-    
-    // Initialize touchscreen
-    if (!m_touchscreen.begin(m_touchSPI)) {
-        Serial.println(F("Touch initialization failed!"));
-    } else {
-        Serial.println(F("Touch initialized successfully"));
-    }
-    
-    m_touchscreen.setRotation(1);
-}
-
-void CYD::setLED(uint8_t r, uint8_t g, uint8_t b) {
-    digitalWrite(PIN_LED_RED, !r);    // Active LOW
-    digitalWrite(PIN_LED_GREEN, !g);
-    digitalWrite(PIN_LED_BLUE, !b);
-}
-
-void CYD::setLEDColor(uint32_t color) {
-    uint8_t r = (color >> 16) & 0xFF;
-    uint8_t g = (color >> 8) & 0xFF;
-    uint8_t b = color & 0xFF;
-    setLED(r > 127, g > 127, b > 127);
-}
-
-void CYD::turnOffLED() {
-    setLED(0, 0, 0);
-}
-
-bool CYD::connectWiFi(const char* ssid, const char* password, uint32_t timeout) {
-    WiFi.begin(ssid, password);
-    
-    uint32_t startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - startTime < timeout) {
-        delay(500);
-    }
-    
-    m_wifiConnected = (WiFi.status() == WL_CONNECTED);
-    if (m_wifiConnected) {
-        syncTime();
-    }
-    return m_wifiConnected;
-}
-
-void CYD::disconnectWiFi() {
-    WiFi.disconnect();
-    m_wifiConnected = false;
-}
-
-bool CYD::isWiFiConnected() const {
-    return WiFi.status() == WL_CONNECTED;
-}
-
-void CYD::syncTime() {
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    
-    time_t now = time(nullptr);
-    while (now < 24 * 3600) {
-        delay(100);
-        now = time(nullptr);
-    }
-    
-    m_timeInitialized = true;
-}
-
-String CYD::getCurrentTime() const {
-    if (!m_timeInitialized) return F("Time not synced");
-    
-    time_t now = time(nullptr);
-    struct tm* timeinfo = localtime(&now);
-    char buffer[9];
-    strftime(buffer, sizeof(buffer), "%H:%M:%S", timeinfo);
-    return String(buffer);
-}
-
-String CYD::getCurrentDate() const {
-    if (!m_timeInitialized) return F("Date not synced");
-    
-    time_t now = time(nullptr);
-    struct tm* timeinfo = localtime(&now);
-    char buffer[11];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d", timeinfo);
-    return String(buffer);
-}
-
-void CYD::getTouchScreenCoordinates(int16_t& x, int16_t& y) {
-    x = y = -1;  // Default to no touch
-    
-    if (!m_touchscreen.touched() || !m_touchscreen.tirqTouched()) {
-        return;
-    }
-    
-    TS_Point p = m_touchscreen.getPoint();
-    
-    // Debug raw values
-    Serial.printf("Raw touch - x:%d y:%d z:%d\n", p.x, p.y, p.z);
-    
-    // Only process valid touches
-    if (p.z > 500) {
-        x = map(p.x, 3800, 200, 0, 320);
-        y = map(p.y, 3800, 200, 0, 240);
-        x = constrain(x, 0, 319);
-        y = constrain(y, 0, 239);
-    }
-}
-
-void CYD::drawHeader() {
-    m_tft.fillRect(0, 0, m_tft.width(), HEADER_HEIGHT, UI_SECONDARY);
-    m_tft.setTextColor(UI_TEXT);
-    m_tft.drawString(F("Smart Light Control"), MARGIN, 8, 2);
-    
-    // Draw connection status
-    int statusX = m_tft.width() - 15;
-    m_tft.fillCircle(statusX, HEADER_HEIGHT/2, 4, isWiFiConnected() ? TFT_GREEN : TFT_RED);
-    
-    // Draw time
-    if(m_timeInitialized) {
-        String timeStr = getCurrentTime();
-        m_tft.drawString(timeStr, m_tft.width() - m_tft.textWidth(timeStr, 2) - 30, 8, 2);
-    }
-}
-
-void CYD::drawUI() {
-    m_tft.fillScreen(UI_BACKGROUND);
-    
-    if (m_inPomodoroMode) {
-        if (m_pomodoroManager) {
-            m_pomodoroManager->begin();
-        }
-        return;
-    }
-    
-    drawHeader();
-    drawMainMenu();
-    m_brightnessSlider.draw(m_tft);
-    m_colorTempSlider.draw(m_tft);
-    updateTemperatureDisplay();
-}
-
-void CYD::update() {
-    if (m_inPomodoroMode) {
-        if (m_pomodoroManager) {
-            m_pomodoroManager->update();
-        }
-        handleTouch();
-        return;
-    }
-    
-    m_audioManager.loop();
-    handleTouch();
-    updateTimeDisplay();
-    
-    // Update temperature every 2 seconds
-    if (millis() - m_lastTempUpdate > 2000) {
-        updateTemperatureDisplay();
-        m_lastTempUpdate = millis();
-    }
-}
-
-void CYD::drawMainMenu() {
-    // Draw Pomodoro button
-    m_tft.fillRoundRect(10, 190, 100, 40, 5, UI_ACCENT);
-    m_tft.setTextColor(TFT_BLACK);
-    m_tft.setTextDatum(MC_DATUM);
-    m_tft.drawString("Pomodoro", 60, 210, 2);
-}
-
-void CYD::updateTimeDisplay() {
-    if (!m_timeInitialized || m_inPomodoroMode) return;
-    
-    if (millis() - m_lastTimeUpdate > 1000) {
-        String timeStr = getCurrentTime();
-        // Clear the entire header area and redraw it
-        drawHeader();
-        m_lastTimeUpdate = millis();
-    }
-}
-
-void CYD::handleTouch() {
-    static unsigned long lastTouchTime = 0;
-    unsigned long currentTime = millis();
-    
-    // Debounce delay
-    if (currentTime - lastTouchTime < 100) {  // Debounce time
-        return;
-    }
-    
-    int16_t screenX, screenY;
-    getTouchScreenCoordinates(screenX, screenY);
-    
-    if (screenX != -1 && screenY != -1) {
-        Serial.printf("Valid touch at x:%d y:%d\n", screenX, screenY);
-        lastTouchTime = currentTime;
-        
-        if (m_inPomodoroMode) {
-            if (m_pomodoroManager) {
-                m_pomodoroManager->handleTouch(screenX, screenY);
-                if (!m_pomodoroManager->isActive()) {
-                    togglePomodoroMode();
-                }
-            }
-        } else {
-            // Check for Pomodoro button
-            if (screenY >= 180 && screenY <= 240 && screenX >= 5 && screenX <= 115) {
-                Serial.println(F("Pomodoro button pressed"));
-                togglePomodoroMode();
-            } else if (m_brightnessSlider.updateValue(screenX, screenY) ||
-                      m_colorTempSlider.updateValue(screenX, screenY)) {
-                m_brightnessSlider.draw(m_tft);
-                m_colorTempSlider.draw(m_tft);
-                sendLightingValues(m_brightnessSlider.getValue(), m_colorTempSlider.getValue());
-            }
-        }
-        
-        delay(10);  // Small delay after processing touch
-    }
-}
-
-void CYD::togglePomodoroMode() {
-    m_inPomodoroMode = !m_inPomodoroMode;
-    if (m_inPomodoroMode) {
-        if (!m_pomodoroManager) {
-            m_pomodoroManager = new PomodoroManager(m_tft, m_audioManager);
-        }
-        m_pomodoroManager->begin();
-    } else {
-        drawUI();
-    }
-}
-
-float CYD::getDummyTemperature() {
-    // Simulate temperature between 18-28°C with some variation
-    static float lastTemp = 23.0;
-    float variation = (random(-10, 11) / 10.0);
-    lastTemp += variation;
-    lastTemp = constrain(lastTemp, 18.0, 28.0);
-    return lastTemp;
-}
-
-void CYD::updateTemperatureDisplay() {
-    if (m_inPomodoroMode) return;
-    
-    static float lastDisplayedTemp = 0;
-    m_currentTemp = getDummyTemperature();
-    
-    if (abs(m_currentTemp - lastDisplayedTemp) > 0.1 || lastDisplayedTemp == 0) {
-        // Clear the temperature area
-        m_tft.fillRect(SLIDER_X - 5, 150, SLIDER_WIDTH + 100, 50, UI_BACKGROUND);
-        
-        uint16_t tempColor = UI_ACCENT;
-        if(m_currentTemp > 26.0) tempColor = TEMP_WARN;
-        if(m_currentTemp > 27.0) tempColor = TEMP_CRITICAL;
-        
-        m_tft.setTextColor(UI_SUBTEXT);
-        m_tft.drawString(F("Temperature"), SLIDER_X, 150, 2);
-        
-        m_tft.setTextColor(tempColor);
-        String tempStr = String(m_currentTemp, 1) + "°C";
-        m_tft.drawString(tempStr, SLIDER_X, 170, 4);
-        
-        lastDisplayedTemp = m_currentTemp;
-    }
-}
-
-void CYD::sendLightingValues(uint8_t brightness, uint8_t colorTemp) {
-    // Dummy function to simulate sending values to light controller
-    Serial.printf("Sending - Brightness: %d%%, Color Temp: %d%%\n", brightness, colorTemp);
-}
-
+#include "CYD.h"
+
+// Logs every tap and lighting command over Serial. Off by default: the
+// prints sit inside the stages TouchLatency measures, and at 115200 baud a
+// line costs milliseconds once the UART buffer fills.
+#ifndef TOUCH_DEBUG
+#define TOUCH_DEBUG 0
+#endif
+
+// Settings keys
+static const char* const KEY_BRIGHTNESS = "light.bright";
+static const char* const KEY_COLOR_TEMP = "light.temp";
+static const char* const KEY_WIFI_OK = "wifi.ok";
+
+// Slider drags are saved once the value has settled, not per touch event
+static constexpr unsigned long LIGHTING_SAVE_DELAY_MS = 1000;
+
+// Temperature sampling and the 24h range shown next to the reading
+static constexpr unsigned long TEMP_SAMPLE_INTERVAL_MS = 2000;
+static constexpr unsigned long TEMP_SUMMARY_INTERVAL_MS = 5 * 60 * 1000;
+static constexpr uint32_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+// Main screen layout
+static constexpr uint16_t SLIDER_VALUE_WIDTH = 40;    // "100%" in font 2
+static constexpr uint16_t TEMP_RANGE_X = SLIDER_X + 110;
+static const ScreenRect HEADER_AREA = {0, 0, 320, HEADER_HEIGHT};
+static const ScreenRect POMODORO_BUTTON_AREA = {10, 190, 100, 40};
+static const ScreenRect TEMPERATURE_AREA = {SLIDER_X - 5, 150, SLIDER_WIDTH + 100, 50};
+// Touch calibration targets, spread over the screen and not in a line
+static constexpr int16_t CALIBRATION_X[TouchCalibration::POINTS] = {32, 288, 160};
+static constexpr int16_t CALIBRATION_Y[TouchCalibration::POINTS] = {24, 120, 216};
+
+static uint16_t temperatureColor(float celsius) {
+    if (celsius > 27.0) return TEMP_CRITICAL;
+    if (celsius > 26.0) return TEMP_WARN;
+    return UI_ACCENT;
+}
+
+// Slider implementation
+Slider::Slider(int x, int y, const String& label, uint16_t color)
+    : Widget(ScreenRect{(int16_t)x, (int16_t)(y - 15), SLIDER_WIDTH + 10 + SLIDER_VALUE_WIDTH, SLIDER_HEIGHT + 15})
+    , m_x(x)
+    , m_y(y)
+    , m_value(0)
+    , m_label(label)
+    , m_color(color) {
+    // The track's right edge included, so a touch there reaches 100%
+    setHitArea(ScreenRect{(int16_t)x, (int16_t)y, SLIDER_WIDTH + 1, SLIDER_HEIGHT + 1});
+    setTouchable(true);
+}
+
+void Slider::draw(TFT_eSPI& tft) {
+    UI_PROFILE_SCOPE(SECTION_SLIDERS);
+    drawTrack(tft);
+    drawFill(tft);
+}
+
+void Slider::drawStatic(TFT_eSPI& tft) {
+    UI_PROFILE_SCOPE(SECTION_SLIDERS);
+    drawTrack(tft);
+}
+
+void Slider::drawOverlay(TFT_eSPI& tft) {
+    UI_PROFILE_SCOPE(SECTION_SLIDERS);
+    drawFill(tft);
+}
+
+void Slider::drawTrack(TFT_eSPI& tft) {
+    tft.setTextDatum(TL_DATUM);
+    tft.setTextColor(UI_SUBTEXT);
+    tft.drawString(m_label, m_x, m_y - 15, 2);
+    tft.fillRoundRect(m_x, m_y, SLIDER_WIDTH, SLIDER_HEIGHT, SLIDER_HEIGHT/2, SLIDER_BG);
+}
+
+void Slider::drawFill(TFT_eSPI& tft) {
+    int fill = fillWidth(m_value);
+    if(fill > 0) {
+        tft.fillRoundRect(m_x, m_y, fill, SLIDER_HEIGHT, SLIDER_HEIGHT/2, m_color);
+    }
+    
+    tft.setTextDatum(TL_DATUM);
+    tft.setTextColor(UI_TEXT);
+    tft.drawString(valueText(m_value), m_x + SLIDER_WIDTH + 10, valueTop(), 2);
+}
+
+int16_t Slider::fillWidth(uint8_t value) {
+    return (SLIDER_WIDTH * value) / 100;
+}
+
+String Slider::valueText(uint8_t value) {
+    return String(value) + "%";
+}
+
+void Slider::setValue(uint8_t value) {
+    value = min<uint8_t>(value, 100);
+    if (value == m_value) return;
+    
+    // Only the strip the fill's end moved across and the digits that
+    // changed are repainted, so drags cost a few hundred pixels a frame
+    ScreenRect track = {(int16_t)m_x, (int16_t)m_y, SLIDER_WIDTH, SLIDER_HEIGHT};
+    invalidate(ProgressBar::fillChange(track, fillWidth(m_value), fillWidth(value)));
+    TFT_eSPI* tft = display();
+    if (tft) {
+        invalidate(DamageTracker::textChange(*tft, valueText(m_value), valueText(value), m_x + SLIDER_WIDTH + 10,
+                                             valueTop(), TL_DATUM, 2));
+    } else {
+        invalidate();
+    }
+    m_value = value;
+}
+
+bool Slider::updateValue(int16_t touchX) {
+    uint8_t before = m_value;
+    setValue(constrain(((touchX - m_x) * 100) / SLIDER_WIDTH, 0, 100));
+    return m_value != before;
+}
+
+// CYD implementation
+CYD::CYD(AudioManager& audio, FlashKVStore& settings, TemperatureLog& temperatureLog)
+    : m_compositor(m_tft)
+    , m_screenCache(m_tft, m_compositor)
+#if UI_LVGL
+    , m_lvgl(m_tft)
+#endif
+    , m_touchSPI(VSPI)
+    // PENIRQ is the sampler's; the library would poll it or attach its own
+    // handler
+    , m_touchscreen(PIN_TOUCH_CS)
+    , m_touchSampler(m_touchscreen, PIN_TOUCH_IRQ)
+    , m_touchRecording(nullptr)
+    , m_audioManager(audio)
+    , m_settings(settings)
+    , m_temperatureLog(temperatureLog)
+    , m_widgets(m_tft)
+    , m_brightnessSlider(SLIDER_X, 45, "Brightness", UI_ACCENT)
+    , m_colorTempSlider(SLIDER_X, 100, "Color Temperature", UI_SECONDARY)
+    , m_pomodoroButton(POMODORO_BUTTON_AREA, "Pomodoro", UI_ACCENT)
+    , m_pomodoroManager(nullptr)
+    , m_wifiConnected(false)
+    , m_timeInitialized(false)
+    , m_inPomodoroMode(false)
+    , m_currentTemp(23.0f)
+    , m_lastTimeUpdate(0)
+    , m_lastTempUpdate(0)
+    , m_lightingChangeTime(0)
+    , m_lightingDirty(false)
+    , m_touchHeld(false)
+    , m_touchX(0)
+    , m_touchY(0)
+    , m_dragSlider(nullptr)
+    , m_calibrateOnLift(false)
+    , m_calibrationTarget(-1)
+    , m_temperatureDay()
+    , m_lastSummaryUpdate(0)
+    , m_shownWiFi(false)
+    , m_shownTempColor(UI_ACCENT)
+    , m_frameTimesReported(false)
+    , m_lastSwitchMicros(0)
+    , m_switchCount(0)
+    , m_headerGlyphs(2, UI_TEXT, UI_SECONDARY)
+    , m_headerClock(m_headerGlyphs, HEADER_AREA.right() - 30, 8, TR_DATUM) {
+    m_widgets.add(m_brightnessSlider);
+    m_widgets.add(m_colorTempSlider);
+    m_widgets.add(m_pomodoroButton);
+    // Presses a little outside the button still count
+    m_pomodoroButton.setHitArea(ScreenRect{5, 180, 111, 60});
+}
+
+void CYD::begin() {
+    Serial.println(F("CYD initialization starting..."));
+    
+    // Initialize SPI for display first
+    SPI.begin(TFT_SCLK, TFT_MISO, TFT_MOSI, TFT_CS);
+    Serial.println(F("Display SPI initialized"));
+    
+    // Initialize display
+    initDisplay();
+    Serial.println(F("Display initialized"));
+    
+    // Initialize touch with delay to allow display to stabilize
+    delay(100);
+    initTouch();
+    Serial.println(F("Touch initialized"));
+    
+    // Initialize LEDs
+    initLEDs();
+    Serial.println(F("LEDs initialized"));
+    
+    Serial.println(F("CYD initialization complete"));
+}
+
+void CYD::initLEDs() {
+    pinMode(PIN_LED_RED, OUTPUT);
+    pinMode(PIN_LED_GREEN, OUTPUT);
+    pinMode(PIN_LED_BLUE, OUTPUT);
+    turnOffLED();
+}
+
+void CYD::initDisplay() {
+    m_tft.init();
+    m_tft.setRotation(3);
+    m_tft.fillScreen(TFT_BLACK);
+    m_damage.setScreenSize(m_tft.width(), m_tft.height());
+    
+#if UI_LVGL
+    // LVGL renders through its own draw buffers, so no band is allocated
+    if (m_lvgl.begin(readTouch, this)) {
+        m_mainScreen.create(onLightingChanged, onPomodoroPressed, this);
+        m_lvgl.printMemoryUsage();
+    } else {
+        Serial.println(F("Not enough heap for the LVGL draw buffers"));
+    }
+    return;
+#endif
+    
+    // Without the band, screens are drawn straight to the display
+    if (m_compositor.begin()) {
+        m_damage.setCompositor(&m_compositor);
+        Serial.printf("Display bands: %lu bytes, %s\n", (unsigned long)m_compositor.memoryUsage(),
+                      m_compositor.canOverlap() ? "DMA overlapped" : "blocking pushes");
+    } else {
+        Serial.println(F("Not enough heap for the display band"));
+    }
+}
+
+void CYD::initTouch() {
+    Serial.println(F("Initializing touch screen..."));
+    
+    // Initialize dedicated SPI for touch
+    m_touchSPI.begin(PIN_TOUCH_SCLK, PIN_TOUCH_MISO, PIN_TOUCH_MOSI, PIN_TOUCH_CS);
+    
+    // Set touch SPI to lower speed
+    m_touchSPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+    m_touchSPI.endTransaction();
+    
+    // Initialize touchscreen
+    if (!m_touchscreen.begin(m_touchSPI)) {
+        Serial.println(F("Touch initialization failed!"));
+    } else {
+        Serial.println(F("Touch initialized successfully"));
+    }
+    
+    m_touchscreen.setRotation(1);
+    
+    // Sampled on PENIRQ from here on; nothing else may use the touch bus
+    if (m_touchSampler.begin()) {
+        Serial.println(F("Touch sampling on PENIRQ"));
+    }
+}
+
+void CYD::setLED(uint8_t r, uint8_t g, uint8_t b) {
+    digitalWrite(PIN_LED_RED, !r);    // Active LOW
+    digitalWrite(PIN_LED_GREEN, !g);
+    digitalWrite(PIN_LED_BLUE, !b);
+}
+
+void CYD::setLEDColor(uint32_t color) {
+    uint8_t r = (color >> 16) & 0xFF;
+    uint8_t g = (color >> 8) & 0xFF;
+    uint8_t b = color & 0xFF;
+    setLED(r > 127, g > 127, b > 127);
+}
+
+void CYD::turnOffLED() {
+    setLED(0, 0, 0);
+}
+
+bool CYD::connectWiFi(const char* ssid, const char* password, uint32_t timeout) {
+    WiFi.begin(ssid, password);
+    
+    uint32_t startTime = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - startTime < timeout) {
+        delay(500);
+    }
+    
+    m_wifiConnected = (WiFi.status() == WL_CONNECTED);
+    m_settings.putUInt(KEY_WIFI_OK, m_wifiConnected);
+    if (m_wifiConnected) {
+        syncTime();
+    }
+    return m_wifiConnected;
+}
+
+void CYD::disconnectWiFi() {
+    WiFi.disconnect();
+    m_wifiConnected = false;
+}
+
+bool CYD::isWiFiConnected() const {
+    return WiFi.status() == WL_CONNECTED;
+}
+
+bool CYD::lastWiFiAttemptFailed() {
+    return m_settings.getUInt(KEY_WIFI_OK, 1) == 0;
+}
+
+void CYD::loadSettings() {
+    m_brightnessSlider.setValue(m_settings.getUInt(KEY_BRIGHTNESS, 0));
+    m_colorTempSlider.setValue(m_settings.getUInt(KEY_COLOR_TEMP, 0));
+    if (m_touchCalibration.load(m_settings)) {
+        m_touchCalibration.print();
+    }
+}
+
+void CYD::saveLightingValues() {
+    m_settings.putUInt(KEY_BRIGHTNESS, m_brightnessSlider.getValue());
+    m_settings.putUInt(KEY_COLOR_TEMP, m_colorTempSlider.getValue());
+    m_lightingDirty = false;
+}
+
+void CYD::syncTime() {
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+    
+    time_t now = time(nullptr);
+    while (now < 24 * 3600) {
+        delay(100);
+        now = time(nullptr);
+    }
+    
+    m_timeInitialized = true;
+}
+
+String CYD::getCurrentTime() const {
+    if (!m_timeInitialized) return F("Time not synced");
+    
+    time_t now = time(nullptr);
+    struct tm* timeinfo = localtime(&now);
+    char buffer[9];
+    strftime(buffer, sizeof(buffer), "%H:%M:%S", timeinfo);
+    return String(buffer);
+}
+
+String CYD::getCurrentDate() const {
+    if (!m_timeInitialized) return F("Date not synced");
+    
+    time_t now = time(nullptr);
+    struct tm* timeinfo = localtime(&now);
+    char buffer[11];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d", timeinfo);
+    return String(buffer);
+}
+
+void CYD::touchToScreen(const TouchPoint& raw, int16_t& x, int16_t& y) {
+    m_touchCalibration.apply(raw, x, y);
+    x = constrain(x, 0, m_tft.width() - 1);
+    y = constrain(y, 0, m_tft.height() - 1);
+}
+
+bool CYD::startTouchCalibration() {
+#if UI_LVGL
+    // LVGL owns the display and the touch reads
+    return false;
+#else
+    if (m_inPomodoroMode) return false;
+    
+    m_calibrationTarget = 0;
+    m_dragSlider = nullptr;
+    m_gestures.cancel();
+    m_damage.clear();
+    m_headerClock.invalidate();
+    m_tft.fillScreen(TFT_BLACK);
+    m_tft.setTextColor(UI_TEXT);
+    m_tft.setTextDatum(MC_DATUM);
+    m_tft.drawString(F("Touch the centre of each cross"), m_tft.width() / 2, m_tft.height() / 2 - 30, 2);
+    drawCalibrationTarget();
+    return true;
+#endif
+}
+
+void CYD::setTouchSmoothing(bool enabled) {
+    m_touchFilter.setSmoothing(enabled);
+}
+
+void CYD::drawCalibrationTarget() {
+    // The previous cross is cleared, the next drawn
+    const int16_t ARM = 10;
+    for (int8_t i = 0; i < TouchCalibration::POINTS; i++) {
+        uint16_t color = i == m_calibrationTarget ? UI_ACCENT : TFT_BLACK;
+        m_tft.fillRect(CALIBRATION_X[i] - ARM, CALIBRATION_Y[i], 2 * ARM + 1, 1, color);
+        m_tft.fillRect(CALIBRATION_X[i], CALIBRATION_Y[i] - ARM, 1, 2 * ARM + 1, color);
+    }
+}
+
+void CYD::handleCalibrationTouch(bool pressed, const TouchPoint& raw) {
+    // Each target takes the filtered position the press ended at
+    if (pressed) {
+        m_calibrationRaw[m_calibrationTarget] = raw;
+        m_touchHeld = true;
+        return;
+    }
+    if (!m_touchHeld) return;
+    m_touchHeld = false;
+    
+    if (++m_calibrationTarget < TouchCalibration::POINTS) {
+        drawCalibrationTarget();
+        return;
+    }
+    m_calibrationTarget = -1;
+    
+    if (m_touchCalibration.solve(m_calibrationRaw, CALIBRATION_X, CALIBRATION_Y)) {
+        m_touchCalibration.save(m_settings);
+        m_touchCalibration.print();
+    } else {
+        Serial.println(F("Touch calibration failed: the three touches were in a line"));
+    }
+    drawUI();
+}
+
+void CYD::drawMainScene(TFT_eSPI& gfx, const ScreenRect& clip) {
+    // Once the static layer is cached, only what changes is drawn over it
+    if (m_screenCache.draw(ScreenCache::SCREEN_MAIN, gfx, clip)) {
+        drawMainLayers(gfx, clip, LAYER_OVERLAY);
+    } else {
+        drawMainLayers(gfx, clip, LAYER_ALL);
+    }
+}
+
+void CYD::drawMainLayers(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers) {
+    // The header paints its own background
+    int16_t top = max<int16_t>(clip.y, HEADER_HEIGHT);
+    if ((layers & LAYER_STATIC) && clip.bottom() > top) {
+        UI_PROFILE_SCOPE(SECTION_BACKGROUND);
+        gfx.fillRect(clip.x, top, clip.w, clip.bottom() - top, UI_BACKGROUND);
+    }
+    
+    if (clip.intersects(HEADER_AREA)) drawHeader(gfx, layers);
+    if (clip.intersects(TEMPERATURE_AREA)) drawTemperature(gfx, layers);
+    
+    // Sliders and the Pomodoro button; the sliders time themselves
+    UI_PROFILE_SCOPE(SECTION_MENU);
+    m_widgets.draw(gfx, clip, layers);
+}
+
+void CYD::flushDamage() {
+    m_widgets.collectDamage(m_damage);
+    m_damage.flush(m_tft, [this](TFT_eSPI& gfx, const ScreenRect& clip) { drawMainScene(gfx, clip); });
+}
+
+void CYD::drawHeader(TFT_eSPI& gfx, uint8_t layers) {
+    UI_PROFILE_SCOPE(SECTION_HEADER);
+    gfx.setTextColor(UI_TEXT);
+    if (layers & LAYER_STATIC) {
+        gfx.fillRect(0, 0, m_tft.width(), HEADER_HEIGHT, UI_SECONDARY);
+        gfx.setTextDatum(TL_DATUM);
+        gfx.drawString(F("Smart Light Control"), MARGIN, 8, 2);
+    }
+    if (!(layers & LAYER_OVERLAY)) return;
+    
+    // Draw connection status
+    int statusX = m_tft.width() - 15;
+    gfx.fillCircle(statusX, HEADER_HEIGHT/2, 4, m_shownWiFi ? TFT_GREEN : TFT_RED);
+    
+    // Draw time
+    gfx.setTextDatum(TR_DATUM);
+    gfx.drawString(m_shownTime, m_tft.width() - 30, 8, 2);
+}
+
+void CYD::drawUI() {
+    if (m_inPomodoroMode) {
+        if (m_pomodoroManager) {
+            m_pomodoroManager->begin();
+        }
+        return;
+    }
+    
+    // Take in the current state, then repaint everything from it
+    refreshHeaderState();
+    updateTemperatureDisplay();
+#if UI_LVGL
+    if (m_lvgl.isReady()) {
+        syncMainScreen();
+        m_mainScreen.load();
+    }
+    return;
+#endif
+    // Rendered into the screen cache on the first visit; from then on every
+    // repaint starts from the cached static layer
+    m_screenCache.capture(ScreenCache::SCREEN_MAIN, [this](TFT_eSPI& gfx, const ScreenRect& clip) {
+        drawMainLayers(gfx, clip, LAYER_STATIC);
+    });
+    if (!m_frameTimesReported) {
+        reportFrameTimes();
+        return;
+    }
+    m_damage.addScreen();
+    flushDamage();
+}
+
+void CYD::reportFrameTimes() {
+    m_frameTimesReported = true;
+    
+    // The first full frame is drawn twice, with blocking pushes and then
+    // with DMA overlap, to show what the pipeline saves on this board
+    uint32_t frameMicros[2] = {0, 0};
+    for (int overlap = 0; overlap < 2; overlap++) {
+        m_compositor.setOverlap(overlap);
+        m_damage.addScreen();
+        flushDamage();
+        frameMicros[overlap] = m_damage.lastFrame().micros;
+    }
+    
+    if (m_compositor.canOverlap()) {
+        Serial.printf("Full frame: %lu us blocking, %lu us with DMA overlap\n",
+                      (unsigned long)frameMicros[0], (unsigned long)frameMicros[1]);
+    } else {
+        Serial.printf("Full frame: %lu us, no DMA overlap\n", (unsigned long)frameMicros[1]);
+    }
+}
+
+void CYD::update() {
+    // The calibration targets own the screen until the last one is touched
+    if (m_calibrationTarget >= 0) {
+        handleTouch();
+        return;
+    }
+    
+    // History keeps recording while the Pomodoro screen is up
+    if (millis() - m_lastTempUpdate > TEMP_SAMPLE_INTERVAL_MS) {
+        sampleTemperature();
+        updateTemperatureDisplay();
+        m_lastTempUpdate = millis();
+    }
+    
+    if (m_inPomodoroMode) {
+        if (m_pomodoroManager) {
+            m_pomodoroManager->update();
+        }
+#if UI_LVGL
+        if (m_lvgl.isReady()) {
+            m_lvgl.handle();
+        }
+        if (m_pomodoroManager && !m_pomodoroManager->isActive()) {
+            togglePomodoroMode();
+        }
+#else
+        handleTouch();
+#endif
+        return;
+    }
+    
+    m_audioManager.loop();
+#if UI_LVGL
+    // LVGL reads the touch panel and repaints the widgets that changed
+    updateTimeDisplay();
+    if (m_lvgl.isReady()) {
+        syncMainScreen();
+        m_lvgl.handle();
+    }
+#else
+    handleTouch();
+    updateTimeDisplay();
+    
+    // Everything that changed this frame goes out in one SPI transaction
+    flushDamage();
+#endif
+    
+    if (m_lightingDirty && millis() - m_lightingChangeTime > LIGHTING_SAVE_DELAY_MS) {
+        saveLightingValues();
+    }
+}
+
+void CYD::updateTimeDisplay() {
+    if (!m_timeInitialized || m_inPomodoroMode) return;
+    
+    if (millis() - m_lastTimeUpdate > 1000) {
+        refreshHeaderState();
+        m_lastTimeUpdate = millis();
+    }
+}
+
+void CYD::refreshHeaderState() {
+    // Only the clock digits that changed and the status dot are repainted;
+    // the old code redrew the whole header every second. A tick goes out
+    // from the glyph atlas, anything else is drawn by the next flush.
+    String timeStr = m_timeInitialized ? getCurrentTime() : String();
+    if (!m_headerClock.update(m_tft, timeStr)) {
+        m_damage.add(DamageTracker::textChange(m_tft, m_shownTime, timeStr, m_tft.width() - 30, 8, TR_DATUM, 2),
+                     HEADER_AREA);
+#if !UI_LVGL
+        m_headerClock.reset(timeStr);
+#endif
+    }
+    m_shownTime = timeStr;
+    
+    bool wifi = isWiFiConnected();
+    if (wifi != m_shownWiFi) {
+        m_damage.add(ScreenRect{(int16_t)(m_tft.width() - 20), HEADER_HEIGHT/2 - 5, 11, 11}, HEADER_AREA);
+        m_shownWiFi = wifi;
+    }
+}
+
+bool CYD::startTouchRecording(TouchTrace& trace) {
+#if UI_LVGL
+    // The trace is taken where the hand-drawn UI's gestures start
+    return false;
+#else
+    stopTouchTrace();
+    if (m_calibrationTarget >= 0 || !trace.startRecording()) return false;
+    m_touchRecording = &trace;
+    return true;
+#endif
+}
+
+bool CYD::startTouchReplay(TouchTrace& trace, uint8_t speed) {
+#if UI_LVGL
+    return false;
+#else
+    stopTouchTrace();
+    if (m_calibrationTarget >= 0 || !m_touchReplayer.start(trace, speed, micros())) return false;
+    // A touch in progress on the panel is dropped, not finished by the trace
+    dropTouch();
+    return true;
+#endif
+}
+
+void CYD::stopTouchTrace() {
+    if (m_touchRecording) {
+        m_touchRecording->stopRecording();
+        m_touchRecording = nullptr;
+    }
+    if (m_touchReplayer.isActive()) {
+        m_touchReplayer.stop();
+        dropTouch();
+    }
+}
+
+void CYD::dropTouch() {
+    // Cancelled, then lifted: the recognizer is idle again without an event
+    m_gestures.cancel();
+    m_gestures.add(false, m_touchX, m_touchY, micros());
+    m_dragSlider = nullptr;
+    m_calibrateOnLift = false;
+}
+
+void CYD::handleTouch() {
+    // Every sample queued since the last frame goes to the gesture
+    // recognizer, then its events are handled in order
+    TouchSample sample;
+    while (m_touchSampler.read(sample)) {
+        TouchPoint raw;
+        bool pressed = m_touchFilter.add(sample, raw);
+        if (m_touchReplayer.isActive()) {
+            // The trace stands in for the panel
+            continue;
+        }
+        if (m_calibrationTarget >= 0) {
+            handleCalibrationTouch(pressed, raw);
+            continue;
+        }
+        if (pressed) {
+            touchToScreen(raw, m_touchX, m_touchY);
+        }
+        m_gestures.add(pressed, m_touchX, m_touchY, sample.micros);
+        if (m_touchRecording &&
+            !m_touchRecording->append({sample.micros, m_touchX, m_touchY, pressed ? sample.z : (uint16_t)0, 0})) {
+            Serial.println(F("Touch trace full, recording stopped"));
+            stopTouchTrace();
+        }
+    }
+    
+    TouchRecord record;
+    bool replaying = m_touchReplayer.isActive();
+    while (m_touchReplayer.next(micros(), record)) {
+        m_touchX = record.x;
+        m_touchY = record.y;
+        m_gestures.add(record.z > 0, record.x, record.y, record.micros);
+    }
+    if (replaying && !m_touchReplayer.isActive()) {
+        Serial.println(F("Touch replay finished"));
+    }
+    
+    GestureEvent event;
+    while (m_calibrationTarget < 0 && m_gestures.read(event)) {
+        handleGesture(event);
+    }
+}
+
+void CYD::handleGesture(const GestureEvent& event) {
+    TOUCH_LATENCY_DISPATCHED(event.micros);
+    
+    // A slider grabbed by the press follows the finger until it lifts,
+    // wherever it wanders vertically. Buttons act on a tap, so a swipe
+    // that starts on one does not press it.
+    if (m_inPomodoroMode) {
+        if (!m_pomodoroManager) return;
+        if (event.type == GESTURE_TAP) {
+#if TOUCH_DEBUG
+            Serial.printf("Tap at x:%d y:%d\n", event.x, event.y);
+#endif
+            m_pomodoroManager->handleTouch(event.x, event.y);
+        } else if (event.type == GESTURE_SWIPE && event.velocityX > 0 && !m_pomodoroManager->isRunning()) {
+            // Swiping right goes back, like the exit button
+            m_pomodoroManager->handleAction(PomodoroManager::ACTION_EXIT);
+        }
+        if (!m_pomodoroManager->isActive()) {
+            togglePomodoroMode();
+        }
+        return;
+    }
+    
+    switch (event.type) {
+        case GESTURE_DOWN: {
+            Widget* target = m_widgets.hitTest(event.x, event.y);
+            if (target == &m_brightnessSlider || target == &m_colorTempSlider) {
+                m_dragSlider = static_cast<Slider*>(target);
+                updateDragSlider(event.x);
+            }
+            break;
+        }
+        
+        case GESTURE_MOVE:
+        case GESTURE_DRAG:
+            updateDragSlider(event.x);
+            break;
+        
+        case GESTURE_TAP:
+#if TOUCH_DEBUG
+            Serial.printf("Tap at x:%d y:%d\n", event.x, event.y);
+#endif
+            if (m_widgets.hitTest(event.x, event.y) == &m_pomodoroButton) {
+#if TOUCH_DEBUG
+                Serial.println(F("Pomodoro button pressed"));
+#endif
+                togglePomodoroMode();
+            }
+            break;
+        
+        case GESTURE_LONG_PRESS:
+            // Held on the header: recalibrate once the finger lifts, for
+            // panels too far off to aim at anything smaller. Nothing else
+            // lives there, so resting a finger on the screen can't set it off.
+            m_calibrateOnLift = !m_dragSlider &&
+                HEADER_AREA.contains(ScreenRect{event.x, event.y, 1, 1});
+            break;
+        
+        case GESTURE_SWIPE:
+            // Swiping left brings in the Pomodoro screen
+            if (!m_dragSlider && event.velocityX < 0) {
+                togglePomodoroMode();
+            }
+            break;
+        
+        case GESTURE_UP:
+            m_dragSlider = nullptr;
+            if (m_calibrateOnLift) {
+                m_calibrateOnLift = false;
+                startTouchCalibration();
+            }
+            break;
+    }
+}
+
+void CYD::updateDragSlider(int16_t screenX) {
+    // Only a value that moved repaints and goes out to the light
+    if (m_dragSlider && m_dragSlider->updateValue(screenX)) {
+        sendLightingValues(m_brightnessSlider.getValue(), m_colorTempSlider.getValue());
+        m_lightingDirty = true;
+        m_lightingChangeTime = millis();
+    }
+}
+
+void CYD::togglePomodoroMode() {
+    unsigned long start = micros();
+    m_inPomodoroMode = !m_inPomodoroMode;
+    if (m_inPomodoroMode) {
+        m_damage.clear();
+        m_headerClock.invalidate();
+        if (!m_pomodoroManager) {
+            m_pomodoroManager = new PomodoroManager(m_tft, m_compositor, m_screenCache, m_audioManager,
+                                                    m_settings);
+        }
+        m_pomodoroManager->begin();
+    } else {
+        drawUI();
+    }
+    
+    // With the screen cached this is one band pass with just the overlays
+    // drawn; the first visit also renders it into the cache
+    m_lastSwitchMicros = micros() - start;
+    m_switchCount++;
+#if TOUCH_DEBUG
+    Serial.printf("Screen switch: %lu us\n", (unsigned long)m_lastSwitchMicros);
+#endif
+}
+
+float CYD::getDummyTemperature() {
+    // Simulate temperature between 18-28°C with some variation
+    static float lastTemp = 23.0;
+    float variation = (random(-10, 11) / 10.0);
+    lastTemp += variation;
+    lastTemp = constrain(lastTemp, 18.0, 28.0);
+    return lastTemp;
+}
+
+void CYD::sampleTemperature() {
+    m_currentTemp = getDummyTemperature();
+    
+    // History is stamped with wall-clock time, so it starts once NTP has synced
+    if (m_timeInitialized) {
+        m_temperatureLog.add(time(nullptr), m_currentTemp);
+    }
+    
+    if (m_lastSummaryUpdate == 0 || millis() - m_lastSummaryUpdate > TEMP_SUMMARY_INTERVAL_MS) {
+        refreshTemperatureSummary();
+    }
+}
+
+void CYD::refreshTemperatureSummary() {
+    m_lastSummaryUpdate = millis();
+    if (!m_timeInitialized) return;
+    
+    // Whole blocks are summed from their headers, so a day costs a few ms
+    uint32_t now = time(nullptr);
+    m_temperatureLog.summarize(now - SECONDS_PER_DAY, now, m_temperatureDay);
+}
+
+void CYD::updateTemperatureDisplay() {
+    if (m_inPomodoroMode) return;
+    
+    // Repaint only the glyphs whose text changed, not the whole 280x50 area
+    String tempStr = String(m_currentTemp, 1) + "°C";
+    uint16_t tempColor = temperatureColor(m_currentTemp);
+    if (tempColor != m_shownTempColor) {
+        m_damage.add(DamageTracker::textChange(m_tft, m_shownTemp, "", SLIDER_X, 170, TL_DATUM, 4)
+                         .united(DamageTracker::textChange(m_tft, "", tempStr, SLIDER_X, 170, TL_DATUM, 4)),
+                     TEMPERATURE_AREA);
+    } else {
+        m_damage.add(DamageTracker::textChange(m_tft, m_shownTemp, tempStr, SLIDER_X, 170, TL_DATUM, 4),
+                     TEMPERATURE_AREA);
+    }
+    m_shownTemp = tempStr;
+    m_shownTempColor = tempColor;
+    
+    String rangeStr;
+    if (m_temperatureDay.count > 0) {
+        rangeStr = "24h " + String(m_temperatureDay.minimum, 1) + " - " + String(m_temperatureDay.maximum, 1);
+    }
+    m_damage.add(DamageTracker::textChange(m_tft, m_shownRange, rangeStr, TEMP_RANGE_X, 176, TL_DATUM, 2),
+                 TEMPERATURE_AREA);
+    m_shownRange = rangeStr;
+}
+
+void CYD::drawTemperature(TFT_eSPI& gfx, uint8_t layers) {
+    UI_PROFILE_SCOPE(SECTION_TEMPERATURE);
+    gfx.setTextDatum(TL_DATUM);
+    if (layers & LAYER_STATIC) {
+        gfx.setTextColor(UI_SUBTEXT);
+        gfx.drawString(F("Temperature"), SLIDER_X, 150, 2);
+    }
+    if (!(layers & LAYER_OVERLAY)) return;
+    
+    gfx.setTextColor(m_shownTempColor);
+    gfx.drawString(m_shownTemp, SLIDER_X, 170, 4);
+    
+    if (m_shownRange.length() > 0) {
+        gfx.setTextColor(UI_SUBTEXT);
+        gfx.drawString(m_shownRange, TEMP_RANGE_X, 176, 2);
+    }
+}
+
+#if UI_LVGL
+void CYD::syncMainScreen() {
+    // Damage only matters to the hand-drawn screen
+    m_damage.clear();
+    m_mainScreen.setTime(m_shownTime);
+    m_mainScreen.setWiFi(m_shownWiFi);
+    m_mainScreen.setTemperature(m_shownTemp, m_shownTempColor);
+    m_mainScreen.setRange(m_shownRange);
+    m_mainScreen.setLighting(m_brightnessSlider.getValue(), m_colorTempSlider.getValue());
+}
+
+bool CYD::readTouch(int16_t& x, int16_t& y, void* context) {
+    // Up to one press or lift per read, so LVGL sees even a tap shorter
+    // than its read period
+    CYD* cyd = static_cast<CYD*>(context);
+    TouchSample sample;
+    while (cyd->m_touchSampler.read(sample)) {
+        TouchPoint raw;
+        bool pressed = cyd->m_touchFilter.add(sample, raw);
+        if (pressed) {
+            cyd->touchToScreen(raw, cyd->m_touchX, cyd->m_touchY);
+        }
+        TOUCH_LATENCY_DISPATCHED(sample.micros);
+        if (pressed != cyd->m_touchHeld) {
+            cyd->m_touchHeld = pressed;
+            break;
+        }
+    }
+    x = cyd->m_touchX;
+    y = cyd->m_touchY;
+    return cyd->m_touchHeld;
+}
+
+void CYD::onLightingChanged(uint8_t brightness, uint8_t colorTemp, void* context) {
+    CYD* cyd = static_cast<CYD*>(context);
+    cyd->m_brightnessSlider.setValue(brightness);
+    cyd->m_colorTempSlider.setValue(colorTemp);
+    cyd->sendLightingValues(brightness, colorTemp);
+    cyd->m_lightingDirty = true;
+    cyd->m_lightingChangeTime = millis();
+}
+
+void CYD::onPomodoroPressed(void* context) {
+    static_cast<CYD*>(context)->togglePomodoroMode();
+}
+#endif
+
+void CYD::sendLightingValues(uint8_t brightness, uint8_t colorTemp) {
+    // Dummy function to simulate sending values to light controller
+#if TOUCH_DEBUG
+    Serial.printf("Sending - Brightness: %d%%, Color Temp: %d%%\n", brightness, colorTemp);
+#else
+    (void)brightness;
+    (void)colorTemp;
+#endif
+    TOUCH_LATENCY_SENT();
+}
+
 // ... (implement remaining methods) ... 
\ No newline at end of file
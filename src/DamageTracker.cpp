@@ -0,0 +1,150 @@
+#include "DamageTracker.h"
+#include "TouchLatency.h"
+
+DamageTracker::DamageTracker()
+    : m_screen{0, 0, 0, 0}
+    , m_compositor(nullptr)
+    , m_count(0)
+    , m_legacyCount(0)
+    , m_lastFrame()
+    , m_stats() {
+}
+
+void DamageTracker::setScreenSize(int16_t width, int16_t height) {
+    m_screen = ScreenRect{0, 0, width, height};
+}
+
+void DamageTracker::add(const ScreenRect& rect) {
+    add(rect, rect);
+}
+
+void DamageTracker::add(const ScreenRect& rect, const ScreenRect& legacy) {
+    // The legacy area counts even when nothing changed, as the old code
+    // redrew it anyway
+    addLegacy(legacy.intersected(m_screen));
+
+    ScreenRect clipped = rect.intersected(m_screen);
+    if (!clipped.empty()) {
+        insert(clipped);
+    }
+}
+
+void DamageTracker::addScreen() {
+    add(m_screen);
+}
+
+void DamageTracker::clear() {
+    m_count = 0;
+    m_legacyCount = 0;
+}
+
+void DamageTracker::insert(ScreenRect rect) {
+    // Absorb every rectangle that merges cheaply; a merge can make the
+    // result overlap ones that were skipped before, so rescan after each
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (uint8_t i = 0; i < m_count; i++) {
+            ScreenRect combined = rect.united(m_rects[i]);
+            if (combined.area() > rect.area() + m_rects[i].area() + MERGE_SLACK_PIXELS) continue;
+
+            rect = combined;
+            m_rects[i] = m_rects[--m_count];
+            merged = true;
+            break;
+        }
+    }
+
+    if (m_count == MAX_RECTS) {
+        // Out of slots: fold in the rectangle that wastes the fewest pixels
+        uint8_t best = 0;
+        uint32_t bestWaste = UINT32_MAX;
+        for (uint8_t i = 0; i < m_count; i++) {
+            uint32_t waste = rect.united(m_rects[i]).area() - rect.area();
+            if (waste < bestWaste) {
+                best = i;
+                bestWaste = waste;
+            }
+        }
+        rect = rect.united(m_rects[best]);
+        m_rects[best] = m_rects[--m_count];
+        insert(rect);
+        return;
+    }
+    m_rects[m_count++] = rect;
+}
+
+void DamageTracker::addLegacy(const ScreenRect& rect) {
+    // The old code redrew each element once per frame however many of its
+    // parts changed, and a full screen redraw covers everything else
+    if (rect.empty()) {
+        return;
+    }
+    for (uint8_t i = 0; i < m_legacyCount; i++) {
+        if (m_legacy[i].contains(rect)) return;
+    }
+    if (m_legacyCount == MAX_RECTS) {
+        m_legacy[MAX_RECTS - 1] = m_legacy[MAX_RECTS - 1].united(rect);
+        return;
+    }
+    m_legacy[m_legacyCount++] = rect;
+}
+
+ScreenRect DamageTracker::textChange(TFT_eSPI& tft, const String& before, const String& after,
+                                              int16_t x, int16_t y, uint8_t datum, uint8_t font) {
+    if (before == after) {
+        return ScreenRect{0, 0, 0, 0};
+    }
+
+    int16_t height = tft.fontHeight(font);
+    int16_t widthBefore = before.length() ? tft.textWidth(before, font) : 0;
+    int16_t widthAfter = after.length() ? tft.textWidth(after, font) : 0;
+    auto leftOf = [&](int16_t width) -> int16_t {
+        if (datum == TC_DATUM) return x - width / 2;
+        if (datum == TR_DATUM) return x - width;
+        return x;
+    };
+    ScreenRect oldBox{leftOf(widthBefore), y, widthBefore, height};
+    ScreenRect newBox{leftOf(widthAfter), y, widthAfter, height};
+
+    if (oldBox.x != newBox.x) {
+        return oldBox.united(newBox);
+    }
+
+    unsigned int common = 0;
+    while (common < before.length() && common < after.length() && before[common] == after[common]) {
+        common++;
+    }
+    int16_t unchanged = common ? tft.textWidth(after.substring(0, common), font) : 0;
+    return ScreenRect{(int16_t)(newBox.x + unchanged), y, (int16_t)(max(widthBefore, widthAfter) - unchanged), height};
+}
+
+void DamageTracker::finishFrame(uint16_t windows, uint32_t elapsedMicros) {
+    // The last pixel is out: a touch this frame handled has been drawn
+    TOUCH_LATENCY_DRAWN();
+
+    FrameStats frame = {};
+    frame.rects = m_count;
+    frame.windows = windows;
+    frame.micros = elapsedMicros;
+    for (uint8_t i = 0; i < m_count; i++) {
+        frame.pixels += m_rects[i].area();
+    }
+    frame.legacyRects = m_legacyCount;
+    for (uint8_t i = 0; i < m_legacyCount; i++) {
+        frame.legacyPixels += m_legacy[i].area();
+    }
+
+    m_lastFrame = frame;
+    m_stats.frames++;
+    m_stats.spiBytes += frame.spiBytes();
+    m_stats.legacySpiBytes += frame.legacySpiBytes();
+    clear();
+
+#if UI_DAMAGE_LOG
+    Serial.printf("Frame: %u rects in %lu us, %lu px (was %lu px), %lu SPI bytes saved\n",
+                  frame.rects, (unsigned long)frame.micros, (unsigned long)frame.pixels,
+                  (unsigned long)frame.legacyPixels,
+                  (unsigned long)(frame.legacySpiBytes() - min(frame.legacySpiBytes(), frame.spiBytes())));
+#endif
+}
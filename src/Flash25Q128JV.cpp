@@ -1,262 +1,985 @@
-#include "Flash25Q128JV.h"
-
-Flash25Q128JV::Flash25Q128JV() : _initialized(false) {
-    _spi = &SPI; // Use default SPI bus instead of creating new instance
-}
-
-bool Flash25Q128JV::begin() {
-    // Configure pins
-    pinMode(FLASH_CS_PIN, OUTPUT);
-    digitalWrite(FLASH_CS_PIN, HIGH);  // Deselect by default
-    
-    // Initialize SPI with default pins
-    _spi->begin();
-    
-    // Add a small delay after SPI initialization
-    delay(10);
-    
-    // Try reading ID multiple times with timeout
-    unsigned long startTime = millis();
-    uint32_t id = 0;
-    
-    while (millis() - startTime < 1000) { // 1 second timeout
-        id = readID();
-        Serial.printf("Attempting Flash ID read: 0x%06X\n", id);
-        
-        if (id == 0x17701860) {
-            _initialized = true;
-            break;
-        }
-        delay(10);
-    }
-    
-    if (!_initialized) {
-        Serial.printf("Flash initialization failed. Last ID read: 0x%06X\n", id);
-    }
-    
-    return _initialized;
-}
-
-uint32_t Flash25Q128JV::readID() {
-    uint32_t id = 0;
-    
-    select();
-    delayMicroseconds(1);
-    
-    _spi->transfer(FLASH_CMD_READ_ID);
-    id = (_spi->transfer(0) << 16);
-    id |= (_spi->transfer(0) << 8);
-    id |= _spi->transfer(0);
-    
-    delayMicroseconds(1);
-    deselect();
-    
-    return id;
-}
-
-uint8_t Flash25Q128JV::readStatus() {
-    select();
-    _spi->transfer(FLASH_CMD_READ_STATUS);
-    uint8_t status = _spi->transfer(0);
-    deselect();
-    return status;
-}
-
-bool Flash25Q128JV::isBusy() {
-    return (readStatus() & 0x01) != 0;
-}
-
-void Flash25Q128JV::waitUntilReady() {
-    while(isBusy()) {
-        delay(1);
-    }
-}
-
-void Flash25Q128JV::writeEnable() {
-    select();
-    _spi->transfer(FLASH_CMD_WRITE_ENABLE);
-    deselect();
-}
-
-void Flash25Q128JV::writeDisable() {
-    select();
-    _spi->transfer(FLASH_CMD_WRITE_DISABLE);
-    deselect();
-}
-
-void Flash25Q128JV::select() {
-    _spi->beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
-    digitalWrite(FLASH_CS_PIN, LOW);
-}
-
-void Flash25Q128JV::deselect() {
-    digitalWrite(FLASH_CS_PIN, HIGH);
-    _spi->endTransaction();
-}
-
-bool Flash25Q128JV::read(uint32_t address, uint8_t* buffer, uint32_t length) {
-    if (!_initialized || !buffer || address + length > FLASH_CHIP_SIZE) {
-        return false;
-    }
-    
-    select();
-    _spi->transfer(FLASH_CMD_READ_DATA);
-    _spi->transfer((address >> 16) & 0xFF);
-    _spi->transfer((address >> 8) & 0xFF);
-    _spi->transfer(address & 0xFF);
-    
-    for (uint32_t i = 0; i < length; i++) {
-        buffer[i] = _spi->transfer(0);
-    }
-    
-    deselect();
-    return true;
-}
-
-bool Flash25Q128JV::write(uint32_t address, const uint8_t* buffer, uint32_t length) {
-    if (!_initialized || !buffer || address + length > FLASH_CHIP_SIZE) {
-        return false;
-    }
-    
-    uint32_t remainingBytes = length;
-    uint32_t currentAddr = address;
-    const uint8_t* currentBuffer = buffer;
-    
-    while (remainingBytes > 0) {
-        uint32_t pageOffset = currentAddr % FLASH_PAGE_SIZE;
-        uint32_t pageRemaining = FLASH_PAGE_SIZE - pageOffset;
-        uint32_t bytesToWrite = min(remainingBytes, pageRemaining);
-        
-        if (!writePageInternal(currentAddr, currentBuffer, bytesToWrite)) {
-            return false;
-        }
-        
-        remainingBytes -= bytesToWrite;
-        currentAddr += bytesToWrite;
-        currentBuffer += bytesToWrite;
-    }
-    
-    return true;
-}
-
-bool Flash25Q128JV::writePageInternal(uint32_t address, const uint8_t* buffer, uint32_t length) {
-    writeEnable();
-    
-    select();
-    _spi->transfer(FLASH_CMD_PAGE_PROGRAM);
-    _spi->transfer((address >> 16) & 0xFF);
-    _spi->transfer((address >> 8) & 0xFF);
-    _spi->transfer(address & 0xFF);
-    
-    for (uint32_t i = 0; i < length; i++) {
-        _spi->transfer(buffer[i]);
-    }
-    
-    deselect();
-    
-    waitUntilReady();
-    return true;
-}
-
-bool Flash25Q128JV::eraseSector(uint32_t address) {
-    if (!_initialized || address >= FLASH_CHIP_SIZE) {
-        return false;
-    }
-    
-    writeEnable();
-    
-    select();
-    _spi->transfer(FLASH_CMD_SECTOR_ERASE);
-    _spi->transfer((address >> 16) & 0xFF);
-    _spi->transfer((address >> 8) & 0xFF);
-    _spi->transfer(address & 0xFF);
-    deselect();
-    
-    waitUntilReady();
-    return true;
-}
-
-bool Flash25Q128JV::eraseChip() {
-    if (!_initialized) {
-        return false;
-    }
-    
-    writeEnable();
-    
-    select();
-    _spi->transfer(FLASH_CMD_CHIP_ERASE);
-    deselect();
-    
-    waitUntilReady();
-    return true;
-}
-
-bool Flash25Q128JV::performSelfTest() {
-    if (!_initialized) {
-        Serial.println("Flash not initialized!");
-        return false;
-    }
-    
-    Serial.println("Starting Flash Memory Self-Test...");
-    
-    // Test 1: Read ID
-    uint32_t id = readID();
-    Serial.printf("Flash ID: 0x%06X\n", id);
-    if (id != 0x17701860) {
-        Serial.println("ID verification failed!");
-        return false;
-    }
-    
-    // Test 2: Erase-Write-Read test on first sector
-    const uint32_t testAddress = 0;
-    const uint8_t testPattern[] = {0x55, 0xAA, 0x12, 0x34, 0x78, 0x9F};
-    uint8_t readBuffer[sizeof(testPattern)];
-    
-    Serial.println("Erasing sector 0...");
-    if (!eraseSector(testAddress)) {
-        Serial.println("Sector erase failed!");
-        return false;
-    }
-    
-    Serial.println("Writing test pattern...");
-    if (!write(testAddress, testPattern, sizeof(testPattern))) {
-        Serial.println("Write failed!");
-        return false;
-    }
-    
-    Serial.println("Reading back data...");
-    if (!read(testAddress, readBuffer, sizeof(testPattern))) {
-        Serial.println("Read failed!");
-        return false;
-    }
-    
-    // Verify data
-    for (size_t i = 0; i < sizeof(testPattern); i++) {
-        if (readBuffer[i] != testPattern[i]) {
-            Serial.printf("Data mismatch at offset %d: expected 0x%02X, got 0x%02X\n",
-                        i, testPattern[i], readBuffer[i]);
-            return false;
-        }
-    }
-    
-    Serial.println("Self-test passed successfully!");
-    return true;
-}
-
-void Flash25Q128JV::printFlashInfo() {
-    if (!_initialized) {
-        Serial.println("Flash not initialized!");
-        return;
-    }
-    
-    uint32_t id = readID();
-    uint8_t status = readStatus();
-    
-    Serial.println("\nFlash Memory Information:");
-    Serial.printf("Manufacturer ID: 0x%06X\n", id);
-    Serial.printf("Status Register: 0x%02X\n", status);
-    Serial.println("Capacity: 16MB (128Mbit)");
-    Serial.printf("Page Size: %d bytes\n", FLASH_PAGE_SIZE);
-    Serial.printf("Sector Size: %d bytes\n", FLASH_SECTOR_SIZE);
-    Serial.println("Write Protected: " + String((status & 0x0C) ? "Yes" : "No"));
+#include "Flash25Q128JV.h"
+
+namespace {
+
+// Holds the driver's recursive mutex for one command sequence
+class FlashLock {
+public:
+    explicit FlashLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+        if (_mutex) xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+    }
+    ~FlashLock() {
+        if (_mutex) xSemaphoreGiveRecursive(_mutex);
+    }
+
+private:
+    SemaphoreHandle_t _mutex;
+};
+
+uint32_t dword(const uint8_t* bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// BFPT erase time field: 5 bit count and 2 bit unit (1ms, 16ms, 128ms, 1s)
+uint16_t sfdpEraseMs(uint8_t field) {
+    static const uint16_t UNITS[] = {1, 16, 128, 1000};
+    return ((field & 0x1F) + 1) * UNITS[(field >> 5) & 0x03];
+}
+
+// Typical times of the W25Q128JV, for tables that predate the timing DWORDs
+uint16_t defaultEraseMs(uint32_t size) {
+    if (size <= FLASH_SECTOR_SIZE) return FLASH_SECTOR_ERASE_MS;
+    if (size <= FLASH_BLOCK32_SIZE) return FLASH_BLOCK32_ERASE_MS;
+    return FLASH_BLOCK64_ERASE_MS;
+}
+
+}
+
+Flash25Q128JV::Flash25Q128JV()
+    : _initialized(false)
+    , _clockHz(FLASH_SPI_DEFAULT_CLOCK)
+    , _readMode(FLASH_READ_FAST)
+    , _params()
+    , _lock(nullptr)
+    , _pendingOp(OP_NONE)
+    , _pendingAddress(0)
+    , _pendingSize(0)
+    , _suspended(false)
+    , _resumeMicros(0)
+    , _suspendCount(0) {
+    _spi = &SPI; // Use default SPI bus instead of creating new instance
+}
+
+bool Flash25Q128JV::begin() {
+    if (!_lock) {
+        _lock = xSemaphoreCreateRecursiveMutex();
+    }
+    
+    // Configure pins
+    pinMode(FLASH_CS_PIN, OUTPUT);
+    digitalWrite(FLASH_CS_PIN, HIGH);  // Deselect by default
+    
+    // Initialize SPI with default pins
+    _spi->begin();
+    
+    // Add a small delay after SPI initialization
+    delay(10);
+    
+    // Probe the ID at the safe init clock, then switch to the operating clock
+    uint32_t operatingClock = _clockHz;
+    _clockHz = FLASH_SPI_INIT_CLOCK;
+    
+    // Try reading ID multiple times with timeout; a missing or unpowered
+    // chip reads as all zeros or all ones
+    unsigned long startTime = millis();
+    uint32_t id = 0;
+    bool answered = false;
+    
+    while (millis() - startTime < 1000) { // 1 second timeout
+        id = readID();
+        Serial.printf("Attempting Flash ID read: 0x%06X\n", id);
+        
+        if (id != 0 && id != 0xFFFFFF) {
+            answered = true;
+            break;
+        }
+        delay(10);
+    }
+    
+    // Parameters are parsed once per part and kept across begin() calls.
+    // SFDP is read at the init clock too, before anything is known about the part.
+    bool configured = answered &&
+        (_params.jedecId == id || loadSfdpParameters(id) || loadDefaultParameters(id));
+    
+    _clockHz = operatingClock;
+    
+    if (!configured) {
+        Serial.printf("Flash initialization failed. Last ID read: 0x%06X\n", id);
+        return false;
+    }
+    _initialized = true;
+    
+    if (_params.enter4ByteMode) {
+        FlashLock lock(_lock);
+        select();
+        _spi->transfer(FLASH_CMD_ENTER_4BYTE);
+        deselect();
+    }
+    
+    // Fastest read the part and the bus both support (quad needs QE set)
+    if (!setReadMode(FLASH_READ_QUAD_OUTPUT) && !setReadMode(FLASH_READ_DUAL_OUTPUT)) {
+        setReadMode(FLASH_READ_FAST);
+    }
+    
+    return _initialized;
+}
+
+bool Flash25Q128JV::readSfdp(uint32_t address, uint8_t* buffer, uint32_t length) {
+    // Always 3 address bytes and 8 dummy clocks, whatever the address mode
+    uint8_t header[5] = {
+        FLASH_CMD_READ_SFDP,
+        (uint8_t)((address >> 16) & 0xFF),
+        (uint8_t)((address >> 8) & 0xFF),
+        (uint8_t)(address & 0xFF),
+        0
+    };
+    
+    FlashLock lock(_lock);
+    select();
+    _spi->writeBytes(header, sizeof(header));
+    _spi->transferBytes(nullptr, buffer, length);
+    deselect();
+    return true;
+}
+
+bool Flash25Q128JV::loadSfdpParameters(uint32_t jedecId) {
+    uint8_t header[8];
+    if (!readSfdp(0, header, sizeof(header)) || dword(header) != FLASH_SFDP_SIGNATURE) {
+        return false;
+    }
+    
+    // Pick the newest Basic Flash Parameter Table among the parameter headers
+    uint8_t headerCount = min(header[6] + 1, 8);
+    uint32_t tableAddress = 0;
+    uint8_t tableDwords = 0;
+    uint16_t tableRevision = 0;
+    for (uint8_t i = 0; i < headerCount; i++) {
+        uint8_t parameter[8];
+        if (!readSfdp(8 + i * 8, parameter, sizeof(parameter))) return false;
+        uint16_t id = (parameter[7] << 8) | parameter[0];
+        uint16_t revision = (parameter[2] << 8) | parameter[1];
+        if (id != FLASH_SFDP_BFPT_ID || revision < tableRevision) continue;
+        tableRevision = revision;
+        tableDwords = parameter[3];
+        tableAddress = parameter[4] | (parameter[5] << 8) | (parameter[6] << 16);
+    }
+    if (tableDwords < 9) {
+        return false;
+    }
+    
+    uint8_t table[FLASH_SFDP_MAX_DWORDS * 4];
+    memset(table, 0xFF, sizeof(table));
+    tableDwords = min<uint8_t>(tableDwords, FLASH_SFDP_MAX_DWORDS);
+    if (!readSfdp(tableAddress, table, tableDwords * 4)) {
+        return false;
+    }
+    // DWORD n of the JESD216 tables, counted from 1
+    auto dw = [&](uint8_t n) { return dword(table + (n - 1) * 4); };
+    
+    FlashParameters params = {};
+    params.jedecId = jedecId;
+    params.fromSfdp = true;
+    params.sfdpMajor = tableRevision >> 8;
+    params.sfdpMinor = tableRevision & 0xFF;
+    
+    // Density: bit count minus one, or 2^N bits above 2Gbit
+    uint32_t density = dw(2);
+    uint64_t bits = (density & 0x80000000) ? (1ULL << (density & 0x7FFFFFFF)) : (uint64_t)density + 1;
+    params.chipSize = bits / 8 > 0xFFFFFFFFULL ? 0xFFFFFFFF : (uint32_t)(bits / 8);
+    
+    // Address bytes: 00 = 3 only, 01 = 3 or 4, 10 = 4 only
+    uint8_t addressing = (dw(1) >> 17) & 0x03;
+    params.addressBytes = addressing == 2 || (addressing == 1 && params.chipSize > (1UL << 24)) ? 4 : 3;
+    params.enter4ByteMode = addressing == 1 && params.addressBytes == 4;
+    
+    // Fast reads with the address on one line; the dummy field includes mode clocks
+    if (dw(1) & (1UL << 16)) {
+        uint16_t field = dw(4) & 0xFFFF;
+        params.dualReadOpcode = field >> 8;
+        params.dualReadDummy = ((field & 0x1F) + ((field >> 5) & 0x07)) / 8;
+    }
+    if (dw(1) & (1UL << 22)) {
+        uint16_t field = dw(3) >> 16;
+        params.quadReadOpcode = field >> 8;
+        params.quadReadDummy = ((field & 0x1F) + ((field >> 5) & 0x07)) / 8;
+    }
+    
+    // Erase types, each a 2^N size and an opcode; times come from DWORD 10
+    uint32_t eraseTimes = tableDwords >= 10 ? dw(10) : 0;
+    uint8_t count = 0;
+    for (uint8_t type = 0; type < 4; type++) {
+        uint32_t field = (type < 2 ? dw(8) : dw(9)) >> ((type % 2) * 16);
+        uint8_t sizeExponent = field & 0xFF;
+        if (sizeExponent == 0 || sizeExponent > 31) continue;
+        FlashEraseType& erase = params.erase[count++];
+        erase.size = 1UL << sizeExponent;
+        erase.opcode = (field >> 8) & 0xFF;
+        erase.typicalMs = eraseTimes ? sfdpEraseMs((eraseTimes >> (4 + type * 7)) & 0x7F)
+                                     : defaultEraseMs(erase.size);
+    }
+    // The table doesn't promise any order
+    for (uint8_t i = 1; i < count; i++) {
+        for (uint8_t j = i; j > 0 && params.erase[j].size < params.erase[j - 1].size; j--) {
+            FlashEraseType swap = params.erase[j];
+            params.erase[j] = params.erase[j - 1];
+            params.erase[j - 1] = swap;
+        }
+    }
+    bool hasSector = false;
+    for (uint8_t i = 0; i < count; i++) {
+        hasSector |= params.erase[i].size == FLASH_SECTOR_SIZE;
+    }
+    if (!hasSector && count < 4 && (dw(1) & 0x03) == 0x01) {
+        // Older tables only give the 4KB opcode in DWORD 1
+        memmove(&params.erase[1], &params.erase[0], count * sizeof(FlashEraseType));
+        params.erase[0] = FlashEraseType{FLASH_SECTOR_SIZE, (uint8_t)(dw(1) >> 8), FLASH_SECTOR_ERASE_MS};
+    }
+    
+    params.pageSize = FLASH_PAGE_SIZE;
+    params.pageProgramUs = 700;
+    if (tableDwords >= 11) {
+        uint32_t timing = dw(11);
+        params.pageSize = 1 << ((timing >> 4) & 0x0F);
+        params.pageProgramUs = (((timing >> 8) & 0x1F) + 1) * ((timing & (1UL << 13)) ? 64 : 8);
+    }
+    
+    // DWORD 12 bit 31 is clear when suspend/resume is supported, DWORD 13 has the opcodes
+    params.suspendSupported = tableDwords >= 13 && !(dw(12) & 0x80000000);
+    if (params.suspendSupported) {
+        params.resumeOpcode = (dw(13) >> 16) & 0xFF;
+        params.suspendOpcode = dw(13) >> 24;
+    }
+    
+    params.quadEnable = tableDwords >= 15 ? (dw(15) >> 20) & 0x07 : 5;
+    
+    _params = params;
+    return true;
+}
+
+bool Flash25Q128JV::loadDefaultParameters(uint32_t jedecId) {
+    if (jedecId != FLASH_JEDEC_ID_W25Q128JV_IQ && jedecId != FLASH_JEDEC_ID_W25Q128JV_IM) {
+        return false;
+    }
+    
+    FlashParameters params = {};
+    params.jedecId = jedecId;
+    params.chipSize = FLASH_CHIP_SIZE;
+    params.pageSize = FLASH_PAGE_SIZE;
+    params.addressBytes = 3;
+    params.erase[0] = FlashEraseType{FLASH_SECTOR_SIZE, FLASH_CMD_SECTOR_ERASE, FLASH_SECTOR_ERASE_MS};
+    params.erase[1] = FlashEraseType{FLASH_BLOCK32_SIZE, FLASH_CMD_BLOCK_ERASE_32K, FLASH_BLOCK32_ERASE_MS};
+    params.erase[2] = FlashEraseType{FLASH_BLOCK64_SIZE, FLASH_CMD_BLOCK_ERASE_64K, FLASH_BLOCK64_ERASE_MS};
+    params.dualReadOpcode = FLASH_CMD_FAST_READ_DUAL;
+    params.dualReadDummy = 1;
+    params.quadReadOpcode = FLASH_CMD_FAST_READ_QUAD;
+    params.quadReadDummy = 1;
+    params.quadEnable = 5;   // SR2 bit 1, written with 0x31
+    params.suspendSupported = true;
+    params.suspendOpcode = FLASH_CMD_SUSPEND;
+    params.resumeOpcode = FLASH_CMD_RESUME;
+    params.pageProgramUs = 400;
+    
+    _params = params;
+    return true;
+}
+
+uint8_t Flash25Q128JV::putAddress(uint8_t* out, uint32_t address) const {
+    uint8_t length = 0;
+    if (_params.addressBytes == 4) {
+        out[length++] = (address >> 24) & 0xFF;
+    }
+    out[length++] = (address >> 16) & 0xFF;
+    out[length++] = (address >> 8) & 0xFF;
+    out[length++] = address & 0xFF;
+    return length;
+}
+
+const FlashEraseType* Flash25Q128JV::findEraseType(uint32_t size) const {
+    for (const FlashEraseType& type : _params.erase) {
+        if (type.size == size) return &type;
+    }
+    return nullptr;
+}
+
+uint16_t Flash25Q128JV::eraseTimeMs(uint32_t size) const {
+    const FlashEraseType* type = findEraseType(size);
+    return type ? type->typicalMs : 0;
+}
+
+uint32_t Flash25Q128JV::readID() {
+    FlashLock lock(_lock);
+    uint32_t id = 0;
+    
+    select();
+    delayMicroseconds(1);
+    
+    _spi->transfer(FLASH_CMD_READ_ID);
+    id = (_spi->transfer(0) << 16);
+    id |= (_spi->transfer(0) << 8);
+    id |= _spi->transfer(0);
+    
+    delayMicroseconds(1);
+    deselect();
+    
+    return id;
+}
+
+uint8_t Flash25Q128JV::readStatus() {
+    FlashLock lock(_lock);
+    select();
+    _spi->transfer(FLASH_CMD_READ_STATUS);
+    uint8_t status = _spi->transfer(0);
+    deselect();
+    return status;
+}
+
+uint8_t Flash25Q128JV::readStatus2() {
+    select();
+    _spi->transfer(FLASH_CMD_READ_STATUS2);
+    uint8_t status2 = _spi->transfer(0);
+    deselect();
+    return status2;
+}
+
+bool Flash25Q128JV::isBusy() {
+    FlashLock lock(_lock);
+    
+    // A suspended operation still has to be resumed and finished
+    if (_suspended || (readStatus() & FLASH_STATUS_BUSY)) {
+        return true;
+    }
+    
+    _pendingOp = OP_NONE;
+    return false;
+}
+
+void Flash25Q128JV::waitUntilReady() {
+    while(isBusy()) {
+        delay(1);
+    }
+}
+
+void Flash25Q128JV::writeEnable() {
+    select();
+    _spi->transfer(FLASH_CMD_WRITE_ENABLE);
+    deselect();
+}
+
+void Flash25Q128JV::writeDisable() {
+    select();
+    _spi->transfer(FLASH_CMD_WRITE_DISABLE);
+    deselect();
+}
+
+void Flash25Q128JV::select() {
+    _spi->beginTransaction(SPISettings(_clockHz, MSBFIRST, SPI_MODE0));
+    digitalWrite(FLASH_CS_PIN, LOW);
+}
+
+void Flash25Q128JV::deselect() {
+    digitalWrite(FLASH_CS_PIN, HIGH);
+    _spi->endTransaction();
+}
+
+bool Flash25Q128JV::setReadMode(FlashReadMode mode) {
+    FlashLock lock(_lock);
+    uint8_t lines = 1;
+    if (mode == FLASH_READ_DUAL_OUTPUT) lines = 2;
+    if (mode == FLASH_READ_QUAD_OUTPUT) lines = 4;
+    
+    // Fall back to single-line Fast Read if the bus or chip can't do it
+    bool supported = !_initialized ||
+        (lines == 2 && _params.dualReadOpcode) || (lines == 4 && _params.quadReadOpcode) || lines == 1;
+    if (lines > FLASH_SPI_DATA_LINES || !supported || (lines == 4 && _initialized && !enableQuadIO())) {
+        _readMode = FLASH_READ_FAST;
+        return false;
+    }
+    
+    _readMode = mode;
+    return true;
+}
+
+bool Flash25Q128JV::enableQuadIO() {
+    // Where the QE bit lives and how it is written differs between vendors;
+    // the SFDP table says which scheme the part uses (JESD216 DWORD 15)
+    bool inStatus1 = _params.quadEnable == 2;
+    auto quadEnabled = [&]() {
+        return inStatus1 ? (readStatus() & FLASH_STATUS1_QE) != 0
+                         : (readStatus2() & FLASH_STATUS2_QE) != 0;
+    };
+    
+    if (_params.quadEnable == 0 || quadEnabled()) {
+        return true;
+    }
+    
+    uint8_t status1 = readStatus();
+    uint8_t status2 = readStatus2();
+    
+    // QE is non-volatile, so this only costs a status write once per chip
+    writeEnable();
+    select();
+    switch (_params.quadEnable) {
+        case 2:
+            // SR1 bit 6, one byte status write
+            _spi->transfer(FLASH_CMD_WRITE_STATUS);
+            _spi->transfer(status1 | FLASH_STATUS1_QE);
+            break;
+        case 1:
+        case 4:
+            // SR2 bit 1, only writable as the second byte of 01h
+            _spi->transfer(FLASH_CMD_WRITE_STATUS);
+            _spi->transfer(status1);
+            _spi->transfer(status2 | FLASH_STATUS2_QE);
+            break;
+        case 5:
+        case 6:
+            _spi->transfer(FLASH_CMD_WRITE_STATUS2);
+            _spi->transfer(status2 | FLASH_STATUS2_QE);
+            break;
+        default:
+            // Code 3 (SR2 bit 7 through 3Eh/3Fh) and reserved codes
+            deselect();
+            writeDisable();
+            return false;
+    }
+    deselect();
+    waitUntilReady();
+    
+    return quadEnabled();
+}
+
+void Flash25Q128JV::readDataPhase(uint8_t* buffer, uint32_t length, uint8_t lines) {
+#if FLASH_SPI_DATA_LINES > 1
+    _spi->setDataLines(lines);
+#else
+    (void)lines;
+#endif
+    
+    // One bulk transfer instead of a transfer() call per byte; a null
+    // transmit buffer clocks out 0xFF while the chip drives the data lines
+    _spi->transferBytes(nullptr, buffer, length);
+    
+#if FLASH_SPI_DATA_LINES > 1
+    _spi->setDataLines(1);
+#endif
+}
+
+bool Flash25Q128JV::read(uint32_t address, uint8_t* buffer, uint32_t length, FlashPriority priority) {
+    if (!_initialized || !buffer || address + length > _params.chipSize) {
+        return false;
+    }
+    
+    if (length == 0) {
+        return true;
+    }
+    
+    while (true) {
+        PendingOp pending;
+        {
+            FlashLock lock(_lock);
+            
+            // The chip ignores reads while busy, so only go ahead once the
+            // last program/erase has finished or has been suspended
+            if (_pendingOp == OP_NONE || !isBusy()) {
+                readInternal(address, buffer, length);
+                return true;
+            }
+            
+            // Suspending only helps a read outside what the operation
+            // changes; inside it the array reads undefined until it's done
+            bool overlaps = address < _pendingAddress + _pendingSize && _pendingAddress < address + length;
+            if (priority == FLASH_PRIORITY_URGENT && !overlaps && suspend()) {
+                readInternal(address, buffer, length);
+                resume();
+                return true;
+            }
+            pending = _pendingOp;
+        }
+        
+        // Wait outside the lock so the task that owns the operation can poll it
+        waitForOperation(pending);
+    }
+}
+
+void Flash25Q128JV::waitForOperation(PendingOp pending) {
+    if (pending == OP_PROGRAM) {
+        delayMicroseconds(50);
+    } else {
+        delay(1);
+    }
+}
+
+bool Flash25Q128JV::suspend() {
+    // Chip erase and status writes can't be suspended
+    if (!_params.suspendSupported || (_pendingOp != OP_PROGRAM && _pendingOp != OP_ERASE)) {
+        return false;
+    }
+    
+    // tSUS has to pass between a resume and the next suspend
+    unsigned long sinceResume = micros() - _resumeMicros;
+    if (_suspendCount > 0 && sinceResume < FLASH_SUSPEND_US) {
+        delayMicroseconds(FLASH_SUSPEND_US - sinceResume);
+    }
+    
+    select();
+    _spi->transfer(_params.suspendOpcode);
+    deselect();
+    
+    // BUSY clears within tSUS; allow a generous margin before giving up
+    unsigned long start = micros();
+    while (readStatus() & FLASH_STATUS_BUSY) {
+        if (micros() - start > FLASH_SUSPEND_US * 10) {
+            // The suspend may still have landed: resume it, or the operation
+            // would stay suspended with nobody left to resume it
+            if (readStatus2() & FLASH_STATUS2_SUS) {
+                _suspended = true;
+                resume();
+            }
+            return false;
+        }
+    }
+    
+    // SUS stays clear if the operation completed before the suspend landed
+    if (readStatus2() & FLASH_STATUS2_SUS) {
+        _suspended = true;
+    } else {
+        _pendingOp = OP_NONE;
+    }
+    return true;
+}
+
+void Flash25Q128JV::resume() {
+    if (!_suspended) {
+        return;
+    }
+    
+    select();
+    _spi->transfer(_params.resumeOpcode);
+    deselect();
+    
+    _suspended = false;
+    _resumeMicros = micros();
+    _suspendCount++;
+}
+
+void Flash25Q128JV::readInternal(uint32_t address, uint8_t* buffer, uint32_t length) {
+    uint8_t header[12];
+    uint8_t dummyBytes = 0;
+    uint8_t lines = 1;
+    
+    switch (_readMode) {
+        case FLASH_READ_STANDARD:    header[0] = FLASH_CMD_READ_DATA; break;
+        case FLASH_READ_FAST:        header[0] = FLASH_CMD_FAST_READ; dummyBytes = 1; break;
+        case FLASH_READ_DUAL_OUTPUT:
+            header[0] = _params.dualReadOpcode; dummyBytes = _params.dualReadDummy; lines = 2; break;
+        case FLASH_READ_QUAD_OUTPUT:
+            header[0] = _params.quadReadOpcode; dummyBytes = _params.quadReadDummy; lines = 4; break;
+    }
+    uint8_t headerLength = 1 + putAddress(header + 1, address);
+    
+    // Dummy (and mode) clocks go out on the single-line bus
+    dummyBytes = min<uint8_t>(dummyBytes, sizeof(header) - headerLength);
+    memset(header + headerLength, 0, dummyBytes);
+    headerLength += dummyBytes;
+    
+    select();
+    _spi->writeBytes(header, headerLength);
+    readDataPhase(buffer, length, lines);
+    deselect();
+}
+
+bool Flash25Q128JV::write(uint32_t address, const uint8_t* buffer, uint32_t length) {
+    if (!_initialized || !buffer || address + length > _params.chipSize) {
+        return false;
+    }
+    
+    uint32_t remainingBytes = length;
+    uint32_t currentAddr = address;
+    const uint8_t* currentBuffer = buffer;
+    
+    while (remainingBytes > 0) {
+        uint32_t pageOffset = currentAddr % _params.pageSize;
+        uint32_t pageRemaining = _params.pageSize - pageOffset;
+        uint32_t bytesToWrite = min(remainingBytes, pageRemaining);
+        
+        if (!writePageInternal(currentAddr, currentBuffer, bytesToWrite)) {
+            return false;
+        }
+        
+        remainingBytes -= bytesToWrite;
+        currentAddr += bytesToWrite;
+        currentBuffer += bytesToWrite;
+    }
+    
+    return true;
+}
+
+bool Flash25Q128JV::writePageInternal(uint32_t address, const uint8_t* buffer, uint32_t length) {
+    bool finished;
+    if (!programPage(address, buffer, length, finished)) {
+        return false;
+    }
+    
+    // A program made under another task's erase suspend is done already;
+    // waitUntilReady() would wait out that erase as well
+    if (!finished) {
+        waitUntilReady();
+    }
+    return true;
+}
+
+bool Flash25Q128JV::startPageProgram(uint32_t address, const uint8_t* buffer, uint32_t length,
+                                     bool* finished) {
+    bool done;
+    bool ok = programPage(address, buffer, length, done);
+    if (finished) {
+        *finished = done;
+    }
+    return ok;
+}
+
+bool Flash25Q128JV::programPage(uint32_t address, const uint8_t* buffer, uint32_t length, bool& finished) {
+    // A program must stay inside one page, the chip wraps otherwise
+    if (!_initialized || !buffer || length == 0 ||
+        (address % _params.pageSize) + length > _params.pageSize ||
+        address + length > _params.chipSize) {
+        return false;
+    }
+    
+    while (true) {
+        PendingOp pending;
+        {
+            FlashLock lock(_lock);
+            if (_pendingOp == OP_NONE || !isBusy()) {
+                sendPageProgram(address, buffer, length);
+                _pendingOp = OP_PROGRAM;
+                _pendingAddress = address;
+                _pendingSize = length;
+                finished = false;
+                return true;
+            }
+            
+            // Another task's erase: a page outside it can be programmed
+            // while the erase is suspended, as the part allows
+            bool overlaps = address < _pendingAddress + _pendingSize && _pendingAddress < address + length;
+            if (_pendingOp == OP_ERASE && !overlaps && programWhileSuspended(address, buffer, length, finished)) {
+                return true;
+            }
+            pending = _pendingOp;
+        }
+        waitForOperation(pending);
+    }
+}
+
+bool Flash25Q128JV::programWhileSuspended(uint32_t address, const uint8_t* buffer, uint32_t length,
+                                          bool& finished) {
+    if (!suspend()) {
+        return false;
+    }
+    
+    // The erase may have finished before the suspend landed
+    if (!_suspended) {
+        sendPageProgram(address, buffer, length);
+        _pendingOp = OP_PROGRAM;
+        _pendingAddress = address;
+        _pendingSize = length;
+        finished = false;
+        return true;
+    }
+    
+    // The program has to finish before the erase resumes. isBusy() reports
+    // the suspended erase, so poll the status register itself.
+    sendPageProgram(address, buffer, length);
+    while (readStatus() & FLASH_STATUS_BUSY) {
+        delayMicroseconds(50);
+    }
+    resume();
+    finished = true;
+    return true;
+}
+
+void Flash25Q128JV::sendPageProgram(uint32_t address, const uint8_t* buffer, uint32_t length) {
+    writeEnable();
+    
+    uint8_t header[5] = {FLASH_CMD_PAGE_PROGRAM};
+    uint8_t headerLength = 1 + putAddress(header + 1, address);
+    
+    select();
+    _spi->writeBytes(header, headerLength);
+    _spi->writeBytes(buffer, length);
+    deselect();
+}
+
+bool Flash25Q128JV::sendErase(uint8_t command, uint32_t address, uint32_t size) {
+    while (true) {
+        PendingOp pending;
+        {
+            FlashLock lock(_lock);
+            if (_pendingOp == OP_NONE || !isBusy()) {
+                writeEnable();
+                
+                uint8_t header[5] = {command};
+                uint8_t headerLength = 1 + putAddress(header + 1, address);
+                
+                select();
+                _spi->writeBytes(header, headerLength);
+                deselect();
+                _pendingOp = OP_ERASE;
+                _pendingAddress = address;
+                _pendingSize = size;
+                return true;
+            }
+            pending = _pendingOp;
+        }
+        waitForOperation(pending);
+    }
+}
+
+bool Flash25Q128JV::startSectorErase(uint32_t address) {
+    return startBlockErase(address - (address % FLASH_SECTOR_SIZE), FLASH_SECTOR_SIZE);
+}
+
+bool Flash25Q128JV::startBlockErase(uint32_t address, uint32_t blockSize) {
+    const FlashEraseType* type = findEraseType(blockSize);
+    if (!_initialized || !type || address >= _params.chipSize || address % blockSize != 0) {
+        return false;
+    }
+    
+    return sendErase(type->opcode, address, blockSize);
+}
+
+bool Flash25Q128JV::startChipErase() {
+    if (!_initialized) {
+        return false;
+    }
+    
+    while (true) {
+        PendingOp pending;
+        {
+            FlashLock lock(_lock);
+            if (_pendingOp == OP_NONE || !isBusy()) {
+                writeEnable();
+                
+                select();
+                _spi->transfer(FLASH_CMD_CHIP_ERASE);
+                deselect();
+                _pendingOp = OP_CHIP_ERASE;
+                _pendingAddress = 0;
+                _pendingSize = _params.chipSize;
+                return true;
+            }
+            pending = _pendingOp;
+        }
+        waitForOperation(pending);
+    }
+}
+
+bool Flash25Q128JV::eraseSector(uint32_t address) {
+    if (!startSectorErase(address)) {
+        return false;
+    }
+    
+    waitUntilReady();
+    return true;
+}
+
+bool Flash25Q128JV::eraseChip() {
+    if (!startChipErase()) {
+        return false;
+    }
+    
+    waitUntilReady();
+    return true;
+}
+
+bool Flash25Q128JV::isBlank(uint32_t address, uint32_t length) {
+    alignas(4) uint8_t buffer[FLASH_PAGE_SIZE];
+    
+    // Page-sized reads so a programmed sector is usually rejected after one
+    while (length > 0) {
+        uint32_t chunk = min<uint32_t>(length, sizeof(buffer));
+        if (!read(address, buffer, chunk)) {
+            return false;
+        }
+        
+        // memcpy keeps the word loads free of aliasing; it compiles to one load
+        for (uint32_t i = 0; i < chunk / 4; i++) {
+            uint32_t word;
+            memcpy(&word, buffer + i * 4, sizeof(word));
+            if (word != 0xFFFFFFFF) return false;
+        }
+        for (uint32_t i = chunk & ~3u; i < chunk; i++) {
+            if (buffer[i] != 0xFF) return false;
+        }
+        
+        address += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool Flash25Q128JV::eraseRange(uint32_t address, uint32_t length, FlashEraseReport* report) {
+    if (!_initialized || address % FLASH_SECTOR_SIZE != 0 || length % FLASH_SECTOR_SIZE != 0 ||
+        address + length > _params.chipSize) {
+        return false;
+    }
+    
+    // Erase costs of the part; a block size it lacks is never chosen
+    uint32_t sectorMs = eraseTimeMs(FLASH_SECTOR_SIZE);
+    uint32_t block32Ms = eraseTimeMs(FLASH_BLOCK32_SIZE);
+    uint32_t block64Ms = eraseTimeMs(FLASH_BLOCK64_SIZE);
+    if (sectorMs == 0) {
+        return false;
+    }
+    
+    FlashEraseReport result = {};
+    unsigned long start = millis();
+    uint32_t end = address + length;
+    
+    // Walk the range one 64KB block window at a time. Per window, erase each
+    // 32KB half as a block or as its dirty sectors, whichever is cheaper, and
+    // use one 64KB erase instead if that beats both halves together.
+    for (uint32_t window = address - (address % FLASH_BLOCK64_SIZE); window < end; window += FLASH_BLOCK64_SIZE) {
+        uint16_t dirty = 0;    // one bit per sector of the window
+        uint16_t blank = 0;
+        uint8_t inRange = 0;
+        
+        unsigned long checkStart = millis();
+        for (uint8_t i = 0; i < FLASH_BLOCK64_SIZE / FLASH_SECTOR_SIZE; i++) {
+            uint32_t sector = window + i * FLASH_SECTOR_SIZE;
+            if (sector < address || sector >= end) continue;
+            inRange++;
+            if (isBlank(sector, FLASH_SECTOR_SIZE)) {
+                blank |= 1 << i;
+            } else {
+                dirty |= 1 << i;
+            }
+        }
+        result.blankCheckMs += millis() - checkStart;
+        
+        if (dirty == 0) {
+            result.skippedSectors += inRange;
+            continue;
+        }
+        
+        // Cost of each 32KB half; a block erase is only allowed when the
+        // whole block lies inside the range
+        uint32_t halfCost[2];
+        bool halfAsBlock[2];
+        for (uint8_t half = 0; half < 2; half++) {
+            uint32_t halfStart = window + half * FLASH_BLOCK32_SIZE;
+            uint8_t dirtySectors = __builtin_popcount((dirty >> (half * 8)) & 0xFF);
+            uint32_t sectorCost = dirtySectors * sectorMs;
+            bool blockAllowed = block32Ms && halfStart >= address && halfStart + FLASH_BLOCK32_SIZE <= end;
+            
+            halfAsBlock[half] = blockAllowed && dirtySectors > 0 && block32Ms < sectorCost;
+            halfCost[half] = halfAsBlock[half] ? block32Ms : sectorCost;
+        }
+        
+        bool wholeWindow = inRange == FLASH_BLOCK64_SIZE / FLASH_SECTOR_SIZE;
+        if (wholeWindow && block64Ms && block64Ms < halfCost[0] + halfCost[1]) {
+            if (!startBlockErase(window, FLASH_BLOCK64_SIZE)) return false;
+            waitUntilReady();
+            result.blocks64++;
+            continue;
+        }
+        
+        for (uint8_t half = 0; half < 2; half++) {
+            uint32_t halfStart = window + half * FLASH_BLOCK32_SIZE;
+            if (halfAsBlock[half]) {
+                if (!startBlockErase(halfStart, FLASH_BLOCK32_SIZE)) return false;
+                waitUntilReady();
+                result.blocks32++;
+                continue;
+            }
+            result.skippedSectors += __builtin_popcount((blank >> (half * 8)) & 0xFF);
+            for (uint8_t i = half * 8; i < half * 8 + 8; i++) {
+                if (!(dirty & (1 << i))) continue;
+                if (!startSectorErase(window + i * FLASH_SECTOR_SIZE)) return false;
+                waitUntilReady();
+                result.sectors++;
+            }
+        }
+    }
+    
+    result.elapsedMs = millis() - start;
+    if (report) {
+        *report = result;
+    }
+    return true;
+}
+
+bool Flash25Q128JV::performSelfTest() {
+    if (!_initialized) {
+        Serial.println("Flash not initialized!");
+        return false;
+    }
+    
+    Serial.println("Starting Flash Memory Self-Test...");
+    
+    // Test 1: Read ID
+    uint32_t id = readID();
+    Serial.printf("Flash ID: 0x%06X\n", id);
+    if (id != _params.jedecId) {
+        Serial.println("ID verification failed!");
+        return false;
+    }
+    
+    // Test 2: Erase-Write-Read test on first sector
+    const uint32_t testAddress = 0;
+    const uint8_t testPattern[] = {0x55, 0xAA, 0x12, 0x34, 0x78, 0x9F};
+    uint8_t readBuffer[sizeof(testPattern)];
+    
+    Serial.println("Erasing sector 0...");
+    if (!eraseSector(testAddress)) {
+        Serial.println("Sector erase failed!");
+        return false;
+    }
+    
+    Serial.println("Writing test pattern...");
+    if (!write(testAddress, testPattern, sizeof(testPattern))) {
+        Serial.println("Write failed!");
+        return false;
+    }
+    
+    Serial.println("Reading back data...");
+    if (!read(testAddress, readBuffer, sizeof(testPattern))) {
+        Serial.println("Read failed!");
+        return false;
+    }
+    
+    // Verify data
+    for (size_t i = 0; i < sizeof(testPattern); i++) {
+        if (readBuffer[i] != testPattern[i]) {
+            Serial.printf("Data mismatch at offset %d: expected 0x%02X, got 0x%02X\n",
+                        i, testPattern[i], readBuffer[i]);
+            return false;
+        }
+    }
+    
+    Serial.println("Self-test passed successfully!");
+    return true;
+}
+
+void Flash25Q128JV::printFlashInfo() {
+    if (!_initialized) {
+        Serial.println("Flash not initialized!");
+        return;
+    }
+    
+    uint32_t id = readID();
+    uint8_t status = readStatus();
+    
+    Serial.println("\nFlash Memory Information:");
+    Serial.printf("Manufacturer ID: 0x%06X\n", id);
+    Serial.printf("Status Register: 0x%02X\n", status);
+    if (_params.fromSfdp) {
+        Serial.printf("Parameters: SFDP %u.%u\n", _params.sfdpMajor, _params.sfdpMinor);
+    } else {
+        Serial.println("Parameters: W25Q128JV defaults (no SFDP)");
+    }
+    Serial.printf("Capacity: %luKB, %u byte addresses\n",
+                  (unsigned long)(_params.chipSize / 1024), _params.addressBytes);
+    Serial.printf("Page Size: %u bytes, program %uus\n", _params.pageSize, _params.pageProgramUs);
+    for (const FlashEraseType& type : _params.erase) {
+        if (type.size == 0) continue;
+        Serial.printf("Erase %luKB: opcode 0x%02X, %ums\n",
+                      (unsigned long)(type.size / 1024), type.opcode, type.typicalMs);
+    }
+    Serial.printf("Dual Read: 0x%02X, Quad Read: 0x%02X (QE scheme %u)\n",
+                  _params.dualReadOpcode, _params.quadReadOpcode, _params.quadEnable);
+    Serial.printf("Suspend: %s\n", _params.suspendSupported ? "Yes" : "No");
+    Serial.printf("SPI Clock: %lu Hz\n", (unsigned long)_clockHz);
+    Serial.printf("Read Mode: %d\n", _readMode);
+    Serial.println("Write Protected: " + String((status & 0x0C) ? "Yes" : "No"));
 } 
\ No newline at end of file
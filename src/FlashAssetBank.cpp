@@ -0,0 +1,262 @@
+#include "FlashAssetBank.h"
+#include "Crc32.h"
+
+namespace {
+
+constexpr uint32_t BANK_MAGIC = 0x42415359;   // "YSAB"
+constexpr uint16_t BANK_VERSION = 1;
+
+struct __attribute__((packed)) BankHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entryCount;
+    uint32_t indexCrc;      // over all index entries
+    uint32_t imageSize;
+    uint8_t reserved[16];
+};
+
+struct __attribute__((packed)) BankEntry {
+    char name[32];
+    uint32_t offset;        // from the start of the image
+    uint32_t length;
+    uint32_t crc;
+    uint32_t flags;
+};
+
+static_assert(sizeof(BankHeader) == FlashAssetBank::HEADER_SIZE, "Header layout");
+static_assert(sizeof(BankEntry) == FlashAssetBank::ENTRY_SIZE, "Entry layout");
+
+}
+
+FlashAssetBank::FlashAssetBank(Flash25Q128JV& flash, uint32_t baseAddress, uint32_t capacity)
+    : m_flash(flash)
+    , m_queue(nullptr)
+    , m_baseAddress(baseAddress)
+    , m_capacity(capacity)
+    , m_ready(false)
+    , m_count(0)
+    , m_imageSize(0)
+    , m_indexCrc(0)
+    , m_entries(nullptr)
+    , m_headerPage(nullptr)
+    , m_installSize(0)
+    , m_installPosition(0) {
+}
+
+bool FlashAssetBank::begin() {
+    m_ready = false;
+    m_count = 0;
+    
+    BankHeader header;
+    if (!m_flash.read(m_baseAddress, reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+        return false;
+    }
+    
+    if (header.magic != BANK_MAGIC || header.version != BANK_VERSION ||
+        header.entryCount > MAX_ASSETS || header.imageSize > m_capacity) {
+        Serial.println(F("No asset bank in flash"));
+        return false;
+    }
+    
+    if (!m_entries) {
+        m_entries = new Entry[MAX_ASSETS];
+    }
+    
+    // Pull the whole index into RAM, checking the CRC on the way
+    uint32_t crc = 0;
+    for (uint16_t i = 0; i < header.entryCount; i++) {
+        BankEntry raw;
+        uint32_t address = m_baseAddress + HEADER_SIZE + (uint32_t)i * ENTRY_SIZE;
+        if (!m_flash.read(address, reinterpret_cast<uint8_t*>(&raw), sizeof(raw))) {
+            return false;
+        }
+        crc = crc32Update(&raw, sizeof(raw), crc);
+        
+        Entry& entry = m_entries[i];
+        memcpy(entry.name, raw.name, MAX_NAME_LENGTH);
+        entry.name[MAX_NAME_LENGTH] = '\0';
+        entry.offset = raw.offset;
+        entry.length = raw.length;
+        entry.crc = raw.crc;
+        
+        if (raw.offset + raw.length > header.imageSize) {
+            Serial.printf("Asset %s lies outside the image\n", entry.name);
+            return false;
+        }
+    }
+    
+    if (crc != header.indexCrc) {
+        Serial.println(F("Asset bank index CRC mismatch"));
+        return false;
+    }
+    
+    m_count = header.entryCount;
+    m_imageSize = header.imageSize;
+    m_indexCrc = header.indexCrc;
+    m_ready = true;
+    return true;
+}
+
+int16_t FlashAssetBank::indexOf(const char* name) const {
+    if (!m_ready || !name) {
+        return -1;
+    }
+    
+    // The packer sorts the index bytewise, matching strcmp
+    int16_t low = 0;
+    int16_t high = (int16_t)m_count - 1;
+    while (low <= high) {
+        int16_t middle = (low + high) / 2;
+        int order = strcmp(name, m_entries[middle].name);
+        if (order == 0) return middle;
+        if (order < 0) {
+            high = middle - 1;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return -1;
+}
+
+bool FlashAssetBank::find(const char* name, FlashAsset& asset) const {
+    int16_t index = indexOf(name);
+    if (index < 0) {
+        return false;
+    }
+    
+    asset.address = m_baseAddress + m_entries[index].offset;
+    asset.length = m_entries[index].length;
+    asset.crc = m_entries[index].crc;
+    return true;
+}
+
+bool FlashAssetBank::exists(const char* name) const {
+    return indexOf(name) >= 0;
+}
+
+bool FlashAssetBank::read(const FlashAsset& asset, uint32_t offset, uint8_t* buffer, uint32_t length) {
+    if (offset > asset.length || length > asset.length - offset) {
+        return false;
+    }
+    // Asset data feeds audio playback, so it suspends a running erase
+    // rather than waiting behind it
+    return m_flash.read(asset.address + offset, buffer, length, FLASH_PRIORITY_URGENT);
+}
+
+bool FlashAssetBank::verify(const FlashAsset& asset) {
+    uint8_t buffer[FLASH_PAGE_SIZE];
+    uint32_t crc = 0;
+    for (uint32_t offset = 0; offset < asset.length; offset += sizeof(buffer)) {
+        uint32_t chunk = min<uint32_t>(sizeof(buffer), asset.length - offset);
+        if (!read(asset, offset, buffer, chunk)) return false;
+        crc = crc32Update(buffer, chunk, crc);
+    }
+    return crc == asset.crc;
+}
+
+bool FlashAssetBank::matches(const uint8_t* header) const {
+    const BankHeader* candidate = reinterpret_cast<const BankHeader*>(header);
+    return m_ready && candidate->magic == BANK_MAGIC &&
+           candidate->indexCrc == m_indexCrc && candidate->imageSize == m_imageSize;
+}
+
+bool FlashAssetBank::beginInstall(uint32_t imageSize) {
+    if (imageSize < HEADER_SIZE || imageSize > m_capacity) {
+        Serial.println(F("Asset image does not fit the bank"));
+        return false;
+    }
+    
+    if (!m_headerPage) {
+        m_headerPage = new uint8_t[FLASH_PAGE_SIZE];
+    }
+    memset(m_headerPage, 0xFF, FLASH_PAGE_SIZE);
+    
+    m_ready = false;
+    m_installSize = imageSize;
+    m_installPosition = 0;
+    
+    uint32_t eraseLength = (imageSize + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+    FlashEraseReport report;
+    bool erased = m_queue ? m_queue->eraseRange(m_baseAddress, eraseLength, &report)
+                          : m_flash.eraseRange(m_baseAddress, eraseLength, &report);
+    if (!erased) {
+        return false;
+    }
+    Serial.printf("Asset bank erased in %lu ms (%u x64K, %u x32K, %u x4K, %u blank)\n",
+                  (unsigned long)report.elapsedMs, report.blocks64, report.blocks32,
+                  report.sectors, report.skippedSectors);
+    return true;
+}
+
+bool FlashAssetBank::writeInstall(const uint8_t* data, uint32_t length) {
+    if (!m_headerPage || length > m_installSize - m_installPosition) {
+        return false;
+    }
+    
+    // The first page waits in RAM until finishInstall()
+    if (m_installPosition < FLASH_PAGE_SIZE) {
+        uint32_t chunk = min<uint32_t>(length, FLASH_PAGE_SIZE - m_installPosition);
+        memcpy(m_headerPage + m_installPosition, data, chunk);
+        m_installPosition += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    
+    if (length > 0) {
+        if (!program(m_baseAddress + m_installPosition, data, length)) {
+            return false;
+        }
+        m_installPosition += length;
+    }
+    return true;
+}
+
+bool FlashAssetBank::finishInstall() {
+    if (!m_headerPage || m_installPosition != m_installSize) {
+        return false;
+    }
+    
+    uint32_t headLength = min<uint32_t>(m_installSize, FLASH_PAGE_SIZE);
+    bool ok = program(m_baseAddress, m_headerPage, headLength) && begin();
+    
+    delete[] m_headerPage;
+    m_headerPage = nullptr;
+    
+    for (uint16_t i = 0; ok && i < m_count; i++) {
+        FlashAsset asset;
+        find(m_entries[i].name, asset);
+        if (!verify(asset)) {
+            Serial.printf("Asset %s failed verification\n", m_entries[i].name);
+            ok = false;
+        }
+    }
+    
+    if (!ok) {
+        // Leave no half-valid bank behind
+        if (m_queue) {
+            m_queue->eraseSector(m_baseAddress);
+        } else {
+            m_flash.eraseSector(m_baseAddress);
+        }
+        m_ready = false;
+    }
+    return ok;
+}
+
+bool FlashAssetBank::program(uint32_t address, const uint8_t* data, uint32_t length) {
+    return m_queue ? m_queue->program(address, data, length) : m_flash.write(address, data, length);
+}
+
+void FlashAssetBank::printInfo() const {
+    if (!m_ready) {
+        Serial.println(F("Asset bank not loaded"));
+        return;
+    }
+    
+    Serial.printf("Asset bank: %u assets, %lu bytes\n", m_count, (unsigned long)m_imageSize);
+    for (uint16_t i = 0; i < m_count; i++) {
+        Serial.printf("  %-31s %8lu bytes @ 0x%06lX\n", m_entries[i].name,
+                      (unsigned long)m_entries[i].length,
+                      (unsigned long)(m_baseAddress + m_entries[i].offset));
+    }
+}
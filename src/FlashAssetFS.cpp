@@ -0,0 +1,93 @@
+#include "FlashAssetFS.h"
+
+namespace {
+
+class FlashAssetFile : public fs::FileImpl {
+public:
+    FlashAssetFile(FlashAssetBank& bank, const char* path, const FlashAsset& asset)
+        : m_bank(bank)
+        , m_asset(asset)
+        , m_position(0)
+        , m_open(true) {
+        strncpy(m_path, path, sizeof(m_path) - 1);
+        m_path[sizeof(m_path) - 1] = '\0';
+    }
+
+    size_t write(const uint8_t*, size_t) override { return 0; }
+    
+    size_t read(uint8_t* buf, size_t size) override {
+        if (!m_open) return 0;
+        size_t chunk = min<size_t>(size, m_asset.length - m_position);
+        if (chunk == 0 || !m_bank.read(m_asset, m_position, buf, chunk)) {
+            return 0;
+        }
+        m_position += chunk;
+        return chunk;
+    }
+    
+    void flush() override {}
+    
+    bool seek(uint32_t pos, fs::SeekMode mode) override {
+        int64_t target = pos;
+        if (mode == fs::SeekCur) target = (int64_t)m_position + (int32_t)pos;
+        if (mode == fs::SeekEnd) target = (int64_t)m_asset.length + (int32_t)pos;
+        if (target < 0 || target > (int64_t)m_asset.length) return false;
+        m_position = (uint32_t)target;
+        return true;
+    }
+    
+    size_t position() const override { return m_position; }
+    size_t size() const override { return m_asset.length; }
+    bool setBufferSize(size_t) override { return true; }
+    void close() override { m_open = false; }
+    time_t getLastWrite() override { return 0; }
+    const char* path() const override { return m_path; }
+    
+    const char* name() const override {
+        const char* slash = strrchr(m_path, '/');
+        return slash ? slash + 1 : m_path;
+    }
+    
+    boolean isDirectory(void) override { return false; }
+    fs::FileImplPtr openNextFile(const char*) override { return fs::FileImplPtr(); }
+    boolean seekDir(long) override { return false; }
+    String getNextFileName(void) override { return String(); }
+    String getNextFileName(bool* isDir) override { if (isDir) *isDir = false; return String(); }
+    void rewindDirectory(void) override {}
+    operator bool() override { return m_open; }
+
+private:
+    FlashAssetBank& m_bank;
+    const FlashAsset m_asset;
+    uint32_t m_position;
+    bool m_open;
+    char m_path[FlashAssetBank::MAX_NAME_LENGTH + 1];
+};
+
+class FlashAssetFSImpl : public fs::FSImpl {
+public:
+    explicit FlashAssetFSImpl(FlashAssetBank& bank) : m_bank(bank) {}
+
+    fs::FileImplPtr open(const char* path, const char* mode, const bool) override {
+        FlashAsset asset;
+        if (strcmp(mode, FILE_READ) != 0 || !m_bank.find(path, asset)) {
+            return fs::FileImplPtr();
+        }
+        return std::make_shared<FlashAssetFile>(m_bank, path, asset);
+    }
+    
+    bool exists(const char* path) override { return m_bank.exists(path); }
+    bool rename(const char*, const char*) override { return false; }
+    bool remove(const char*) override { return false; }
+    bool mkdir(const char*) override { return false; }
+    bool rmdir(const char*) override { return false; }
+
+private:
+    FlashAssetBank& m_bank;
+};
+
+}
+
+FlashAssetFS::FlashAssetFS(FlashAssetBank& bank)
+    : fs::FS(fs::FSImplPtr(new FlashAssetFSImpl(bank))) {
+}
@@ -0,0 +1,267 @@
+#include "FlashAsyncQueue.h"
+
+// Handles carry the slot index in the low byte and a generation counter
+// above it, so a stale handle never matches a reused slot.
+static int32_t makeHandle(uint8_t slot, uint8_t generation) {
+    return ((int32_t)generation << 8) | slot;
+}
+
+FlashAsyncQueue::FlashAsyncQueue(Flash25Q128JV& flash)
+    : m_flash(flash)
+    , m_requests()
+    , m_queue(nullptr)
+    , m_lock(nullptr)
+    , m_task(nullptr)
+    , m_pending(0) {
+}
+
+bool FlashAsyncQueue::begin() {
+    if (m_task) {
+        return true;
+    }
+    
+    m_queue = xQueueCreate(MAX_REQUESTS, sizeof(uint8_t));
+    m_lock = xSemaphoreCreateMutex();
+    if (!m_queue || !m_lock) {
+        Serial.println(F("Flash queue allocation failed"));
+        return false;
+    }
+    
+    if (xTaskCreatePinnedToCore(taskEntry, "flash", TASK_STACK_SIZE, this,
+                                TASK_PRIORITY, &m_task, TASK_CORE) != pdPASS) {
+        Serial.println(F("Flash worker task creation failed"));
+        m_task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+int32_t FlashAsyncQueue::submitRead(uint32_t address, uint8_t* buffer, uint32_t length,
+                                    FlashCallback callback, void* context) {
+    if (!buffer) return -1;
+    return submit(FLASH_OP_READ, address, buffer, length, nullptr, callback, context);
+}
+
+int32_t FlashAsyncQueue::submitProgram(uint32_t address, const uint8_t* buffer, uint32_t length,
+                                       FlashCallback callback, void* context) {
+    if (!buffer) return -1;
+    return submit(FLASH_OP_PROGRAM, address, const_cast<uint8_t*>(buffer), length, nullptr, callback, context);
+}
+
+int32_t FlashAsyncQueue::submitEraseSector(uint32_t address, FlashCallback callback, void* context) {
+    return submit(FLASH_OP_ERASE_SECTOR, address, nullptr, 0, nullptr, callback, context);
+}
+
+int32_t FlashAsyncQueue::submitEraseRange(uint32_t address, uint32_t length, FlashEraseReport* report,
+                                          FlashCallback callback, void* context) {
+    return submit(FLASH_OP_ERASE_RANGE, address, nullptr, length, report, callback, context);
+}
+
+int32_t FlashAsyncQueue::submitEraseChip(FlashCallback callback, void* context) {
+    return submit(FLASH_OP_ERASE_CHIP, 0, nullptr, 0, nullptr, callback, context);
+}
+
+int32_t FlashAsyncQueue::submit(FlashOp op, uint32_t address, uint8_t* buffer, uint32_t length,
+                                FlashEraseReport* report, FlashCallback callback, void* context) {
+    if (!m_task) {
+        return -1;
+    }
+    
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    
+    // A free slot, or else one whose callback has already had the outcome
+    int8_t chosen = -1;
+    for (uint8_t slot = 0; slot < MAX_REQUESTS && chosen < 0; slot++) {
+        if (m_requests[slot].state == FLASH_REQ_INVALID) chosen = slot;
+    }
+    for (uint8_t slot = 0; slot < MAX_REQUESTS && chosen < 0; slot++) {
+        const Request& request = m_requests[slot];
+        if (request.callback && (request.state == FLASH_REQ_DONE || request.state == FLASH_REQ_FAILED)) {
+            chosen = slot;
+        }
+    }
+    
+    int32_t handle = -1;
+    if (chosen >= 0) {
+        uint8_t slot = chosen;
+        Request& request = m_requests[slot];
+        request.op = op;
+        request.address = address;
+        request.buffer = buffer;
+        request.length = length;
+        request.report = report;
+        request.callback = callback;
+        request.context = context;
+        request.generation++;
+        request.state = FLASH_REQ_QUEUED;
+        
+        handle = makeHandle(slot, request.generation);
+        m_pending++;
+        // The queue is as deep as the slot table, so this never blocks
+        xQueueSend(m_queue, &slot, 0);
+    }
+    
+    xSemaphoreGive(m_lock);
+    return handle;
+}
+
+FlashAsyncQueue::Request* FlashAsyncQueue::lookup(int32_t handle) {
+    if (handle < 0 || (handle & 0xFF) >= MAX_REQUESTS) {
+        return nullptr;
+    }
+    Request& request = m_requests[handle & 0xFF];
+    if (request.generation != ((handle >> 8) & 0xFF)) {
+        return nullptr;
+    }
+    return &request;
+}
+
+FlashRequestState FlashAsyncQueue::poll(int32_t handle) {
+    Request* request = lookup(handle);
+    if (!request) {
+        return FLASH_REQ_INVALID;
+    }
+    
+    FlashRequestState state = request->state;
+    if (state == FLASH_REQ_DONE || state == FLASH_REQ_FAILED) {
+        request->state = FLASH_REQ_INVALID;
+    }
+    return state;
+}
+
+FlashRequestState FlashAsyncQueue::wait(int32_t handle, uint32_t timeoutMs) {
+    unsigned long start = millis();
+    for (;;) {
+        FlashRequestState state = poll(handle);
+        if (state != FLASH_REQ_QUEUED && state != FLASH_REQ_RUNNING) {
+            return state;
+        }
+        if (timeoutMs != portMAX_DELAY && millis() - start >= timeoutMs) {
+            return state;
+        }
+        vTaskDelay(1);
+    }
+}
+
+bool FlashAsyncQueue::program(uint32_t address, const uint8_t* buffer, uint32_t length) {
+    return buffer && runToCompletion(FLASH_OP_PROGRAM, address, const_cast<uint8_t*>(buffer), length, nullptr);
+}
+
+bool FlashAsyncQueue::eraseSector(uint32_t address) {
+    return runToCompletion(FLASH_OP_ERASE_SECTOR, address, nullptr, 0, nullptr);
+}
+
+bool FlashAsyncQueue::eraseRange(uint32_t address, uint32_t length, FlashEraseReport* report) {
+    return runToCompletion(FLASH_OP_ERASE_RANGE, address, nullptr, length, report);
+}
+
+bool FlashAsyncQueue::runToCompletion(FlashOp op, uint32_t address, uint8_t* buffer, uint32_t length,
+                                      FlashEraseReport* report) {
+    if (!m_task) {
+        Request request = {};
+        request.op = op;
+        request.address = address;
+        request.buffer = buffer;
+        request.length = length;
+        request.report = report;
+        return execute(request);
+    }
+    
+    int32_t handle;
+    while ((handle = submit(op, address, buffer, length, report, nullptr, nullptr)) < 0) {
+        vTaskDelay(1);
+    }
+    return wait(handle) == FLASH_REQ_DONE;
+}
+
+void FlashAsyncQueue::taskEntry(void* param) {
+    static_cast<FlashAsyncQueue*>(param)->run();
+}
+
+void FlashAsyncQueue::run() {
+    uint8_t slot;
+    for (;;) {
+        if (xQueueReceive(m_queue, &slot, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        
+        Request& request = m_requests[slot];
+        request.state = FLASH_REQ_RUNNING;
+        bool ok = execute(request);
+        
+        xSemaphoreTake(m_lock, portMAX_DELAY);
+        m_pending--;
+        xSemaphoreGive(m_lock);
+        
+        // The outcome stays readable through wait() after the callback too
+        if (request.callback) {
+            request.callback(makeHandle(slot, request.generation), ok, request.context);
+        }
+        request.state = ok ? FLASH_REQ_DONE : FLASH_REQ_FAILED;
+    }
+}
+
+void FlashAsyncQueue::waitWhileBusy(bool longOperation) {
+    // Erases take tens of ms to seconds: sleep a tick between polls. Page
+    // programs finish in well under a millisecond, so poll them tightly -
+    // unless the chip is busy with an erase another task started.
+    while (m_flash.isBusy()) {
+        if (longOperation || m_flash.isErasing()) {
+            vTaskDelay(1);
+        } else {
+            delayMicroseconds(50);
+        }
+    }
+}
+
+bool FlashAsyncQueue::execute(Request& request) {
+    switch (request.op) {
+        case FLASH_OP_READ:
+            return m_flash.read(request.address, request.buffer, request.length);
+        
+        case FLASH_OP_PROGRAM: {
+            uint32_t address = request.address;
+            const uint8_t* data = request.buffer;
+            uint32_t remaining = request.length;
+            
+            while (remaining > 0) {
+                uint32_t chunk = min(remaining, FLASH_PAGE_SIZE - (address % FLASH_PAGE_SIZE));
+                bool finished;
+                if (!m_flash.startPageProgram(address, data, chunk, &finished)) {
+                    return false;
+                }
+                // A page made under another task's erase suspend is done;
+                // the chip stays busy with the resumed erase, not with it
+                if (!finished) {
+                    waitWhileBusy(false);
+                }
+                
+                address += chunk;
+                data += chunk;
+                remaining -= chunk;
+                // Let same-priority tasks in between pages of long programs
+                taskYIELD();
+            }
+            return true;
+        }
+        
+        case FLASH_OP_ERASE_SECTOR:
+            if (!m_flash.startSectorErase(request.address)) {
+                return false;
+            }
+            waitWhileBusy(true);
+            return true;
+        
+        case FLASH_OP_ERASE_RANGE:
+            // Sleeps through each block erase in the driver's own polling
+            return m_flash.eraseRange(request.address, request.length, request.report);
+        
+        case FLASH_OP_ERASE_CHIP:
+            if (!m_flash.startChipErase()) {
+                return false;
+            }
+            waitWhileBusy(true);
+            return true;
+    }
+    return false;
+}
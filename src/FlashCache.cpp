@@ -0,0 +1,283 @@
+#include "FlashCache.h"
+
+namespace {
+
+constexpr uint8_t PAGES_PER_SECTOR = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+
+static_assert(PAGES_PER_SECTOR <= 16, "Dirty page mask is 16 bits");
+
+uint32_t sectorBase(uint32_t address) {
+    return address & ~(uint32_t)(FLASH_SECTOR_SIZE - 1);
+}
+
+bool isErased(const uint8_t* data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+}
+
+FlashCache::FlashCache(Flash25Q128JV& flash, uint8_t sectorCount)
+    : m_flash(flash)
+    , m_sectorCount(constrain(sectorCount, 1, MAX_SECTORS))
+    , m_lines(nullptr)
+    , m_data(nullptr)
+    , m_useCounter(0)
+    , m_stats() {
+}
+
+FlashCache::~FlashCache() {
+    free(m_lines);
+    free(m_data);
+}
+
+bool FlashCache::begin() {
+    if (m_data) {
+        return true;
+    }
+    
+    m_lines = static_cast<Line*>(calloc(m_sectorCount, sizeof(Line)));
+    m_data = static_cast<uint8_t*>(malloc((size_t)m_sectorCount * FLASH_SECTOR_SIZE));
+    if (!m_lines || !m_data) {
+        free(m_lines);
+        free(m_data);
+        m_lines = nullptr;
+        m_data = nullptr;
+        Serial.println("Flash cache: out of memory");
+        return false;
+    }
+    return true;
+}
+
+uint32_t FlashCache::memoryUsage() const {
+    return m_sectorCount * (FLASH_SECTOR_SIZE + sizeof(Line));
+}
+
+uint8_t* FlashCache::lineData(const Line* line) const {
+    return m_data + (line - m_lines) * FLASH_SECTOR_SIZE;
+}
+
+FlashCache::Line* FlashCache::lookup(uint32_t sector) {
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        if (m_lines[i].valid && m_lines[i].address == sector) {
+            return &m_lines[i];
+        }
+    }
+    return nullptr;
+}
+
+FlashCache::Line* FlashCache::allocate(uint32_t sector) {
+    // Prefer an unused line, otherwise evict the least recently used one
+    Line* victim = &m_lines[0];
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        Line* line = &m_lines[i];
+        if (!line->valid) {
+            victim = line;
+            break;
+        }
+        if (line->lastUse < victim->lastUse) {
+            victim = line;
+        }
+    }
+    
+    if (victim->valid) {
+        if (!writeBack(victim)) {
+            return nullptr;
+        }
+        m_stats.evictions++;
+    }
+    
+    victim->address = sector;
+    victim->dirtyPages = 0;
+    victim->valid = true;
+    victim->filled = false;
+    memset(lineData(victim), 0xFF, FLASH_SECTOR_SIZE);
+    return victim;
+}
+
+bool FlashCache::fill(Line* line) {
+    uint8_t* data = lineData(line);
+    
+    if (line->dirtyPages == 0) {
+        if (!m_flash.read(line->address, data, FLASH_SECTOR_SIZE)) return false;
+    } else {
+        // Pending writes stay on top: merge the chip contents in with AND,
+        // one page at a time to keep the stack small
+        uint8_t page[FLASH_PAGE_SIZE];
+        for (uint32_t offset = 0; offset < FLASH_SECTOR_SIZE; offset += FLASH_PAGE_SIZE) {
+            if (!m_flash.read(line->address + offset, page, FLASH_PAGE_SIZE)) return false;
+            for (uint32_t i = 0; i < FLASH_PAGE_SIZE; i++) {
+                data[offset + i] &= page[i];
+            }
+        }
+    }
+    
+    line->filled = true;
+    return true;
+}
+
+bool FlashCache::writeBack(Line* line) {
+    uint8_t* data = lineData(line);
+    
+    for (uint8_t page = 0; page < PAGES_PER_SECTOR; page++) {
+        if (!(line->dirtyPages & (1 << page))) continue;
+        
+        // An unfilled page that is still all 0xFF has nothing to program
+        const uint8_t* pageData = data + page * FLASH_PAGE_SIZE;
+        if (line->filled || !isErased(pageData, FLASH_PAGE_SIZE)) {
+            if (!m_flash.write(line->address + page * FLASH_PAGE_SIZE, pageData, FLASH_PAGE_SIZE)) {
+                return false;
+            }
+            m_stats.pagePrograms++;
+        }
+        line->dirtyPages &= ~(1 << page);
+    }
+    return true;
+}
+
+bool FlashCache::read(uint32_t address, uint8_t* buffer, uint32_t length) {
+    if (!m_data || !buffer || address + length > m_flash.getCapacity()) {
+        return false;
+    }
+    
+    while (length > 0) {
+        uint32_t sector = sectorBase(address);
+        uint32_t offset = address - sector;
+        uint32_t chunk = min(length, FLASH_SECTOR_SIZE - offset);
+        Line* line = lookup(sector);
+        
+        if (line && line->filled) {
+            m_stats.hits++;
+        } else if (!line && chunk == FLASH_SECTOR_SIZE) {
+            // Streaming through whole sectors would only flush out the hot set
+            if (!m_flash.read(address, buffer, chunk)) return false;
+            m_stats.bypassedReads++;
+            line = nullptr;
+        } else {
+            m_stats.misses++;
+            if (!line && !(line = allocate(sector))) return false;
+            if (!fill(line)) return false;
+        }
+        
+        if (line) {
+            memcpy(buffer, lineData(line) + offset, chunk);
+            touch(line);
+        }
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool FlashCache::write(uint32_t address, const uint8_t* buffer, uint32_t length) {
+    if (!m_data || !buffer || address + length > m_flash.getCapacity()) {
+        return false;
+    }
+    
+    m_stats.writes++;
+    while (length > 0) {
+        uint32_t sector = sectorBase(address);
+        uint32_t offset = address - sector;
+        uint32_t chunk = min(length, FLASH_SECTOR_SIZE - offset);
+        
+        Line* line = lookup(sector);
+        if (!line && !(line = allocate(sector))) {
+            return false;
+        }
+        
+        // Programming can only clear bits
+        uint8_t* data = lineData(line) + offset;
+        for (uint32_t i = 0; i < chunk; i++) {
+            data[i] &= buffer[i];
+        }
+        
+        uint8_t firstPage = offset / FLASH_PAGE_SIZE;
+        uint8_t lastPage = (offset + chunk - 1) / FLASH_PAGE_SIZE;
+        for (uint8_t page = firstPage; page <= lastPage; page++) {
+            line->dirtyPages |= 1 << page;
+        }
+        touch(line);
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool FlashCache::eraseSector(uint32_t address) {
+    if (!m_data) {
+        return false;
+    }
+    
+    // Pending writes to the sector are moot once it is erased
+    Line* line = lookup(sectorBase(address));
+    if (line) {
+        memset(lineData(line), 0xFF, FLASH_SECTOR_SIZE);
+        line->dirtyPages = 0;
+        line->filled = true;
+    }
+    return m_flash.eraseSector(address);
+}
+
+bool FlashCache::flush() {
+    if (!m_data) {
+        return false;
+    }
+    
+    // Write back in address order so consecutive sectors program in sequence
+    uint32_t lastAddress = 0;
+    bool first = true;
+    while (true) {
+        Line* next = nullptr;
+        for (uint8_t i = 0; i < m_sectorCount; i++) {
+            Line* line = &m_lines[i];
+            if (!line->valid || line->dirtyPages == 0) continue;
+            if (!first && line->address <= lastAddress) continue;
+            if (!next || line->address < next->address) next = line;
+        }
+        if (!next) break;
+        
+        if (!writeBack(next)) return false;
+        lastAddress = next->address;
+        first = false;
+    }
+    return true;
+}
+
+bool FlashCache::sync() {
+    if (!flush()) {
+        return false;
+    }
+    
+    invalidate(0, m_flash.getCapacity());
+    return true;
+}
+
+void FlashCache::invalidate(uint32_t address, uint32_t length) {
+    if (!m_lines) {
+        return;
+    }
+    
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        Line* line = &m_lines[i];
+        if (line->valid && line->address + FLASH_SECTOR_SIZE > address && line->address < address + length) {
+            line->valid = false;
+            line->dirtyPages = 0;
+        }
+    }
+}
+
+uint16_t FlashCache::dirtyPageCount() const {
+    uint16_t count = 0;
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        if (m_lines && m_lines[i].valid) {
+            count += __builtin_popcount(m_lines[i].dirtyPages);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,550 @@
+#include "FlashKVStore.h"
+#include "Crc32.h"
+
+namespace {
+
+constexpr uint32_t SECTOR_MAGIC = 0x5653594B;   // "KYSV"
+constexpr uint8_t RECORD_MAGIC = 0xA5;
+constexpr uint8_t TOMBSTONE_MAGIC = 0xA4;
+
+struct __attribute__((packed)) SectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t eraseCount;
+    uint32_t crc;
+};
+
+struct __attribute__((packed)) RecordHeader {
+    uint8_t magic;
+    uint8_t keyLength;
+    uint16_t valueLength;
+    uint32_t crc;           // over magic, lengths, key and value
+};
+
+constexpr uint16_t SECTOR_DATA_START = sizeof(SectorHeader);
+constexpr uint16_t MAX_RECORD_SIZE = sizeof(RecordHeader) + FlashKVStore::MAX_KEY_LENGTH +
+                                     FlashKVStore::MAX_VALUE_LENGTH;
+
+static_assert(MAX_RECORD_SIZE <= FLASH_PAGE_SIZE, "A record must fit in one page program");
+
+uint16_t alignedSize(uint16_t size) {
+    return (size + 3) & ~3;
+}
+
+uint32_t recordCrc(const uint8_t* record) {
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+    uint32_t crc = crc32Update(record, offsetof(RecordHeader, crc));
+    return crc32Update(record + sizeof(RecordHeader), header->keyLength + header->valueLength, crc);
+}
+
+}
+
+FlashKVStore::FlashKVStore(Flash25Q128JV& flash, uint32_t baseAddress, uint8_t sectorCount)
+    : m_flash(flash)
+    , m_queue(nullptr)
+    , m_baseAddress(baseAddress)
+    , m_sectorCount(min<uint8_t>(sectorCount, MAX_SECTORS))
+    , m_ready(false)
+    , m_eraseHandle(-1)
+    , m_erasingSector(-1)
+    , m_activeSector(-1)
+    , m_head(0)
+    , m_nextSequence(1)
+    , m_stats() {
+    memset(m_sequence, 0, sizeof(m_sequence));
+    memset(m_eraseCount, 0, sizeof(m_eraseCount));
+    memset(m_index, 0, sizeof(m_index));
+}
+
+uint32_t FlashKVStore::sectorAddress(uint8_t sector) const {
+    return m_baseAddress + (uint32_t)sector * FLASH_SECTOR_SIZE;
+}
+
+int8_t FlashKVStore::sectorOf(uint32_t address) const {
+    if (address < m_baseAddress) return -1;
+    uint32_t sector = (address - m_baseAddress) / FLASH_SECTOR_SIZE;
+    return sector < m_sectorCount ? (int8_t)sector : -1;
+}
+
+uint8_t FlashKVStore::freeSectorCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        if (m_sequence[i] == 0) count++;
+    }
+    return count;
+}
+
+int8_t FlashKVStore::oldestSector() const {
+    int8_t oldest = -1;
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        if (m_sequence[i] != 0 && (oldest < 0 || m_sequence[i] < m_sequence[oldest])) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+bool FlashKVStore::begin() {
+    finishErase();
+    m_ready = false;
+    m_activeSector = -1;
+    m_nextSequence = 1;
+    memset(m_sequence, 0, sizeof(m_sequence));
+    memset(m_index, 0, sizeof(m_index));
+    m_stats = Stats();
+    
+    if (m_sectorCount < 3) {
+        Serial.println(F("KV store needs at least 3 sectors"));
+        return false;
+    }
+    
+    // Pass 1: sector headers
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        SectorHeader header;
+        if (!m_flash.read(sectorAddress(i), reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+            Serial.println(F("KV store: flash not available"));
+            return false;
+        }
+        
+        if (header.magic == SECTOR_MAGIC &&
+            header.crc == crc32Update(&header, offsetof(SectorHeader, crc)) &&
+            header.sequence != 0) {
+            m_sequence[i] = header.sequence;
+            m_eraseCount[i] = header.eraseCount;
+            m_nextSequence = max(m_nextSequence, header.sequence + 1);
+        }
+        m_stats.maxEraseCount = max(m_stats.maxEraseCount, m_eraseCount[i]);
+    }
+    
+    // Sectors without a valid header (erased, or an erase cut short) inherit
+    // the worst known wear so the count stays conservative
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        if (m_sequence[i] == 0) m_eraseCount[i] = m_stats.maxEraseCount;
+    }
+    
+    // Pass 2: replay the sectors oldest first so newer records win
+    uint32_t lastSequence = 0;
+    for (;;) {
+        int8_t next = -1;
+        for (uint8_t i = 0; i < m_sectorCount; i++) {
+            if (m_sequence[i] > lastSequence && (next < 0 || m_sequence[i] < m_sequence[next])) {
+                next = i;
+            }
+        }
+        if (next < 0) break;
+        
+        uint32_t end;
+        if (!scanSector(next, end)) return false;
+        m_activeSector = next;
+        m_head = end;
+        lastSequence = m_sequence[next];
+    }
+    
+    m_ready = true;
+    
+    // A cut between activating the last free sector and finishing the
+    // collection of the oldest one leaves no free sector: finish it now
+    if (m_activeSector >= 0 && freeSectorCount() == 0) {
+        collect(oldestSector());
+    }
+    
+    Serial.printf("KV store mounted: %u keys, %u records skipped\n",
+                  m_stats.liveKeys, (unsigned)m_stats.corruptRecords);
+    return true;
+}
+
+bool FlashKVStore::scanSector(uint8_t sector, uint32_t& end) {
+    uint32_t start = sectorAddress(sector);
+    uint8_t page[FLASH_PAGE_SIZE];
+    
+    // Records never cross a page, so the log is parsed one page read at a time
+    end = start + FLASH_SECTOR_SIZE;
+    for (uint32_t pageStart = start; pageStart < start + FLASH_SECTOR_SIZE; pageStart += FLASH_PAGE_SIZE) {
+        if (!m_flash.read(pageStart, page, sizeof(page))) {
+            return false;
+        }
+        
+        uint16_t offset = pageStart == start ? SECTOR_DATA_START : 0;
+        
+        uint16_t first = offset;
+        
+        while (offset + sizeof(RecordHeader) <= FLASH_PAGE_SIZE) {
+            const RecordHeader* header = reinterpret_cast<const RecordHeader*>(page + offset);
+            if (header->magic == 0xFF) {
+                break;  // padding before the next page
+            }
+            
+            uint16_t size = sizeof(RecordHeader) + header->keyLength + header->valueLength;
+            bool valid = (header->magic == RECORD_MAGIC || header->magic == TOMBSTONE_MAGIC) &&
+                         header->keyLength > 0 && header->keyLength <= MAX_KEY_LENGTH &&
+                         header->valueLength <= MAX_VALUE_LENGTH &&
+                         offset + size <= FLASH_PAGE_SIZE &&
+                         header->crc == recordCrc(page + offset);
+            
+            if (!valid) {
+                // Torn record: the rest of its page is suspect
+                m_stats.corruptRecords++;
+                offset = FLASH_PAGE_SIZE;
+                break;
+            }
+            
+            char key[MAX_KEY_LENGTH + 1];
+            memcpy(key, page + offset + sizeof(RecordHeader), header->keyLength);
+            key[header->keyLength] = '\0';
+            
+            if (header->magic == RECORD_MAGIC) {
+                indexSet(key, pageStart + offset, alignedSize(size));
+            } else {
+                indexDelete(key);
+            }
+            offset += alignedSize(size);
+        }
+        
+        // Appends must land on erased bytes: if anything after the last good
+        // record was programmed (a cut mid-program), continue on the next page
+        end = pageStart + FLASH_PAGE_SIZE;
+        for (uint16_t i = offset; i < FLASH_PAGE_SIZE; i++) {
+            if (page[i] != 0xFF) break;
+            if (i == FLASH_PAGE_SIZE - 1) end = pageStart + offset;
+        }
+        
+        // Nothing is ever written after a page left blank from its start; a
+        // torn record can leave 0xFF at the start with programmed bytes after
+        if (end == pageStart + first) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool FlashKVStore::readRecord(uint32_t address, uint8_t* record, uint16_t& size, bool verify) {
+    // Records never live in a sector being erased, so urgent reads can
+    // suspend the erase instead of waiting it out
+    if (!m_flash.read(address, record, sizeof(RecordHeader), FLASH_PRIORITY_URGENT)) return false;
+    
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+    size = sizeof(RecordHeader) + header->keyLength + header->valueLength;
+    if (size > MAX_RECORD_SIZE) return false;
+    
+    if (!m_flash.read(address + sizeof(RecordHeader), record + sizeof(RecordHeader),
+                      size - sizeof(RecordHeader), FLASH_PRIORITY_URGENT)) {
+        return false;
+    }
+    return !verify || header->crc == recordCrc(record);
+}
+
+bool FlashKVStore::eraseRingSector(uint8_t sector) {
+    finishErase();
+    if (m_queue) {
+        m_eraseHandle = m_queue->submitEraseSector(sectorAddress(sector));
+    }
+    if (m_eraseHandle >= 0) {
+        m_erasingSector = sector;
+    } else if (!m_flash.eraseSector(sectorAddress(sector))) {
+        return false;
+    }
+    
+    m_sequence[sector] = 0;
+    m_eraseCount[sector]++;
+    m_stats.sectorErases++;
+    m_stats.maxEraseCount = max(m_stats.maxEraseCount, m_eraseCount[sector]);
+    return true;
+}
+
+// A failed erase shows up as a sector that isn't blank when activated
+bool FlashKVStore::finishErase() {
+    if (m_eraseHandle < 0) {
+        return true;
+    }
+    bool ok = m_queue->wait(m_eraseHandle) == FLASH_REQ_DONE;
+    m_eraseHandle = -1;
+    m_erasingSector = -1;
+    return ok;
+}
+
+bool FlashKVStore::activateSector(uint8_t sector) {
+    if (sector == m_erasingSector) {
+        finishErase();
+    }
+    
+    // Free sectors are normally blank already; anything left over from an
+    // interrupted erase gets erased again before use
+    uint8_t buffer[FLASH_PAGE_SIZE];
+    for (uint32_t offset = 0; offset < FLASH_SECTOR_SIZE; offset += sizeof(buffer)) {
+        if (!m_flash.read(sectorAddress(sector) + offset, buffer, sizeof(buffer), FLASH_PRIORITY_URGENT)) {
+            return false;
+        }
+        
+        bool blank = true;
+        for (uint16_t i = 0; i < sizeof(buffer) && blank; i++) {
+            blank = buffer[i] == 0xFF;
+        }
+        if (!blank) {
+            if (!eraseRingSector(sector) || !finishErase()) return false;
+            break;
+        }
+    }
+    
+    SectorHeader header;
+    header.magic = SECTOR_MAGIC;
+    header.sequence = m_nextSequence++;
+    header.eraseCount = m_eraseCount[sector];
+    header.crc = crc32Update(&header, offsetof(SectorHeader, crc));
+    
+    if (!m_flash.write(sectorAddress(sector), reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+        return false;
+    }
+    
+    m_sequence[sector] = header.sequence;
+    m_activeSector = sector;
+    m_head = sectorAddress(sector) + SECTOR_DATA_START;
+    return true;
+}
+
+bool FlashKVStore::collect(uint8_t sector) {
+    uint32_t start = sectorAddress(sector);
+    uint8_t record[FLASH_PAGE_SIZE];
+    
+    // Copy the live records forward first; until the erase below both
+    // copies exist and the newer sequence wins on the next mount
+    for (uint16_t i = 0; i < INDEX_CAPACITY; i++) {
+        IndexEntry& entry = m_index[i];
+        if (entry.hash == 0 || entry.address == ADDRESS_DELETED ||
+            entry.address < start || entry.address >= start + FLASH_SECTOR_SIZE) {
+            continue;
+        }
+        
+        uint16_t size;
+        if (!readRecord(entry.address, record, size, false)) return false;
+        
+        const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+        uint32_t address;
+        if (!append(RECORD_MAGIC, entry.key, record + sizeof(RecordHeader) + header->keyLength,
+                    header->valueLength, address)) {
+            return false;
+        }
+        entry.address = address;
+    }
+    
+    // Tombstones in the oldest sector are dropped here: every older record
+    // they could shadow lives in this same sector
+    m_stats.gcRuns++;
+    return eraseRingSector(sector);
+}
+
+bool FlashKVStore::reserve(uint16_t size) {
+    if (m_activeSector < 0) {
+        return activateSector(0);
+    }
+    
+    uint32_t pageRemaining = FLASH_PAGE_SIZE - (m_head % FLASH_PAGE_SIZE);
+    uint32_t head = size > pageRemaining ? m_head + pageRemaining : m_head;
+    
+    if (head + size <= sectorAddress(m_activeSector) + FLASH_SECTOR_SIZE) {
+        m_head = head;
+        return true;
+    }
+    
+    // Rotate to the next sector of the ring, which the spare kept below
+    // guarantees to be free, and then restore the spare
+    uint8_t next = (m_activeSector + 1) % m_sectorCount;
+    if (m_sequence[next] != 0) {
+        Serial.println(F("KV store: no free sector"));
+        return false;
+    }
+    if (!activateSector(next)) {
+        return false;
+    }
+    if (freeSectorCount() == 0) {
+        return collect(oldestSector());
+    }
+    return true;
+}
+
+bool FlashKVStore::append(uint8_t magic, const char* key, const void* value, uint16_t length,
+                          uint32_t& address) {
+    uint8_t keyLength = strlen(key);
+    uint16_t size = sizeof(RecordHeader) + keyLength + length;
+    
+    if (!reserve(alignedSize(size))) {
+        return false;
+    }
+    
+    uint8_t record[FLASH_PAGE_SIZE];
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(record);
+    header->magic = magic;
+    header->keyLength = keyLength;
+    header->valueLength = length;
+    memcpy(record + sizeof(RecordHeader), key, keyLength);
+    if (length) memcpy(record + sizeof(RecordHeader) + keyLength, value, length);
+    header->crc = recordCrc(record);
+    
+    // reserve() keeps the record inside one page: a single page program
+    if (!m_flash.write(m_head, record, size)) {
+        return false;
+    }
+    
+    address = m_head;
+    m_head += alignedSize(size);
+    m_stats.appendedRecords++;
+    return true;
+}
+
+bool FlashKVStore::format() {
+    for (uint8_t i = 0; i < m_sectorCount; i++) {
+        if (m_sequence[i] != 0 && !eraseRingSector(i)) return false;
+    }
+    return begin();
+}
+
+bool FlashKVStore::put(const char* key, const void* value, uint16_t length) {
+    if (!m_ready || !key || (!value && length) || length > MAX_VALUE_LENGTH) {
+        return false;
+    }
+    size_t keyLength = strlen(key);
+    if (keyLength == 0 || keyLength > MAX_KEY_LENGTH) {
+        return false;
+    }
+    
+    // Unchanged values cost a read, not a program
+    int16_t slot = findSlot(key);
+    uint16_t oldSize = 0;
+    if (slot >= 0 && m_index[slot].address != ADDRESS_DELETED) {
+        uint8_t record[FLASH_PAGE_SIZE];
+        uint16_t size;
+        if (readRecord(m_index[slot].address, record, size, false)) {
+            const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+            if (header->valueLength == length &&
+                memcmp(record + sizeof(RecordHeader) + header->keyLength, value, length) == 0) {
+                m_stats.skippedWrites++;
+                return true;
+            }
+        }
+        oldSize = m_index[slot].size;
+    }
+    
+    // Live data must fit in half a sector so collection always has room
+    uint16_t size = alignedSize(sizeof(RecordHeader) + keyLength + length);
+    if (m_stats.liveBytes - oldSize + size > (FLASH_SECTOR_SIZE - SECTOR_DATA_START) / 2) {
+        Serial.println(F("KV store full"));
+        return false;
+    }
+    
+    uint32_t address;
+    if (!append(RECORD_MAGIC, key, value, length, address)) {
+        return false;
+    }
+    indexSet(key, address, size);
+    return true;
+}
+
+int32_t FlashKVStore::get(const char* key, void* value, uint16_t maxLength) {
+    int16_t slot = m_ready && key ? findSlot(key) : -1;
+    if (slot < 0 || m_index[slot].address == ADDRESS_DELETED) {
+        return -1;
+    }
+    
+    uint8_t record[FLASH_PAGE_SIZE];
+    uint16_t size;
+    if (!readRecord(m_index[slot].address, record, size, true)) {
+        return -1;
+    }
+    
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+    if (value) {
+        memcpy(value, record + sizeof(RecordHeader) + header->keyLength,
+               min<uint16_t>(header->valueLength, maxLength));
+    }
+    return header->valueLength;
+}
+
+bool FlashKVStore::remove(const char* key) {
+    if (!contains(key)) {
+        return true;
+    }
+    
+    uint32_t address;
+    if (!append(TOMBSTONE_MAGIC, key, nullptr, 0, address)) {
+        return false;
+    }
+    indexDelete(key);
+    return true;
+}
+
+bool FlashKVStore::contains(const char* key) const {
+    int16_t slot = m_ready && key ? findSlot(key) : -1;
+    return slot >= 0 && m_index[slot].address != ADDRESS_DELETED;
+}
+
+bool FlashKVStore::putUInt(const char* key, uint32_t value) {
+    return put(key, &value, sizeof(value));
+}
+
+uint32_t FlashKVStore::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value;
+    return get(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+uint32_t FlashKVStore::hashKey(const char* key) {
+    // FNV-1a; 0 is reserved for empty slots
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash = (hash ^ (uint8_t)*key++) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+int16_t FlashKVStore::findSlot(const char* key) const {
+    uint32_t hash = hashKey(key);
+    for (uint16_t probe = 0; probe < INDEX_CAPACITY; probe++) {
+        uint16_t slot = (hash + probe) % INDEX_CAPACITY;
+        const IndexEntry& entry = m_index[slot];
+        if (entry.hash == 0) return -1;
+        if (entry.hash == hash && strcmp(entry.key, key) == 0) return slot;
+    }
+    return -1;
+}
+
+void FlashKVStore::indexSet(const char* key, uint32_t address, uint16_t size) {
+    int16_t slot = findSlot(key);
+    
+    if (slot < 0) {
+        // Deleted keys keep their slot, so the first free one ends the chain
+        uint32_t hash = hashKey(key);
+        for (uint16_t probe = 0; probe < INDEX_CAPACITY && slot < 0; probe++) {
+            uint16_t candidate = (hash + probe) % INDEX_CAPACITY;
+            if (m_index[candidate].hash == 0) slot = candidate;
+        }
+        if (slot < 0) {
+            Serial.println(F("KV index full"));
+            return;
+        }
+        m_index[slot].hash = hash;
+        m_index[slot].address = ADDRESS_DELETED;
+        m_index[slot].size = 0;
+        strncpy(m_index[slot].key, key, MAX_KEY_LENGTH);
+        m_index[slot].key[MAX_KEY_LENGTH] = '\0';
+    }
+    
+    IndexEntry& entry = m_index[slot];
+    if (entry.address == ADDRESS_DELETED) {
+        m_stats.liveKeys++;
+    } else {
+        m_stats.liveBytes -= entry.size;
+    }
+    entry.address = address;
+    entry.size = size;
+    m_stats.liveBytes += size;
+}
+
+void FlashKVStore::indexDelete(const char* key) {
+    int16_t slot = findSlot(key);
+    if (slot < 0 || m_index[slot].address == ADDRESS_DELETED) {
+        return;
+    }
+    
+    m_stats.liveKeys--;
+    m_stats.liveBytes -= m_index[slot].size;
+    m_index[slot].address = ADDRESS_DELETED;
+    m_index[slot].size = 0;
+}
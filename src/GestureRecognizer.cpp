@@ -0,0 +1,125 @@
+#include "GestureRecognizer.h"
+
+GestureRecognizer::GestureRecognizer()
+    : m_state(STATE_IDLE)
+    , m_startX(0)
+    , m_startY(0)
+    , m_startMicros(0)
+    , m_lastX(0)
+    , m_lastY(0)
+    , m_historyNext(0)
+    , m_historyCount(0)
+    , m_head(0)
+    , m_tail(0)
+    , m_dropped(0) {
+}
+
+void GestureRecognizer::add(bool pressed, int16_t x, int16_t y, uint32_t micros) {
+    if (!pressed) {
+        if (m_state == STATE_IDLE) return;
+
+        int16_t dx = m_lastX - m_startX;
+        int16_t dy = m_lastY - m_startY;
+        int16_t vx, vy;
+        velocity(vx, vy);
+        if (m_state == STATE_PRESSED) {
+            emit(GESTURE_TAP, micros);
+        } else if (m_state == STATE_DRAGGING && abs(dx) >= SWIPE_MIN_DISTANCE_PX && abs(dx) > 2 * abs(dy) &&
+                   abs(vx) >= SWIPE_MIN_SPEED_PX_S && (vx > 0) == (dx > 0)) {
+            emit(GESTURE_SWIPE, micros);
+        }
+        if (m_state != STATE_CANCELLED) {
+            emit(GESTURE_UP, micros);
+        }
+        m_state = STATE_IDLE;
+        return;
+    }
+
+    if (m_state == STATE_IDLE) {
+        m_state = STATE_PRESSED;
+        m_startX = m_lastX = x;
+        m_startY = m_lastY = y;
+        m_startMicros = micros;
+        m_historyCount = 0;
+        m_historyNext = 0;
+        addHistory(x, y, micros);
+        emit(GESTURE_DOWN, micros);
+        return;
+    }
+    if (m_state == STATE_CANCELLED) return;
+
+    addHistory(x, y, micros);
+    bool moved = x != m_lastX || y != m_lastY;
+    m_lastX = x;
+    m_lastY = y;
+
+    if (m_state == STATE_PRESSED) {
+        if (abs(x - m_startX) > TAP_SLOP_PX || abs(y - m_startY) > TAP_SLOP_PX) {
+            m_state = STATE_DRAGGING;
+        } else if (micros - m_startMicros >= LONG_PRESS_MS * 1000) {
+            m_state = STATE_LONG_PRESSED;
+            emit(GESTURE_LONG_PRESS, micros);
+        }
+    }
+    if (moved) {
+        emit(m_state == STATE_DRAGGING ? GESTURE_DRAG : GESTURE_MOVE, micros);
+    }
+}
+
+void GestureRecognizer::cancel() {
+    m_head = m_tail;
+    if (m_state != STATE_IDLE) {
+        m_state = STATE_CANCELLED;
+    }
+}
+
+bool GestureRecognizer::read(GestureEvent& event) {
+    if (m_tail == m_head) return false;
+    event = m_queue[m_tail % QUEUE_SIZE];
+    m_tail++;
+    return true;
+}
+
+void GestureRecognizer::addHistory(int16_t x, int16_t y, uint32_t micros) {
+    m_historyX[m_historyNext] = x;
+    m_historyY[m_historyNext] = y;
+    m_historyMicros[m_historyNext] = micros;
+    m_historyNext = (m_historyNext + 1) % VELOCITY_SAMPLES;
+    if (m_historyCount < VELOCITY_SAMPLES) m_historyCount++;
+}
+
+void GestureRecognizer::velocity(int16_t& vx, int16_t& vy) const {
+    // From the oldest position kept to the newest
+    vx = vy = 0;
+    if (m_historyCount < 2) return;
+    uint8_t newest = (m_historyNext + VELOCITY_SAMPLES - 1) % VELOCITY_SAMPLES;
+    uint8_t oldest = m_historyCount < VELOCITY_SAMPLES ? 0 : m_historyNext;
+    int32_t elapsed = m_historyMicros[newest] - m_historyMicros[oldest];
+    if (elapsed <= 0) return;
+    vx = constrain((int32_t)(m_historyX[newest] - m_historyX[oldest]) * 1000000 / elapsed, -INT16_MAX, INT16_MAX);
+    vy = constrain((int32_t)(m_historyY[newest] - m_historyY[oldest]) * 1000000 / elapsed, -INT16_MAX, INT16_MAX);
+}
+
+void GestureRecognizer::emit(GestureType type, uint32_t micros) {
+    GestureEvent event;
+    event.type = type;
+    event.x = m_lastX;
+    event.y = m_lastY;
+    event.startX = m_startX;
+    event.startY = m_startY;
+    velocity(event.velocityX, event.velocityY);
+    event.micros = micros;
+
+    // A move replaces the one before it if the UI has not read that yet
+    if ((type == GESTURE_MOVE || type == GESTURE_DRAG) && m_head != m_tail &&
+        m_queue[(uint8_t)(m_head - 1) % QUEUE_SIZE].type == type) {
+        m_queue[(uint8_t)(m_head - 1) % QUEUE_SIZE] = event;
+        return;
+    }
+    if ((uint8_t)(m_head - m_tail) >= QUEUE_SIZE) {
+        m_dropped++;
+        return;
+    }
+    m_queue[m_head % QUEUE_SIZE] = event;
+    m_head++;
+}
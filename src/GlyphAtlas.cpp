@@ -0,0 +1,80 @@
+#include "GlyphAtlas.h"
+
+GlyphAtlas::GlyphAtlas(uint8_t font, uint16_t color, uint16_t background)
+    : m_font(font)
+    , m_color(color)
+    , m_background(background)
+    , m_pixels(nullptr)
+    , m_failed(false)
+    , m_height(0)
+    , m_widths{}
+    , m_offsets{} {
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    free(m_pixels);
+}
+
+bool GlyphAtlas::build(TFT_eSPI& tft) {
+    if (m_pixels || m_failed) {
+        return m_pixels != nullptr;
+    }
+
+    m_height = tft.fontHeight(m_font);
+    int16_t widest = 0;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < GLYPH_COUNT; i++) {
+        char text[2] = {GLYPHS[i], '\0'};
+        m_widths[i] = tft.textWidth(text, m_font);
+        m_offsets[i] = total;
+        total += (uint32_t)m_widths[i] * m_height;
+        widest = max<int16_t>(widest, m_widths[i]);
+    }
+
+    // Each glyph is drawn the way the screens draw text, then packed
+    m_pixels = static_cast<uint16_t*>(malloc(total * sizeof(uint16_t)));
+    TFT_eSprite cell(&tft);
+    cell.setColorDepth(16);
+    if (!m_pixels || !cell.createSprite(widest, m_height)) {
+        free(m_pixels);
+        m_pixels = nullptr;
+        m_failed = true;
+        return false;
+    }
+    cell.setTextColor(m_color);
+    cell.setTextDatum(TL_DATUM);
+    const uint16_t* rendered = static_cast<const uint16_t*>(cell.getPointer());
+    for (uint8_t i = 0; i < GLYPH_COUNT; i++) {
+        char text[2] = {GLYPHS[i], '\0'};
+        cell.fillSprite(m_background);
+        cell.drawString(text, 0, 0, m_font);
+        for (int16_t row = 0; row < m_height; row++) {
+            memcpy(m_pixels + m_offsets[i] + row * m_widths[i], rendered + row * widest,
+                   m_widths[i] * sizeof(uint16_t));
+        }
+    }
+    cell.deleteSprite();
+    return true;
+}
+
+int8_t GlyphAtlas::indexOf(char c) const {
+    const char* found = c ? strchr(GLYPHS, c) : nullptr;
+    return found ? found - GLYPHS : -1;
+}
+
+const uint16_t* GlyphAtlas::glyph(char c) const {
+    int8_t index = indexOf(c);
+    return (m_pixels && index >= 0) ? m_pixels + m_offsets[index] : nullptr;
+}
+
+int16_t GlyphAtlas::width(char c) const {
+    int8_t index = indexOf(c);
+    return index >= 0 ? m_widths[index] : 0;
+}
+
+uint32_t GlyphAtlas::memoryUsage() const {
+    if (!m_pixels) {
+        return 0;
+    }
+    return (m_offsets[GLYPH_COUNT - 1] + (uint32_t)m_widths[GLYPH_COUNT - 1] * m_height) * sizeof(uint16_t);
+}
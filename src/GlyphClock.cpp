@@ -0,0 +1,93 @@
+#include "GlyphClock.h"
+
+GlyphClock::GlyphClock(GlyphAtlas& atlas, int16_t x, int16_t y, uint8_t datum)
+    : m_atlas(atlas)
+    , m_x(x)
+    , m_y(y)
+    , m_datum(datum)
+    , m_valid(false)
+    , m_lastSpiBytes(0) {
+}
+
+void GlyphClock::reset(const String& shown) {
+    m_shown = shown;
+    m_valid = true;
+}
+
+bool GlyphClock::sameLayout(const String& text) const {
+    if (text.length() != m_shown.length()) {
+        return false;
+    }
+    for (unsigned int i = 0; i < text.length(); i++) {
+        if (!m_atlas.glyph(text[i]) || !m_atlas.glyph(m_shown[i]) ||
+            m_atlas.width(text[i]) != m_atlas.width(m_shown[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GlyphClock::update(TFT_eSPI& tft, const String& text) {
+    UI_PROFILE_SCOPE(SECTION_CLOCK);
+    m_lastSpiBytes = 0;
+    if (!m_valid || !m_atlas.build(tft) || !sameLayout(text)) {
+        return false;
+    }
+
+    int16_t width = 0;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        width += m_atlas.width(text[i]);
+    }
+    int16_t x = m_x;
+    if (m_datum == TC_DATUM) x -= width / 2;
+    if (m_datum == TR_DATUM) x -= width;
+
+    tft.startWrite();
+    for (unsigned int i = 0; i < text.length(); i++) {
+        if (text[i] != m_shown[i]) {
+            m_lastSpiBytes += pushChange(tft, x, m_shown[i], text[i]);
+        }
+        x += m_atlas.width(text[i]);
+    }
+    tft.endWrite();
+    UI_PROFILE_BUS_BYTES(m_lastSpiBytes);
+
+#if UI_DAMAGE_LOG
+    Serial.printf("Clock: \"%s\" in %lu SPI bytes\n", text.c_str(), (unsigned long)m_lastSpiBytes);
+#endif
+    m_shown = text;
+    return true;
+}
+
+uint32_t GlyphClock::pushChange(TFT_eSPI& tft, int16_t x, char before, char after) {
+    const uint16_t* oldCell = m_atlas.glyph(before);
+    const uint16_t* newCell = m_atlas.glyph(after);
+    int16_t width = m_atlas.width(after);
+    int16_t height = m_atlas.height();
+
+    // Bounding box of the pixels that differ; on a seven segment digit
+    // that is often a segment or two
+    int16_t left = width, right = -1, top = height, bottom = -1;
+    for (int16_t row = 0; row < height; row++) {
+        const uint16_t* a = oldCell + row * width;
+        const uint16_t* b = newCell + row * width;
+        for (int16_t col = 0; col < width; col++) {
+            if (a[col] == b[col]) continue;
+            left = min(left, col);
+            right = max(right, col);
+            top = min(top, row);
+            bottom = max(bottom, row);
+        }
+    }
+    if (right < 0) {
+        return 0;
+    }
+
+    int16_t boxWidth = right - left + 1;
+    int16_t boxHeight = bottom - top + 1;
+    tft.setAddrWindow(x + left, m_y + top, boxWidth, boxHeight);
+    for (int16_t row = top; row <= bottom; row++) {
+        tft.pushPixels(newCell + row * width + left, boxWidth);
+    }
+    return (uint32_t)boxWidth * boxHeight * 2 + DamageTracker::WINDOW_OVERHEAD_BYTES;
+}
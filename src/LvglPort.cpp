@@ -0,0 +1,121 @@
+#include "LvglPort.h"
+#include "TouchLatency.h"
+
+#if UI_LVGL
+#include <esp_heap_caps.h>
+
+LvglPort::LvglPort(TFT_eSPI& tft)
+    : m_tft(tft)
+    , m_display(nullptr)
+    , m_touch(nullptr)
+    , m_buffers{nullptr, nullptr}
+    , m_bufferBytes(0)
+    , m_dma(false)
+    , m_writing(false)
+    , m_touchReader(nullptr)
+    , m_touchContext(nullptr)
+    , m_lastPoint{0, 0} {
+}
+
+bool LvglPort::begin(TouchReader reader, void* context) {
+    int16_t width = m_tft.width();
+    int16_t height = m_tft.height();
+    m_bufferBytes = (uint32_t)width * (height / BUFFER_FRACTION) * sizeof(uint16_t);
+    for (uint8_t*& buffer : m_buffers) {
+        buffer = static_cast<uint8_t*>(heap_caps_malloc(m_bufferBytes, MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+        if (!buffer) {
+            return false;
+        }
+    }
+
+    lv_init();
+    lv_tick_set_cb(tick);
+
+    m_display = lv_display_create(width, height);
+    lv_display_set_user_data(m_display, this);
+    lv_display_set_flush_cb(m_display, flush);
+    lv_display_set_buffers(m_display, m_buffers[0], m_buffers[1], m_bufferBytes,
+                           LV_DISPLAY_RENDER_MODE_PARTIAL);
+
+    m_touchReader = reader;
+    m_touchContext = context;
+    m_touch = lv_indev_create();
+    lv_indev_set_type(m_touch, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_user_data(m_touch, this);
+    lv_indev_set_read_cb(m_touch, readTouch);
+
+#if UI_DMA
+    m_dma = m_tft.initDMA();
+#endif
+    return true;
+}
+
+void LvglPort::handle() {
+    lv_timer_handler();
+}
+
+void LvglPort::printMemoryUsage() {
+    lv_mem_monitor_t monitor;
+    lv_mem_monitor(&monitor);
+    Serial.printf("LVGL heap: %lu of %lu bytes used (peak %lu), %u%% fragmented; draw buffers 2x%lu bytes%s\n",
+                  (unsigned long)(monitor.total_size - monitor.free_size), (unsigned long)monitor.total_size,
+                  (unsigned long)monitor.max_used, monitor.frag_pct, (unsigned long)m_bufferBytes,
+                  m_dma ? ", DMA" : "");
+}
+
+uint32_t LvglPort::tick() {
+    return millis();
+}
+
+void LvglPort::flush(lv_display_t* display, const lv_area_t* area, uint8_t* pixels) {
+    LvglPort* port = static_cast<LvglPort*>(lv_display_get_user_data(display));
+    TFT_eSPI& tft = port->m_tft;
+    int32_t width = lv_area_get_width(area);
+    int32_t height = lv_area_get_height(area);
+
+    // LVGL renders RGB565 in CPU byte order; the panel takes it big-endian
+    lv_draw_sw_rgb565_swap(pixels, width * height);
+
+    // CS stays asserted from the first area of a refresh to the last
+    if (!port->m_writing) {
+        tft.startWrite();
+        port->m_writing = true;
+    }
+#if UI_DMA
+    if (port->m_dma) {
+        // Returns once queued. LVGL alternates buffers, and this waits for
+        // the previous area first, so the buffer LVGL draws into next is free.
+        tft.pushImageDMA(area->x1, area->y1, width, height, reinterpret_cast<uint16_t*>(pixels));
+    } else
+#endif
+    {
+        tft.pushImage(area->x1, area->y1, width, height, reinterpret_cast<uint16_t*>(pixels));
+    }
+
+    if (lv_display_flush_is_last(display)) {
+#if UI_DMA
+        if (port->m_dma) {
+            tft.dmaWait();
+        }
+#endif
+        tft.endWrite();
+        port->m_writing = false;
+        TOUCH_LATENCY_DRAWN();
+    }
+    lv_display_flush_ready(display);
+}
+
+void LvglPort::readTouch(lv_indev_t* indev, lv_indev_data_t* data) {
+    LvglPort* port = static_cast<LvglPort*>(lv_indev_get_user_data(indev));
+    int16_t x, y;
+    if (port->m_touchReader && port->m_touchReader(x, y, port->m_touchContext)) {
+        port->m_lastPoint.x = x;
+        port->m_lastPoint.y = y;
+        data->state = LV_INDEV_STATE_PRESSED;
+    } else {
+        data->state = LV_INDEV_STATE_RELEASED;
+    }
+    // A release is reported where the last touch was
+    data->point = port->m_lastPoint;
+}
+#endif
@@ -0,0 +1,292 @@
+#include "LvglScreens.h"
+
+#if UI_LVGL
+#include "CYD.h"
+
+// Fonts standing in for the TFT_eSPI ones: 2 (16px), 4 (26px) and 7 (48px)
+static const lv_font_t* const FONT_SMALL = &lv_font_montserrat_14;
+static const lv_font_t* const FONT_MEDIUM = &lv_font_montserrat_24;
+static const lv_font_t* const FONT_LARGE = &lv_font_montserrat_48;
+
+static lv_color_t toColor(uint16_t rgb565) {
+    return lv_color_make((rgb565 >> 8) & 0xF8, (rgb565 >> 3) & 0xFC, (rgb565 << 3) & 0xF8);
+}
+
+static lv_obj_t* createScreen() {
+    lv_obj_t* screen = lv_obj_create(nullptr);
+    lv_obj_set_style_bg_color(screen, toColor(UI_BACKGROUND), 0);
+    lv_obj_remove_flag(screen, LV_OBJ_FLAG_SCROLLABLE);
+    return screen;
+}
+
+// Transparent full-screen container; touches pass through to the screen
+static lv_obj_t* createPanel(lv_obj_t* parent) {
+    lv_obj_t* panel = lv_obj_create(parent);
+    lv_obj_remove_style_all(panel);
+    lv_obj_set_size(panel, LV_PCT(100), LV_PCT(100));
+    lv_obj_remove_flag(panel, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_remove_flag(panel, LV_OBJ_FLAG_SCROLLABLE);
+    return panel;
+}
+
+static lv_obj_t* createLabel(lv_obj_t* parent, const char* text, const lv_font_t* font, uint16_t color) {
+    lv_obj_t* label = lv_label_create(parent);
+    lv_label_set_text(label, text);
+    lv_obj_set_style_text_font(label, font, 0);
+    lv_obj_set_style_text_color(label, toColor(color), 0);
+    return label;
+}
+
+static lv_obj_t* createButton(lv_obj_t* parent, const ScreenRect& area, const char* text, uint16_t color) {
+    lv_obj_t* button = lv_button_create(parent);
+    lv_obj_set_pos(button, area.x, area.y);
+    lv_obj_set_size(button, area.w, area.h);
+    lv_obj_set_style_bg_color(button, toColor(color), 0);
+    lv_obj_set_style_radius(button, 5, 0);
+    lv_obj_center(createLabel(button, text, FONT_SMALL, TFT_BLACK));
+    return button;
+}
+
+// lv_label_set_text() invalidates the label even when the text is the same
+static void setText(lv_obj_t* label, const char* text) {
+    if (strcmp(lv_label_get_text(label), text) != 0) {
+        lv_label_set_text(label, text);
+    }
+}
+
+static void setPercent(lv_obj_t* label, int32_t value) {
+    char text[8];
+    snprintf(text, sizeof(text), "%ld%%", (long)value);
+    setText(label, text);
+}
+
+// Main screen
+
+LvglMainScreen::LvglMainScreen()
+    : m_screen(nullptr)
+    , m_time(nullptr)
+    , m_wifi(nullptr)
+    , m_temperature(nullptr)
+    , m_range(nullptr)
+    , m_sliders{nullptr, nullptr}
+    , m_sliderValues{nullptr, nullptr}
+    , m_wifiShown(false)
+    , m_temperatureColor(UI_ACCENT)
+    , m_onLighting(nullptr)
+    , m_onPomodoro(nullptr)
+    , m_context(nullptr) {
+}
+
+void LvglMainScreen::create(LightingHandler onLighting, PressHandler onPomodoro, void* context) {
+    m_onLighting = onLighting;
+    m_onPomodoro = onPomodoro;
+    m_context = context;
+    m_screen = createScreen();
+
+    // Header: title, clock and WiFi status
+    lv_obj_t* header = lv_obj_create(m_screen);
+    lv_obj_remove_style_all(header);
+    lv_obj_set_size(header, LV_PCT(100), HEADER_HEIGHT);
+    lv_obj_set_style_bg_color(header, toColor(UI_SECONDARY), 0);
+    lv_obj_set_style_bg_opa(header, LV_OPA_COVER, 0);
+    lv_obj_align(createLabel(header, "Smart Light Control", FONT_SMALL, UI_TEXT), LV_ALIGN_LEFT_MID, MARGIN, 0);
+    m_time = createLabel(header, "", FONT_SMALL, UI_TEXT);
+    lv_obj_align(m_time, LV_ALIGN_RIGHT_MID, -30, 0);
+    m_wifi = lv_obj_create(header);
+    lv_obj_remove_style_all(m_wifi);
+    lv_obj_set_size(m_wifi, 8, 8);
+    lv_obj_set_style_radius(m_wifi, LV_RADIUS_CIRCLE, 0);
+    lv_obj_set_style_bg_opa(m_wifi, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_color(m_wifi, toColor(TFT_RED), 0);
+    lv_obj_align(m_wifi, LV_ALIGN_RIGHT_MID, -11, 0);
+
+    m_sliders[0] = createSlider(45, "Brightness", UI_ACCENT, 0);
+    m_sliders[1] = createSlider(100, "Color Temperature", UI_SECONDARY, 1);
+
+    lv_obj_set_pos(createLabel(m_screen, "Temperature", FONT_SMALL, UI_SUBTEXT), SLIDER_X, 150);
+    m_temperature = createLabel(m_screen, "", FONT_MEDIUM, m_temperatureColor);
+    lv_obj_set_pos(m_temperature, SLIDER_X, 170);
+    m_range = createLabel(m_screen, "", FONT_SMALL, UI_SUBTEXT);
+    lv_obj_set_pos(m_range, SLIDER_X + 110, 176);
+
+    lv_obj_t* pomodoro = createButton(m_screen, ScreenRect{10, 190, 100, 40}, "Pomodoro", UI_ACCENT);
+    lv_obj_add_event_cb(pomodoro, pomodoroClicked, LV_EVENT_CLICKED, this);
+}
+
+lv_obj_t* LvglMainScreen::createSlider(int16_t y, const char* label, uint16_t color, uint8_t index) {
+    lv_obj_set_pos(createLabel(m_screen, label, FONT_SMALL, UI_SUBTEXT), SLIDER_X, y - 15);
+
+    lv_obj_t* slider = lv_slider_create(m_screen);
+    lv_obj_set_pos(slider, SLIDER_X, y);
+    lv_obj_set_size(slider, SLIDER_WIDTH, SLIDER_HEIGHT);
+    lv_slider_set_range(slider, 0, 100);
+    lv_obj_set_style_bg_color(slider, toColor(SLIDER_BG), LV_PART_MAIN);
+    lv_obj_set_style_bg_color(slider, toColor(color), LV_PART_INDICATOR);
+    lv_obj_set_style_bg_color(slider, toColor(UI_TEXT), LV_PART_KNOB);
+    lv_obj_add_event_cb(slider, sliderChanged, LV_EVENT_VALUE_CHANGED, this);
+
+    m_sliderValues[index] = createLabel(m_screen, "0%", FONT_SMALL, UI_TEXT);
+    lv_obj_set_pos(m_sliderValues[index], SLIDER_X + SLIDER_WIDTH + 10, y + SLIDER_HEIGHT/2 - 8);
+    return slider;
+}
+
+void LvglMainScreen::load() {
+    lv_screen_load(m_screen);
+}
+
+void LvglMainScreen::setTime(const String& time) {
+    setText(m_time, time.c_str());
+}
+
+void LvglMainScreen::setWiFi(bool connected) {
+    if (connected != m_wifiShown) {
+        lv_obj_set_style_bg_color(m_wifi, toColor(connected ? TFT_GREEN : TFT_RED), 0);
+        m_wifiShown = connected;
+    }
+}
+
+void LvglMainScreen::setTemperature(const String& text, uint16_t color) {
+    setText(m_temperature, text.c_str());
+    if (color != m_temperatureColor) {
+        lv_obj_set_style_text_color(m_temperature, toColor(color), 0);
+        m_temperatureColor = color;
+    }
+}
+
+void LvglMainScreen::setRange(const String& text) {
+    setText(m_range, text.c_str());
+}
+
+void LvglMainScreen::setLighting(uint8_t brightness, uint8_t colorTemp) {
+    uint8_t values[2] = {brightness, colorTemp};
+    for (uint8_t i = 0; i < 2; i++) {
+        if (lv_slider_get_value(m_sliders[i]) != values[i]) {
+            lv_slider_set_value(m_sliders[i], values[i], LV_ANIM_OFF);
+        }
+        setPercent(m_sliderValues[i], values[i]);
+    }
+}
+
+void LvglMainScreen::sliderChanged(lv_event_t* event) {
+    LvglMainScreen* screen = static_cast<LvglMainScreen*>(lv_event_get_user_data(event));
+    int32_t brightness = lv_slider_get_value(screen->m_sliders[0]);
+    int32_t colorTemp = lv_slider_get_value(screen->m_sliders[1]);
+    setPercent(screen->m_sliderValues[0], brightness);
+    setPercent(screen->m_sliderValues[1], colorTemp);
+    if (screen->m_onLighting) {
+        screen->m_onLighting(brightness, colorTemp, screen->m_context);
+    }
+}
+
+void LvglMainScreen::pomodoroClicked(lv_event_t* event) {
+    LvglMainScreen* screen = static_cast<LvglMainScreen*>(lv_event_get_user_data(event));
+    if (screen->m_onPomodoro) {
+        screen->m_onPomodoro(screen->m_context);
+    }
+}
+
+// Pomodoro screen
+
+LvglPomodoroScreen::LvglPomodoroScreen()
+    : m_screen(nullptr)
+    , m_setup(nullptr)
+    , m_timer(nullptr)
+    , m_workMinutes(nullptr)
+    , m_breakMinutes(nullptr)
+    , m_session(nullptr)
+    , m_time(nullptr)
+    , m_progress(nullptr)
+    , m_shownSession(-1)
+    , m_onAction(nullptr)
+    , m_context(nullptr) {
+}
+
+void LvglPomodoroScreen::create(ActionHandler onAction, void* context) {
+    m_onAction = onAction;
+    m_context = context;
+
+    // Touches outside the buttons land on the screen itself (ACTION_NONE)
+    m_screen = createScreen();
+    lv_obj_add_event_cb(m_screen, clicked, LV_EVENT_CLICKED, this);
+
+    m_setup = createPanel(m_screen);
+    lv_obj_align(createLabel(m_setup, "Pomodoro Timer", FONT_MEDIUM, TFT_WHITE), LV_ALIGN_TOP_MID, 0, 20);
+    m_workMinutes = createAdjustRow(70, "Work Time", PomodoroManager::ACTION_WORK_LESS,
+                                    PomodoroManager::ACTION_WORK_MORE);
+    m_breakMinutes = createAdjustRow(150, "Break Time", PomodoroManager::ACTION_BREAK_LESS,
+                                     PomodoroManager::ACTION_BREAK_MORE);
+    createActionButton(m_setup, ScreenRect{110, 190, 100, 40}, "START", TFT_GREEN, PomodoroManager::ACTION_START);
+    createActionButton(m_setup, ScreenRect{5, 5, 50, 30}, "X", TFT_RED, PomodoroManager::ACTION_EXIT);
+
+    m_timer = createPanel(m_screen);
+    m_session = createLabel(m_timer, "", FONT_MEDIUM, TFT_GREEN);
+    lv_obj_align(m_session, LV_ALIGN_TOP_MID, 0, 40);
+    m_time = createLabel(m_timer, "", FONT_LARGE, TFT_WHITE);
+    lv_obj_align(m_time, LV_ALIGN_TOP_MID, 0, 100);
+    m_progress = lv_bar_create(m_timer);
+    lv_obj_set_pos(m_progress, 40, 160);
+    lv_obj_set_size(m_progress, 240, 10);
+    lv_bar_set_range(m_progress, 0, 240);
+    lv_obj_set_style_bg_color(m_progress, toColor(TFT_DARKGREY), LV_PART_MAIN);
+    createActionButton(m_timer, ScreenRect{110, 190, 100, 40}, "STOP", TFT_RED, PomodoroManager::ACTION_STOP);
+    lv_obj_add_flag(m_timer, LV_OBJ_FLAG_HIDDEN);
+}
+
+lv_obj_t* LvglPomodoroScreen::createAdjustRow(int16_t y, const char* label, uint8_t lessAction,
+                                              uint8_t moreAction) {
+    lv_obj_align(createLabel(m_setup, label, FONT_SMALL, TFT_WHITE), LV_ALIGN_TOP_MID, 0, y - 20);
+    createActionButton(m_setup, ScreenRect{60, y, PomodoroManager::BUTTON_WIDTH, PomodoroManager::BUTTON_HEIGHT},
+                       "-", TFT_BLUE, lessAction);
+    createActionButton(m_setup, ScreenRect{200, y, PomodoroManager::BUTTON_WIDTH, PomodoroManager::BUTTON_HEIGHT},
+                       "+", TFT_BLUE, moreAction);
+
+    lv_obj_t* minutes = createLabel(m_setup, "", FONT_MEDIUM, TFT_WHITE);
+    lv_obj_align(minutes, LV_ALIGN_TOP_MID, 0, y + (PomodoroManager::BUTTON_HEIGHT - lv_font_get_line_height(FONT_MEDIUM)) / 2);
+    return minutes;
+}
+
+void LvglPomodoroScreen::createActionButton(lv_obj_t* parent, const ScreenRect& area, const char* label,
+                                            uint16_t color, uint8_t action) {
+    lv_obj_t* button = createButton(parent, area, label, color);
+    lv_obj_set_user_data(button, reinterpret_cast<void*>(static_cast<uintptr_t>(action)));
+    lv_obj_add_event_cb(button, clicked, LV_EVENT_CLICKED, this);
+}
+
+void LvglPomodoroScreen::load() {
+    lv_screen_load(m_screen);
+}
+
+void LvglPomodoroScreen::showSetup(uint16_t workMinutes, uint16_t breakMinutes) {
+    lv_obj_add_flag(m_timer, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(m_setup, LV_OBJ_FLAG_HIDDEN);
+    setText(m_workMinutes, String(workMinutes).c_str());
+    setText(m_breakMinutes, String(breakMinutes).c_str());
+}
+
+void LvglPomodoroScreen::showTimer(bool workTime, const String& time, int progress) {
+    lv_obj_add_flag(m_setup, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(m_timer, LV_OBJ_FLAG_HIDDEN);
+
+    if (m_shownSession != workTime) {
+        lv_color_t color = toColor(workTime ? TFT_GREEN : TFT_ORANGE);
+        lv_label_set_text(m_session, workTime ? "WORK TIME" : "BREAK TIME");
+        lv_obj_set_style_text_color(m_session, color, 0);
+        lv_obj_set_style_bg_color(m_progress, color, LV_PART_INDICATOR);
+        m_shownSession = workTime;
+    }
+    setText(m_time, time.c_str());
+    if (lv_bar_get_value(m_progress) != progress) {
+        // A new session resets the bar; ticks ease into place
+        lv_bar_set_value(m_progress, progress, progress > lv_bar_get_value(m_progress) ? LV_ANIM_OFF : LV_ANIM_ON);
+    }
+}
+
+void LvglPomodoroScreen::clicked(lv_event_t* event) {
+    LvglPomodoroScreen* screen = static_cast<LvglPomodoroScreen*>(lv_event_get_user_data(event));
+    lv_obj_t* target = static_cast<lv_obj_t*>(lv_event_get_current_target(event));
+    uint8_t action = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(lv_obj_get_user_data(target)));
+    if (screen->m_onAction) {
+        screen->m_onAction(action, screen->m_context);
+    }
+}
+#endif
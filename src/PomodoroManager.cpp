@@ -1,196 +1,318 @@
-#include "PomodoroManager.h"
-
-PomodoroManager::PomodoroManager(TFT_eSPI& tft, AudioManager& audio) 
-    : m_tft(tft)
-    , m_audio(audio)
-    , m_workMinutes(DEFAULT_WORK_MINUTES)
-    , m_breakMinutes(DEFAULT_BREAK_MINUTES)
-    , m_currentSeconds(0)
-    , m_isWorkTime(true)
-    , m_isRunning(false)
-    , m_isActive(true)
-    , m_isAlarmSounding(false)
-    , m_lastUpdate(0)
-    , m_lastAlarmTime(0) {
-}
-
-void PomodoroManager::drawButton(int x, int y, int w, int h, const char* label, uint16_t color) {
-    m_tft.fillRoundRect(x, y, w, h, 5, color);
-    m_tft.setTextColor(TFT_BLACK);
-    m_tft.setTextDatum(MC_DATUM);
-    m_tft.drawString(label, x + w/2, y + h/2, 2);
-}
-
-void PomodoroManager::begin() {
-    m_tft.fillScreen(TFT_BLACK);
-    drawInterface();
-}
-
-void PomodoroManager::drawInterface() {
-    m_tft.fillScreen(TFT_BLACK);
-    
-    if (m_isRunning) {
-        drawTimer(true);  // Full redraw
-        return;
-    }
-    
-    // Draw title
-    m_tft.setTextColor(TFT_WHITE);
-    m_tft.setTextDatum(TC_DATUM);
-    m_tft.drawString("Pomodoro Timer", 160, 20, 4);
-    
-    // Draw work time settings
-    drawTimeAdjustButtons(70, "Work Time", m_workMinutes);
-    
-    // Draw break time settings
-    drawTimeAdjustButtons(150, "Break Time", m_breakMinutes);
-    
-    // Draw start button
-    drawButton(110, 190, 100, 40, "START", TFT_GREEN);
-    
-    // Draw exit button
-    drawButton(5, 5, 50, 30, "X", TFT_RED);
-}
-
-void PomodoroManager::drawTimeAdjustButtons(int y, const char* label, int minutes) {
-    m_tft.setTextColor(TFT_WHITE);
-    m_tft.setTextDatum(TC_DATUM);
-    m_tft.drawString(label, 160, y - 20, 2);
-    
-    drawButton(60, y, BUTTON_WIDTH, BUTTON_HEIGHT, "-", TFT_BLUE);
-    
-    m_tft.setTextColor(TFT_WHITE);
-    m_tft.setTextDatum(MC_DATUM);
-    m_tft.drawString(String(minutes), 160, y + BUTTON_HEIGHT/2, 4);
-    
-    drawButton(200, y, BUTTON_WIDTH, BUTTON_HEIGHT, "+", TFT_BLUE);
-}
-
-String PomodoroManager::formatTime(int seconds) const {
-    int minutes = seconds / 60;
-    int secs = seconds % 60;
-    char buffer[6];
-    sprintf(buffer, "%02d:%02d", minutes, secs);
-    return String(buffer);
-}
-
-void PomodoroManager::drawTimer(bool fullRedraw = false) {
-    uint16_t sessionColor = m_isWorkTime ? TFT_GREEN : TFT_ORANGE;
-    
-    if (fullRedraw) {
-        m_tft.fillScreen(TFT_BLACK);
-        
-        // Draw session type
-        m_tft.setTextColor(sessionColor);
-        m_tft.setTextDatum(TC_DATUM);
-        m_tft.drawString(m_isWorkTime ? "WORK TIME" : "BREAK TIME", 160, 40, 4);
-        
-        // Draw stop button
-        drawButton(110, 190, 100, 40, "STOP", TFT_RED);
-    }
-    
-    // Clear only the time display area
-    m_tft.fillRect(40, 80, 240, 70, TFT_BLACK);
-    
-    // Draw time remaining
-    m_tft.setTextColor(TFT_WHITE);
-    m_tft.setTextFont(7);
-    m_tft.setTextDatum(TC_DATUM);
-    m_tft.drawString(formatTime(m_currentSeconds), 160, 100);
-    m_tft.setTextFont(2);
-    
-    // Update progress bar
-    int totalSeconds = m_isWorkTime ? m_workMinutes * 60 : m_breakMinutes * 60;
-    int barWidth = 240;
-    int barHeight = 10;
-    int progress = map(m_currentSeconds, 0, totalSeconds, 0, barWidth);
-    
-    // Draw background bar
-    m_tft.fillRoundRect(40, 160, barWidth, barHeight, barHeight/2, TFT_DARKGREY);
-    // Draw progress
-    if (progress > 0) {
-        m_tft.fillRoundRect(40, 160, progress, barHeight, barHeight/2, sessionColor);
-    }
-}
-
-void PomodoroManager::update() {
-    if (!m_isRunning) return;
-    
-    unsigned long currentTime = millis();
-    if (currentTime - m_lastUpdate >= 1000) {
-        if (m_currentSeconds > 0) {
-            m_currentSeconds--;
-            m_lastUpdate = currentTime;
-            drawTimer(false);  // Partial redraw
-        }
-        
-        if (m_currentSeconds <= 0 && !m_isAlarmSounding) {
-            m_isAlarmSounding = true;
-            m_audio.playFile("/beep.mp3");
-            m_lastAlarmTime = currentTime;  // Store the time when the alarm was triggered
-        }
-    }
-    
-    // Keep playing alarm if it's sounding
-    if (m_isAlarmSounding) {
-        // Check if enough time has passed since the last alarm
-        if (currentTime - m_lastAlarmTime >= 500) {  // 500 ms cooldown
-            m_audio.playFile("/beep.mp3");
-            m_lastAlarmTime = currentTime;  // Update the last alarm time
-        }
-        
-    }
-}
-
-void PomodoroManager::handleTouch(int16_t x, int16_t y) {
-    if (m_isAlarmSounding) {
-        // Stop alarm on any touch
-        m_audio.stop();
-        m_isAlarmSounding = false;
-        m_isWorkTime = !m_isWorkTime;
-        m_currentSeconds = (m_isWorkTime ? m_workMinutes : m_breakMinutes) * 60;
-        drawTimer(true);
-        return;
-    }
-    
-    if (m_isRunning) {
-        // Stop button
-        if (y >= 190 && y <= 230 && x >= 110 && x <= 210) {
-            m_isRunning = false;
-            drawInterface();
-        }
-        return;
-    }
-    
-    // Exit button
-    if (x < 55 && y < 35) {
-        m_isActive = false;
-        return;
-    }
-    
-    // Work time adjustment
-    if (y >= 70 && y <= 110) {
-        if (x >= 60 && x <= 120) m_workMinutes = max(5, m_workMinutes - 5);
-        if (x >= 200 && x <= 260) m_workMinutes = min(120, m_workMinutes + 5);
-        drawInterface();
-        return;
-    }
-    
-    // Break time adjustment
-    if (y >= 150 && y <= 190) {
-        if (x >= 60 && x <= 120) m_breakMinutes = max(5, m_breakMinutes - 5);
-        if (x >= 200 && x <= 260) m_breakMinutes = min(60, m_breakMinutes + 5);
-        drawInterface();
-        return;
-    }
-    
-    // Start button
-    if (y >= 190 && y <= 230 && x >= 110 && x <= 210) {
-        m_isRunning = true;
-        m_isWorkTime = true;
-        m_currentSeconds = m_workMinutes * 60;
-        m_lastUpdate = millis();
-        m_isAlarmSounding = false;
-        drawTimer(true);
-    }
-}
\ No newline at end of file
+#include "PomodoroManager.h"
+
+// Settings keys
+static const char* const KEY_WORK_MINUTES = "pomo.work";
+static const char* const KEY_BREAK_MINUTES = "pomo.break";
+
+// Screen layout
+static const ScreenRect EXIT_BUTTON_AREA = {5, 5, 50, 30};
+static const ScreenRect TITLE_AREA = {0, 20, 320, 50};
+static const ScreenRect BOTTOM_BUTTON_AREA = {110, 190, 100, 40};
+static const ScreenRect TIME_AREA = {40, 80, 240, 70};
+static const ScreenRect PROGRESS_AREA = {40, 160, 240, 10};
+static constexpr int WORK_ROW_Y = 70;
+static constexpr int BREAK_ROW_Y = 150;
+static constexpr int TIME_TEXT_Y = 100;
+
+static ScreenRect rowTitleArea(int y) {
+    return ScreenRect{60, (int16_t)(y - 20), 200, 16};
+}
+
+static ScreenRect adjustButtonArea(int x, int y) {
+    return ScreenRect{(int16_t)x, (int16_t)y, PomodoroManager::BUTTON_WIDTH, PomodoroManager::BUTTON_HEIGHT};
+}
+
+// Between the - and + buttons of a row
+static ScreenRect minutesArea(int y) {
+    return ScreenRect{120, (int16_t)y, 80, PomodoroManager::BUTTON_HEIGHT};
+}
+
+PomodoroManager::PomodoroManager(TFT_eSPI& tft, BandCompositor& compositor, ScreenCache& screenCache,
+                                 AudioManager& audio, FlashKVStore& settings)
+    : m_tft(tft)
+    , m_audio(audio)
+    , m_settings(settings)
+    , m_screenCache(screenCache)
+    , m_workMinutes(settings.getUInt(KEY_WORK_MINUTES, DEFAULT_WORK_MINUTES))
+    , m_breakMinutes(settings.getUInt(KEY_BREAK_MINUTES, DEFAULT_BREAK_MINUTES))
+    , m_currentSeconds(0)
+    , m_isWorkTime(true)
+    , m_isRunning(false)
+    , m_isActive(true)
+    , m_isAlarmSounding(false)
+    , m_lastUpdate(0)
+    , m_lastAlarmTime(0)
+    , m_setupWidgets(tft)
+    , m_setupTitle(TITLE_AREA, 160, 20, TC_DATUM, 4, TFT_WHITE, "Pomodoro Timer")
+    , m_workTitle(rowTitleArea(WORK_ROW_Y), 160, WORK_ROW_Y - 20, TC_DATUM, 2, TFT_WHITE, "Work Time")
+    , m_workLess(adjustButtonArea(60, WORK_ROW_Y), "-", TFT_BLUE, ACTION_WORK_LESS)
+    , m_workLabel(minutesArea(WORK_ROW_Y), 160, WORK_ROW_Y + BUTTON_HEIGHT/2 - tft.fontHeight(4)/2, TC_DATUM, 4,
+                  TFT_WHITE, String(m_workMinutes))
+    , m_workMore(adjustButtonArea(200, WORK_ROW_Y), "+", TFT_BLUE, ACTION_WORK_MORE)
+    , m_breakTitle(rowTitleArea(BREAK_ROW_Y), 160, BREAK_ROW_Y - 20, TC_DATUM, 2, TFT_WHITE, "Break Time")
+    , m_breakLess(adjustButtonArea(60, BREAK_ROW_Y), "-", TFT_BLUE, ACTION_BREAK_LESS)
+    , m_breakLabel(minutesArea(BREAK_ROW_Y), 160, BREAK_ROW_Y + BUTTON_HEIGHT/2 - tft.fontHeight(4)/2, TC_DATUM, 4,
+                   TFT_WHITE, String(m_breakMinutes))
+    , m_breakMore(adjustButtonArea(200, BREAK_ROW_Y), "+", TFT_BLUE, ACTION_BREAK_MORE)
+    , m_startButton(BOTTOM_BUTTON_AREA, "START", TFT_GREEN, ACTION_START)
+    , m_exitButton(EXIT_BUTTON_AREA, "X", TFT_RED, ACTION_EXIT)
+    , m_timerWidgets(tft)
+    , m_sessionTitle(TITLE_AREA, 160, 40, TC_DATUM, 4, TFT_GREEN, "WORK TIME")
+    , m_stopButton(BOTTOM_BUTTON_AREA, "STOP", TFT_RED, ACTION_STOP)
+    , m_progressBar(PROGRESS_AREA, TFT_DARKGREY, TFT_GREEN)
+    , m_timeGlyphs(7, TFT_WHITE, TFT_BLACK)
+    , m_timeClock(m_timeGlyphs, 160, TIME_TEXT_Y, TC_DATUM) {
+    m_damage.setScreenSize(tft.width(), tft.height());
+    m_damage.setCompositor(&compositor);
+    
+    Widget* setup[] = {&m_setupTitle, &m_workTitle, &m_workLess, &m_workLabel, &m_workMore, &m_breakTitle,
+                       &m_breakLess, &m_breakLabel, &m_breakMore, &m_startButton, &m_exitButton};
+    for (Widget* widget : setup) {
+        m_setupWidgets.add(*widget);
+    }
+    // The whole top-left corner exits
+    m_exitButton.setHitArea(ScreenRect{0, 0, 55, 35});
+    // Drawn over the cached screens
+    m_workLabel.setStatic(false);
+    m_breakLabel.setStatic(false);
+    m_sessionTitle.setStatic(false);
+    
+    m_timerWidgets.add(m_sessionTitle);
+    m_timerWidgets.add(m_stopButton);
+    m_timerWidgets.add(m_progressBar);
+#if UI_LVGL
+    m_screen.create(onScreenAction, this);
+#endif
+}
+
+#if UI_LVGL
+void PomodoroManager::onScreenAction(uint8_t action, void* context) {
+    static_cast<PomodoroManager*>(context)->handleAction(static_cast<Action>(action));
+}
+#endif
+
+void PomodoroManager::begin() {
+    m_isActive = true;
+#if UI_LVGL
+    m_screen.load();
+#endif
+    drawInterface();
+}
+
+void PomodoroManager::drawInterface() {
+    if (m_isRunning) {
+        drawTimer(true);  // Full redraw
+        return;
+    }
+    
+#if UI_LVGL
+    m_screen.showSetup(m_workMinutes, m_breakMinutes);
+#else
+    captureScreen();
+    m_damage.addScreen();
+    flushDamage();
+#endif
+}
+
+void PomodoroManager::captureScreen() {
+    // Rendered into the screen cache on the first visit; from then on every
+    // repaint starts from the cached static layer
+    m_screenCache.capture(currentScreen(), [this](TFT_eSPI& gfx, const ScreenRect& clip) {
+        drawLayers(gfx, clip, LAYER_STATIC);
+    });
+}
+
+void PomodoroManager::flushDamage() {
+    activeWidgets().collectDamage(m_damage);
+    m_damage.flush(m_tft, [this](TFT_eSPI& gfx, const ScreenRect& clip) { drawScene(gfx, clip); });
+}
+
+void PomodoroManager::drawScene(TFT_eSPI& gfx, const ScreenRect& clip) {
+    // Once the static layer is cached, only what changes is drawn over it
+    if (m_screenCache.draw(currentScreen(), gfx, clip)) {
+        drawLayers(gfx, clip, LAYER_OVERLAY);
+    } else {
+        drawLayers(gfx, clip, LAYER_ALL);
+    }
+}
+
+void PomodoroManager::drawLayers(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers) {
+    if (layers & LAYER_STATIC) {
+        UI_PROFILE_SCOPE(SECTION_BACKGROUND);
+        gfx.fillRect(clip.x, clip.y, clip.w, clip.h, TFT_BLACK);
+    }
+    
+    if (m_isRunning) {
+        drawTimerScene(gfx, clip, layers);
+    } else {
+        UI_PROFILE_SCOPE(SECTION_POMODORO_SETUP);
+        m_setupWidgets.draw(gfx, clip, layers);
+    }
+}
+
+void PomodoroManager::saveDurations() {
+    m_settings.putUInt(KEY_WORK_MINUTES, m_workMinutes);
+    m_settings.putUInt(KEY_BREAK_MINUTES, m_breakMinutes);
+}
+
+String PomodoroManager::formatTime(int seconds) const {
+    int minutes = seconds / 60;
+    int secs = seconds % 60;
+    char buffer[6];
+    sprintf(buffer, "%02d:%02d", minutes, secs);
+    return String(buffer);
+}
+
+int PomodoroManager::progressWidth() const {
+    int totalSeconds = m_isWorkTime ? m_workMinutes * 60 : m_breakMinutes * 60;
+    return map(m_currentSeconds, 0, totalSeconds, 0, PROGRESS_AREA.w);
+}
+
+void PomodoroManager::drawTimer(bool fullRedraw = false) {
+    String timeStr = formatTime(m_currentSeconds);
+    int progress = progressWidth();
+    
+#if UI_LVGL
+    m_screen.showTimer(m_isWorkTime, timeStr, progress);
+#else
+    uint16_t sessionColor = m_isWorkTime ? TFT_GREEN : TFT_ORANGE;
+    m_sessionTitle.setText(m_isWorkTime ? "WORK TIME" : "BREAK TIME");
+    m_sessionTitle.setColor(sessionColor);
+    m_progressBar.setFillColor(sessionColor);
+    m_progressBar.setFillWidth(progress);
+    
+    if (fullRedraw) {
+        captureScreen();
+        m_damage.addScreen();
+        m_timeClock.reset(timeStr);
+    } else {
+        // A tick changes one or two digits, pushed straight from the glyph
+        // atlas, and moves the bar's end a pixel every few seconds; the old
+        // code cleared the whole time area and redrew the bar
+        if (!m_timeClock.update(m_tft, timeStr)) {
+            m_damage.add(DamageTracker::textChange(m_tft, m_shownTime, timeStr, 160, TIME_TEXT_Y, TC_DATUM, 7),
+                         TIME_AREA);
+            m_timeClock.reset(timeStr);
+        }
+    }
+#endif
+    
+    m_shownTime = timeStr;
+#if !UI_LVGL
+    flushDamage();
+#endif
+}
+
+void PomodoroManager::drawTimerScene(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers) {
+    UI_PROFILE_SCOPE(SECTION_POMODORO_TIMER);
+    // Session title, stop button and progress bar
+    m_timerWidgets.draw(gfx, clip, layers);
+    
+    // Draw time remaining
+    if ((layers & LAYER_OVERLAY) && clip.intersects(TIME_AREA)) {
+        gfx.setTextColor(TFT_WHITE);
+        gfx.setTextFont(7);
+        gfx.setTextDatum(TC_DATUM);
+        gfx.drawString(m_shownTime, 160, TIME_TEXT_Y);
+        gfx.setTextFont(2);
+    }
+}
+
+void PomodoroManager::showMinutes(Label& label, uint16_t minutes) {
+    // Only the digits that change are repainted; the old code redrew the
+    // whole screen
+    label.setText(String(minutes));
+#if UI_LVGL
+    m_screen.showSetup(m_workMinutes, m_breakMinutes);
+#else
+    flushDamage();
+#endif
+}
+
+void PomodoroManager::update() {
+    if (!m_isRunning) return;
+    
+    unsigned long currentTime = millis();
+    if (currentTime - m_lastUpdate >= 1000) {
+        if (m_currentSeconds > 0) {
+            m_currentSeconds--;
+            m_lastUpdate = currentTime;
+            drawTimer(false);  // Partial redraw
+        }
+        
+        if (m_currentSeconds <= 0 && !m_isAlarmSounding) {
+            m_isAlarmSounding = true;
+            m_audio.playFile("/beep.mp3");
+            m_lastAlarmTime = currentTime;  // Store the time when the alarm was triggered
+        }
+    }
+    
+    // Keep playing alarm if it's sounding
+    if (m_isAlarmSounding) {
+        // Check if enough time has passed since the last alarm
+        if (currentTime - m_lastAlarmTime >= 500) {  // 500 ms cooldown
+            m_audio.playFile("/beep.mp3");
+            m_lastAlarmTime = currentTime;  // Update the last alarm time
+        }
+        
+    }
+}
+
+PomodoroManager::Action PomodoroManager::actionAt(int16_t x, int16_t y) {
+    // While the timer runs only the stop button is there
+    Widget* target = activeWidgets().hitTest(x, y);
+    return target ? static_cast<Action>(target->tag()) : ACTION_NONE;
+}
+
+void PomodoroManager::handleTouch(int16_t x, int16_t y) {
+    handleAction(actionAt(x, y));
+}
+
+void PomodoroManager::handleAction(Action action) {
+    if (m_isAlarmSounding) {
+        // Stop alarm on any touch
+        m_audio.stop();
+        m_isAlarmSounding = false;
+        m_isWorkTime = !m_isWorkTime;
+        m_currentSeconds = (m_isWorkTime ? m_workMinutes : m_breakMinutes) * 60;
+        drawTimer(true);
+        return;
+    }
+    
+    switch (action) {
+        case ACTION_EXIT:
+            m_isActive = false;
+            break;
+        
+        case ACTION_WORK_LESS:
+        case ACTION_WORK_MORE:
+            m_workMinutes = action == ACTION_WORK_LESS ? max(5, m_workMinutes - 5) : min(120, m_workMinutes + 5);
+            saveDurations();
+            showMinutes(m_workLabel, m_workMinutes);
+            break;
+        
+        case ACTION_BREAK_LESS:
+        case ACTION_BREAK_MORE:
+            m_breakMinutes = action == ACTION_BREAK_LESS ? max(5, m_breakMinutes - 5) : min(60, m_breakMinutes + 5);
+            saveDurations();
+            showMinutes(m_breakLabel, m_breakMinutes);
+            break;
+        
+        case ACTION_START:
+            m_isRunning = true;
+            m_isWorkTime = true;
+            m_currentSeconds = m_workMinutes * 60;
+            m_lastUpdate = millis();
+            m_isAlarmSounding = false;
+            drawTimer(true);
+            break;
+        
+        case ACTION_STOP:
+            m_isRunning = false;
+            drawInterface();
+            break;
+        
+        case ACTION_NONE:
+            break;
+    }
+}
@@ -0,0 +1,127 @@
+#include "ScreenCache.h"
+
+ScreenCache::ScreenCache(TFT_eSPI& tft, BandCompositor& compositor)
+    : m_tft(tft)
+    , m_compositor(compositor)
+    , m_entries{} {
+}
+
+ScreenCache::~ScreenCache() {
+    for (Entry& entry : m_entries) {
+        free(entry.rows);
+    }
+}
+
+bool ScreenCache::draw(Screen screen, TFT_eSPI& gfx, const ScreenRect& clip) const {
+    const Entry& entry = m_entries[screen];
+    if (!entry.runs) return false;
+
+    ScreenRect area = clip.intersected(ScreenRect{0, 0, (int16_t)m_tft.width(), (int16_t)m_tft.height()});
+    uint16_t row[MAX_WIDTH];
+    for (int16_t y = area.y; y < area.bottom(); y++) {
+        // Runs up to the clip's right edge; the last may reach past it
+        const uint16_t* run = entry.runs + entry.rows[y];
+        for (int16_t x = 0; x < area.right();) {
+            uint16_t header = *run++;
+            uint16_t length = header & MAX_RUN;
+            if (header & LITERAL) {
+                memcpy(row + x, run, length * sizeof(uint16_t));
+                run += length;
+            } else {
+                uint16_t color = *run++;
+                for (uint16_t i = 0; i < length; i++) {
+                    row[x + i] = color;
+                }
+            }
+            x += length;
+        }
+        // Already in the panel's byte order, as sprites keep it
+        gfx.pushImage(area.x, y, area.w, 1, row + area.x);
+    }
+    return true;
+}
+
+uint32_t ScreenCache::memoryUsage() const {
+    uint32_t bytes = 0;
+    for (const Entry& entry : m_entries) {
+        bytes += entry.bytes;
+    }
+    return bytes;
+}
+
+// Encoder implementation
+ScreenCache::Encoder::Encoder(uint16_t* rows, uint16_t* runs)
+    : m_rows(rows)
+    , m_runs(runs)
+    , m_words(0)
+    , m_repeatColor(0)
+    , m_repeatLength(0)
+    , m_literalHeader(0)
+    , m_literalLength(0) {
+}
+
+void ScreenCache::Encoder::addBand(const uint16_t* pixels, int16_t stride, const ScreenRect& slice) {
+    for (int16_t row = 0; row < slice.h; row++) {
+        if (m_rows) {
+            m_rows[slice.y + row] = m_words;
+        }
+        const uint16_t* line = pixels + (uint32_t)row * stride;
+        for (int16_t col = 0; col < slice.w; col++) {
+            add(line[col]);
+        }
+        endRow();
+    }
+}
+
+void ScreenCache::Encoder::add(uint16_t pixel) {
+    if (m_repeatLength > 0 && pixel == m_repeatColor) {
+        m_repeatLength++;
+        return;
+    }
+    endRepeat();
+    m_repeatColor = pixel;
+    m_repeatLength = 1;
+}
+
+void ScreenCache::Encoder::endRow() {
+    endRepeat();
+    endLiteral();
+}
+
+void ScreenCache::Encoder::endRepeat() {
+    if (m_repeatLength >= MIN_REPEAT) {
+        endLiteral();
+        emit(m_repeatLength);
+        emit(m_repeatColor);
+    } else {
+        for (uint16_t i = 0; i < m_repeatLength; i++) {
+            addLiteral(m_repeatColor);
+        }
+    }
+    m_repeatLength = 0;
+}
+
+void ScreenCache::Encoder::addLiteral(uint16_t pixel) {
+    if (m_literalLength == 0) {
+        // Header written once the length is known
+        m_literalHeader = m_words;
+        emit(0);
+    }
+    emit(pixel);
+    m_literalLength++;
+}
+
+void ScreenCache::Encoder::endLiteral() {
+    if (m_literalLength == 0) return;
+    if (m_runs) {
+        m_runs[m_literalHeader] = LITERAL | m_literalLength;
+    }
+    m_literalLength = 0;
+}
+
+void ScreenCache::Encoder::emit(uint16_t word) {
+    if (m_runs) {
+        m_runs[m_words] = word;
+    }
+    m_words++;
+}
@@ -0,0 +1,470 @@
+#include "TemperatureLog.h"
+#include "Crc32.h"
+
+namespace {
+
+constexpr uint16_t BLOCK_MAGIC = 0x4C54;   // "TL"
+
+struct __attribute__((packed)) BlockHeader {
+    uint16_t magic;
+    uint16_t count;
+    uint32_t sequence;
+    uint32_t firstTime;
+    uint32_t lastTime;
+    int16_t firstValue;
+    int16_t minValue;
+    int16_t maxValue;
+    uint16_t payloadLength;
+    int32_t sum;
+    uint32_t crc;           // over the header up to here and the payload
+};
+
+constexpr uint16_t PAYLOAD_SIZE = FLASH_PAGE_SIZE - sizeof(BlockHeader);
+
+static_assert(sizeof(BlockHeader) == 32, "Block header layout changed");
+
+uint32_t blockCrc(const uint8_t* block) {
+    const BlockHeader* header = reinterpret_cast<const BlockHeader*>(block);
+    uint32_t crc = crc32Update(block, offsetof(BlockHeader, crc));
+    return crc32Update(block + sizeof(BlockHeader), min<uint16_t>(header->payloadLength, PAYLOAD_SIZE), crc);
+}
+
+// Checks a header against itself, for summing it without reading the
+// block's payload and CRC. Every sample after the first takes a byte or more.
+bool headerConsistent(const BlockHeader& header) {
+    return header.count > 0 && header.payloadLength <= PAYLOAD_SIZE &&
+           header.count <= header.payloadLength + 1u &&
+           header.firstTime <= header.lastTime &&
+           header.minValue <= header.firstValue && header.firstValue <= header.maxValue &&
+           header.sum >= (int32_t)header.minValue * header.count &&
+           header.sum <= (int32_t)header.maxValue * header.count;
+}
+
+// Each sample after the first is varint(zigzag(value delta) << 1 | flag),
+// followed by varint(time delta) only if the flag says the sampling period
+// changed. At a steady rate and small changes that is one byte per sample.
+uint8_t putVarint(uint8_t* out, uint32_t value) {
+    uint8_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+bool getVarint(const uint8_t* data, uint16_t length, uint16_t& position, uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35 && position < length; shift += 7) {
+        uint8_t byte = data[position++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Small deltas of either sign encode into a single byte
+uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Calls emit(sample) for every sample in the block until it returns false
+template <typename Fn>
+bool decodeBlock(const uint8_t* block, Fn emit) {
+    const BlockHeader* header = reinterpret_cast<const BlockHeader*>(block);
+    const uint8_t* payload = block + sizeof(BlockHeader);
+    uint16_t length = min<uint16_t>(header->payloadLength, PAYLOAD_SIZE);
+    uint16_t position = 0;
+
+    TemperatureLog::Sample sample = {header->firstTime, header->firstValue};
+    uint32_t timeDelta = 0;
+    for (uint16_t i = 0; i < header->count; i++) {
+        if (i > 0) {
+            uint32_t code;
+            if (!getVarint(payload, length, position, code)) return false;
+            if ((code & 1) && !getVarint(payload, length, position, timeDelta)) return false;
+            sample.time += timeDelta;
+            sample.deciCelsius += unzigzag(code >> 1);
+        }
+        if (!emit(sample)) break;
+    }
+    return true;
+}
+
+}
+
+TemperatureLog::TemperatureLog(Flash25Q128JV& flash, uint32_t baseAddress, uint16_t sectorCount)
+    : m_flash(flash)
+    , m_queue(nullptr)
+    , m_baseAddress(baseAddress)
+    , m_sectorCount(constrain(sectorCount, 2, MAX_SECTORS))
+    , m_ready(false)
+    , m_headSector(0)
+    , m_headPage(0)
+    , m_nextSequence(1)
+    , m_blockLastValue(0)
+    , m_blockTimeDelta(0)
+    , m_eraseHandle(-1)
+    , m_writeHandle(-1)
+    , m_recentStart(0)
+    , m_recentCount(0)
+    , m_lastTime(0)
+    , m_stats() {
+    memset(m_index, 0, sizeof(m_index));
+    memset(m_block, 0xFF, sizeof(m_block));
+}
+
+uint32_t TemperatureLog::pageAddress(uint16_t sector, uint8_t page) const {
+    return m_baseAddress + (uint32_t)sector * FLASH_SECTOR_SIZE + (uint32_t)page * FLASH_PAGE_SIZE;
+}
+
+bool TemperatureLog::begin() {
+    finishWrite();
+    BlockHeader header;
+    uint32_t newestSequence = 0;
+
+    // The first block of each sector gives the sector's place in the ring
+    for (uint16_t sector = 0; sector < m_sectorCount; sector++) {
+        if (!m_flash.read(pageAddress(sector, 0), reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+            return false;
+        }
+        if (header.magic != BLOCK_MAGIC || header.sequence == 0) {
+            m_index[sector] = SectorIndex{0, 0};
+            continue;
+        }
+        m_index[sector] = SectorIndex{header.sequence, header.firstTime};
+        if (header.sequence > newestSequence) {
+            newestSequence = header.sequence;
+            m_headSector = sector;
+        }
+    }
+
+    // Continue after the last programmed page of the newest sector
+    m_headPage = 0;
+    m_nextSequence = newestSequence + 1;
+    if (newestSequence > 0) {
+        for (uint8_t page = 0; page < PAGES_PER_SECTOR; page++) {
+            if (!m_flash.read(pageAddress(m_headSector, page), reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+                return false;
+            }
+            if (header.magic == 0xFFFF && header.sequence == 0xFFFFFFFF) {
+                break;
+            }
+            m_headPage = page + 1;
+            if (header.magic == BLOCK_MAGIC) {
+                m_nextSequence = max(m_nextSequence, header.sequence + 1);
+                m_lastTime = max(m_lastTime, header.lastTime);
+            } else {
+                m_stats.corruptBlocks++;
+            }
+        }
+    }
+
+    m_ready = true;
+    return true;
+}
+
+uint16_t TemperatureLog::oldestSector() const {
+    // Sectors are filled in ring order, so the oldest follows the head
+    for (uint16_t n = 1; n <= m_sectorCount; n++) {
+        uint16_t sector = (m_headSector + n) % m_sectorCount;
+        if (m_index[sector].sequence != 0) return sector;
+    }
+    return m_headSector;
+}
+
+uint32_t TemperatureLog::oldestTime() const {
+    if (m_ready && m_index[oldestSector()].sequence != 0) {
+        return m_index[oldestSector()].firstTime;
+    }
+    if (!blockEmpty()) {
+        return reinterpret_cast<const BlockHeader*>(m_block)->firstTime;
+    }
+    return m_recentCount > 0 ? m_recent[m_recentStart].time : 0;
+}
+
+bool TemperatureLog::blockEmpty() const {
+    return reinterpret_cast<const BlockHeader*>(m_block)->magic != BLOCK_MAGIC;
+}
+
+void TemperatureLog::startBlock(uint32_t time, int16_t value) {
+    memset(m_block, 0xFF, sizeof(m_block));
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(m_block);
+    header->magic = BLOCK_MAGIC;
+    header->count = 1;
+    header->firstTime = time;
+    header->lastTime = time;
+    header->firstValue = value;
+    header->minValue = value;
+    header->maxValue = value;
+    header->payloadLength = 0;
+    header->sum = value;
+    m_blockLastValue = value;
+    m_blockTimeDelta = 0;
+}
+
+bool TemperatureLog::appendToBlock(uint32_t time, int16_t value) {
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(m_block);
+    uint32_t timeDelta = time - header->lastTime;
+    bool periodChanged = timeDelta != m_blockTimeDelta;
+    uint8_t encoded[10];
+    uint8_t length = putVarint(encoded, zigzag(value - m_blockLastValue) << 1 | periodChanged);
+    if (periodChanged) {
+        length += putVarint(encoded + length, timeDelta);
+    }
+
+    if (header->payloadLength + length > PAYLOAD_SIZE) {
+        return false;
+    }
+
+    memcpy(m_block + sizeof(BlockHeader) + header->payloadLength, encoded, length);
+    header->payloadLength += length;
+    header->count++;
+    header->lastTime = time;
+    header->minValue = min(header->minValue, value);
+    header->maxValue = max(header->maxValue, value);
+    header->sum += value;
+    m_blockLastValue = value;
+    m_blockTimeDelta = timeDelta;
+    return true;
+}
+
+bool TemperatureLog::prepareSector(uint16_t sector) {
+    // Reusing a sector drops the oldest block run in the ring
+    m_index[sector] = SectorIndex{0, 0};
+    uint32_t address = pageAddress(sector, 0);
+    if (m_flash.isBlank(address, FLASH_SECTOR_SIZE)) {
+        return true;
+    }
+    m_stats.sectorErases++;
+    // Queued ahead of the block's program, so the worker erases first
+    if (m_queue) {
+        m_eraseHandle = m_queue->submitEraseSector(address);
+    }
+    return m_eraseHandle >= 0 || m_flash.eraseSector(address);
+}
+
+bool TemperatureLog::writeBlock() {
+    if (!m_ready || blockEmpty()) {
+        return false;
+    }
+
+    // The previous block's buffer is about to be reused
+    finishWrite();
+
+    if (m_headPage >= PAGES_PER_SECTOR) {
+        m_headSector = (m_headSector + 1) % m_sectorCount;
+        m_headPage = 0;
+    }
+    if (m_headPage == 0 && !prepareSector(m_headSector)) {
+        return false;
+    }
+
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(m_block);
+    header->sequence = m_nextSequence++;
+    header->crc = blockCrc(m_block);
+
+    // The page is consumed even if the program fails half way
+    uint8_t page = m_headPage++;
+    uint32_t address = pageAddress(m_headSector, page);
+    if (m_queue) {
+        memcpy(m_writing, m_block, sizeof(m_writing));
+        m_writeHandle = m_queue->submitProgram(address, m_writing, sizeof(m_writing));
+    }
+    if (m_writeHandle < 0 && !m_flash.write(address, m_block, FLASH_PAGE_SIZE)) {
+        return false;
+    }
+    if (page == 0) {
+        m_index[m_headSector] = SectorIndex{header->sequence, header->firstTime};
+    }
+    m_stats.blocksWritten++;
+    return true;
+}
+
+// Waits for the requests writeBlock() queued; true if they all succeeded
+bool TemperatureLog::finishWrite() {
+    bool ok = true;
+    if (m_eraseHandle >= 0) {
+        ok = m_queue->wait(m_eraseHandle) == FLASH_REQ_DONE;
+        m_eraseHandle = -1;
+    }
+    if (m_writeHandle >= 0) {
+        ok = m_queue->wait(m_writeHandle) == FLASH_REQ_DONE && ok;
+        m_writeHandle = -1;
+    }
+    if (!ok) {
+        Serial.println(F("Temperature log: block write failed"));
+    }
+    return ok;
+}
+
+void TemperatureLog::add(uint32_t time, float celsius) {
+    int16_t value = (int16_t)lroundf(celsius * 10);
+    time = max(time, m_lastTime);
+    m_lastTime = time;
+    m_stats.samples++;
+
+    uint16_t slot = (m_recentStart + m_recentCount) % RAM_SAMPLES;
+    m_recent[slot] = Sample{time, value};
+    if (m_recentCount < RAM_SAMPLES) {
+        m_recentCount++;
+    } else {
+        m_recentStart = (m_recentStart + 1) % RAM_SAMPLES;
+    }
+
+    if (!m_ready) {
+        return;
+    }
+
+    if (blockEmpty()) {
+        startBlock(time, value);
+    } else if (!appendToBlock(time, value)) {
+        if (!writeBlock()) {
+            Serial.println(F("Temperature log: block write failed"));
+        }
+        startBlock(time, value);
+    }
+}
+
+bool TemperatureLog::flush() {
+    if (blockEmpty()) {
+        return finishWrite();
+    }
+
+    bool ok = writeBlock() && finishWrite();
+    memset(m_block, 0xFF, sizeof(m_block));
+    return ok;
+}
+
+uint16_t TemperatureLog::recent(Sample* samples, uint16_t maxCount) const {
+    uint16_t count = min(maxCount, m_recentCount);
+    uint16_t skip = m_recentCount - count;
+    for (uint16_t i = 0; i < count; i++) {
+        samples[i] = m_recent[(m_recentStart + skip + i) % RAM_SAMPLES];
+    }
+    return count;
+}
+
+// Calls fn(header, address) for every block that may hold samples in
+// [from, to], oldest first, until it returns false. The address is 0 for
+// the block still being filled in RAM.
+template <typename Fn>
+void TemperatureLog::forEachBlock(uint32_t from, uint32_t to, Fn fn) {
+    if (m_ready) {
+        // The index already counts the block the queue may still be writing
+        finishWrite();
+        BlockHeader header;
+        uint16_t sector = oldestSector();
+        for (uint16_t n = 0; n < m_sectorCount; n++, sector = (sector + 1) % m_sectorCount) {
+            if (m_index[sector].sequence == 0) continue;
+            if (m_index[sector].firstTime > to) break;
+
+            // A sector ends where the next one in the ring starts
+            uint16_t next = (sector + 1) % m_sectorCount;
+            if (sector != m_headSector && m_index[next].sequence != 0 && m_index[next].firstTime < from) {
+                continue;
+            }
+
+            uint8_t pages = sector == m_headSector ? m_headPage : PAGES_PER_SECTOR;
+            for (uint8_t page = 0; page < pages; page++) {
+                uint32_t address = pageAddress(sector, page);
+                if (!m_flash.read(address, reinterpret_cast<uint8_t*>(&header), sizeof(header))) return;
+                m_stats.headersRead++;
+                if (header.magic != BLOCK_MAGIC || header.lastTime < from) continue;
+                if (header.firstTime > to) return;
+                if (!fn(header, address)) return;
+            }
+            if (sector == m_headSector) break;
+        }
+    }
+
+    const BlockHeader* pending = reinterpret_cast<const BlockHeader*>(m_block);
+    if (!blockEmpty() && pending->lastTime >= from && pending->firstTime <= to) {
+        fn(*pending, 0);
+    }
+}
+
+uint32_t TemperatureLog::query(uint32_t from, uint32_t to, SampleVisitor visitor, void* context) {
+    uint32_t visited = 0;
+    bool stopped = false;
+    uint8_t buffer[FLASH_PAGE_SIZE];
+
+    forEachBlock(from, to, [&](const BlockHeader&, uint32_t address) {
+        const uint8_t* block = m_block;
+        if (address != 0) {
+            if (!m_flash.read(address, buffer, sizeof(buffer))) return false;
+            m_stats.blocksDecoded++;
+            if (blockCrc(buffer) != reinterpret_cast<const BlockHeader*>(buffer)->crc) {
+                m_stats.corruptBlocks++;
+                return true;
+            }
+            block = buffer;
+        }
+
+        decodeBlock(block, [&](const Sample& sample) {
+            if (sample.time < from) return true;
+            if (sample.time > to) return false;
+            visited++;
+            stopped = !visitor(sample, context);
+            return !stopped;
+        });
+        return !stopped;
+    });
+    return visited;
+}
+
+bool TemperatureLog::summarize(uint32_t from, uint32_t to, Summary& summary) {
+    uint32_t count = 0;
+    int16_t minimum = INT16_MAX;
+    int16_t maximum = INT16_MIN;
+    int64_t sum = 0;
+    uint8_t buffer[FLASH_PAGE_SIZE];
+
+    forEachBlock(from, to, [&](const BlockHeader& header, uint32_t address) {
+        // Blocks inside the range are summed from their headers alone; a
+        // header that contradicts itself gets its CRC checked below
+        if (header.firstTime >= from && header.lastTime <= to && headerConsistent(header)) {
+            count += header.count;
+            minimum = min(minimum, header.minValue);
+            maximum = max(maximum, header.maxValue);
+            sum += header.sum;
+            return true;
+        }
+
+        const uint8_t* block = m_block;
+        if (address != 0) {
+            if (!m_flash.read(address, buffer, sizeof(buffer))) return false;
+            m_stats.blocksDecoded++;
+            if (blockCrc(buffer) != reinterpret_cast<const BlockHeader*>(buffer)->crc) {
+                m_stats.corruptBlocks++;
+                return true;
+            }
+            block = buffer;
+        }
+
+        decodeBlock(block, [&](const Sample& sample) {
+            if (sample.time < from) return true;
+            if (sample.time > to) return false;
+            count++;
+            minimum = min(minimum, sample.deciCelsius);
+            maximum = max(maximum, sample.deciCelsius);
+            sum += sample.deciCelsius;
+            return true;
+        });
+        return true;
+    });
+
+    summary.count = count;
+    if (count == 0) {
+        summary.minimum = summary.maximum = summary.mean = 0;
+        return false;
+    }
+    summary.minimum = minimum / 10.0f;
+    summary.maximum = maximum / 10.0f;
+    summary.mean = (float)sum / count / 10.0f;
+    return true;
+}
@@ -0,0 +1,80 @@
+#include "TouchCalibration.h"
+
+static const char* const KEY_TOUCH_CALIBRATION = "touch.cal";
+static constexpr uint8_t MATRIX_BITS = 16;
+static constexpr int64_t MATRIX_ONE = 1 << MATRIX_BITS;
+
+// Nominal panel span: raw counts at the screen's left/top and right/bottom
+static constexpr int32_t NOMINAL_RAW_START = 3800;
+static constexpr int32_t NOMINAL_RAW_END = 200;
+
+// One row of the map, solved by Cramer's rule: the coefficients that take
+// (rx[i], ry[i], 1) to out[i]
+static bool solveRow(const TouchPoint raw[3], const int16_t out[3], int32_t row[3]) {
+    int64_t x1 = raw[0].x, x2 = raw[1].x, x3 = raw[2].x;
+    int64_t y1 = raw[0].y, y2 = raw[1].y, y3 = raw[2].y;
+    int64_t det = x1 * (y2 - y3) - x2 * (y1 - y3) + x3 * (y1 - y2);
+    if (det == 0) return false;
+    
+    int64_t a = out[0] * (y2 - y3) - out[1] * (y1 - y3) + out[2] * (y1 - y2);
+    int64_t b = x1 * (out[1] - out[2]) - x2 * (out[0] - out[2]) + x3 * (out[0] - out[1]);
+    int64_t c = x1 * (y2 * out[2] - y3 * out[1]) - x2 * (y1 * out[2] - y3 * out[0]) +
+                x3 * (y1 * out[1] - y2 * out[0]);
+    row[0] = (int32_t)(a * MATRIX_ONE / det);
+    row[1] = (int32_t)(b * MATRIX_ONE / det);
+    row[2] = (int32_t)(c * MATRIX_ONE / det);
+    return true;
+}
+
+TouchCalibration::TouchCalibration() {
+    reset();
+}
+
+void TouchCalibration::reset() {
+    // Screen = (raw - start) * size / (end - start) per axis
+    const int64_t span = NOMINAL_RAW_END - NOMINAL_RAW_START;
+    const int64_t fractionSpan = span * (1 << TouchFilter::FRACTION_BITS);
+    m_matrix[0] = (int32_t)(320 * MATRIX_ONE / fractionSpan);
+    m_matrix[1] = 0;
+    m_matrix[2] = (int32_t)(-NOMINAL_RAW_START * 320 * MATRIX_ONE / span);
+    m_matrix[3] = 0;
+    m_matrix[4] = (int32_t)(240 * MATRIX_ONE / fractionSpan);
+    m_matrix[5] = (int32_t)(-NOMINAL_RAW_START * 240 * MATRIX_ONE / span);
+}
+
+bool TouchCalibration::solve(const TouchPoint raw[POINTS], const int16_t screenX[POINTS],
+                             const int16_t screenY[POINTS]) {
+    int32_t matrix[6];
+    if (!solveRow(raw, screenX, matrix) || !solveRow(raw, screenY, matrix + 3)) {
+        return false;
+    }
+    memcpy(m_matrix, matrix, sizeof(m_matrix));
+    return true;
+}
+
+void TouchCalibration::apply(const TouchPoint& raw, int16_t& x, int16_t& y) const {
+    // Rounded to the nearest pixel
+    int64_t sx = (int64_t)m_matrix[0] * raw.x + (int64_t)m_matrix[1] * raw.y + m_matrix[2] + MATRIX_ONE / 2;
+    int64_t sy = (int64_t)m_matrix[3] * raw.x + (int64_t)m_matrix[4] * raw.y + m_matrix[5] + MATRIX_ONE / 2;
+    x = (int16_t)(sx >> MATRIX_BITS);
+    y = (int16_t)(sy >> MATRIX_BITS);
+}
+
+bool TouchCalibration::load(FlashKVStore& settings) {
+    int32_t matrix[6];
+    if (settings.get(KEY_TOUCH_CALIBRATION, matrix, sizeof(matrix)) != (int32_t)sizeof(matrix)) {
+        return false;
+    }
+    memcpy(m_matrix, matrix, sizeof(m_matrix));
+    return true;
+}
+
+bool TouchCalibration::save(FlashKVStore& settings) const {
+    return settings.put(KEY_TOUCH_CALIBRATION, m_matrix, sizeof(m_matrix));
+}
+
+void TouchCalibration::print() const {
+    Serial.printf("Touch calibration (1/65536): x = %ld rx %+ld ry %+ld, y = %ld rx %+ld ry %+ld\n",
+                  (long)m_matrix[0], (long)m_matrix[1], (long)m_matrix[2],
+                  (long)m_matrix[3], (long)m_matrix[4], (long)m_matrix[5]);
+}
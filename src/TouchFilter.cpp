@@ -0,0 +1,112 @@
+#include "TouchFilter.h"
+
+// 10^9 / (2 pi): a cutoff in mHz to the filter's time constant in us
+static constexpr uint32_t MICROS_PER_RADIAN_MHZ = 159154943;
+
+TouchFilter::TouchFilter(bool smoothing)
+    : m_smoothing(smoothing)
+    , m_pressed(false)
+    , m_lastMicros(0)
+    , m_rawNext(0)
+    , m_rawCount(0)
+    , m_medianNext(0)
+    , m_medianCount(0)
+    , m_point{0, 0} {
+    m_euroX.reset();
+    m_euroY.reset();
+}
+
+void TouchFilter::reset() {
+    m_pressed = false;
+    m_rawNext = 0;
+    m_rawCount = 0;
+    m_medianNext = 0;
+    m_medianCount = 0;
+    m_euroX.reset();
+    m_euroY.reset();
+}
+
+bool TouchFilter::add(const TouchSample& sample, TouchPoint& point) {
+    if (sample.z == 0) {
+        reset();
+        return false;
+    }
+    if (sample.z < MIN_PRESSURE) {
+        point = m_point;
+        return m_pressed;
+    }
+    
+    bool first = m_rawCount == 0;
+    m_rawX[m_rawNext] = sample.x;
+    m_rawY[m_rawNext] = sample.y;
+    m_rawNext = (m_rawNext + 1) % MEDIAN_SAMPLES;
+    if (m_rawCount < MEDIAN_SAMPLES) m_rawCount++;
+    
+    m_medianX[m_medianNext] = median(m_rawX, m_rawCount);
+    m_medianY[m_medianNext] = median(m_rawY, m_rawCount);
+    m_pressure[m_medianNext] = sample.z;
+    m_medianNext = (m_medianNext + 1) % AVERAGE_SAMPLES;
+    if (m_medianCount < AVERAGE_SAMPLES) m_medianCount++;
+    
+    int64_t sumX = 0, sumY = 0, weight = 0;
+    for (uint8_t i = 0; i < m_medianCount; i++) {
+        sumX += (int64_t)m_medianX[i] * m_pressure[i];
+        sumY += (int64_t)m_medianY[i] * m_pressure[i];
+        weight += m_pressure[i];
+    }
+    TouchPoint averaged = {(int32_t)((sumX << FRACTION_BITS) / weight), (int32_t)((sumY << FRACTION_BITS) / weight)};
+    
+    if (m_smoothing) {
+        uint32_t elapsed = first ? 1 : max<uint32_t>(sample.micros - m_lastMicros, 1);
+        averaged.x = m_euroX.filter(averaged.x, elapsed);
+        averaged.y = m_euroY.filter(averaged.y, elapsed);
+    }
+    
+    m_lastMicros = sample.micros;
+    m_pressed = true;
+    m_point = averaged;
+    point = averaged;
+    return true;
+}
+
+int16_t TouchFilter::median(const int16_t* values, uint8_t count) {
+    // Insertion sort of at most MEDIAN_SAMPLES values
+    int16_t sorted[MEDIAN_SAMPLES];
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > values[i]) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = values[i];
+    }
+    return sorted[count / 2];
+}
+
+int32_t TouchFilter::OneEuro::filter(int32_t value, uint32_t elapsedMicros) {
+    if (!m_started) {
+        m_started = true;
+        m_value = value;
+        m_speed = 0;
+        return value;
+    }
+    
+    int32_t speed = (int32_t)((int64_t)(value - m_value) * 1000000 / elapsedMicros);
+    m_speed += blend(speed - m_speed, alpha(SPEED_CUTOFF_MHZ, elapsedMicros));
+    
+    // Faster moves get a higher cutoff, so less lag
+    uint32_t countsPerSecond = (uint32_t)abs(m_speed) >> FRACTION_BITS;
+    uint32_t cutoff = MIN_CUTOFF_MHZ + (uint32_t)((uint64_t)BETA_MHZ * countsPerSecond / 1000);
+    m_value += blend(value - m_value, alpha(cutoff, elapsedMicros));
+    return m_value;
+}
+
+uint32_t TouchFilter::OneEuro::alpha(uint32_t cutoffMilliHz, uint32_t elapsedMicros) {
+    // Smoothing factor Te / (Te + tau) in Q16, tau = 1 / (2 pi fc)
+    uint32_t tau = MICROS_PER_RADIAN_MHZ / cutoffMilliHz;
+    return (uint32_t)(((uint64_t)elapsedMicros << 16) / (elapsedMicros + tau));
+}
+
+int32_t TouchFilter::OneEuro::blend(int32_t difference, uint32_t alpha) {
+    return (int32_t)(((int64_t)difference * alpha + 0x8000) >> 16);
+}
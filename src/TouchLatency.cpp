@@ -0,0 +1,101 @@
+#include "TouchLatency.h"
+
+#if TOUCH_LATENCY
+// Upper bounds of the histogram buckets; the last one takes the rest
+static const uint32_t BUCKET_LIMITS_US[TouchLatency::BUCKET_COUNT - 1] = {
+    1000, 2000, 4000, 8000, 12000, 16000, 24000, 32000, 48000, 64000, 100000
+};
+
+TouchLatency::Histogram TouchLatency::s_stages[TouchLatency::STAGE_COUNT] = {};
+bool TouchLatency::s_pending = false;
+bool TouchLatency::s_sent = false;
+uint32_t TouchLatency::s_acquiredMicros = 0;
+uint32_t TouchLatency::s_dispatchedMicros = 0;
+
+void TouchLatency::dispatched(uint32_t acquiredMicros) {
+    uint32_t now = micros();
+    record(STAGE_DISPATCH, now - acquiredMicros);
+    if (!s_pending) {
+        s_pending = true;
+        s_sent = false;
+        s_acquiredMicros = acquiredMicros;
+        s_dispatchedMicros = now;
+    }
+}
+
+void TouchLatency::drawn() {
+    if (!s_pending) return;
+    uint32_t now = micros();
+    record(STAGE_DRAW, now - s_dispatchedMicros);
+    record(STAGE_PHOTON, now - s_acquiredMicros);
+    s_pending = false;
+}
+
+void TouchLatency::sent() {
+    if (!s_pending || s_sent) return;
+    record(STAGE_SEND, micros() - s_acquiredMicros);
+    s_sent = true;
+}
+
+void TouchLatency::endFrame() {
+    s_pending = false;
+}
+
+void TouchLatency::record(Stage stage, uint32_t micros) {
+    Histogram& histogram = s_stages[stage];
+    uint8_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && micros >= BUCKET_LIMITS_US[bucket]) bucket++;
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.totalMicros += micros;
+    histogram.maxMicros = max(histogram.maxMicros, micros);
+}
+
+uint32_t TouchLatency::percentileBound(const Histogram& histogram, uint8_t p) {
+    uint32_t rank = (histogram.count * p + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t bucket = 0; bucket < BUCKET_COUNT - 1; bucket++) {
+        seen += histogram.buckets[bucket];
+        if (seen >= rank) return min(BUCKET_LIMITS_US[bucket], histogram.maxMicros);
+    }
+    return histogram.maxMicros;
+}
+
+void TouchLatency::reset() {
+    memset(s_stages, 0, sizeof(s_stages));
+    s_pending = false;
+}
+
+const char* TouchLatency::stageName(Stage stage) {
+    switch (stage) {
+        case STAGE_DISPATCH: return "dispatch";
+        case STAGE_DRAW:     return "draw";
+        case STAGE_PHOTON:   return "photon";
+        case STAGE_SEND:     return "send";
+        case STAGE_COUNT:    break;
+    }
+    return "?";
+}
+
+void TouchLatency::print() {
+    // Percentiles are the upper bounds of the buckets they fall in
+    Serial.println(F("Touch latency from the sample read off the panel, ms"));
+    Serial.println(F("stage     count   mean  p50<=  p90<=  p99<=    max | "
+                     " <1  <2  <4  <8 <12 <16 <24 <32 <48 <64 <100 100+"));
+
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        const Histogram& histogram = s_stages[i];
+        if (histogram.count == 0) {
+            continue;
+        }
+        Serial.printf("%-8s %6lu %6.1f %6.1f %6.1f %6.1f %6.1f |", stageName((Stage)i),
+                      (unsigned long)histogram.count, histogram.totalMicros / 1000.0 / histogram.count,
+                      percentileBound(histogram, 50) / 1000.0, percentileBound(histogram, 90) / 1000.0,
+                      percentileBound(histogram, 99) / 1000.0, histogram.maxMicros / 1000.0);
+        for (uint32_t count : histogram.buckets) {
+            Serial.printf(" %3lu", (unsigned long)count);
+        }
+        Serial.println();
+    }
+}
+#endif
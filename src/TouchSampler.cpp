@@ -0,0 +1,102 @@
+#include "TouchSampler.h"
+
+TouchSampler::TouchSampler(XPT2046_Touchscreen& touchscreen, uint8_t irqPin)
+    : m_touchscreen(touchscreen)
+    , m_irqPin(irqPin)
+    , m_task(nullptr)
+    , m_ring()
+    , m_head(0)
+    , m_tail(0)
+    , m_dropped(0)
+    , m_armed(false) {
+}
+
+bool TouchSampler::begin() {
+    if (m_task) {
+        return true;
+    }
+    
+    // GPIO 36 is input only; the board pulls PENIRQ up
+    pinMode(m_irqPin, INPUT);
+    if (xTaskCreatePinnedToCore(taskEntry, "touch", TASK_STACK_SIZE, this,
+                                TASK_PRIORITY, &m_task, TASK_CORE) != pdPASS) {
+        Serial.println(F("Touch sampler task creation failed"));
+        m_task = nullptr;
+        return false;
+    }
+    attachInterruptArg(digitalPinToInterrupt(m_irqPin), onPenDown, this, FALLING);
+    return true;
+}
+
+bool TouchSampler::read(TouchSample& sample) {
+    uint8_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    sample = m_ring[tail & (RING_SIZE - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool TouchSampler::push(const TouchSample& sample) {
+    uint8_t head = m_head.load(std::memory_order_relaxed);
+    if ((uint8_t)(head - m_tail.load(std::memory_order_acquire)) >= RING_SIZE) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_ring[head & (RING_SIZE - 1)] = sample;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void IRAM_ATTR TouchSampler::onPenDown(void* context) {
+    TouchSampler* sampler = static_cast<TouchSampler*>(context);
+    if (!sampler->m_armed.exchange(false)) {
+        return;
+    }
+    
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(sampler->m_task, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void TouchSampler::taskEntry(void* param) {
+    static_cast<TouchSampler*>(param)->run();
+}
+
+void TouchSampler::run() {
+    for (;;) {
+        // A press that started before the interrupt was armed left no edge
+        // to wake on, so check the line once armed
+        m_armed.store(true);
+        if (digitalRead(m_irqPin) == HIGH) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        m_armed.store(false);
+        samplePress();
+    }
+}
+
+void TouchSampler::samplePress() {
+    TouchSample last = {};
+    bool pressed = false;
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        TS_Point point = m_touchscreen.getPoint();
+        if (point.z > 0) {
+            last = TouchSample{(uint32_t)micros(), point.x, point.y, (uint16_t)point.z};
+            push(last);
+            pressed = true;
+        } else {
+            // Too light to read, or lifted: nothing to report if the press
+            // never registered, else the release at the last position
+            if (!pressed) return;
+            last.micros = micros();
+            last.z = 0;
+            if (push(last)) return;
+        }
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
+    }
+}
@@ -0,0 +1,139 @@
+#include "TouchTrace.h"
+
+TouchTrace::TouchTrace(Flash25Q128JV& flash, uint32_t address, uint32_t size)
+    : m_flash(flash)
+    , m_address(address)
+    , m_size(size)
+    , m_header{}
+    , m_recording(false)
+    , m_last{}
+    , m_buffered(0)
+    , m_writeAddress(0) {
+}
+
+bool TouchTrace::begin() {
+    m_recording = false;
+    Header header;
+    if (!m_flash.read(m_address, reinterpret_cast<uint8_t*>(&header), sizeof(header)) || !isValid(header) ||
+        header.count > capacity()) {
+        m_header = Header{};
+        return false;
+    }
+    m_header = header;
+    return true;
+}
+
+bool TouchTrace::isValid(const Header& header) {
+    return header.magic == MAGIC && header.version == VERSION && header.recordSize == sizeof(TouchRecord);
+}
+
+bool TouchTrace::startRecording() {
+    m_recording = false;
+    m_header = Header{};
+    if (!m_flash.eraseRange(m_address, m_size)) {
+        return false;
+    }
+    m_header.magic = MAGIC;
+    m_header.version = VERSION;
+    m_header.recordSize = sizeof(TouchRecord);
+    m_buffered = 0;
+    m_writeAddress = m_address + sizeof(Header);
+    m_last = TouchRecord{};
+    m_recording = true;
+    return true;
+}
+
+bool TouchTrace::append(const TouchRecord& record) {
+    if (!m_recording || m_header.count >= capacity()) return false;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (uint8_t i = 0; i < sizeof(record); i++) {
+        m_buffer[m_buffered++] = bytes[i];
+        // The buffer ends where the page being filled does
+        if ((m_writeAddress + m_buffered) % FLASH_PAGE_SIZE == 0 && !flushBuffer()) {
+            m_recording = false;
+            return false;
+        }
+    }
+
+    if (m_header.count == 0) {
+        m_header.durationMicros = 0;
+        m_last.micros = record.micros;
+    }
+    m_header.durationMicros += record.micros - m_last.micros;
+    m_header.count++;
+    m_last = record;
+    return true;
+}
+
+bool TouchTrace::stopRecording() {
+    if (!m_recording) return false;
+    if (m_last.z != 0) {
+        TouchRecord lift = m_last;
+        lift.z = 0;
+        append(lift);
+    }
+    m_recording = false;
+
+    // The header goes in last: a trace cut short by a reset reads as none
+    return flushBuffer() &&
+           m_flash.write(m_address, reinterpret_cast<const uint8_t*>(&m_header), sizeof(m_header));
+}
+
+bool TouchTrace::read(uint32_t index, TouchRecord& record) {
+    if (index >= count()) return false;
+    uint32_t address = m_address + sizeof(Header) + index * sizeof(TouchRecord);
+    return m_flash.read(address, reinterpret_cast<uint8_t*>(&record), sizeof(record));
+}
+
+bool TouchTrace::flushBuffer() {
+    if (m_buffered == 0) return true;
+    bool ok = m_flash.write(m_writeAddress, m_buffer, m_buffered);
+    m_writeAddress += m_buffered;
+    m_buffered = 0;
+    return ok;
+}
+
+// TouchReplayer implementation
+TouchReplayer::TouchReplayer()
+    : m_trace(nullptr)
+    , m_index(0)
+    , m_speed(1)
+    , m_startMicros(0)
+    , m_firstMicros(0)
+    , m_pending{}
+    , m_hasPending(false) {
+}
+
+bool TouchReplayer::start(TouchTrace& trace, uint8_t speed, uint32_t nowMicros) {
+    TouchRecord first;
+    if (!trace.read(0, first)) return false;
+    m_trace = &trace;
+    m_index = 0;
+    m_speed = max<uint8_t>(speed, 1);
+    m_startMicros = nowMicros;
+    m_firstMicros = first.micros;
+    m_hasPending = false;
+    return true;
+}
+
+bool TouchReplayer::next(uint32_t nowMicros, TouchRecord& record) {
+    if (!m_trace) return false;
+    if (!m_hasPending) {
+        if (!m_trace->read(m_index, m_pending)) {
+            m_trace = nullptr;
+            return false;
+        }
+        m_index++;
+        m_pending.micros = m_startMicros + (m_pending.micros - m_firstMicros) / m_speed;
+        m_hasPending = true;
+    }
+    // Due when the replay clock has reached it
+    if ((int32_t)(nowMicros - m_pending.micros) < 0) return false;
+    record = m_pending;
+    m_hasPending = false;
+    if (m_index >= m_trace->count()) {
+        m_trace = nullptr;
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+#include "UiProfiler.h"
+
+#if UI_PROFILE
+#include "DamageTracker.h"
+
+static const ScreenRect UNCLIPPED = {0, 0, INT16_MAX, INT16_MAX};
+
+// Upper bounds of the histogram buckets; the last one takes the rest
+static const uint32_t BUCKET_LIMITS_US[UiProfiler::BUCKET_COUNT - 1] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000
+};
+
+UiProfiler::Section UiProfiler::s_current = UiProfiler::SECTION_OTHER;
+uint8_t UiProfiler::s_depth = 0;
+ScreenRect UiProfiler::s_clip = UNCLIPPED;
+UiProfiler::Counters UiProfiler::s_frame[UiProfiler::SECTION_COUNT] = {};
+UiProfiler::Totals UiProfiler::s_totals[UiProfiler::SECTION_COUNT] = {};
+uint32_t UiProfiler::s_frames = 0;
+
+UiProfiler::Scope::Scope(Section section)
+    : m_previous(s_current)
+    , m_start(micros()) {
+    s_current = section;
+}
+
+UiProfiler::Scope::~Scope() {
+    s_frame[s_current].micros += micros() - m_start;
+    s_current = m_previous;
+}
+
+void UiProfiler::Primitive::count(int32_t x, int32_t y, int32_t w, int32_t h, bool onBus) {
+    if (!m_outermost) {
+        return;
+    }
+    Counters& frame = s_frame[s_current];
+    frame.calls++;
+
+    // Coordinates are screen coordinates on every canvas
+    ScreenRect drawn = ScreenRect{(int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h}.intersected(s_clip);
+    frame.pixels += drawn.area();
+    if (onBus && !drawn.empty()) {
+        frame.busBytes += drawn.area() * 2 + DamageTracker::WINDOW_OVERHEAD_BYTES;
+    }
+}
+
+void UiProfiler::resetClip() {
+    s_clip = UNCLIPPED;
+}
+
+void UiProfiler::addBusBytes(uint32_t bytes) {
+    s_frame[s_current].busBytes += bytes;
+}
+
+void UiProfiler::endFrame() {
+    bool drew = false;
+    for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+        Counters& frame = s_frame[i];
+        // Time spent in a section that drew nothing is dropped with the frame
+        if (frame.calls == 0 && frame.busBytes == 0) {
+            frame = Counters{};
+            continue;
+        }
+
+        Totals& totals = s_totals[i];
+        totals.frames++;
+        totals.calls += frame.calls;
+        totals.pixels += frame.pixels;
+        totals.busBytes += frame.busBytes;
+        totals.window[totals.windowNext] = frame.micros;
+        totals.windowNext = (totals.windowNext + 1) % WINDOW_FRAMES;
+        totals.windowCount = min<uint8_t>(totals.windowCount + 1, WINDOW_FRAMES);
+        frame = Counters{};
+        drew = true;
+    }
+    if (drew) {
+        s_frames++;
+    }
+}
+
+void UiProfiler::reset() {
+    memset(s_frame, 0, sizeof(s_frame));
+    memset(s_totals, 0, sizeof(s_totals));
+    s_frames = 0;
+}
+
+const char* UiProfiler::sectionName(Section section) {
+    switch (section) {
+        case SECTION_OTHER:          return "other";
+        case SECTION_BACKGROUND:     return "background";
+        case SECTION_HEADER:         return "header";
+        case SECTION_SLIDERS:        return "sliders";
+        case SECTION_TEMPERATURE:    return "temperature";
+        case SECTION_MENU:           return "menu";
+        case SECTION_POMODORO_SETUP: return "pomodoro setup";
+        case SECTION_POMODORO_TIMER: return "pomodoro timer";
+        case SECTION_CLOCK:          return "glyph clocks";
+        case SECTION_BAND_PUSH:      return "band push";
+        case SECTION_COUNT:          break;
+    }
+    return "?";
+}
+
+void UiProfiler::print() {
+    Serial.printf("UI profile, %lu frames drawn. Counts are per frame the caller drew in; "
+                  "times over its last %u such frames.\n", (unsigned long)s_frames, WINDOW_FRAMES);
+    Serial.println(F("caller           frames  calls  pixels  bus B |  p50 us  p90 us  max us | "
+                     "<.1 <.2 <.5  <1  <2  <5 <10 <20 <50 50+ ms"));
+
+    for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+        const Totals& totals = s_totals[i];
+        if (totals.frames == 0) {
+            continue;
+        }
+
+        // Percentiles and histogram over the rolling window
+        uint32_t sorted[WINDOW_FRAMES];
+        uint8_t buckets[BUCKET_COUNT] = {};
+        for (uint8_t n = 0; n < totals.windowCount; n++) {
+            uint32_t us = totals.window[n];
+            uint8_t bucket = 0;
+            while (bucket < BUCKET_COUNT - 1 && us >= BUCKET_LIMITS_US[bucket]) bucket++;
+            buckets[bucket]++;
+
+            // Insertion sort; the window is small
+            uint8_t at = n;
+            while (at > 0 && sorted[at - 1] > us) {
+                sorted[at] = sorted[at - 1];
+                at--;
+            }
+            sorted[at] = us;
+        }
+        uint8_t count = totals.windowCount;
+
+        Serial.printf("%-16s %6lu %6lu %7lu %6lu | %7lu %7lu %7lu |",
+                      sectionName((Section)i), (unsigned long)totals.frames,
+                      (unsigned long)(totals.calls / totals.frames), (unsigned long)(totals.pixels / totals.frames),
+                      (unsigned long)(totals.busBytes / totals.frames), (unsigned long)sorted[count / 2],
+                      (unsigned long)sorted[(count * 9) / 10], (unsigned long)sorted[count - 1]);
+        for (uint8_t bucket : buckets) {
+            Serial.printf(" %3u", bucket);
+        }
+        Serial.println();
+    }
+}
+#endif
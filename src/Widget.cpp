@@ -0,0 +1,307 @@
+#include "Widget.h"
+
+#include <algorithm>
+
+// Index of the last of 'count' sorted values that is <= key, -1 if none
+static int lastAtOrBefore(const int16_t* values, uint16_t count, int16_t key) {
+    return (int)(std::upper_bound(values, values + count, key) - values) - 1;
+}
+
+// Inserts 'value' into the sorted values unless it is there already
+static void insertEdge(int16_t* values, uint8_t& count, int16_t value) {
+    uint8_t i = count;
+    while (i > 0 && values[i - 1] > value) {
+        i--;
+    }
+    if (i > 0 && values[i - 1] == value) return;
+    memmove(values + i + 1, values + i, (count - i) * sizeof(values[0]));
+    values[i] = value;
+    count++;
+}
+
+// Widget implementation
+Widget::Widget(const ScreenRect& bounds, uint8_t tag)
+    : m_bounds(bounds)
+    , m_hitArea(bounds)
+    , m_damageCount(0)
+    , m_tree(nullptr)
+    , m_tag(tag)
+    , m_visible(true)
+    , m_touchable(false)
+    , m_static(true) {
+}
+
+void Widget::setVisible(bool visible) {
+    if (visible == m_visible) return;
+    m_visible = visible;
+    // Shown it paints itself, hidden the background shows through
+    invalidate();
+    if (m_tree) m_tree->m_indexStale = true;
+}
+
+void Widget::setTouchable(bool touchable) {
+    m_touchable = touchable;
+    if (m_tree) m_tree->m_indexStale = true;
+}
+
+void Widget::setHitArea(const ScreenRect& area) {
+    m_hitArea = area;
+    if (m_tree) m_tree->m_indexStale = true;
+}
+
+void Widget::invalidate(const ScreenRect& area) {
+    if (area.empty()) return;
+    if (m_damageCount < MAX_DAMAGE_RECTS) {
+        m_damage[m_damageCount++] = area;
+        return;
+    }
+
+    uint8_t best = 0;
+    uint32_t bestArea = UINT32_MAX;
+    for (uint8_t i = 0; i < m_damageCount; i++) {
+        uint32_t merged = m_damage[i].united(area).area();
+        if (merged < bestArea) {
+            best = i;
+            bestArea = merged;
+        }
+    }
+    m_damage[best] = m_damage[best].united(area);
+}
+
+void Widget::drawStatic(TFT_eSPI& gfx) {
+    if (m_static) draw(gfx);
+}
+
+void Widget::drawOverlay(TFT_eSPI& gfx) {
+    if (!m_static) draw(gfx);
+}
+
+TFT_eSPI* Widget::display() const {
+    return m_tree ? &m_tree->display() : nullptr;
+}
+
+// Button implementation
+Button::Button(const ScreenRect& bounds, const char* label, uint16_t color, uint8_t tag)
+    : Widget(bounds, tag)
+    , m_label(label)
+    , m_color(color) {
+    setTouchable(true);
+}
+
+void Button::setLabel(const char* label) {
+    if (strcmp(label, m_label) == 0) return;
+    m_label = label;
+    invalidate();
+}
+
+void Button::setColor(uint16_t color) {
+    if (color == m_color) return;
+    m_color = color;
+    invalidate();
+}
+
+void Button::draw(TFT_eSPI& gfx) {
+    const ScreenRect& area = bounds();
+    gfx.fillRoundRect(area.x, area.y, area.w, area.h, 5, m_color);
+    gfx.setTextColor(TFT_BLACK);
+    gfx.setTextDatum(MC_DATUM);
+    gfx.drawString(m_label, area.x + area.w/2, area.y + area.h/2, 2);
+}
+
+// Label implementation
+Label::Label(const ScreenRect& bounds, int16_t x, int16_t y, uint8_t datum, uint8_t font, uint16_t color,
+             const String& text)
+    : Widget(bounds)
+    , m_x(x)
+    , m_y(y)
+    , m_datum(datum)
+    , m_font(font)
+    , m_color(color)
+    , m_text(text) {
+}
+
+void Label::setText(const String& text) {
+    if (text == m_text) return;
+    TFT_eSPI* tft = display();
+    if (tft) {
+        invalidate(DamageTracker::textChange(*tft, m_text, text, m_x, m_y, m_datum, m_font));
+    } else {
+        invalidate();
+    }
+    m_text = text;
+}
+
+void Label::setColor(uint16_t color) {
+    if (color == m_color) return;
+    m_color = color;
+    invalidate();
+}
+
+void Label::draw(TFT_eSPI& gfx) {
+    gfx.setTextColor(m_color);
+    gfx.setTextDatum(m_datum);
+    gfx.drawString(m_text, m_x, m_y, m_font);
+}
+
+// ProgressBar implementation
+ProgressBar::ProgressBar(const ScreenRect& bounds, uint16_t trackColor, uint16_t fillColor)
+    : Widget(bounds)
+    , m_trackColor(trackColor)
+    , m_fillColor(fillColor)
+    , m_fillWidth(0) {
+}
+
+ScreenRect ProgressBar::fillChange(const ScreenRect& bar, int16_t before, int16_t after) {
+    if (before == after) return ScreenRect{0, 0, 0, 0};
+    // Each row of the pill spans [x + r - d, x + w - r + d) for some d <= r,
+    // the middle rows [x, x + w)
+    int16_t left = max<int16_t>(0, min(before, after) - bar.h/2);
+    int16_t right = min<int16_t>(bar.w, max(before, after));
+    return ScreenRect{(int16_t)(bar.x + left), bar.y, (int16_t)(right - left), bar.h};
+}
+
+void ProgressBar::setFillWidth(int16_t width) {
+    width = constrain(width, 0, bounds().w);
+    if (width == m_fillWidth) return;
+    invalidate(fillChange(bounds(), m_fillWidth, width));
+    m_fillWidth = width;
+}
+
+void ProgressBar::setFillColor(uint16_t color) {
+    if (color == m_fillColor) return;
+    m_fillColor = color;
+    invalidate();
+}
+
+void ProgressBar::draw(TFT_eSPI& gfx) {
+    drawStatic(gfx);
+    drawOverlay(gfx);
+}
+
+void ProgressBar::drawStatic(TFT_eSPI& gfx) {
+    const ScreenRect& bar = bounds();
+    gfx.fillRoundRect(bar.x, bar.y, bar.w, bar.h, bar.h/2, m_trackColor);
+}
+
+void ProgressBar::drawOverlay(TFT_eSPI& gfx) {
+    const ScreenRect& bar = bounds();
+    if (m_fillWidth > 0) {
+        gfx.fillRoundRect(bar.x, bar.y, m_fillWidth, bar.h, bar.h/2, m_fillColor);
+    }
+}
+
+// WidgetTree implementation
+WidgetTree::WidgetTree(TFT_eSPI& tft)
+    : m_tft(tft)
+    , m_count(0)
+    , m_indexStale(true)
+    , m_edgeCount(0)
+    , m_runCount(0) {
+}
+
+bool WidgetTree::add(Widget& widget) {
+    if (m_count >= MAX_WIDGETS) return false;
+    widget.m_tree = this;
+    m_widgets[m_count++] = &widget;
+    m_indexStale = true;
+    return true;
+}
+
+Widget* WidgetTree::hitTest(int16_t x, int16_t y) {
+    if (m_indexStale) {
+        rebuildIndex();
+    }
+
+    int slab = lastAtOrBefore(m_slabTop, m_edgeCount, y);
+    if (slab < 0 || slab >= m_edgeCount - 1) return nullptr;
+
+    uint16_t first = m_slabRuns[slab];
+    int run = lastAtOrBefore(m_runStart + first, m_slabRuns[slab + 1] - first, x);
+    if (run < 0) return nullptr;
+
+    uint8_t owner = m_runWidget[first + run];
+    return owner == NO_WIDGET ? nullptr : m_widgets[owner];
+}
+
+void WidgetTree::rebuildIndex() {
+    m_indexStale = false;
+    m_edgeCount = 0;
+    m_runCount = 0;
+
+    uint8_t targets[MAX_TARGETS];
+    uint8_t targetCount = 0;
+    for (uint8_t i = 0; i < m_count && targetCount < MAX_TARGETS; i++) {
+        const Widget& widget = *m_widgets[i];
+        if (widget.m_visible && widget.m_touchable && !widget.m_hitArea.empty()) {
+            targets[targetCount++] = i;
+            insertEdge(m_slabTop, m_edgeCount, widget.m_hitArea.y);
+            insertEdge(m_slabTop, m_edgeCount, widget.m_hitArea.bottom());
+        }
+    }
+
+    for (uint8_t slab = 0; slab + 1 < m_edgeCount; slab++) {
+        m_slabRuns[slab] = m_runCount;
+        int16_t top = m_slabTop[slab];
+
+        // Vertical edges of the targets crossing this slab
+        int16_t edges[MAX_EDGES];
+        uint8_t edgeCount = 0;
+        for (uint8_t t = 0; t < targetCount; t++) {
+            const ScreenRect& area = m_widgets[targets[t]]->m_hitArea;
+            if (area.y <= top && top < area.bottom()) {
+                insertEdge(edges, edgeCount, area.x);
+                insertEdge(edges, edgeCount, area.right());
+            }
+        }
+
+        // Each run belongs to the topmost target covering it; neighbours
+        // with the same owner are merged
+        for (uint8_t e = 0; e < edgeCount; e++) {
+            uint8_t owner = NO_WIDGET;
+            for (int t = targetCount - 1; t >= 0 && e + 1 < edgeCount; t--) {
+                const ScreenRect& area = m_widgets[targets[t]]->m_hitArea;
+                if (area.y <= top && top < area.bottom() && area.x <= edges[e] && edges[e] < area.right()) {
+                    owner = targets[t];
+                    break;
+                }
+            }
+            if (m_runCount > m_slabRuns[slab] && m_runWidget[m_runCount - 1] == owner) continue;
+            m_runStart[m_runCount] = edges[e];
+            m_runWidget[m_runCount] = owner;
+            m_runCount++;
+        }
+    }
+    if (m_edgeCount > 0) {
+        m_slabRuns[m_edgeCount - 1] = m_runCount;
+    }
+}
+
+void WidgetTree::collectDamage(DamageTracker& damage) {
+    for (uint8_t i = 0; i < m_count; i++) {
+        Widget& widget = *m_widgets[i];
+        for (uint8_t d = 0; d < widget.m_damageCount; d++) {
+            damage.add(widget.m_damage[d], widget.m_bounds);
+        }
+        widget.m_damageCount = 0;
+    }
+}
+
+void WidgetTree::clearDamage() {
+    for (uint8_t i = 0; i < m_count; i++) {
+        m_widgets[i]->m_damageCount = 0;
+    }
+}
+
+void WidgetTree::draw(TFT_eSPI& gfx, const ScreenRect& clip, uint8_t layers) {
+    for (uint8_t i = 0; i < m_count; i++) {
+        Widget& widget = *m_widgets[i];
+        if (!widget.m_visible || !clip.intersects(widget.m_bounds)) continue;
+        if (layers == LAYER_ALL) {
+            widget.draw(gfx);
+        } else if (layers == LAYER_STATIC) {
+            widget.drawStatic(gfx);
+        } else if (layers == LAYER_OVERLAY) {
+            widget.drawOverlay(gfx);
+        }
+    }
+}
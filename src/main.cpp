@@ -1,69 +1,251 @@
-#include "CYD.h"
-#include "AudioManager.h"
-#include "SDManager.h"
-#include "config.h"
-
-AudioManager audioManager;
-CYD cyd(audioManager);
-
-SDManager sdManager;
-
-void setup() {
-    Serial.begin(115200);
-    delay(100);
-    
-    // Initialize display and touch first
-    cyd.begin();
-    delay(100);
-    
-    //Initialize SD card after display
-    if (sdManager.begin()) {
-        sdManager.printCardInfo();
-        
-        // Initialize audio and play test sound
-        audioManager.begin();
-        delay(500);
-        for(int i = 0; i < 3; i++) {
-            audioManager.playFile("/beep.mp3");
-            unsigned long startTime = millis();
-            while (millis() - startTime < 500) {
-                audioManager.loop();
-            }
-        }
-    }
-    
-    // // End SD card SPI to free the bus
-    //sdManager.endSPI();
-    delay(100);
-    
-    
-    // Connect to WiFi
-    if (cyd.connectWiFi(WIFI_SSID, WIFI_PASSWORD)) {
-        Serial.println("Connected to WiFi");
-        cyd.setLED(0, 1, 0);
-    } else {
-        Serial.println("Failed to connect to WiFi");
-        cyd.setLED(1, 0, 0);
-    }
-    
-    //audioManager.stop();
-    cyd.drawUI();
-}
-
-void loop() {
-    static unsigned long lastUpdate = 0;
-    unsigned long currentTime = millis();
-    
-    // Update display and handle touch every 20ms
-    if (currentTime - lastUpdate >= 20) {
-        // Only end the main SPI transaction
-        SPI.endTransaction();
-        
-        cyd.update();
-        lastUpdate = currentTime;
-    }
-    audioManager.loop();
-    
-    // Small delay to prevent overwhelming the CPU
-
+#include "CYD.h"
+#include "AudioManager.h"
+#include "SDManager.h"
+#include "Flash25Q128JV.h"
+#include "FlashKVStore.h"
+#include "FlashAssetBank.h"
+#include "FlashAssetFS.h"
+#include "FlashAsyncQueue.h"
+#include "FlashLayout.h"
+#include "TemperatureLog.h"
+#include "TouchTrace.h"
+#include "config.h"
+
+// Packed asset image on the SD card, installed into the flash bank when it differs
+static const char* const ASSET_IMAGE_PATH = "/assets.bin";
+// Touch trace exported to and imported from the SD card, as stored in flash
+static const char* const TOUCH_TRACE_PATH = "/touch.trc";
+
+Flash25Q128JV flash;
+FlashAsyncQueue flashQueue(flash);
+FlashKVStore settings(flash, FLASH_SETTINGS_ADDR, FLASH_SETTINGS_SECTORS);
+FlashAssetBank assetBank(flash, FLASH_ASSETS_ADDR, FLASH_ASSETS_SIZE);
+FlashAssetFS assetFS(assetBank);
+TemperatureLog temperatureLog(flash, FLASH_TEMPLOG_ADDR, FLASH_TEMPLOG_SECTORS);
+TouchTrace touchTrace(flash, FLASH_TOUCH_TRACE_ADDR, FLASH_TOUCH_TRACE_SIZE);
+
+AudioManager audioManager;
+CYD cyd(audioManager, settings, temperatureLog);
+
+SDManager sdManager;
+
+void installAssetsFromSD() {
+    File image = sdManager.openFile(ASSET_IMAGE_PATH);
+    if (!image) {
+        return;
+    }
+    
+    uint8_t buffer[1024];
+    size_t length = image.read(buffer, FlashAssetBank::HEADER_SIZE);
+    if (length < FlashAssetBank::HEADER_SIZE || assetBank.matches(buffer)) {
+        image.close();
+        return;
+    }
+    
+    Serial.println(F("Installing asset bank from SD..."));
+    bool ok = assetBank.beginInstall(image.size()) && assetBank.writeInstall(buffer, length);
+    while (ok && image.available()) {
+        length = image.read(buffer, sizeof(buffer));
+        ok = length > 0 && assetBank.writeInstall(buffer, length);
+    }
+    ok = ok && assetBank.finishInstall();
+    image.close();
+    
+    Serial.println(ok ? F("Asset bank installed") : F("Asset bank install failed"));
+}
+
+bool saveTouchTraceToSD() {
+    if (touchTrace.count() == 0) {
+        return false;
+    }
+    File file = sdManager.createFile(TOUCH_TRACE_PATH);
+    if (!file) {
+        return false;
+    }
+    
+    const TouchTrace::Header& header = touchTrace.header();
+    bool ok = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    TouchRecord record;
+    for (uint32_t i = 0; ok && i < touchTrace.count(); i++) {
+        ok = touchTrace.read(i, record) &&
+             file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+    }
+    file.close();
+    return ok;
+}
+
+bool loadTouchTraceFromSD() {
+    File file = sdManager.openFile(TOUCH_TRACE_PATH);
+    if (!file) {
+        return false;
+    }
+    
+    TouchTrace::Header header;
+    bool ok = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+              TouchTrace::isValid(header) && header.count <= touchTrace.capacity() && touchTrace.startRecording();
+    TouchRecord record;
+    for (uint32_t i = 0; ok && i < header.count; i++) {
+        ok = file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record) &&
+             touchTrace.append(record);
+    }
+    file.close();
+    // A partial import is kept as far as it got; the header makes it whole
+    return touchTrace.stopRecording() && ok;
+}
+
+void printTouchTrace() {
+    const TouchTrace::Header& header = touchTrace.header();
+    Serial.printf("Touch trace: %lu records over %.1f s\n", (unsigned long)touchTrace.count(),
+                  header.durationMicros / 1000000.0);
+}
+
+// Serial console: one command per line
+void runCommand(const String& command) {
+    if (command == "prof") {
+#if UI_PROFILE
+        UiProfiler::print();
+#else
+        Serial.println(F("Profiling is compiled out; build with -DUI_PROFILE=1"));
+#endif
+    } else if (command == "prof reset") {
+#if UI_PROFILE
+        UiProfiler::reset();
+#endif
+    } else if (command == "lat") {
+#if TOUCH_LATENCY
+        TouchLatency::print();
+#else
+        Serial.println(F("Touch latency is compiled out; build with -DTOUCH_LATENCY=1"));
+#endif
+    } else if (command == "lat reset") {
+#if TOUCH_LATENCY
+        TouchLatency::reset();
+#endif
+    } else if (command == "touch cal") {
+        if (!cyd.startTouchCalibration()) {
+            Serial.println(F("Touch calibration runs from the main screen of the hand-drawn UI"));
+        }
+    } else if (command == "touch smooth on" || command == "touch smooth off") {
+        cyd.setTouchSmoothing(command == "touch smooth on");
+    } else if (command == "touch rec") {
+        if (cyd.startTouchRecording(touchTrace)) {
+            Serial.println(F("Recording touches until 'touch stop'"));
+        } else {
+            Serial.println(F("Touch recording needs the flash and the hand-drawn UI"));
+        }
+    } else if (command == "touch stop") {
+        cyd.stopTouchTrace();
+        printTouchTrace();
+    } else if (command.substring(0, 10) == "touch play") {
+        int speed = command.length() > 11 ? command.substring(11).toInt() : 1;
+        if (speed < 1 || speed > 255 || !cyd.startTouchReplay(touchTrace, speed)) {
+            Serial.println(F("Nothing to replay; record with 'touch rec' or 'touch load'"));
+        } else {
+            printTouchTrace();
+        }
+    } else if (command == "touch save") {
+        Serial.println(saveTouchTraceToSD() ? F("Touch trace saved to SD") : F("Touch trace save failed"));
+    } else if (command == "touch load") {
+        cyd.stopTouchTrace();
+        Serial.println(loadTouchTraceFromSD() ? F("Touch trace loaded from SD") : F("Touch trace load failed"));
+    } else {
+        Serial.println(F("Commands: prof, prof reset, lat, lat reset, touch cal, touch smooth on|off, "
+                         "touch rec|stop|play [speed]|save|load"));
+    }
+}
+
+void handleSerialCommands() {
+    static String line;
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r' || c == '\n') {
+            if (line.length() > 0) {
+                runCommand(line);
+            }
+            line = "";
+        } else if (line.length() < 64) {
+            line += c;
+        }
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(100);
+    
+    // Initialize display and touch first
+    cyd.begin();
+    delay(100);
+    
+    // Restore persisted settings; without the flash the defaults are used
+    if (flash.begin()) {
+        // Erases and block programs run on the flash worker from here on,
+        // so the UI loop doesn't stall for them
+        flashQueue.begin();
+        settings.setQueue(&flashQueue);
+        assetBank.setQueue(&flashQueue);
+        temperatureLog.setQueue(&flashQueue);
+        settings.begin();
+        assetBank.begin();
+        temperatureLog.begin();
+        touchTrace.begin();
+    }
+    cyd.loadSettings();
+    
+    //Initialize SD card after display
+    if (sdManager.begin()) {
+        sdManager.printCardInfo();
+        installAssetsFromSD();
+    }
+    assetBank.printInfo();
+    
+    // Initialize audio and play test sound; sounds come from the flash
+    // asset bank, so this works without an SD card too
+    audioManager.setAssetFS(&assetFS);
+    audioManager.begin();
+    delay(500);
+    for(int i = 0; i < 3; i++) {
+        audioManager.playFile("/beep.mp3");
+        unsigned long startTime = millis();
+        while (millis() - startTime < 500) {
+            audioManager.loop();
+        }
+    }
+    
+    // // End SD card SPI to free the bus
+    //sdManager.endSPI();
+    delay(100);
+    
+    
+    // Connect to WiFi, giving up sooner if the network was unreachable last boot
+    uint32_t wifiTimeout = cyd.lastWiFiAttemptFailed() ? 5000 : 20000;
+    if (cyd.connectWiFi(WIFI_SSID, WIFI_PASSWORD, wifiTimeout)) {
+        Serial.println("Connected to WiFi");
+        cyd.setLED(0, 1, 0);
+    } else {
+        Serial.println("Failed to connect to WiFi");
+        cyd.setLED(1, 0, 0);
+    }
+    
+    //audioManager.stop();
+    cyd.drawUI();
+}
+
+void loop() {
+    static unsigned long lastUpdate = 0;
+    unsigned long currentTime = millis();
+    
+    // Update display and handle touch every 16ms, so slider drags follow
+    // the finger at 60Hz
+    if (currentTime - lastUpdate >= 16) {
+        cyd.update();
+        UI_PROFILE_END_FRAME();
+        TOUCH_LATENCY_END_FRAME();
+        lastUpdate = currentTime;
+    }
+    audioManager.loop();
+    handleSerialCommands();
+    
+    // Small delay to prevent overwhelming the CPU
+
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Pack files into a FlashAssetBank image (see include/FlashAssetBank.h).
+
+Each file is stored under "/<file name>", the same path the firmware uses on
+the SD card, so AudioManager::playFile("/beep.mp3") finds it in either place.
+
+    python tools/pack_assets.py assets.bin data/beep.mp3 data/alarm.mp3
+    python tools/pack_assets.py assets.bin data/          # every file in a directory
+
+Copy the image to the root of the SD card as /assets.bin; the firmware
+installs it into the external flash on the next boot when it differs.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x42415359          # "YSAB"
+VERSION = 1
+HEADER_SIZE = 32
+ENTRY_SIZE = 48
+NAME_SIZE = 32
+MAX_ASSETS = 64
+DATA_ALIGNMENT = 256        # one flash page
+BANK_CAPACITY = 0x700000    # FLASH_ASSETS_SIZE in include/FlashLayout.h
+
+
+def collect(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                full = os.path.join(path, name)
+                if os.path.isfile(full):
+                    files.append(full)
+        else:
+            files.append(path)
+    return files
+
+
+def align(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def pack(files):
+    assets = {}
+    for path in files:
+        name = "/" + os.path.basename(path)
+        if len(name.encode()) > NAME_SIZE - 1:
+            sys.exit(f"asset name too long (max {NAME_SIZE - 1} bytes): {name}")
+        if name in assets:
+            sys.exit(f"duplicate asset name: {name}")
+        with open(path, "rb") as f:
+            assets[name] = f.read()
+
+    if len(assets) > MAX_ASSETS:
+        sys.exit(f"too many assets ({len(assets)} > {MAX_ASSETS})")
+
+    # The firmware binary-searches the index with strcmp
+    names = sorted(assets, key=lambda n: n.encode())
+
+    offset = align(HEADER_SIZE + ENTRY_SIZE * len(names), DATA_ALIGNMENT)
+    index = bytearray()
+    data = bytearray()
+    for name in names:
+        blob = assets[name]
+        data += b"\xff" * (offset - HEADER_SIZE - ENTRY_SIZE * len(names) - len(data))
+        index += struct.pack("<32sIIII", name.encode(), offset, len(blob), zlib.crc32(blob), 0)
+        data += blob
+        offset = align(offset + len(blob), DATA_ALIGNMENT)
+
+    image_size = HEADER_SIZE + len(index) + len(data)
+    if image_size > BANK_CAPACITY:
+        sys.exit(f"image is {image_size} bytes, the bank holds {BANK_CAPACITY}")
+
+    header = struct.pack("<IHHII16s", MAGIC, VERSION, len(names), zlib.crc32(bytes(index)),
+                         image_size, b"\xff" * 16)
+    return header + bytes(index) + bytes(data), names, assets
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("output", help="image file to write")
+    parser.add_argument("inputs", nargs="+", help="files or directories to pack")
+    args = parser.parse_args()
+
+    image, names, assets = pack(collect(args.inputs))
+    with open(args.output, "wb") as f:
+        f.write(image)
+
+    for name in names:
+        print(f"  {name:<31} {len(assets[name]):>8} bytes")
+    print(f"{args.output}: {len(names)} assets, {len(image)} bytes")
+
+
+if __name__ == "__main__":
+    main()